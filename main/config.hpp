@@ -85,3 +85,46 @@ static constexpr uint32_t INACTIVITY_TIMEOUT_SEC_ = 60;
 // Sleep duration threshold - if sleep exceeds this, show splash instead of restoring state (seconds)
 static constexpr uint32_t SLEEP_RESET_THRESHOLD_SEC_ = 30 * 60; // 30 minutes
 
+// Minimum time between settings commits to NVS; changes in between are coalesced (ms)
+static constexpr uint32_t SETTINGS_COMMIT_INTERVAL_MS_ = 10000;
+
+// Status streaming: default StatusUpdate period and subscription lease (ms).
+// The lease is renewed at half-time while a device screen is open.
+static constexpr uint16_t STATUS_STREAM_PERIOD_MS_ = 250;
+static constexpr uint16_t STATUS_STREAM_LEASE_MS_  = 5000;
+
+// ConfigRequest retry interval until a device's configuration has been read once (ms)
+static constexpr uint32_t CONFIG_SYNC_RETRY_MS_ = 1000;
+
+// Longest interval between RequestStatus() calls while a device screen is open,
+// independent of the status rate (keeps subscription leases renewed) (ms)
+static constexpr uint32_t STATUS_SERVICE_PERIOD_MS_ = 1000;
+
+// UI loop: longest sleep without input or protocol events (ms). Settings commits,
+// rate control and time sync need no more; render and status periods wake it sooner.
+static constexpr uint32_t UI_IDLE_WAKE_MS_ = 1000;
+
+// UI loop period while a group command collects acks or a time sync round runs (ms)
+static constexpr uint32_t UI_BUSY_WAKE_MS_ = 50;
+
+// List the Link Diagnostics screen (RSSI / loss / RTT per peer) in device selection
+static constexpr bool LINK_DIAGNOSTICS_ENABLED_ = true;
+
+// Slow heartbeat used on menus / when nothing changes on screen (ms)
+static constexpr uint16_t STATUS_HEARTBEAT_MS_ = 5000;
+
+// Fatigue tester status period (ms) per test state and visible screen.
+// Rows are indexed by FatigueTestState: Idle, Running, Paused, Completed, Error.
+struct StatusRateMs {
+    uint16_t control;   // Control screen / popups
+    uint16_t main;      // Main (status) screen
+    uint16_t menu;      // Settings menu
+};
+static constexpr StatusRateMs FATIGUE_STATUS_RATES_[] = {
+    { 1000, 2000, STATUS_HEARTBEAT_MS_ },   // Idle
+    {  200, 1000, STATUS_HEARTBEAT_MS_ },   // Running
+    { 1000, 2000, STATUS_HEARTBEAT_MS_ },   // Paused
+    { 2000, 5000, STATUS_HEARTBEAT_MS_ },   // Completed
+    {  500, 1000, STATUS_HEARTBEAT_MS_ },   // Error
+};
+
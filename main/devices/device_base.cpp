@@ -6,14 +6,19 @@
 #include "device_base.hpp"
 #include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
 #include "../settings.hpp"
+#include "../config.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <cstring>
 
 DeviceBase::DeviceBase(Adafruit_SH1106* display, Settings* settings) noexcept
     : display_(display)
     , settings_(settings)
     , connected_(false)
     , last_status_tick_(0)
+    , visibility_(ScreenVisibility::Hidden)
+    , peer_mac_{}
+    , peer_bound_(false)
 {
 }
 
@@ -27,8 +32,49 @@ void DeviceBase::updateConnectionStatus() noexcept
     }
 }
 
+void DeviceBase::SetVisibility(ScreenVisibility visibility) noexcept
+{
+    if (visibility == visibility_) return;
+    ScreenVisibility previous = visibility_;
+    visibility_ = visibility;
+    onVisibilityChanged(previous);
+}
+
+void DeviceBase::BindPeer(const uint8_t* mac) noexcept
+{
+    peer_bound_ = (mac != nullptr);
+    if (mac) {
+        std::memcpy(peer_mac_, mac, sizeof(peer_mac_));
+    }
+}
+
+bool DeviceBase::isOwnEvent(const espnow::ProtoEvent& event) const noexcept
+{
+    if (event.device_id != GetDeviceId()) return false;
+    if (!peer_bound_) return true;
+
+    static constexpr uint8_t LOCAL_MAC[6] = {};
+    return MacEquals(event.src_mac, peer_mac_) || MacEquals(event.src_mac, LOCAL_MAC);
+}
+
 bool DeviceBase::IsConnected() const noexcept
 {
     return connected_;
 }
 
+uint32_t DeviceBase::GetStatusPeriodMs() const noexcept
+{
+    switch (visibility_) {
+        case ScreenVisibility::Control:
+        case ScreenVisibility::Main:    return STATUS_SERVICE_PERIOD_MS_;
+        case ScreenVisibility::Menu:
+        case ScreenVisibility::Background: return STATUS_HEARTBEAT_MS_;
+        case ScreenVisibility::Hidden:  break;
+    }
+    return 0;
+}
+
+uint32_t DeviceBase::GetRenderPeriodMs() const noexcept
+{
+    return (visibility_ == ScreenVisibility::Control || visibility_ == ScreenVisibility::Main) ? 250 : 0;
+}
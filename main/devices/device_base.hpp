@@ -12,6 +12,17 @@
 #include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
 #include "../settings.hpp"
 
+/**
+ * @brief What the operator can currently see of a device.
+ */
+enum class ScreenVisibility : uint8_t {
+    Hidden,     ///< Splash / device selection: no status needed
+    Menu,       ///< Settings menu
+    Main,       ///< Device main (status) screen
+    Control,    ///< Control screen and its popups
+    Background, ///< Session kept open while another screen is shown: heartbeat status only
+};
+
 class DeviceBase {
 public:
     virtual ~DeviceBase() = default;
@@ -26,6 +37,32 @@ public:
     virtual void UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept = 0;
     virtual bool IsConnected() const noexcept;
     virtual void RequestStatus() noexcept = 0;
+
+    // Adaptive update rates (set by the UI controller every loop)
+    void SetVisibility(ScreenVisibility visibility) noexcept;
+
+    /**
+     * @brief Desired status period for the current visibility/state in ms (0 = none).
+     */
+    virtual uint32_t GetStatusPeriodMs() const noexcept;
+
+    /**
+     * @brief Periodic re-render interval in ms (0 = render only on events/input).
+     */
+    virtual uint32_t GetRenderPeriodMs() const noexcept;
+
+    /**
+     * @brief Address this instance to one peer so several devices of a type can run side by side.
+     *
+     * The UI controller binds one instance per approved tester it opens.
+     * @param mac Peer MAC, or nullptr to follow the protocol's current target (default)
+     */
+    void BindPeer(const uint8_t* mac) noexcept;
+
+    /**
+     * @brief MAC for the *To send functions: the bound peer, or nullptr for the current target.
+     */
+    const uint8_t* GetPeerMac() const noexcept { return peer_bound_ ? peer_mac_ : nullptr; }
     
     // Settings menu support
     virtual void BuildSettingsMenu(class MenuBuilder& builder) noexcept = 0;
@@ -40,9 +77,23 @@ protected:
 protected:
     // Protected helper to update connection status
     void updateConnectionStatus() noexcept;
+
+    /**
+     * @brief Called by SetVisibility() when the visibility changes.
+     */
+    virtual void onVisibilityChanged(ScreenVisibility previous) noexcept { (void)previous; }
+
+    /**
+     * @brief True if the event carries our device id and, when bound, comes from our peer
+     *        (locally injected events have no source MAC and always pass).
+     */
+    bool isOwnEvent(const espnow::ProtoEvent& event) const noexcept;
     
     // Member variables: snake_case + trailing underscore
     bool connected_;
     uint32_t last_status_tick_;
+    ScreenVisibility visibility_;
+    uint8_t peer_mac_[6];
+    bool peer_bound_;
 };
 
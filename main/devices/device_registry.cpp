@@ -7,6 +7,10 @@
 #include "device_base.hpp"
 #include "fatigue_tester.hpp"
 #include "mock_device.hpp"
+#include "pairing_screen.hpp"
+#include "groups_screen.hpp"
+#include "link_diagnostics.hpp"
+#include "../config.hpp"
 #include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
 #include "../settings.hpp"
 #include <vector>
@@ -14,10 +18,10 @@
 
 namespace device_registry {
 
-static std::vector<uint8_t> s_available_device_ids_ = {
-    DEVICE_ID_FATIGUE_TESTER_,
-    DEVICE_ID_MOCK_
-};
+static std::vector<uint8_t> s_available_device_ids_ = LINK_DIAGNOSTICS_ENABLED_
+    ? std::vector<uint8_t>{ DEVICE_ID_FATIGUE_TESTER_, DEVICE_ID_MOCK_, DEVICE_ID_PAIRING_, DEVICE_ID_GROUPS_,
+                            DEVICE_ID_LINK_DIAGNOSTICS_ }
+    : std::vector<uint8_t>{ DEVICE_ID_FATIGUE_TESTER_, DEVICE_ID_MOCK_, DEVICE_ID_PAIRING_, DEVICE_ID_GROUPS_ };
 
 std::unique_ptr<DeviceBase> CreateDevice(uint8_t device_id, 
                                          Adafruit_SH1106* display,
@@ -28,6 +32,12 @@ std::unique_ptr<DeviceBase> CreateDevice(uint8_t device_id,
             return std::make_unique<FatigueTester>(display, settings);
         case DEVICE_ID_MOCK_:
             return std::make_unique<MockDevice>(display, settings);
+        case DEVICE_ID_PAIRING_:
+            return std::make_unique<PairingScreen>(display, settings);
+        case DEVICE_ID_GROUPS_:
+            return std::make_unique<GroupsScreen>(display, settings);
+        case DEVICE_ID_LINK_DIAGNOSTICS_:
+            return std::make_unique<LinkDiagnostics>(display, settings);
         default:
             return nullptr;
     }
@@ -45,6 +55,12 @@ const char* GetDeviceName(uint8_t device_id) noexcept
             return "Fatigue Tester";
         case DEVICE_ID_MOCK_:
             return "Mock Device";
+        case DEVICE_ID_PAIRING_:
+            return "Pairing";
+        case DEVICE_ID_GROUPS_:
+            return "Groups";
+        case DEVICE_ID_LINK_DIAGNOSTICS_:
+            return "Link Diagnostics";
         default:
             return "Unknown";
     }
@@ -16,6 +16,9 @@ namespace device_registry {
 static constexpr uint8_t MAX_DEVICES_ = 16;
 static constexpr uint8_t DEVICE_ID_FATIGUE_TESTER_ = 1;
 static constexpr uint8_t DEVICE_ID_MOCK_ = 2;
+static constexpr uint8_t DEVICE_ID_GROUPS_ = 0xFC;             ///< Local screen, never on the air
+static constexpr uint8_t DEVICE_ID_PAIRING_ = 0xFD;            ///< Local screen, never on the air
+static constexpr uint8_t DEVICE_ID_LINK_DIAGNOSTICS_ = 0xFE;   ///< Local screen, never on the air
 
 // Public functions: PascalCase
 std::unique_ptr<DeviceBase> CreateDevice(uint8_t device_id, 
@@ -20,31 +20,75 @@
 #include "fatigue_tester.hpp"
 #include "../protocol/espnow_protocol.hpp"
 #include "../protocol/device_protocols.hpp"
+#include "../protocol/espnow_time.hpp"
 #include "../devices/device_registry.hpp"
 #include "../settings.hpp"
+#include "../config.hpp"
 #include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
 #include "../menu/menu_system.hpp"
 #include "../menu/menu_items.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 
 static const char* TAG_ = "FatigueTester";
 
+using device_protocols::FATIGUE_CONFIG_FIELDS_;
+using device_protocols::FATIGUE_CONFIG_FIELD_COUNT_;
+
+static constexpr uint32_t ALL_CONFIG_FIELDS_ = (1u << FATIGUE_CONFIG_FIELD_COUNT_) - 1;
+
+static uint32_t configFieldBit(device_protocols::FatigueConfigField id) noexcept
+{
+    size_t index = 0;
+    if (!espnow::FindConfigField(FATIGUE_CONFIG_FIELDS_, FATIGUE_CONFIG_FIELD_COUNT_,
+                                 static_cast<uint8_t>(id), &index)) {
+        return 0;
+    }
+    return 1u << index;
+}
+
+/**
+ * @brief Controller time of an event: the device's own stamp when it sent one
+ *        and the clocks are synchronized, else when the radio delivered it.
+ * @return true if the time came from the device clock
+ */
+static bool eventTimeUs(const espnow::ProtoEvent& event, bool has_stamp, int64_t device_us,
+                        int64_t& time_us) noexcept
+{
+    if (has_stamp && TimeSync::ToControllerTime(event.src_mac, device_us, time_us)) {
+        return true;
+    }
+    time_us = event.rx_us ? event.rx_us : esp_timer_get_time();
+    return false;
+}
+
 FatigueTester::FatigueTester(Adafruit_SH1106* display, Settings* settings) noexcept
     : DeviceBase(display, settings)
     , current_state_(device_protocols::FatigueTestState::Idle)
     , current_cycle_(0)
     , error_code_(0)
+    , status_sample_us_(0)
+    , status_device_stamped_(false)
     , popup_active_(false)
     , popup_mode_(PopupMode::None)
     , popup_selected_index_(0)
     , settings_synced_(false)
     , pending_command_id_(0)
     , pending_command_tick_(0)
+    , config_fields_supported_(false)
+    , device_config_{}
+    , device_config_known_(0)
+    , config_writes_{}
+    , config_write_head_(0)
+    , config_write_count_(0)
+    , status_sub_(device_registry::DEVICE_ID_FATIGUE_TESTER_, STATUS_STREAM_PERIOD_MS_, STATUS_STREAM_LEASE_MS_)
+    , last_poll_tick_(0)
     , menu_active_(false)
     , menu_selected_index_(0)
     , editing_value_(false)
@@ -203,7 +247,10 @@ void FatigueTester::RenderControlScreen() noexcept
 
     TickType_t now_ticks = xTaskGetTickCount();
     bool connected = (last_status_tick_ > 0) && (now_ticks - last_status_tick_ < pdMS_TO_TICKS(5000));
-    bool cmd_pending = (pending_command_id_ != 0) && (now_ticks - pending_command_tick_ < pdMS_TO_TICKS(2000));
+    // The protocol layer retries the command for up to RELIABLE_MAX_DELIVERY_MS_ and posts
+    // DeliveryFailed when it gives up; the local expiry is only a backstop.
+    bool cmd_pending = (pending_command_id_ != 0) &&
+                       (now_ticks - pending_command_tick_ < pdMS_TO_TICKS(espnow::RELIABLE_MAX_DELIVERY_MS_ + 500));
     if (!cmd_pending && pending_command_id_ != 0) {
         pending_command_id_ = 0;
         pending_command_tick_ = 0;
@@ -342,29 +389,29 @@ void FatigueTester::HandleButton(ButtonId button_id) noexcept
             if (popup_mode_ == PopupMode::StartConfirm) {
                 // 0=BACK, 1=START
                 if (popup_selected_index_ == 1) {
-                    espnow::SendCommand(GetDeviceId(), 1, nullptr, 0); // START
+                    espnow::SendCommandTo(GetPeerMac(), GetDeviceId(), 1, nullptr, 0); // START
                     pending_command_id_ = 1;
                     pending_command_tick_ = xTaskGetTickCount();
                 }
             } else if (popup_mode_ == PopupMode::RunningActions) {
                 // 0=BACK, 1=PAUSE, 2=STOP
                 if (popup_selected_index_ == 1) {
-                    espnow::SendCommand(GetDeviceId(), 2, nullptr, 0); // PAUSE
+                    espnow::SendCommandTo(GetPeerMac(), GetDeviceId(), 2, nullptr, 0); // PAUSE
                     pending_command_id_ = 2;
                     pending_command_tick_ = xTaskGetTickCount();
                 } else if (popup_selected_index_ == 2) {
-                    espnow::SendCommand(GetDeviceId(), 4, nullptr, 0); // STOP
+                    espnow::SendCommandTo(GetPeerMac(), GetDeviceId(), 4, nullptr, 0, espnow::TxPriority::Safety); // STOP
                     pending_command_id_ = 4;
                     pending_command_tick_ = xTaskGetTickCount();
                 }
             } else if (popup_mode_ == PopupMode::PausedActions) {
                 // 0=BACK, 1=RESUME, 2=STOP
                 if (popup_selected_index_ == 1) {
-                    espnow::SendCommand(GetDeviceId(), 3, nullptr, 0); // RESUME
+                    espnow::SendCommandTo(GetPeerMac(), GetDeviceId(), 3, nullptr, 0); // RESUME
                     pending_command_id_ = 3;
                     pending_command_tick_ = xTaskGetTickCount();
                 } else if (popup_selected_index_ == 2) {
-                    espnow::SendCommand(GetDeviceId(), 4, nullptr, 0); // STOP
+                    espnow::SendCommandTo(GetPeerMac(), GetDeviceId(), 4, nullptr, 0, espnow::TxPriority::Safety); // STOP
                     pending_command_id_ = 4;
                     pending_command_tick_ = xTaskGetTickCount();
                 }
@@ -389,7 +436,7 @@ void FatigueTester::HandleButton(ButtonId button_id) noexcept
                 menu_active_ = false;
                 // Save and send settings
                 if (settings_) {
-                    SettingsStore::Save(*settings_);
+                    SettingsStore::Update(*settings_);
                     sendSettingsToDevice();
                 }
             }
@@ -522,72 +569,70 @@ void FatigueTester::HandleEncoderButton(bool pressed) noexcept
 
 void FatigueTester::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
 {
-    if (event.device_id != GetDeviceId()) return;
+    if (!isOwnEvent(event)) return;
+
+    status_sub_.HandleEvent(event);
     
     if (event.type == espnow::MsgType::StatusUpdate && 
-        event.payload_len >= sizeof(device_protocols::FatigueTestStatusPayload)) {
+        event.payload_len >= device_protocols::FATIGUE_TEST_STATUS_BASE_SIZE) {
         device_protocols::FatigueTestStatusPayload status{};
-        std::memcpy(&status, event.payload, sizeof(status));
-        handleStatusUpdate(status);
+        std::memcpy(&status, event.payload, std::min(event.payload_len, sizeof(status)));
+        int64_t sample_us = 0;
+        bool stamped = eventTimeUs(event, event.payload_len >= sizeof(status), status.device_time_us, sample_us);
+        handleStatusUpdate(status, sample_us, stamped);
+    } else if (event.type == espnow::MsgType::StatusCompact) {
+        device_protocols::FatigueTestStatusSample sample{};
+        if (compact_status_.Decode(event.payload, event.payload_len, sample) ==
+            device_protocols::CompactStatusDecoder::Result::Ok) {
+            int64_t sample_us = 0;
+            bool stamped = eventTimeUs(event, sample.has_time, sample.device_time_us, sample_us);
+            handleStatusUpdate(device_protocols::ToStatusPayload(sample), sample_us, stamped);
+        }
+        if (compact_status_.AckDue()) {
+            espnow::StatusCompactAckPayload ack{};
+            compact_status_.BuildAck(ack);
+            espnow::SendStatusCompactAckTo(GetPeerMac(), GetDeviceId(), ack);
+        }
+    } else if (event.type == espnow::MsgType::DeviceInfo) {
+        // Sent after a reboot or re-pairing; compact status references start over
+        compact_status_.Reset();
+        espnow::PeerCapabilities caps{};
+        if (espnow::ParseCapabilities(event.payload, event.payload_len, caps)) {
+            config_fields_supported_ = caps.Has(espnow::CAP_CONFIG_FIELDS_);
+        }
     } else if (event.type == espnow::MsgType::ConfigResponse) {
-        // Settings received from device - handle both base and extended fields
-        // PROTOCOL V2 layout: 17 base bytes, 16 extended bytes, 1 SGT byte
-        constexpr size_t BASE_CONFIG_SIZE = 17; // cycle_amount(4) + vmax(4) + amax(4) + dwell_ms(4) + bounds_method(1)
-        constexpr size_t EXT_CONFIG_V1_SIZE = 17 + (4 * 4); // 33 bytes (4 floats for bounds finding)
-        constexpr size_t EXT_CONFIG_V2_SIZE = EXT_CONFIG_V1_SIZE + 1; // + SGT
-        
-        if (event.payload_len >= BASE_CONFIG_SIZE) {
-            device_protocols::FatigueTestConfigPayload config{};
-            // Copy only the received bytes to handle older firmware without extended fields
-            size_t copy_len = (event.payload_len < sizeof(config)) ? event.payload_len : sizeof(config);
-            std::memcpy(&config, event.payload, copy_len);
-            
-            // DON'T overwrite settings while user is editing in the menu
-            // Only update connection status and sync flag
-            if (menu_active_) {
-                last_status_tick_ = xTaskGetTickCount();
-                connected_ = true;
-                pushLogLine("CFG rx (menu)");
-                // Don't update settings_ or save - user is editing
-            } else if (settings_) {
-                // Base fields (always present) - direct velocity/acceleration control
-                settings_->fatigue_test.cycle_amount = config.cycle_amount;
-                settings_->fatigue_test.oscillation_vmax_rpm = config.oscillation_vmax_rpm;
-                settings_->fatigue_test.oscillation_amax_rev_s2 = config.oscillation_amax_rev_s2;
-                settings_->fatigue_test.dwell_time_ms = config.dwell_time_ms;
-                settings_->fatigue_test.bounds_method_stallguard = (config.bounds_method == 0);
-                
-                // Extended fields (v1): floats for bounds finding config
-                if (event.payload_len >= EXT_CONFIG_V1_SIZE) {
-                    settings_->fatigue_test.bounds_search_velocity_rpm = config.bounds_search_velocity_rpm;
-                    settings_->fatigue_test.stallguard_min_velocity_rpm = config.stallguard_min_velocity_rpm;
-                    settings_->fatigue_test.stall_detection_current_factor = config.stall_detection_current_factor;
-                    settings_->fatigue_test.bounds_search_accel_rev_s2 = config.bounds_search_accel_rev_s2;
-
-                    // Extended v2: SGT
-                    settings_->fatigue_test.stallguard_sgt = 127;
-                    if (event.payload_len >= EXT_CONFIG_V2_SIZE) {
-                        settings_->fatigue_test.stallguard_sgt = config.stallguard_sgt;
-                    }
-
-                    ESP_LOGI(TAG_, "Config: VMAX=%.1f RPM, AMAX=%.1f rev/s², dwell=%lu ms, bounds_vel=%.1f, SGT=%d",
-                             config.oscillation_vmax_rpm, config.oscillation_amax_rev_s2,
-                             (unsigned long)config.dwell_time_ms,
-                             config.bounds_search_velocity_rpm,
-                             static_cast<int>(settings_->fatigue_test.stallguard_sgt));
-                } else {
-                    ESP_LOGI(TAG_, "Config received (base fields only, payload_len=%u)", event.payload_len);
-                }
-                
-                settings_synced_ = true;
-                last_status_tick_ = xTaskGetTickCount();
-                connected_ = true;
-                SettingsStore::Save(*settings_);
-                pushLogLine("CFG rx");
-            }
+        // Legacy fixed layout; older firmware sends a shorter prefix of the struct
+        device_protocols::FatigueTestConfigPayload config{};
+        buildConfigPayload(config);
+        uint32_t fields = 0;
+        espnow::DecodeLegacyConfig(FATIGUE_CONFIG_FIELDS_, FATIGUE_CONFIG_FIELD_COUNT_,
+                                   event.payload, event.payload_len, &config, &fields);
+        if (fields != 0) {
+            applyDeviceConfig(config, fields);
+        }
+    } else if (event.type == espnow::MsgType::ConfigFieldReport) {
+        config_fields_supported_ = true;
+        device_protocols::FatigueTestConfigPayload config{};
+        buildConfigPayload(config);
+        uint32_t fields = 0;
+        if (!espnow::DecodeConfigFields(FATIGUE_CONFIG_FIELDS_, FATIGUE_CONFIG_FIELD_COUNT_,
+                                        event.payload, event.payload_len, &config, &fields)) {
+            ESP_LOGW(TAG_, "Truncated ConfigFieldReport (%u bytes)", event.payload_len);
         }
+        if (fields != 0) {
+            applyDeviceConfig(config, fields);
+        }
+    } else if (event.type == espnow::MsgType::ConfigFieldAck) {
+        handleConfigFieldAck(event);
     } else if (event.type == espnow::MsgType::ConfigAck) {
-        settings_synced_ = true;
+        // Oldest full ConfigSet applied: the device now holds everything it carried
+        if (config_write_count_ > 0) {
+            device_config_ = config_writes_[config_write_head_].values;
+            device_config_known_ = ALL_CONFIG_FIELDS_;
+            config_write_head_ = static_cast<uint8_t>((config_write_head_ + 1) % CONFIG_WRITES_);
+            config_write_count_--;
+        }
+        settings_synced_ = (config_write_count_ == 0);
         last_status_tick_ = xTaskGetTickCount();
         connected_ = true;
         pushLogLine("CFG ack");
@@ -597,16 +642,34 @@ void FatigueTester::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
         last_status_tick_ = xTaskGetTickCount();
         connected_ = true;
         pushLogLine("CMD ack");
+    } else if (event.type == espnow::MsgType::DeliveryFailed) {
+        espnow::DeliveryReport report{};
+        std::memcpy(&report, event.payload, sizeof(report));
+        if (report.type == espnow::MsgType::Command) {
+            pending_command_id_ = 0;
+            pending_command_tick_ = 0;
+            pushLogLine("CMD lost");
+        } else if (report.type == espnow::MsgType::ConfigSet ||
+                   report.type == espnow::MsgType::ConfigFieldSet) {
+            // Unknown what arrived; resend those fields on the next sync
+            dropConfigWrites();
+            settings_synced_ = false;
+            pushLogLine("CFG lost");
+        }
     } else if (event.type == espnow::MsgType::TestComplete) {
         current_state_ = device_protocols::FatigueTestState::Completed;
         pushLogLine("DONE");
     } else if (event.type == espnow::MsgType::Error) {
         current_state_ = device_protocols::FatigueTestState::Error;
-        if (event.payload_len >= 1) {
-            error_code_ = event.payload[0];
+        if (event.payload_len >= device_protocols::FATIGUE_TEST_ERROR_BASE_SIZE) {
+            device_protocols::FatigueTestErrorPayload error{};
+            std::memcpy(&error, event.payload, std::min(event.payload_len, sizeof(error)));
+            error_code_ = error.err_code;
             // Default severity: assume high (3) if not specified
-            uint8_t severity = (event.payload_len >= 2) ? event.payload[1] : 3;
-            addError(error_code_, severity);
+            uint8_t severity = (event.payload_len >= 2) ? error.severity : 3;
+            int64_t time_us = 0;
+            eventTimeUs(event, event.payload_len >= sizeof(error), error.device_time_us, time_us);
+            addError(error_code_, severity, time_us);
             pushLogLine("ERR E%u S%u", (unsigned)error_code_, (unsigned)severity);
         }
     } else if (event.type == espnow::MsgType::ErrorClear) {
@@ -623,7 +686,50 @@ bool FatigueTester::IsConnected() const noexcept
 
 void FatigueTester::RequestStatus() noexcept
 {
-    espnow::SendConfigRequest(GetDeviceId());
+    uint32_t period_ms = GetStatusPeriodMs();
+    if (period_ms == 0) return;
+    status_sub_.SetPeer(GetPeerMac());
+    status_sub_.SetPeriod(static_cast<uint16_t>(period_ms));
+
+    // While the status stream is up, only ask for config until it has been synced once.
+    // Fallback polling follows the adaptive rate too.
+    bool poll = status_sub_.Service();
+    TickType_t now = xTaskGetTickCount();
+    bool poll_due = (now - last_poll_tick_) >= pdMS_TO_TICKS(period_ms);
+    bool sync_due = !settings_synced_ && (now - last_poll_tick_) >= pdMS_TO_TICKS(CONFIG_SYNC_RETRY_MS_);
+    if ((poll && poll_due) || sync_due) {
+        espnow::SendConfigRequestTo(GetPeerMac(), GetDeviceId());
+        last_poll_tick_ = now;
+    }
+}
+
+uint32_t FatigueTester::GetStatusPeriodMs() const noexcept
+{
+    size_t row = static_cast<size_t>(current_state_);
+    if (row >= sizeof(FATIGUE_STATUS_RATES_) / sizeof(FATIGUE_STATUS_RATES_[0])) {
+        row = 0;
+    }
+    const StatusRateMs& rate = FATIGUE_STATUS_RATES_[row];
+
+    switch (visibility_) {
+        case ScreenVisibility::Control: return rate.control;
+        case ScreenVisibility::Main:    return rate.main;
+        case ScreenVisibility::Menu:    return rate.menu;
+        case ScreenVisibility::Background: return STATUS_HEARTBEAT_MS_;
+        case ScreenVisibility::Hidden:  break;
+    }
+    return 0;
+}
+
+uint32_t FatigueTester::GetRenderPeriodMs() const noexcept
+{
+    // Control screen needs 250 ms for pending/NOT CONNECTED flashes; the main screen
+    // only changes when status arrives (which renders anyway), so a slow refresh suffices.
+    switch (visibility_) {
+        case ScreenVisibility::Control: return 250;
+        case ScreenVisibility::Main:    return 1000;
+        default:                        return 0;
+    }
 }
 
 void FatigueTester::BuildSettingsMenu(class MenuBuilder& builder) noexcept
@@ -670,8 +776,16 @@ void FatigueTester::renderStatusScreen() noexcept
     RenderMainScreen();
 }
 
-void FatigueTester::handleStatusUpdate(const device_protocols::FatigueTestStatusPayload& status) noexcept
+void FatigueTester::handleStatusUpdate(const device_protocols::FatigueTestStatusPayload& status, int64_t sample_us,
+                                       bool device_stamped) noexcept
 {
+    // Device stamps order samples even when delivery reordered them; an older one is stale
+    if (device_stamped && status_device_stamped_ && sample_us < status_sample_us_) {
+        return;
+    }
+    status_sample_us_ = sample_us;
+    status_device_stamped_ = device_stamped;
+
     device_protocols::FatigueTestState prev_state = current_state_;
     uint8_t prev_err = error_code_;
     uint32_t prev_cycle = current_cycle_;
@@ -712,13 +826,11 @@ void FatigueTester::handleStatusUpdate(const device_protocols::FatigueTestStatus
     }
 }
 
-void FatigueTester::sendSettingsToDevice() noexcept
+void FatigueTester::buildConfigPayload(device_protocols::FatigueTestConfigPayload& config) const noexcept
 {
+    config = {};
     if (!settings_) return;
-    
-    // Build config payload with all fields including extended ones
-    device_protocols::FatigueTestConfigPayload config{};
-    
+
     // Base fields - PROTOCOL V2: direct velocity/acceleration control
     config.cycle_amount = settings_->fatigue_test.cycle_amount;
     config.oscillation_vmax_rpm = settings_->fatigue_test.oscillation_vmax_rpm;
@@ -734,13 +846,186 @@ void FatigueTester::sendSettingsToDevice() noexcept
 
     // SGT (127 means "use test unit default")
     config.stallguard_sgt = settings_->fatigue_test.stallguard_sgt;
+}
+
+void FatigueTester::applyDeviceConfig(device_protocols::FatigueTestConfigPayload& config,
+                                      uint32_t fields) noexcept
+{
+    // A device that does not report SGT runs with its own default
+    if (!(fields & configFieldBit(device_protocols::FatigueConfigField::StallguardSgt))) {
+        config.stallguard_sgt = 127;
+    }
+
+    device_config_ = config;
+    device_config_known_ = fields;
+    last_status_tick_ = xTaskGetTickCount();
+    connected_ = true;
+
+    // DON'T overwrite settings while user is editing in the menu
+    // Only update connection status and sync flag
+    if (menu_active_) {
+        pushLogLine("CFG rx (menu)");
+        return;
+    }
+    // settings_ is shared by every open tester and shows the foreground one:
+    // a background session keeps device_config_ and copies it when brought back
+    if (visibility_ == ScreenVisibility::Background) {
+        settings_synced_ = true;
+        pushLogLine("CFG rx (bg)");
+        return;
+    }
+    if (!settings_) return;
+
+    // Fields the device did not report already hold the local values (see buildConfigPayload)
+    copyConfigToSettings(config);
+
+    ESP_LOGI(TAG_, "Config: VMAX=%.1f RPM, AMAX=%.1f rev/s², dwell=%lu ms, bounds_vel=%.1f, SGT=%d (fields 0x%03lx)",
+             config.oscillation_vmax_rpm, config.oscillation_amax_rev_s2,
+             (unsigned long)config.dwell_time_ms,
+             config.bounds_search_velocity_rpm,
+             static_cast<int>(config.stallguard_sgt),
+             (unsigned long)fields);
+
+    settings_synced_ = true;
+    pushLogLine("CFG rx");
+}
+
+void FatigueTester::copyConfigToSettings(const device_protocols::FatigueTestConfigPayload& config) noexcept
+{
+    if (!settings_) return;
+
+    settings_->fatigue_test.cycle_amount = config.cycle_amount;
+    settings_->fatigue_test.oscillation_vmax_rpm = config.oscillation_vmax_rpm;
+    settings_->fatigue_test.oscillation_amax_rev_s2 = config.oscillation_amax_rev_s2;
+    settings_->fatigue_test.dwell_time_ms = config.dwell_time_ms;
+    settings_->fatigue_test.bounds_method_stallguard = (config.bounds_method == 0);
+    settings_->fatigue_test.bounds_search_velocity_rpm = config.bounds_search_velocity_rpm;
+    settings_->fatigue_test.stallguard_min_velocity_rpm = config.stallguard_min_velocity_rpm;
+    settings_->fatigue_test.stall_detection_current_factor = config.stall_detection_current_factor;
+    settings_->fatigue_test.bounds_search_accel_rev_s2 = config.bounds_search_accel_rev_s2;
+    settings_->fatigue_test.stallguard_sgt = config.stallguard_sgt;
+    SettingsStore::Update(*settings_);
+}
+
+void FatigueTester::onVisibilityChanged(ScreenVisibility previous) noexcept
+{
+    // Back in the foreground: show this tester's config, not the last one opened
+    if (previous == ScreenVisibility::Background && device_config_known_ != 0 && !menu_active_) {
+        copyConfigToSettings(device_config_);
+    }
+}
+
+void FatigueTester::handleConfigFieldAck(const espnow::ProtoEvent& event) noexcept
+{
+    config_fields_supported_ = true;
+    last_status_tick_ = xTaskGetTickCount();
+    connected_ = true;
+
+    if (config_write_count_ == 0) {
+        return;
+    }
+    // The device acks ConfigFieldSets in the order it applies them: this is the oldest
+    ConfigWrite write = config_writes_[config_write_head_];
+    config_write_head_ = static_cast<uint8_t>((config_write_head_ + 1) % CONFIG_WRITES_);
+    config_write_count_--;
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(&device_config_);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(&write.values);
+    bool rejected = false;
+
+    for (size_t pos = 0; pos + sizeof(espnow::ConfigFieldStatus) <= event.payload_len;
+         pos += sizeof(espnow::ConfigFieldStatus)) {
+        espnow::ConfigFieldStatus st{};
+        std::memcpy(&st, event.payload + pos, sizeof(st));
+
+        size_t index = 0;
+        const espnow::ConfigFieldDesc* f = espnow::FindConfigField(FATIGUE_CONFIG_FIELDS_, FATIGUE_CONFIG_FIELD_COUNT_,
+                                                                   st.id, &index);
+        if (!f || !(write.fields & (1u << index))) {
+            continue;
+        }
+        write.fields &= ~(1u << index);
+
+        switch (static_cast<espnow::ConfigFieldResult>(st.result)) {
+            case espnow::ConfigFieldResult::Applied:
+            case espnow::ConfigFieldResult::UnknownField:
+                // Unknown fields count as synced so older firmware is not sent them on every edit
+                std::memcpy(dst + f->offset, src + f->offset, f->size);
+                device_config_known_ |= (1u << index);
+                break;
+            default:
+                // Device kept its old value; re-read it so the menu shows the truth
+                device_config_known_ &= ~(1u << index);
+                rejected = true;
+                break;
+        }
+    }
+
+    // Fields the ack did not mention: unknown whether they were applied
+    device_config_known_ &= ~write.fields;
+
+    settings_synced_ = !rejected && write.fields == 0 && config_write_count_ == 0;
+    pushLogLine(rejected ? "CFG rejected" : "CFG ack");
+}
+
+void FatigueTester::pushConfigWrite(const device_protocols::FatigueTestConfigPayload& values,
+                                    uint32_t fields) noexcept
+{
+    if (config_write_count_ == CONFIG_WRITES_) {
+        // Oldest write's ack is overdue; its outcome is unknown, so resend those fields later
+        device_config_known_ &= ~config_writes_[config_write_head_].fields;
+        config_write_head_ = static_cast<uint8_t>((config_write_head_ + 1) % CONFIG_WRITES_);
+        config_write_count_--;
+    }
+    ConfigWrite& write = config_writes_[(config_write_head_ + config_write_count_) % CONFIG_WRITES_];
+    write.values = values;
+    write.fields = fields;
+    config_write_count_++;
+}
+
+void FatigueTester::dropConfigWrites() noexcept
+{
+    for (uint8_t i = 0; i < config_write_count_; ++i) {
+        device_config_known_ &= ~config_writes_[(config_write_head_ + i) % CONFIG_WRITES_].fields;
+    }
+    config_write_head_ = 0;
+    config_write_count_ = 0;
+}
+
+void FatigueTester::sendSettingsToDevice() noexcept
+{
+    if (!settings_) return;
     
+    device_protocols::FatigueTestConfigPayload config{};
+    buildConfigPayload(config);
+
+    if (config_fields_supported_) {
+        uint8_t records[espnow::MAX_PAYLOAD_SIZE_];
+        uint32_t fields = 0;
+        size_t len = espnow::EncodeConfigFields(FATIGUE_CONFIG_FIELDS_, FATIGUE_CONFIG_FIELD_COUNT_,
+                                                &config, &device_config_, device_config_known_,
+                                                records, sizeof(records), &fields);
+        if (len == 0) {
+            ESP_LOGI(TAG_, "Config unchanged, nothing to send");
+            return;
+        }
+
+        ESP_LOGI(TAG_, "Sending config fields 0x%03lx (%u bytes)", (unsigned long)fields, (unsigned)len);
+        if (espnow::SendConfigFieldsTo(GetPeerMac(), GetDeviceId(), records, len)) {
+            pushConfigWrite(config, fields);
+        }
+        settings_synced_ = false;
+        return;
+    }
+
     ESP_LOGI(TAG_, "Sending config: cycles=%lu, VMAX=%.1f RPM, AMAX=%.1f rev/s², dwell=%lu ms, bounds=%s",
              (unsigned long)config.cycle_amount, config.oscillation_vmax_rpm,
              config.oscillation_amax_rev_s2, (unsigned long)config.dwell_time_ms,
              config.bounds_method == 0 ? "SG" : "ENC");
     
-    espnow::SendConfigSet(GetDeviceId(), &config, sizeof(config));
+    if (espnow::SendConfigSetTo(GetPeerMac(), GetDeviceId(), &config, sizeof(config))) {
+        pushConfigWrite(config, ALL_CONFIG_FIELDS_);
+    }
     settings_synced_ = false;
 }
 
@@ -854,7 +1139,7 @@ void FatigueTester::handleMenuEnter() noexcept
     if (menu_selected_index_ == MENU_BACK) {
         menu_active_ = false;
         if (settings_) {
-            SettingsStore::Save(*settings_);
+            SettingsStore::Update(*settings_);
             sendSettingsToDevice();
         }
     } else if (menu_selected_index_ == MENU_CYCLES ||
@@ -1264,14 +1549,14 @@ void FatigueTester::RenderPopup() noexcept
     display_->display();
 }
 
-void FatigueTester::addError(uint8_t code, uint8_t severity) noexcept
+void FatigueTester::addError(uint8_t code, uint8_t severity, int64_t time_us) noexcept
 {
     // Remove existing error with same code
     for (size_t i = 0; i < error_count_; ++i) {
         if (errors_[i].code == code) {
-            // Update severity and timestamp
+            // Update severity and time
             errors_[i].severity = severity;
-            errors_[i].timestamp = xTaskGetTickCount();
+            errors_[i].time_us = time_us;
             return;
         }
     }
@@ -1280,21 +1565,21 @@ void FatigueTester::addError(uint8_t code, uint8_t severity) noexcept
     if (error_count_ < MAX_ERRORS_) {
         errors_[error_count_].code = code;
         errors_[error_count_].severity = severity;
-        errors_[error_count_].timestamp = xTaskGetTickCount();
+        errors_[error_count_].time_us = time_us;
         error_count_++;
     } else {
         // Replace oldest error
         size_t oldest_idx = 0;
-        TickType_t oldest_time = errors_[0].timestamp;
+        int64_t oldest_time = errors_[0].time_us;
         for (size_t i = 1; i < MAX_ERRORS_; ++i) {
-            if (errors_[i].timestamp < oldest_time) {
-                oldest_time = errors_[i].timestamp;
+            if (errors_[i].time_us < oldest_time) {
+                oldest_time = errors_[i].time_us;
                 oldest_idx = i;
             }
         }
         errors_[oldest_idx].code = code;
         errors_[oldest_idx].severity = severity;
-        errors_[oldest_idx].timestamp = xTaskGetTickCount();
+        errors_[oldest_idx].time_us = time_us;
     }
 }
 
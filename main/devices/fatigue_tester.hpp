@@ -6,6 +6,7 @@
 #pragma once
 
 #include "device_base.hpp"
+#include "status_subscription.hpp"
 #include "../protocol/device_protocols.hpp"
 
 class FatigueTester : public DeviceBase {
@@ -23,6 +24,8 @@ public:
     void UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept override;
     bool IsConnected() const noexcept override;
     void RequestStatus() noexcept override;
+    uint32_t GetStatusPeriodMs() const noexcept override;
+    uint32_t GetRenderPeriodMs() const noexcept override;
     void BuildSettingsMenu(class MenuBuilder& builder) noexcept override;
     
     // Additional rendering for settings menu
@@ -35,6 +38,9 @@ public:
     
     // Popup state
     bool IsPopupActive() const noexcept { return popup_active_; }
+
+protected:
+    void onVisibilityChanged(ScreenVisibility previous) noexcept override;
     
 private:
     enum class PopupMode : uint8_t {
@@ -61,14 +67,21 @@ private:
 
     // Private functions: camelCase
     void renderStatusScreen() noexcept;
-    void handleStatusUpdate(const device_protocols::FatigueTestStatusPayload& status) noexcept;
+    void handleStatusUpdate(const device_protocols::FatigueTestStatusPayload& status, int64_t sample_us,
+                            bool device_stamped) noexcept;
     void sendSettingsToDevice() noexcept;
+    void buildConfigPayload(device_protocols::FatigueTestConfigPayload& config) const noexcept;
+    void applyDeviceConfig(device_protocols::FatigueTestConfigPayload& config, uint32_t fields) noexcept;
+    void copyConfigToSettings(const device_protocols::FatigueTestConfigPayload& config) noexcept;
+    void handleConfigFieldAck(const espnow::ProtoEvent& event) noexcept;
+    void pushConfigWrite(const device_protocols::FatigueTestConfigPayload& values, uint32_t fields) noexcept;
+    void dropConfigWrites() noexcept;
     void adjustCurrentValue(int32_t delta) noexcept;
     void adjustCurrentFloatValue(int32_t delta) noexcept;
     void toggleCurrentChoice() noexcept;
     void handleMenuEnter() noexcept;
     void renderErrorFooter() noexcept;
-    void addError(uint8_t code, uint8_t severity) noexcept;
+    void addError(uint8_t code, uint8_t severity, int64_t time_us) noexcept;
     void clearErrors() noexcept;
     void checkConfirmHold(ButtonId button_id) noexcept;
     void pushLogLine(const char* fmt, ...) noexcept;
@@ -77,6 +90,8 @@ private:
     device_protocols::FatigueTestState current_state_;
     uint32_t current_cycle_;
     uint8_t error_code_;
+    int64_t status_sample_us_;      ///< Controller time of the applied status sample
+    bool status_device_stamped_;    ///< status_sample_us_ came from the device clock
     bool popup_active_;
     PopupMode popup_mode_;
     uint8_t popup_selected_index_; // 0..2 depending on popup_mode_
@@ -86,6 +101,30 @@ private:
     // 0 = none, otherwise command_id (1=start, 2=pause, 3=resume, 4=stop)
     uint8_t pending_command_id_;
     TickType_t pending_command_tick_;
+
+    // Per-field config sync. device_config_ holds the values the device is known
+    // to have (bit i of device_config_known_ covers FATIGUE_CONFIG_FIELDS_[i]);
+    // only fields that differ from it are sent to ConfigField-capable firmware.
+    bool config_fields_supported_;
+    device_protocols::FatigueTestConfigPayload device_config_;
+    uint32_t device_config_known_;
+
+    /// One ConfigSet/ConfigFieldSet awaiting its ack, with the values it carried.
+    /// Acks complete writes in send order, so each commits its own values and a
+    /// later edit of the same field cannot be mistaken for the acked one.
+    struct ConfigWrite {
+        device_protocols::FatigueTestConfigPayload values;
+        uint32_t fields;
+    };
+    static constexpr uint8_t CONFIG_WRITES_ = 4;
+    ConfigWrite config_writes_[CONFIG_WRITES_];     ///< Ring, oldest at config_write_head_
+    uint8_t config_write_head_;
+    uint8_t config_write_count_;
+
+    // Pushed StatusUpdate stream; ConfigRequest polling only as fallback
+    StatusSubscription status_sub_;
+    device_protocols::CompactStatusDecoder compact_status_;    ///< StatusCompact references of this peer
+    TickType_t last_poll_tick_;
     
     // Menu state
     bool menu_active_;
@@ -100,7 +139,7 @@ private:
     struct ErrorEntry {
         uint8_t code;
         uint8_t severity; // 1=low, 2=medium, 3=high
-        TickType_t timestamp;
+        int64_t time_us;    ///< Controller esp_timer time of the error
     };
     static constexpr size_t MAX_ERRORS_ = 3;
     ErrorEntry errors_[MAX_ERRORS_];
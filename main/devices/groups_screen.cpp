@@ -0,0 +1,353 @@
+/**
+ * @file groups_screen.cpp
+ * @brief Peer group screen implementation
+ */
+
+#include "groups_screen.hpp"
+#include "../devices/device_registry.hpp"
+#include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
+#include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
+#include "esp_log.h"
+#include <cstdio>
+#include <cstring>
+
+static const char* TAG_ = "GroupsScreen";
+
+static const char* const ROW_NAMES_[] = {
+    nullptr,        // Group row shows the group itself
+    "Edit members",
+    "Start all",
+    "Stop all",
+    "Clear",
+};
+
+GroupsScreen::GroupsScreen(Adafruit_SH1106* display, Settings* settings) noexcept
+    : DeviceBase(display, settings)
+    , group_(0)
+    , row_(Row::Group)
+    , editing_(false)
+    , edit_cursor_(0)
+    , peer_count_(0)
+    , peers_{}
+    , chosen_{}
+    , start_armed_(false)
+    , armed_tick_(0)
+    , sending_(false)
+    , notice_(nullptr)
+{
+    connected_ = true;  // Local screen: nothing to connect to
+}
+
+uint8_t GroupsScreen::GetDeviceId() const noexcept
+{
+    return device_registry::DEVICE_ID_GROUPS_;
+}
+
+const char* GroupsScreen::GetDeviceName() const noexcept
+{
+    return "Groups";
+}
+
+void GroupsScreen::RenderMainScreen() noexcept
+{
+    if (!display_) return;
+
+    if (editing_) {
+        renderEdit();
+        return;
+    }
+
+    sending_ = PeerGroups::IsBusy();
+    if (start_armed_ && (xTaskGetTickCount() - armed_tick_) >= pdMS_TO_TICKS(START_CONFIRM_MS_)) {
+        start_armed_ = false;
+    }
+
+    display_->clearDisplay();
+    display_->setTextSize(1);
+    display_->setTextColor(1);
+
+    // Title line: what is going on, else the outcome of the last group command
+    char buf[28];
+    PeerGroups::Result result{};
+    if (sending_) {
+        snprintf(buf, sizeof(buf), "Sending...");
+    } else if (start_armed_) {
+        snprintf(buf, sizeof(buf), "Press again: START");
+    } else if (notice_) {
+        snprintf(buf, sizeof(buf), "%s", notice_);
+    } else if (PeerGroups::GetLastResult(result)) {
+        const char* what = (result.command_id == COMMAND_START_) ? "Start"
+                         : (result.command_id == COMMAND_STOP_)  ? "Stop" : "Cmd";
+        if (result.complete) {
+            snprintf(buf, sizeof(buf), "G%u %s %u/%u %lums", result.group + 1, what,
+                     result.acked, result.members, static_cast<unsigned long>(result.last_ack_us / 1000));
+        } else {
+            snprintf(buf, sizeof(buf), "G%u %s %u/%u acked", result.group + 1, what,
+                     result.acked, result.members);
+        }
+    } else {
+        snprintf(buf, sizeof(buf), "Groups");
+    }
+    display_->setCursor(0, 0);
+    display_->print(buf);
+    display_->drawLine(0, 9, 128, 9, 1);
+
+    PeerGroups::Group group{};
+    bool defined = PeerGroups::GetGroup(group_, group) && group.valid;
+
+    int16_t y_pos = 12;
+    for (uint8_t i = 0; i < ROW_COUNT_; ++i) {
+        bool highlighted = (static_cast<uint8_t>(row_) == i);
+        if (highlighted) {
+            display_->fillRect(0, y_pos - 1, 128, 10, 1);
+            display_->setTextColor(0); // Inverted text
+        }
+        display_->setCursor(4, y_pos);
+        if (static_cast<Row>(i) == Row::Group) {
+            if (defined) {
+                snprintf(buf, sizeof(buf), "G%u %.12s (%u)", group_ + 1, group.name, group.member_count);
+            } else {
+                snprintf(buf, sizeof(buf), "G%u (empty)", group_ + 1);
+            }
+            display_->print(buf);
+        } else {
+            display_->print(ROW_NAMES_[i]);
+        }
+        if (highlighted) {
+            display_->setTextColor(1);
+        }
+        y_pos += 10;
+    }
+
+    display_->display();
+}
+
+void GroupsScreen::renderEdit() noexcept
+{
+    display_->clearDisplay();
+    display_->setTextSize(1);
+    display_->setTextColor(1);
+
+    size_t chosen = 0;
+    for (size_t i = 0; i < peer_count_; ++i) {
+        chosen += chosen_[i] ? 1 : 0;
+    }
+    char buf[28];
+    if (notice_) {
+        snprintf(buf, sizeof(buf), "%s", notice_);
+    } else {
+        snprintf(buf, sizeof(buf), "G%u members: %u", group_ + 1, static_cast<unsigned>(chosen));
+    }
+    display_->setCursor(0, 0);
+    display_->print(buf);
+    display_->drawLine(0, 9, 128, 9, 1);
+
+    if (peer_count_ == 0) {
+        display_->setCursor(0, 12);
+        display_->print("No approved testers");
+        display_->display();
+        return;
+    }
+
+    // Scroll so the cursor stays visible
+    size_t first = edit_cursor_ >= EDIT_ROWS_ ? edit_cursor_ - EDIT_ROWS_ + 1 : 0;
+    int16_t y_pos = 12;
+    for (size_t i = first; i < peer_count_ && i < first + EDIT_ROWS_; ++i) {
+        bool highlighted = (i == edit_cursor_);
+        if (highlighted) {
+            display_->fillRect(0, y_pos - 1, 128, 10, 1);
+            display_->setTextColor(0);
+        }
+        snprintf(buf, sizeof(buf), "[%c] Tester %02X%02X", chosen_[i] ? 'x' : ' ', peers_[i][4], peers_[i][5]);
+        display_->setCursor(4, y_pos);
+        display_->print(buf);
+        if (highlighted) {
+            display_->setTextColor(1);
+        }
+        y_pos += 10;
+    }
+
+    display_->display();
+}
+
+void GroupsScreen::beginEdit() noexcept
+{
+    static ApprovedPeer s_peers[LIST_MAX_];
+    peer_count_ = espnow::GetApprovedPeersOfType(DeviceType::FatigueTester, s_peers, LIST_MAX_);
+
+    PeerGroups::Group group{};
+    bool defined = PeerGroups::GetGroup(group_, group) && group.valid;
+    for (size_t i = 0; i < peer_count_; ++i) {
+        std::memcpy(peers_[i], s_peers[i].mac, sizeof(peers_[i]));
+        chosen_[i] = false;
+        for (size_t m = 0; defined && m < group.member_count; ++m) {
+            chosen_[i] = chosen_[i] || MacEquals(group.members[m], peers_[i]);
+        }
+    }
+    edit_cursor_ = 0;
+    editing_ = true;
+}
+
+void GroupsScreen::saveEdit() noexcept
+{
+    editing_ = false;
+
+    uint8_t members[PeerGroups::MAX_MEMBERS_][6];
+    size_t count = 0;
+    for (size_t i = 0; i < peer_count_ && count < PeerGroups::MAX_MEMBERS_; ++i) {
+        if (chosen_[i]) {
+            std::memcpy(members[count++], peers_[i], sizeof(members[0]));
+        }
+    }
+    if (count == 0) {
+        PeerGroups::ClearGroup(group_);
+        return;
+    }
+
+    // Keep the group's name; a new group is named after its slot
+    PeerGroups::Group group{};
+    char name[PeerGroups::NAME_LEN_];
+    if (PeerGroups::GetGroup(group_, group) && group.valid && group.name[0] != '\0') {
+        snprintf(name, sizeof(name), "%s", group.name);
+    } else {
+        snprintf(name, sizeof(name), "Group %u", group_ + 1);
+    }
+    if (!PeerGroups::SetGroup(group_, name, members, count)) {
+        ESP_LOGW(TAG_, "Group %u not saved", group_ + 1);
+        notice_ = "Not saved (busy?)";
+    }
+}
+
+void GroupsScreen::sendCommand(uint8_t command_id) noexcept
+{
+    PeerGroups::Group group{};
+    if (!PeerGroups::GetGroup(group_, group) || !group.valid) {
+        notice_ = "Group is empty";
+        return;
+    }
+
+    // Stop goes out at Safety priority and cuts a running group command short
+    espnow::TxPriority priority = (command_id == COMMAND_STOP_) ? espnow::TxPriority::Safety
+                                                               : espnow::TxPriority::Control;
+    if (!PeerGroups::SendCommand(group_, device_registry::DEVICE_ID_FATIGUE_TESTER_, command_id,
+                                 nullptr, 0, priority)) {
+        notice_ = "Busy, not sent";
+        return;
+    }
+    sending_ = true;
+}
+
+void GroupsScreen::pressRow() noexcept
+{
+    notice_ = nullptr;
+
+    if (editing_) {
+        if (edit_cursor_ >= peer_count_) return;
+        size_t chosen = 0;
+        for (size_t i = 0; i < peer_count_; ++i) {
+            chosen += chosen_[i] ? 1 : 0;
+        }
+        if (!chosen_[edit_cursor_] && chosen >= PeerGroups::MAX_MEMBERS_) {
+            notice_ = "Max 16 members";
+            return;
+        }
+        chosen_[edit_cursor_] = !chosen_[edit_cursor_];
+        return;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    bool armed = start_armed_ && (now - armed_tick_) < pdMS_TO_TICKS(START_CONFIRM_MS_);
+    start_armed_ = false;
+
+    switch (row_) {
+        case Row::Group:
+            group_ = static_cast<uint8_t>((group_ + 1) % PeerGroups::MAX_GROUPS_);
+            break;
+        case Row::Edit:
+            beginEdit();
+            break;
+        case Row::Start:
+            if (armed) {
+                sendCommand(COMMAND_START_);
+            } else {
+                start_armed_ = true;
+                armed_tick_ = now;
+            }
+            break;
+        case Row::Stop:
+            sendCommand(COMMAND_STOP_);
+            break;
+        case Row::Clear:
+            PeerGroups::ClearGroup(group_);
+            break;
+    }
+}
+
+void GroupsScreen::HandleButton(ButtonId button_id) noexcept
+{
+    if (button_id == ButtonId::Back) {
+        if (editing_) {
+            notice_ = nullptr;
+            saveEdit();
+        }
+    } else if (button_id == ButtonId::Confirm) {
+        pressRow();
+    }
+}
+
+void GroupsScreen::HandleEncoder(EC11Encoder::Direction direction) noexcept
+{
+    if (editing_) {
+        if (direction == EC11Encoder::Direction::CW && edit_cursor_ + 1 < peer_count_) {
+            edit_cursor_++;
+        } else if (direction == EC11Encoder::Direction::CCW && edit_cursor_ > 0) {
+            edit_cursor_--;
+        }
+        return;
+    }
+
+    uint8_t row = static_cast<uint8_t>(row_);
+    if (direction == EC11Encoder::Direction::CW && row + 1 < ROW_COUNT_) {
+        row_ = static_cast<Row>(row + 1);
+    } else if (direction == EC11Encoder::Direction::CCW && row > 0) {
+        row_ = static_cast<Row>(row - 1);
+    }
+    start_armed_ = false;
+}
+
+void GroupsScreen::HandleEncoderButton(bool pressed) noexcept
+{
+    if (pressed) {
+        pressRow();
+    }
+}
+
+void GroupsScreen::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
+{
+    (void)event;    // PeerGroups reads acks from the peer sessions
+}
+
+bool GroupsScreen::IsConnected() const noexcept
+{
+    return true;
+}
+
+void GroupsScreen::RequestStatus() noexcept
+{
+}
+
+uint32_t GroupsScreen::GetStatusPeriodMs() const noexcept
+{
+    return 0;
+}
+
+uint32_t GroupsScreen::GetRenderPeriodMs() const noexcept
+{
+    // Follow a group command until its result is in, and let an unconfirmed start lapse
+    return (visibility_ == ScreenVisibility::Main && (sending_ || start_armed_)) ? 250 : 0;
+}
+
+void GroupsScreen::BuildSettingsMenu(class MenuBuilder& builder) noexcept
+{
+    (void)builder;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file groups_screen.hpp
+ * @brief Peer group screen (local, no device behind it)
+ *
+ * Defines the PeerGroups from the approved fatigue testers and starts or
+ * stops every member of a group with one group command. Rows: the group
+ * (press to step to the next one), Edit members, Start all, Stop all and
+ * Clear. Edit lists the approved testers; the encoder button ticks members
+ * and Back saves. Start needs a second press within START_CONFIRM_MS_.
+ * The last group command's ack count and completion latency are shown in
+ * the title line.
+ */
+
+#pragma once
+
+#include "device_base.hpp"
+#include "../protocol/espnow_groups.hpp"
+
+class GroupsScreen : public DeviceBase {
+public:
+    GroupsScreen(class Adafruit_SH1106* display, class Settings* settings) noexcept;
+
+    // Public functions: PascalCase
+    uint8_t GetDeviceId() const noexcept override;
+    const char* GetDeviceName() const noexcept override;
+    void RenderMainScreen() noexcept override;
+    void HandleButton(ButtonId button_id) noexcept override;
+    void HandleEncoder(EC11Encoder::Direction direction) noexcept override;
+    void HandleEncoderButton(bool pressed) noexcept override;
+    void UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept override;
+    bool IsConnected() const noexcept override;
+    void RequestStatus() noexcept override;
+    uint32_t GetStatusPeriodMs() const noexcept override;
+    uint32_t GetRenderPeriodMs() const noexcept override;
+    void BuildSettingsMenu(class MenuBuilder& builder) noexcept override;
+
+    /**
+     * @brief Member list open; Back saves it instead of leaving the screen.
+     */
+    bool IsEditing() const noexcept { return editing_; }
+
+private:
+    enum class Row : uint8_t {
+        Group,
+        Edit,
+        Start,
+        Stop,
+        Clear,
+    };
+    static constexpr uint8_t ROW_COUNT_ = 5;
+    static constexpr size_t LIST_MAX_ = 32;             ///< Approved testers offered in Edit
+    static constexpr size_t EDIT_ROWS_ = 5;
+    static constexpr uint32_t START_CONFIRM_MS_ = 3000;
+    static constexpr uint8_t COMMAND_START_ = 1;        ///< Fatigue tester command ids
+    static constexpr uint8_t COMMAND_STOP_ = 4;
+
+    void pressRow() noexcept;
+    void beginEdit() noexcept;
+    void saveEdit() noexcept;
+    void sendCommand(uint8_t command_id) noexcept;
+    void renderEdit() noexcept;
+
+    // Member variables: snake_case + trailing underscore
+    uint8_t group_;
+    Row row_;
+    bool editing_;
+    size_t edit_cursor_;
+    size_t peer_count_;
+    uint8_t peers_[LIST_MAX_][6];
+    bool chosen_[LIST_MAX_];
+    bool start_armed_;
+    TickType_t armed_tick_;
+    bool sending_;                  ///< PeerGroups busy as of the last render
+    const char* notice_;            ///< One-off message for the title line, e.g. a rejected command
+};
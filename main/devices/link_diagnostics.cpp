@@ -0,0 +1,151 @@
+/**
+ * @file link_diagnostics.cpp
+ * @brief Link-quality screen implementation
+ */
+
+#include "link_diagnostics.hpp"
+#include "../devices/device_registry.hpp"
+#include "../protocol/espnow_rate.hpp"
+#include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
+#include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
+#include <cstdio>
+
+LinkDiagnostics::LinkDiagnostics(Adafruit_SH1106* display, Settings* settings) noexcept
+    : DeviceBase(display, settings)
+    , selected_(0)
+{
+    connected_ = true;  // Local screen: nothing to connect to
+}
+
+uint8_t LinkDiagnostics::GetDeviceId() const noexcept
+{
+    return device_registry::DEVICE_ID_LINK_DIAGNOSTICS_;
+}
+
+const char* LinkDiagnostics::GetDeviceName() const noexcept
+{
+    return "Link Diagnostics";
+}
+
+void LinkDiagnostics::RenderMainScreen() noexcept
+{
+    if (!display_) return;
+
+    display_->clearDisplay();
+    display_->setTextSize(1);
+    display_->setTextColor(1);
+    display_->setCursor(0, 0);
+
+    espnow::SessionInfo sessions[MAX_PEERS_];
+    size_t count = espnow::GetSessions(sessions, MAX_PEERS_);
+    if (count == 0) {
+        display_->print("Link Diagnostics\n\nNo peer traffic yet");
+        display_->display();
+        return;
+    }
+    if (selected_ >= count) {
+        selected_ = count - 1;
+    }
+
+    const espnow::SessionInfo& session = sessions[selected_];
+    espnow::LinkStats stats{};
+    espnow::GetLinkStats(session.mac, stats);
+
+    char buf[32];
+    char mac[18];
+    FormatMac(session.mac, mac, sizeof(mac));
+    const char* rate = RateControl::RateName(RateControl::DEFAULT_RATE_);
+    RateControl::PeerReport rates[RateControl::MAX_PEERS_];
+    size_t rate_count = RateControl::GetRates(rates, RateControl::MAX_PEERS_);
+    for (size_t i = 0; i < rate_count; ++i) {
+        if (MacEquals(rates[i].mac, session.mac)) rate = RateControl::RateName(rates[i].rate);
+    }
+    snprintf(buf, sizeof(buf), "Peer %u/%u %s %s\n", static_cast<unsigned>(selected_ + 1),
+             static_cast<unsigned>(count), session.connected ? "up" : "DOWN", rate);
+    display_->print(buf);
+    snprintf(buf, sizeof(buf), "%s\n", mac);
+    display_->print(buf);
+
+    if (stats.rssi_samples > 0) {
+        snprintf(buf, sizeof(buf), "RSSI %d avg %d min %d\n", stats.rssi_last, stats.rssi_avg, stats.rssi_min);
+    } else {
+        snprintf(buf, sizeof(buf), "RSSI --\n");
+    }
+    display_->print(buf);
+
+    // Loss rates in 0.1 % steps
+    uint32_t tx_loss = stats.tx_frames ? stats.tx_failures * 1000 / stats.tx_frames : 0;
+    snprintf(buf, sizeof(buf), "TX %lu fail %lu.%lu%%\n", static_cast<unsigned long>(stats.tx_frames),
+             static_cast<unsigned long>(tx_loss / 10), static_cast<unsigned long>(tx_loss % 10));
+    display_->print(buf);
+
+    uint32_t rx_total = stats.rx_messages + stats.rx_lost;
+    uint32_t rx_loss = rx_total ? stats.rx_lost * 1000 / rx_total : 0;
+    snprintf(buf, sizeof(buf), "RX %lu lost %lu.%lu%%\n", static_cast<unsigned long>(stats.rx_messages),
+             static_cast<unsigned long>(rx_loss / 10), static_cast<unsigned long>(rx_loss % 10));
+    display_->print(buf);
+
+    if (stats.rtt.count > 0) {
+        snprintf(buf, sizeof(buf), "RTT p50 %lu p95 %lu ms\n",
+                 static_cast<unsigned long>(stats.rtt.PercentileUs(50) / 1000),
+                 static_cast<unsigned long>(stats.rtt.PercentileUs(95) / 1000));
+    } else {
+        snprintf(buf, sizeof(buf), "RTT --\n");
+    }
+    display_->print(buf);
+
+    if (session.last_rx_age_ms != UINT32_MAX) {
+        snprintf(buf, sizeof(buf), "Last rx %lu ms ago\n", static_cast<unsigned long>(session.last_rx_age_ms));
+        display_->print(buf);
+    }
+
+    display_->display();
+}
+
+void LinkDiagnostics::HandleButton(ButtonId button_id) noexcept
+{
+    (void)button_id;
+}
+
+void LinkDiagnostics::HandleEncoder(EC11Encoder::Direction direction) noexcept
+{
+    if (direction == EC11Encoder::Direction::CW) {
+        selected_++;    // Clamped to the session count on render
+    } else if (direction == EC11Encoder::Direction::CCW && selected_ > 0) {
+        selected_--;
+    }
+}
+
+void LinkDiagnostics::HandleEncoderButton(bool pressed) noexcept
+{
+    (void)pressed;
+}
+
+void LinkDiagnostics::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
+{
+    (void)event;    // Reads the protocol's statistics directly
+}
+
+bool LinkDiagnostics::IsConnected() const noexcept
+{
+    return true;
+}
+
+void LinkDiagnostics::RequestStatus() noexcept
+{
+}
+
+uint32_t LinkDiagnostics::GetStatusPeriodMs() const noexcept
+{
+    return 0;
+}
+
+uint32_t LinkDiagnostics::GetRenderPeriodMs() const noexcept
+{
+    return (visibility_ == ScreenVisibility::Main) ? 500 : 0;
+}
+
+void LinkDiagnostics::BuildSettingsMenu(class MenuBuilder& builder) noexcept
+{
+    (void)builder;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file link_diagnostics.hpp
+ * @brief Link-quality screen for approved peers (local, no device behind it)
+ *
+ * Shows PHY rate, RSSI, MAC-level TX failures, receive gaps and request-to-ack
+ * RTT for one peer at a time; the encoder steps through every peer with a session.
+ * Meant for walking the floor to place controllers and testers.
+ */
+
+#pragma once
+
+#include "device_base.hpp"
+
+class LinkDiagnostics : public DeviceBase {
+public:
+    LinkDiagnostics(class Adafruit_SH1106* display, class Settings* settings) noexcept;
+
+    // Public functions: PascalCase
+    uint8_t GetDeviceId() const noexcept override;
+    const char* GetDeviceName() const noexcept override;
+    void RenderMainScreen() noexcept override;
+    void HandleButton(ButtonId button_id) noexcept override;
+    void HandleEncoder(EC11Encoder::Direction direction) noexcept override;
+    void HandleEncoderButton(bool pressed) noexcept override;
+    void UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept override;
+    bool IsConnected() const noexcept override;
+    void RequestStatus() noexcept override;
+    uint32_t GetStatusPeriodMs() const noexcept override;
+    uint32_t GetRenderPeriodMs() const noexcept override;
+    void BuildSettingsMenu(class MenuBuilder& builder) noexcept override;
+
+private:
+    static constexpr size_t MAX_PEERS_ = 16;    ///< Sessions listed on screen
+
+    // Member variables: snake_case + trailing underscore
+    size_t selected_;
+};
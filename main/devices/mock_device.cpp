@@ -5,11 +5,120 @@
 
 #include "mock_device.hpp"
 #include "../devices/device_registry.hpp"
+#include "../protocol/device_protocols.hpp"
 #include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
 #include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
+#include "../config.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 #include <cstdio>
+#include <cstring>
+
+// ============================================================================
+// SIMULATED UNIT
+// ============================================================================
+//
+// Stands in for the device firmware side of the status subscription: grants
+// StatusSubscribe requests, then posts StatusUpdate events into the protocol
+// event queue at the granted period until the lease runs out.
+// ============================================================================
+
+namespace {
+
+constexpr uint16_t SIM_MIN_PERIOD_MS_ = 50;
+constexpr uint64_t SIM_TICK_US_ = 10 * 1000;
+
+portMUX_TYPE s_sim_mux_ = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t s_sim_timer_ = nullptr;
+uint16_t s_sim_period_ms_ = 0;
+int64_t  s_sim_lease_end_us_ = 0;
+int64_t  s_sim_next_status_us_ = 0;
+device_protocols::MockDeviceStatusPayload s_sim_status_{};
+
+void simPostStatus()
+{
+    taskENTER_CRITICAL(&s_sim_mux_);
+    device_protocols::MockDeviceStatusPayload status = s_sim_status_;
+    status.value1++;
+    status.value2 = status.value1 * 3;
+    status.temperature = 25.0f + static_cast<float>(status.value1 % 20) * 0.1f;
+    status.status_flag = (status.value1 / 10) % 2;
+    s_sim_status_ = status;
+    taskEXIT_CRITICAL(&s_sim_mux_);
+
+    espnow::ProtoEvent evt{};
+    evt.type = espnow::MsgType::StatusUpdate;
+    evt.device_id = device_registry::DEVICE_ID_MOCK_;
+    evt.payload_len = sizeof(status);
+    std::memcpy(evt.payload, &status, sizeof(status));
+    espnow::InjectLocalEvent(evt);
+}
+
+void simTimerCb(void* arg)
+{
+    (void)arg;
+    int64_t now_us = esp_timer_get_time();
+    bool post = false;
+
+    taskENTER_CRITICAL(&s_sim_mux_);
+    if (s_sim_period_ms_ != 0 && now_us >= s_sim_lease_end_us_) {
+        s_sim_period_ms_ = 0;   // lease ran out without renewal
+    }
+    if (s_sim_period_ms_ != 0 && now_us >= s_sim_next_status_us_) {
+        s_sim_next_status_us_ += static_cast<int64_t>(s_sim_period_ms_) * 1000;
+        post = true;
+    }
+    taskEXIT_CRITICAL(&s_sim_mux_);
+
+    if (post) {
+        simPostStatus();
+    }
+}
+
+bool simSubscribe(const uint8_t* mac, uint8_t device_id, uint16_t period_ms, uint16_t lease_ms)
+{
+    (void)mac;
+    if (period_ms != 0 && period_ms < SIM_MIN_PERIOD_MS_) {
+        period_ms = SIM_MIN_PERIOD_MS_;
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_sim_mux_);
+    bool was_streaming = s_sim_period_ms_ != 0;
+    s_sim_period_ms_ = (lease_ms != 0) ? period_ms : 0;
+    s_sim_lease_end_us_ = now_us + static_cast<int64_t>(lease_ms) * 1000;
+    if (!was_streaming) {
+        s_sim_next_status_us_ = now_us;
+    }
+    taskEXIT_CRITICAL(&s_sim_mux_);
+
+    if (s_sim_timer_ == nullptr) {
+        esp_timer_create_args_t args{};
+        args.callback = simTimerCb;
+        args.name = "mock_sim";
+        if (esp_timer_create(&args, &s_sim_timer_) == ESP_OK) {
+            esp_timer_start_periodic(s_sim_timer_, SIM_TICK_US_);
+        }
+    }
+
+    espnow::StatusSubscribePayload ack{};
+    ack.period_ms = s_sim_period_ms_;
+    ack.lease_ms = (s_sim_period_ms_ != 0) ? lease_ms : 0;
+
+    espnow::ProtoEvent evt{};
+    evt.type = espnow::MsgType::SubscribeAck;
+    evt.device_id = device_id;
+    evt.payload_len = sizeof(ack);
+    std::memcpy(evt.payload, &ack, sizeof(ack));
+    return espnow::InjectLocalEvent(evt);
+}
+
+} // namespace
+
+// ============================================================================
+// MOCK DEVICE
+// ============================================================================
 
 MockDevice::MockDevice(Adafruit_SH1106* display, Settings* settings) noexcept
     : DeviceBase(display, settings)
@@ -17,6 +126,8 @@ MockDevice::MockDevice(Adafruit_SH1106* display, Settings* settings) noexcept
     , value2_(0)
     , temperature_(25.0f)
     , status_flag_(false)
+    , status_sub_(device_registry::DEVICE_ID_MOCK_, STATUS_STREAM_PERIOD_MS_, STATUS_STREAM_LEASE_MS_,
+                  simSubscribe)
 {
 }
 
@@ -48,6 +159,12 @@ void MockDevice::RenderMainScreen() noexcept
     snprintf(buf, sizeof(buf), "Temp: %.1fC\n", temperature_);
     display_->print(buf);
     display_->print(status_flag_ ? "Status: ON\n" : "Status: OFF\n");
+    if (status_sub_.IsStreaming()) {
+        snprintf(buf, sizeof(buf), "Stream: %u ms\n", status_sub_.GetGrantedPeriodMs());
+    } else {
+        snprintf(buf, sizeof(buf), "Polling\n");
+    }
+    display_->print(buf);
     
     display_->display();
 }
@@ -69,7 +186,21 @@ void MockDevice::HandleEncoderButton(bool pressed) noexcept
 
 void MockDevice::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
 {
-    (void)event; // TODO: Implement protocol handling
+    if (event.device_id != GetDeviceId()) return;
+
+    status_sub_.HandleEvent(event);
+
+    if (event.type == espnow::MsgType::StatusUpdate &&
+        event.payload_len >= sizeof(device_protocols::MockDeviceStatusPayload)) {
+        device_protocols::MockDeviceStatusPayload status{};
+        std::memcpy(&status, event.payload, sizeof(status));
+        value1_ = status.value1;
+        value2_ = status.value2;
+        temperature_ = status.temperature;
+        status_flag_ = status.status_flag;
+        connected_ = true;
+        last_status_tick_ = xTaskGetTickCount();
+    }
 }
 
 bool MockDevice::IsConnected() const noexcept
@@ -79,9 +210,10 @@ bool MockDevice::IsConnected() const noexcept
 
 void MockDevice::RequestStatus() noexcept
 {
-    // Simulate connection
-    connected_ = true;
-    last_status_tick_ = xTaskGetTickCount();
+    if (status_sub_.Service()) {
+        // Fallback poll: the simulated unit answers with a single status
+        simPostStatus();
+    }
 }
 
 void MockDevice::BuildSettingsMenu(class MenuBuilder& builder) noexcept
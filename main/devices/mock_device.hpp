@@ -6,6 +6,7 @@
 #pragma once
 
 #include "device_base.hpp"
+#include "status_subscription.hpp"
 
 class MockDevice : public DeviceBase {
 public:
@@ -29,5 +30,8 @@ private:
     uint32_t value2_;
     float temperature_;
     bool status_flag_;
+
+    // Streams from a local simulated unit (no radio involved)
+    StatusSubscription status_sub_;
 };
 
@@ -0,0 +1,186 @@
+/**
+ * @file pairing_screen.cpp
+ * @brief Pairing screen implementation
+ */
+
+#include "pairing_screen.hpp"
+#include "../devices/device_registry.hpp"
+#include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
+#include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
+#include "esp_log.h"
+#include <cstdio>
+
+static const char* TAG_ = "PairingScreen";
+
+static const char* const ACTION_NAMES_[] = {
+    "Pair one device",
+    "Pair all (sweep)",
+};
+
+PairingScreen::PairingScreen(Adafruit_SH1106* display, Settings* settings) noexcept
+    : DeviceBase(display, settings)
+    , selected_(Action::PairOne)
+    , last_started_(Action::PairOne)
+    , started_(false)
+    , state_(espnow::GetPairingState())
+{
+    connected_ = true;  // Local screen: nothing to connect to
+}
+
+uint8_t PairingScreen::GetDeviceId() const noexcept
+{
+    return device_registry::DEVICE_ID_PAIRING_;
+}
+
+const char* PairingScreen::GetDeviceName() const noexcept
+{
+    return "Pairing";
+}
+
+bool PairingScreen::IsBusy() const noexcept
+{
+    return state_ == espnow::PairingState::WaitingForResponse ||
+           state_ == espnow::PairingState::Sweeping ||
+           state_ == espnow::PairingState::Confirming;
+}
+
+void PairingScreen::RenderMainScreen() noexcept
+{
+    if (!display_) return;
+
+    state_ = espnow::GetPairingState();
+
+    display_->clearDisplay();
+    display_->setTextSize(1);
+    display_->setTextColor(1);
+    display_->setCursor(0, 0);
+    display_->print("Pairing");
+    display_->drawLine(0, 9, 128, 9, 1);
+
+    int16_t y_pos = 12;
+    for (uint8_t i = 0; i < ACTION_COUNT_; ++i) {
+        bool highlighted = (static_cast<uint8_t>(selected_) == i);
+        if (highlighted) {
+            display_->fillRect(0, y_pos - 1, 128, 10, 1);
+            display_->setTextColor(0); // Inverted text
+        }
+        display_->setCursor(4, y_pos);
+        display_->print("> ");
+        display_->print(ACTION_NAMES_[i]);
+        if (highlighted) {
+            display_->setTextColor(1);
+        }
+        y_pos += 11;
+    }
+
+    const char* status = "Confirm to start";
+    switch (state_) {
+        case espnow::PairingState::Idle:
+            status = started_ ? "Cancelled" : "Confirm to start";
+            break;
+        case espnow::PairingState::WaitingForResponse: status = "Searching... (Back)"; break;
+        case espnow::PairingState::Sweeping:           status = "Sweeping... (Back)";  break;
+        case espnow::PairingState::Confirming:         status = "Confirming...";       break;
+        case espnow::PairingState::Complete:           status = "Paired";              break;
+        case espnow::PairingState::Failed:
+            status = (last_started_ == Action::Sweep) ? "Nothing paired" : "No device / failed";
+            break;
+    }
+    display_->setCursor(0, 36);
+    display_->print(status);
+
+    // A single pairing has no counts; the sweep result belongs to the last sweep
+    espnow::PairingSweepResult result{};
+    if (started_ && last_started_ == Action::Sweep && espnow::GetPairingSweepResult(result)) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "OK %u fail %u rej %u", result.paired, result.failed, result.rejected);
+        display_->setCursor(0, 46);
+        display_->print(buf);
+        snprintf(buf, sizeof(buf), "%lu.%lu s %lu/min%s",
+                 static_cast<unsigned long>(result.duration_ms / 1000),
+                 static_cast<unsigned long>(result.duration_ms % 1000 / 100),
+                 static_cast<unsigned long>(result.devices_per_minute),
+                 result.overflow ? " +more" : "");
+        display_->setCursor(0, 56);
+        display_->print(buf);
+    }
+
+    display_->display();
+}
+
+void PairingScreen::startSelected() noexcept
+{
+    if (IsBusy()) return;
+
+    // StartPairing/StartPairingSweep need Idle: clear the last outcome first
+    if (espnow::GetPairingState() != espnow::PairingState::Idle) {
+        espnow::CancelPairing();
+    }
+
+    bool ok = (selected_ == Action::Sweep) ? espnow::StartPairingSweep() : espnow::StartPairing();
+    if (!ok) {
+        ESP_LOGW(TAG_, "%s could not start", ACTION_NAMES_[static_cast<uint8_t>(selected_)]);
+    }
+    last_started_ = selected_;
+    started_ = true;
+    state_ = espnow::GetPairingState();
+}
+
+void PairingScreen::HandleButton(ButtonId button_id) noexcept
+{
+    if (button_id == ButtonId::Back) {
+        if (IsBusy()) {
+            espnow::CancelPairing();
+            state_ = espnow::GetPairingState();
+        }
+    } else if (button_id == ButtonId::Confirm) {
+        startSelected();
+    }
+}
+
+void PairingScreen::HandleEncoder(EC11Encoder::Direction direction) noexcept
+{
+    if (IsBusy()) return;
+    if (direction == EC11Encoder::Direction::CW && static_cast<uint8_t>(selected_) + 1 < ACTION_COUNT_) {
+        selected_ = static_cast<Action>(static_cast<uint8_t>(selected_) + 1);
+    } else if (direction == EC11Encoder::Direction::CCW && selected_ != Action::PairOne) {
+        selected_ = static_cast<Action>(static_cast<uint8_t>(selected_) - 1);
+    }
+}
+
+void PairingScreen::HandleEncoderButton(bool pressed) noexcept
+{
+    if (pressed) {
+        startSelected();
+    }
+}
+
+void PairingScreen::UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept
+{
+    (void)event;    // Pairing frames are handled inside the protocol
+}
+
+bool PairingScreen::IsConnected() const noexcept
+{
+    return true;
+}
+
+void PairingScreen::RequestStatus() noexcept
+{
+}
+
+uint32_t PairingScreen::GetStatusPeriodMs() const noexcept
+{
+    return 0;
+}
+
+uint32_t PairingScreen::GetRenderPeriodMs() const noexcept
+{
+    // Follow the state machine while it runs; the render that sees it finish is the last
+    return (visibility_ == ScreenVisibility::Main && IsBusy()) ? 250 : 0;
+}
+
+void PairingScreen::BuildSettingsMenu(class MenuBuilder& builder) noexcept
+{
+    (void)builder;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file pairing_screen.hpp
+ * @brief Pairing screen (local, no device behind it)
+ *
+ * Pairs one device (espnow::StartPairing) or every device that answers one
+ * request (espnow::StartPairingSweep, for setting up a production line).
+ * The encoder picks the action, Confirm or the encoder button starts it and
+ * Back cancels one in progress; the sweep's counts stay on screen afterwards.
+ */
+
+#pragma once
+
+#include "device_base.hpp"
+
+class PairingScreen : public DeviceBase {
+public:
+    PairingScreen(class Adafruit_SH1106* display, class Settings* settings) noexcept;
+
+    // Public functions: PascalCase
+    uint8_t GetDeviceId() const noexcept override;
+    const char* GetDeviceName() const noexcept override;
+    void RenderMainScreen() noexcept override;
+    void HandleButton(ButtonId button_id) noexcept override;
+    void HandleEncoder(EC11Encoder::Direction direction) noexcept override;
+    void HandleEncoderButton(bool pressed) noexcept override;
+    void UpdateFromProtocol(const espnow::ProtoEvent& event) noexcept override;
+    bool IsConnected() const noexcept override;
+    void RequestStatus() noexcept override;
+    uint32_t GetStatusPeriodMs() const noexcept override;
+    uint32_t GetRenderPeriodMs() const noexcept override;
+    void BuildSettingsMenu(class MenuBuilder& builder) noexcept override;
+
+    /**
+     * @brief Pairing or a sweep is running (as of the last render); Back cancels it.
+     */
+    bool IsBusy() const noexcept;
+
+private:
+    enum class Action : uint8_t {
+        PairOne,    ///< espnow::StartPairing
+        Sweep,      ///< espnow::StartPairingSweep
+    };
+    static constexpr uint8_t ACTION_COUNT_ = 2;
+
+    void startSelected() noexcept;
+
+    // Member variables: snake_case + trailing underscore
+    Action selected_;
+    Action last_started_;           ///< Which action the shown result belongs to
+    bool started_;
+    espnow::PairingState state_;    ///< Polled on render; GetPairingState() also applies the timeout
+};
@@ -0,0 +1,166 @@
+/**
+ * @file status_subscription.cpp
+ * @brief Leased StatusUpdate stream with polling fallback
+ */
+
+#include "status_subscription.hpp"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <cstring>
+
+static const char* TAG_ = "StatusSub";
+
+StatusSubscription::StatusSubscription(uint8_t device_id, uint16_t period_ms, uint16_t lease_ms,
+                                       SendFn send) noexcept
+    : device_id_(device_id)
+    , period_ms_(period_ms)
+    , lease_ms_(lease_ms)
+    , send_(send)
+    , peer_mac_(nullptr)
+    , state_(State::Idle)
+    , unanswered_(0)
+    , granted_period_ms_(0)
+    , granted_lease_ms_(0)
+    , sent_tick_(0)
+    , granted_tick_(0)
+    , last_status_tick_(0)
+{
+}
+
+void StatusSubscription::sendSubscribe(TickType_t now) noexcept
+{
+    if (send_) {
+        send_(peer_mac_, device_id_, period_ms_, lease_ms_);
+    }
+    sent_tick_ = now;
+}
+
+bool StatusSubscription::Service() noexcept
+{
+    TickType_t now = xTaskGetTickCount();
+
+    switch (state_) {
+        case State::Idle:
+            sendSubscribe(now);
+            state_ = State::Requested;
+            return true;
+
+        case State::Requested:
+            if (now - sent_tick_ >= pdMS_TO_TICKS(ACK_TIMEOUT_MS_)) {
+                if (++unanswered_ >= MAX_UNANSWERED_) {
+                    ESP_LOGI(TAG_, "Device %u does not stream status, polling", device_id_);
+                    state_ = State::Unsupported;
+                    sent_tick_ = now;
+                } else {
+                    sendSubscribe(now);
+                }
+            }
+            return true;
+
+        case State::Active: {
+            TickType_t held = now - granted_tick_;
+            if (held >= pdMS_TO_TICKS(granted_lease_ms_)) {
+                // Renewals went unanswered: lease is gone, start over
+                ESP_LOGW(TAG_, "Status lease for device %u expired", device_id_);
+                state_ = State::Requested;
+                unanswered_ = 1;
+                granted_period_ms_ = 0;
+                sendSubscribe(now);
+                return true;
+            }
+            if (held >= pdMS_TO_TICKS(granted_lease_ms_ / 2) &&
+                now - sent_tick_ >= pdMS_TO_TICKS(ACK_TIMEOUT_MS_)) {
+                sendSubscribe(now);
+            }
+            // Granted but nothing arriving: poll until the stream shows up again
+            TickType_t since_status = now - last_status_tick_;
+            return since_status > pdMS_TO_TICKS(static_cast<uint32_t>(granted_period_ms_) * STALE_PERIODS_);
+        }
+
+        case State::Unsupported:
+            if (now - sent_tick_ >= pdMS_TO_TICKS(UNSUPPORTED_RETRY_MS_)) {
+                unanswered_ = 0;
+                state_ = State::Idle;
+            }
+            return true;
+    }
+    return true;
+}
+
+void StatusSubscription::HandleEvent(const espnow::ProtoEvent& event) noexcept
+{
+    if (event.device_id != device_id_) return;
+    // Bound to one peer: another tester's stream says nothing about this lease
+    if (peer_mac_ && std::memcmp(event.src_mac, peer_mac_, sizeof(event.src_mac)) != 0) return;
+
+    TickType_t now = xTaskGetTickCount();
+
+    if (event.type == espnow::MsgType::StatusUpdate || event.type == espnow::MsgType::StatusCompact) {
+        last_status_tick_ = now;
+    } else if (event.type == espnow::MsgType::DeviceInfo) {
+        // Advertised capabilities settle it without spending subscribe frames
+        espnow::PeerCapabilities caps{};
+        if (!espnow::ParseCapabilities(event.payload, event.payload_len, caps)) return;
+        bool streams = caps.Has(espnow::CAP_STATUS_STREAM_);
+        if (!streams && state_ != State::Unsupported) {
+            ESP_LOGI(TAG_, "Device %u does not advertise status streaming, polling", device_id_);
+            state_ = State::Unsupported;
+            granted_period_ms_ = 0;
+            sent_tick_ = now;
+        } else if (streams && state_ == State::Unsupported) {
+            unanswered_ = 0;
+            state_ = State::Idle;
+        }
+    } else if (event.type == espnow::MsgType::SubscribeAck &&
+               event.payload_len >= sizeof(espnow::StatusSubscribePayload)) {
+        espnow::StatusSubscribePayload ack{};
+        std::memcpy(&ack, event.payload, sizeof(ack));
+        unanswered_ = 0;
+
+        if (ack.period_ms == 0 || ack.lease_ms == 0) {
+            if (state_ != State::Idle) {
+                ESP_LOGI(TAG_, "Device %u rejected status stream, polling", device_id_);
+                state_ = State::Unsupported;
+                sent_tick_ = now;
+            }
+            granted_period_ms_ = 0;
+            return;
+        }
+
+        if (state_ != State::Active) {
+            ESP_LOGI(TAG_, "Device %u streaming status every %u ms (lease %u ms)",
+                     device_id_, ack.period_ms, ack.lease_ms);
+            last_status_tick_ = now;
+        }
+        state_ = State::Active;
+        granted_period_ms_ = ack.period_ms;
+        granted_lease_ms_ = ack.lease_ms;
+        granted_tick_ = now;
+    }
+}
+
+void StatusSubscription::SetPeriod(uint16_t period_ms) noexcept
+{
+    if (period_ms == period_ms_) return;
+    period_ms_ = period_ms;
+    if (state_ == State::Active || state_ == State::Requested) {
+        sendSubscribe(xTaskGetTickCount());
+    }
+}
+
+void StatusSubscription::Cancel() noexcept
+{
+    if (state_ == State::Active || state_ == State::Requested) {
+        if (send_) {
+            send_(peer_mac_, device_id_, 0, 0);
+        }
+    }
+    state_ = State::Idle;
+    unanswered_ = 0;
+    granted_period_ms_ = 0;
+}
+
+bool StatusSubscription::IsStreaming() const noexcept
+{
+    return state_ == State::Active;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file status_subscription.hpp
+ * @brief Leased StatusUpdate stream with polling fallback
+ *
+ * The controller asks a device to push StatusUpdate every period_ms for
+ * lease_ms. The lease is renewed at half-time while the device screen is open;
+ * if the controller stops renewing (screen closed, controller asleep) the
+ * device stops streaming on its own. Devices that never answer, or reject the
+ * request, are polled as before.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "../protocol/espnow_protocol.hpp"
+
+class StatusSubscription {
+public:
+    /// mac = nullptr addresses the current target
+    using SendFn = bool (*)(const uint8_t* mac, uint8_t device_id, uint16_t period_ms, uint16_t lease_ms);
+
+    StatusSubscription(uint8_t device_id, uint16_t period_ms, uint16_t lease_ms,
+                       SendFn send = espnow::SendStatusSubscribeTo) noexcept;
+
+    /**
+     * @brief Subscribe to a specific peer (see DeviceBase::GetPeerMac); nullptr = current target.
+     */
+    void SetPeer(const uint8_t* mac) noexcept { peer_mac_ = mac; }
+
+    /**
+     * @brief Drive subscribe/renew/retry. Call from the device's RequestStatus() (~1 Hz).
+     * @return true if the caller should fall back to polling this round
+     */
+    bool Service() noexcept;
+
+    /**
+     * @brief Feed protocol events (SubscribeAck, StatusUpdate and DeviceInfo are used).
+     *
+     * Once SetPeer() named a peer, only its events count.
+     */
+    void HandleEvent(const espnow::ProtoEvent& event) noexcept;
+
+    /**
+     * @brief Change the requested stream period; takes effect with an immediate re-subscribe.
+     */
+    void SetPeriod(uint16_t period_ms) noexcept;
+
+    /**
+     * @brief Ask the device to stop streaming.
+     */
+    void Cancel() noexcept;
+
+    bool IsStreaming() const noexcept;
+    uint16_t GetGrantedPeriodMs() const noexcept { return granted_period_ms_; }
+
+private:
+    enum class State : uint8_t {
+        Idle,           ///< Nothing requested yet
+        Requested,      ///< Subscribe sent, waiting for SubscribeAck
+        Active,         ///< Stream granted, lease running
+        Unsupported,    ///< Device did not answer or rejected; polling only
+    };
+
+    static constexpr uint32_t ACK_TIMEOUT_MS_ = 1000;
+    static constexpr uint8_t  MAX_UNANSWERED_ = 3;            ///< Then treat the device as v1 (no streaming)
+    static constexpr uint32_t UNSUPPORTED_RETRY_MS_ = 30000;  ///< Re-probe after a device firmware update
+    static constexpr uint8_t  STALE_PERIODS_ = 3;             ///< Missed stream periods before polling again
+
+    void sendSubscribe(TickType_t now) noexcept;
+
+    uint8_t device_id_;
+    uint16_t period_ms_;
+    uint16_t lease_ms_;
+    SendFn send_;
+    const uint8_t* peer_mac_;   ///< Owned by the device
+
+    State state_;
+    uint8_t unanswered_;
+    uint16_t granted_period_ms_;
+    uint16_t granted_lease_ms_;
+    TickType_t sent_tick_;
+    TickType_t granted_tick_;
+    TickType_t last_status_tick_;
+};
@@ -14,6 +14,11 @@
 
 #include "config.hpp"
 #include "protocol/espnow_protocol.hpp"
+#include "protocol/espnow_groups.hpp"
+#include "protocol/espnow_channel.hpp"
+#include "protocol/espnow_rate.hpp"
+#include "protocol/espnow_bulk.hpp"
+#include "protocol/espnow_time.hpp"
 #include "button.hpp"
 #include "settings.hpp"
 #include "ui/ui_controller.hpp"
@@ -73,8 +78,21 @@ extern "C" void app_main(void)
     g_proto_queue_  = xQueueCreate(10, sizeof(espnow::ProtoEvent));
     g_ui_queue_     = xQueueCreate(10, sizeof(ButtonEvent)); // Store button events directly
 
+    // Initialize UI controller before anything posts to the queues it waits on:
+    // they can only join its wake set while empty
+    g_last_activity_tick_ = xTaskGetTickCount();
+    if (!g_ui_controller.Init(g_ui_queue_, &g_settings, &g_last_activity_tick_)) {
+        ESP_LOGE(TAG_MAIN_, "Failed to initialize UI controller");
+        return;
+    }
+
     // Init ESPNOW
     espnow::Init(g_proto_queue_);
+    ChannelManager::Init();
+    PeerGroups::Init();
+    RateControl::Init();
+    BulkTransfer::Init();
+    TimeSync::Init();
     LogMacBanner();
 
     // Buttons (ISR->g_button_queue_)
@@ -83,13 +101,6 @@ extern "C" void app_main(void)
     // Configure deep sleep wake from buttons
     Buttons::ConfigureWakeup();
 
-    // Initialize UI controller
-    g_last_activity_tick_ = xTaskGetTickCount();
-    if (!g_ui_controller.Init(g_ui_queue_, &g_settings, &g_last_activity_tick_)) {
-        ESP_LOGE(TAG_MAIN_, "Failed to initialize UI controller");
-        return;
-    }
-
     // Launch tasks
     xTaskCreate(button_task, "button_task", 4096, nullptr, 6, nullptr);
     xTaskCreate(proto_task,  "proto_task",  4096, nullptr, 5, nullptr);
@@ -145,8 +156,10 @@ static void power_task(void* arg)
         if (now - g_last_activity_tick_ > timeout_ticks) {
             ESP_LOGI(TAG_MAIN_, "Inactivity timeout reached, entering deep sleep");
 
-            // Prepare UI for sleep
-            g_ui_controller.PrepareForSleep();
+            // Prepare UI for sleep (settings flush and sleep screen run in the UI task)
+            if (!g_ui_controller.RequestSleep(pdMS_TO_TICKS(2000))) {
+                ESP_LOGW(TAG_MAIN_, "UI task did not prepare for sleep in time");
+            }
 
             vTaskDelay(pdMS_TO_TICKS(100));
             esp_deep_sleep_start();
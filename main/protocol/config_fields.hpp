@@ -0,0 +1,165 @@
+/**
+ * @file config_fields.hpp
+ * @brief TLV encoding of per-field configuration updates
+ *
+ * A ConfigFieldSet/ConfigFieldReport payload is a sequence of records
+ * { uint8 id, uint8 len, value[len] }. Each device type describes its config
+ * struct with a ConfigFieldDesc table (id, byte offset, size), so the same
+ * codec serves every device. Decoding skips ids it does not know and records
+ * whose length does not match the table, which lets either side add fields
+ * without breaking the other.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace espnow {
+
+#pragma pack(push, 1)
+struct ConfigFieldHeader {
+    uint8_t id;
+    uint8_t len;
+};
+
+/// One entry of a ConfigFieldAck payload (repeated once per received field)
+struct ConfigFieldStatus {
+    uint8_t id;
+    uint8_t result;     ///< ConfigFieldResult
+};
+#pragma pack(pop)
+
+enum class ConfigFieldResult : uint8_t {
+    Applied = 0,
+    UnknownField,       ///< Receiver has no field with this id (older firmware)
+    BadLength,
+    OutOfRange,         ///< Value rejected; receiver keeps its previous value
+};
+
+struct ConfigFieldDesc {
+    uint8_t id;
+    uint8_t offset;     ///< Byte offset into the device's config struct
+    uint8_t size;
+};
+
+/// Field tables are indexed into 32-bit masks
+static constexpr size_t CONFIG_FIELDS_MAX_ = 32;
+
+inline const ConfigFieldDesc* FindConfigField(const ConfigFieldDesc* fields, size_t count,
+                                              uint8_t id, size_t* index_out = nullptr) noexcept
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (fields[i].id == id) {
+            if (index_out) *index_out = i;
+            return &fields[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Encode every field that is not in known_mask or differs from baseline.
+ *
+ * @param image Current config struct
+ * @param baseline Values the peer is known to hold (bits set in known_mask)
+ * @param known_mask Bit i set if baseline is valid for fields[i]
+ * @param sent_mask Receives the bits of the fields written to out
+ * @return Bytes written (0 if nothing changed). Fields that do not fit are left
+ *         out of sent_mask so the caller can send them next time.
+ */
+inline size_t EncodeConfigFields(const ConfigFieldDesc* fields, size_t count,
+                                 const void* image, const void* baseline, uint32_t known_mask,
+                                 uint8_t* out, size_t out_cap, uint32_t* sent_mask) noexcept
+{
+    const uint8_t* cur = static_cast<const uint8_t*>(image);
+    const uint8_t* base = static_cast<const uint8_t*>(baseline);
+    size_t pos = 0;
+    uint32_t sent = 0;
+
+    for (size_t i = 0; i < count && i < CONFIG_FIELDS_MAX_; ++i) {
+        const ConfigFieldDesc& f = fields[i];
+        bool known = (known_mask & (1u << i)) != 0;
+        if (known && std::memcmp(cur + f.offset, base + f.offset, f.size) == 0) {
+            continue;
+        }
+        if (pos + sizeof(ConfigFieldHeader) + f.size > out_cap) {
+            continue;
+        }
+        out[pos++] = f.id;
+        out[pos++] = f.size;
+        std::memcpy(out + pos, cur + f.offset, f.size);
+        pos += f.size;
+        sent |= (1u << i);
+    }
+
+    if (sent_mask) *sent_mask = sent;
+    return pos;
+}
+
+/**
+ * @brief Apply TLV records to a config struct.
+ *
+ * @param applied_mask Receives the bits of the fields written into image
+ * @return false if the payload is truncated mid-record (records before the
+ *         truncation are still applied)
+ */
+inline bool DecodeConfigFields(const ConfigFieldDesc* fields, size_t count,
+                               const uint8_t* data, size_t len,
+                               void* image, uint32_t* applied_mask) noexcept
+{
+    uint8_t* dst = static_cast<uint8_t*>(image);
+    uint32_t applied = 0;
+    size_t pos = 0;
+    bool ok = true;
+
+    while (pos < len) {
+        if (pos + sizeof(ConfigFieldHeader) > len) {
+            ok = false;
+            break;
+        }
+        uint8_t id = data[pos];
+        uint8_t flen = data[pos + 1];
+        pos += sizeof(ConfigFieldHeader);
+        if (pos + flen > len) {
+            ok = false;
+            break;
+        }
+
+        size_t index = 0;
+        const ConfigFieldDesc* f = FindConfigField(fields, count, id, &index);
+        if (f && f->size == flen && index < CONFIG_FIELDS_MAX_) {
+            std::memcpy(dst + f->offset, data + pos, flen);
+            applied |= (1u << index);
+        }
+        pos += flen;
+    }
+
+    if (applied_mask) *applied_mask = applied;
+    return ok;
+}
+
+/**
+ * @brief Apply a legacy fixed-layout payload: a field is present if the
+ *        payload covers all of its bytes.
+ */
+inline void DecodeLegacyConfig(const ConfigFieldDesc* fields, size_t count,
+                               const uint8_t* data, size_t len,
+                               void* image, uint32_t* applied_mask) noexcept
+{
+    uint8_t* dst = static_cast<uint8_t*>(image);
+    uint32_t applied = 0;
+
+    for (size_t i = 0; i < count && i < CONFIG_FIELDS_MAX_; ++i) {
+        const ConfigFieldDesc& f = fields[i];
+        if (static_cast<size_t>(f.offset) + f.size <= len) {
+            std::memcpy(dst + f.offset, data + f.offset, f.size);
+            applied |= (1u << i);
+        }
+    }
+
+    if (applied_mask) *applied_mask = applied;
+}
+
+} // namespace espnow
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include "../protocol/espnow_protocol.hpp"
+#include "../protocol/config_fields.hpp"
 
 // Device-specific payload structures
 namespace device_protocols {
@@ -24,9 +26,9 @@ namespace device_protocols {
  * @details
  * This structure is sent in CONFIG_SET messages and received in CONFIG_RESPONSE.
  * Extended fields (float parameters) are optional - older firmware versions
- * may not support them. When sending, always send the full structure.
- * When receiving, check the payload length to determine if extended fields
- * are present.
+ * may not support them. When receiving, FATIGUE_CONFIG_FIELDS_ tells which
+ * fields a short payload covers. Firmware that speaks ConfigFieldSet gets only
+ * the changed fields instead of this structure.
  * 
  * PROTOCOL V2: Uses direct velocity/acceleration control instead of cycle time.
  */
@@ -53,11 +55,28 @@ struct FatigueTestConfigPayload {
 
 /**
  * @brief Status update payload for fatigue test device.
+ *
+ * @details
+ * device_time_us is optional: firmware that answers TimeSync stamps the
+ * sample with its esp_timer time, which TimeSync::ToControllerTime() maps
+ * onto the controller clock. Older firmware sends the 6-byte base.
  */
 struct FatigueTestStatusPayload {
     uint32_t cycle_number;  ///< Current cycle count
     uint8_t  state;         ///< FatigueTestState enum value
     uint8_t  err_code;      ///< Error code if state == Error
+
+    // Optional
+    int64_t  device_time_us;    ///< Device esp_timer time the status was sampled
+};
+
+/**
+ * @brief Error payload for fatigue test device; only err_code is required.
+ */
+struct FatigueTestErrorPayload {
+    uint8_t  err_code;
+    uint8_t  severity;          ///< 1=low, 2=medium, 3=high; 3 if absent
+    int64_t  device_time_us;    ///< Device esp_timer time the error occurred (optional)
 };
 
 /**
@@ -96,6 +115,408 @@ enum class FatigueTestCommandId : uint8_t {
 // Size constants for payload validation
 static constexpr size_t FATIGUE_TEST_CONFIG_BASE_SIZE = 17;     ///< Base config payload size (without extended fields)
 static constexpr size_t FATIGUE_TEST_CONFIG_FULL_SIZE = sizeof(FatigueTestConfigPayload);  ///< Full config payload size
+static constexpr size_t FATIGUE_TEST_STATUS_BASE_SIZE = 6;      ///< Status payload without device_time_us
+static constexpr size_t FATIGUE_TEST_ERROR_BASE_SIZE = 1;       ///< Error payload with err_code only
+
+/**
+ * @brief Field ids for ConfigFieldSet/ConfigFieldReport.
+ * 
+ * Ids are permanent: never renumber or reuse one. New parameters get the next
+ * free id and an entry in FATIGUE_CONFIG_FIELDS_.
+ */
+enum class FatigueConfigField : uint8_t {
+    CycleAmount = 1,
+    OscillationVmaxRpm,
+    OscillationAmaxRevS2,
+    DwellTimeMs,
+    BoundsMethod,
+    BoundsSearchVelocityRpm,
+    StallguardMinVelocityRpm,
+    StallDetectionCurrentFactor,
+    BoundsSearchAccelRevS2,
+    StallguardSgt,
+};
+
+/// Field layout of FatigueTestConfigPayload; also used to decode legacy ConfigResponse by length
+inline constexpr espnow::ConfigFieldDesc FATIGUE_CONFIG_FIELDS_[] = {
+    { static_cast<uint8_t>(FatigueConfigField::CycleAmount),
+      offsetof(FatigueTestConfigPayload, cycle_amount), sizeof(FatigueTestConfigPayload::cycle_amount) },
+    { static_cast<uint8_t>(FatigueConfigField::OscillationVmaxRpm),
+      offsetof(FatigueTestConfigPayload, oscillation_vmax_rpm), sizeof(FatigueTestConfigPayload::oscillation_vmax_rpm) },
+    { static_cast<uint8_t>(FatigueConfigField::OscillationAmaxRevS2),
+      offsetof(FatigueTestConfigPayload, oscillation_amax_rev_s2), sizeof(FatigueTestConfigPayload::oscillation_amax_rev_s2) },
+    { static_cast<uint8_t>(FatigueConfigField::DwellTimeMs),
+      offsetof(FatigueTestConfigPayload, dwell_time_ms), sizeof(FatigueTestConfigPayload::dwell_time_ms) },
+    { static_cast<uint8_t>(FatigueConfigField::BoundsMethod),
+      offsetof(FatigueTestConfigPayload, bounds_method), sizeof(FatigueTestConfigPayload::bounds_method) },
+    { static_cast<uint8_t>(FatigueConfigField::BoundsSearchVelocityRpm),
+      offsetof(FatigueTestConfigPayload, bounds_search_velocity_rpm), sizeof(FatigueTestConfigPayload::bounds_search_velocity_rpm) },
+    { static_cast<uint8_t>(FatigueConfigField::StallguardMinVelocityRpm),
+      offsetof(FatigueTestConfigPayload, stallguard_min_velocity_rpm), sizeof(FatigueTestConfigPayload::stallguard_min_velocity_rpm) },
+    { static_cast<uint8_t>(FatigueConfigField::StallDetectionCurrentFactor),
+      offsetof(FatigueTestConfigPayload, stall_detection_current_factor), sizeof(FatigueTestConfigPayload::stall_detection_current_factor) },
+    { static_cast<uint8_t>(FatigueConfigField::BoundsSearchAccelRevS2),
+      offsetof(FatigueTestConfigPayload, bounds_search_accel_rev_s2), sizeof(FatigueTestConfigPayload::bounds_search_accel_rev_s2) },
+    { static_cast<uint8_t>(FatigueConfigField::StallguardSgt),
+      offsetof(FatigueTestConfigPayload, stallguard_sgt), sizeof(FatigueTestConfigPayload::stallguard_sgt) },
+};
+
+static constexpr size_t FATIGUE_CONFIG_FIELD_COUNT_ = sizeof(FATIGUE_CONFIG_FIELDS_) / sizeof(FATIGUE_CONFIG_FIELDS_[0]);
+static_assert(FATIGUE_CONFIG_FIELD_COUNT_ <= espnow::CONFIG_FIELDS_MAX_);
+
+// ============================================================================
+// Fatigue Test Compact Status (StatusCompact)
+// ============================================================================
+
+/*
+ * A StatusCompact payload is
+ *
+ *   uint8  flags       COMPACT_STATUS_* bits
+ *   uint8  seq         This sample's sequence number
+ *   uint8  ref         Reference sample (absent in a key frame)
+ *   varint cycle       Absolute in a key frame, else zigzag delta from the reference
+ *   uint8  state       If COMPACT_STATUS_STATE_ (always in a key frame)
+ *   uint8  err_code    If COMPACT_STATUS_ERR_ (always in a key frame)
+ *   varint time        If COMPACT_STATUS_TIME_: device_time_us, absolute in a key
+ *                      frame, else zigzag delta from the reference
+ *   uint8  extras      If COMPACT_STATUS_EXTRA_: COMPACT_EXTRA_* bits, followed by
+ *                      one zigzag varint per set bit, lowest bit first
+ *
+ * Varints are LEB128 (7 bits per byte, low group first). The reference is the
+ * last sample the controller acknowledged with StatusCompactAck, so a delta
+ * never depends on a frame that may have been lost. State and err_code are
+ * sent only when they differ from the reference; extras only when the device
+ * has them. Steady running costs 4 bytes, 7 with a device timestamp, against
+ * 14 for a stamped StatusUpdate. The controller acks key frames at once and every
+ * COMPACT_STATUS_ACK_EVERY_ samples after that; a sample whose reference it
+ * no longer holds is dropped and answered with STATUS_ACK_NEED_KEY_.
+ *
+ * Devices send StatusCompact only to a controller advertising
+ * CAP_COMPRESSION_, and the controller decodes per peer, so each link
+ * negotiates it on its own.
+ */
+
+static constexpr uint8_t COMPACT_STATUS_KEY_   = 1u << 0;   ///< No reference: absolute values
+static constexpr uint8_t COMPACT_STATUS_STATE_ = 1u << 1;
+static constexpr uint8_t COMPACT_STATUS_ERR_   = 1u << 2;
+static constexpr uint8_t COMPACT_STATUS_TIME_  = 1u << 3;
+static constexpr uint8_t COMPACT_STATUS_EXTRA_ = 1u << 4;
+
+static constexpr uint8_t COMPACT_EXTRA_CURRENT_     = 1u << 0;  ///< Motor current, mA
+static constexpr uint8_t COMPACT_EXTRA_TEMPERATURE_ = 1u << 1;  ///< Driver temperature, 0.1 °C
+static constexpr uint8_t COMPACT_EXTRA_POSITION_    = 1u << 2;  ///< Encoder position, counts
+static constexpr uint8_t COMPACT_EXTRA_COUNT_ = 3;
+
+static constexpr uint8_t COMPACT_STATUS_ACK_EVERY_ = 8;     ///< Decoded samples per ack after a key frame
+static constexpr uint8_t COMPACT_STATUS_REFS_ = 4;          ///< Acked samples either side keeps as references
+static constexpr size_t  COMPACT_STATUS_MAX_SIZE_ = 3 + 5 + 2 + 10 + 1 + COMPACT_EXTRA_COUNT_ * 5;
+
+static_assert(COMPACT_STATUS_MAX_SIZE_ <= espnow::MAX_PAYLOAD_SIZE_);
+
+/// One fatigue tester status sample, as carried by StatusCompact
+struct FatigueTestStatusSample {
+    uint32_t cycle_number;
+    uint8_t  state;             ///< FatigueTestState
+    uint8_t  err_code;
+    bool     has_time;
+    int64_t  device_time_us;
+    uint8_t  extras;            ///< COMPACT_EXTRA_* bits of the fields below that are present
+    int32_t  current_ma;
+    int32_t  temperature_dc;
+    int32_t  position;
+};
+
+inline uint64_t ZigZagEncode(int64_t value) noexcept
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) noexcept
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/// Append a varint at pos; false if it does not fit
+inline bool PutVarint(uint8_t* out, size_t cap, size_t& pos, uint64_t value) noexcept
+{
+    do {
+        if (pos >= cap) return false;
+        uint8_t byte = static_cast<uint8_t>(value & 0x7F);
+        value >>= 7;
+        out[pos++] = value ? static_cast<uint8_t>(byte | 0x80) : byte;
+    } while (value);
+    return true;
+}
+
+/// Read a varint at pos; false if it is truncated or longer than 64 bits
+inline bool GetVarint(const uint8_t* data, size_t len, size_t& pos, uint64_t& value) noexcept
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= len) return false;
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Encode a sample against ref (nullptr: key frame).
+ * @return Payload length, 0 if cap is too small
+ */
+inline size_t EncodeCompactStatus(const FatigueTestStatusSample& sample, uint8_t seq,
+                                  const FatigueTestStatusSample* ref, uint8_t ref_seq,
+                                  uint8_t* out, size_t cap) noexcept
+{
+    // A time delta needs a stamped reference; the first stamped sample goes out absolute
+    if (ref && sample.has_time && !ref->has_time) ref = nullptr;
+
+    uint8_t flags = 0;
+    if (!ref) flags |= COMPACT_STATUS_KEY_;
+    if (!ref || sample.state != ref->state) flags |= COMPACT_STATUS_STATE_;
+    if (!ref || sample.err_code != ref->err_code) flags |= COMPACT_STATUS_ERR_;
+    if (sample.has_time) flags |= COMPACT_STATUS_TIME_;
+    uint8_t extras = sample.extras & ((1u << COMPACT_EXTRA_COUNT_) - 1);
+    if (extras) flags |= COMPACT_STATUS_EXTRA_;
+
+    if (cap < 3) return 0;
+    size_t pos = 0;
+    out[pos++] = flags;
+    out[pos++] = seq;
+    if (ref) out[pos++] = ref_seq;
+
+    uint64_t cycle = ref ? ZigZagEncode(static_cast<int64_t>(sample.cycle_number) - ref->cycle_number)
+                         : sample.cycle_number;
+    if (!PutVarint(out, cap, pos, cycle)) return 0;
+
+    if (flags & COMPACT_STATUS_STATE_) {
+        if (pos >= cap) return 0;
+        out[pos++] = sample.state;
+    }
+    if (flags & COMPACT_STATUS_ERR_) {
+        if (pos >= cap) return 0;
+        out[pos++] = sample.err_code;
+    }
+    if (flags & COMPACT_STATUS_TIME_) {
+        uint64_t time = ref ? ZigZagEncode(sample.device_time_us - ref->device_time_us)
+                            : static_cast<uint64_t>(sample.device_time_us);
+        if (!PutVarint(out, cap, pos, time)) return 0;
+    }
+    if (flags & COMPACT_STATUS_EXTRA_) {
+        if (pos >= cap) return 0;
+        out[pos++] = extras;
+        const int32_t values[COMPACT_EXTRA_COUNT_] = { sample.current_ma, sample.temperature_dc, sample.position };
+        for (uint8_t i = 0; i < COMPACT_EXTRA_COUNT_; ++i) {
+            if ((extras & (1u << i)) && !PutVarint(out, cap, pos, ZigZagEncode(values[i]))) return 0;
+        }
+    }
+    return pos;
+}
+
+/// Convert to the StatusUpdate layout (device_time_us is 0 if unstamped)
+inline FatigueTestStatusPayload ToStatusPayload(const FatigueTestStatusSample& sample) noexcept
+{
+    FatigueTestStatusPayload status{};
+    status.cycle_number = sample.cycle_number;
+    status.state = sample.state;
+    status.err_code = sample.err_code;
+    status.device_time_us = sample.has_time ? sample.device_time_us : 0;
+    return status;
+}
+
+/**
+ * @brief Controller side of StatusCompact for one peer: decodes and decides acks.
+ *
+ * Keeps the last COMPACT_STATUS_REFS_ acked samples, because the device moves
+ * to a newer reference only once that ack arrives.
+ */
+class CompactStatusDecoder {
+public:
+    enum class Result : uint8_t {
+        Ok,
+        MissingReference,   ///< Delta against a sample not held (ack lost, or controller restarted)
+        Invalid,            ///< Truncated or malformed
+    };
+
+    Result Decode(const uint8_t* data, size_t len, FatigueTestStatusSample& out) noexcept
+    {
+        if (len < 2) return Result::Invalid;
+        uint8_t flags = data[0];
+        uint8_t seq = data[1];
+        size_t pos = 2;
+
+        const FatigueTestStatusSample* ref = nullptr;
+        if (!(flags & COMPACT_STATUS_KEY_)) {
+            if (pos >= len) return Result::Invalid;
+            ref = findRef(data[pos++]);
+            if (!ref) {
+                need_key_ = true;
+                return Result::MissingReference;
+            }
+        }
+
+        FatigueTestStatusSample sample{};
+        uint64_t value = 0;
+        if (!GetVarint(data, len, pos, value)) return Result::Invalid;
+        if (ref) {
+            sample.cycle_number = static_cast<uint32_t>(ref->cycle_number + ZigZagDecode(value));
+        } else if (value > UINT32_MAX) {
+            return Result::Invalid;
+        } else {
+            sample.cycle_number = static_cast<uint32_t>(value);
+        }
+
+        if (flags & COMPACT_STATUS_STATE_) {
+            if (pos >= len) return Result::Invalid;
+            sample.state = data[pos++];
+        } else if (ref) {
+            sample.state = ref->state;
+        }
+        if (flags & COMPACT_STATUS_ERR_) {
+            if (pos >= len) return Result::Invalid;
+            sample.err_code = data[pos++];
+        } else if (ref) {
+            sample.err_code = ref->err_code;
+        }
+        if (flags & COMPACT_STATUS_TIME_) {
+            if (!GetVarint(data, len, pos, value)) return Result::Invalid;
+            if (ref && !ref->has_time) return Result::Invalid;
+            sample.has_time = true;
+            sample.device_time_us = ref ? ref->device_time_us + ZigZagDecode(value) : static_cast<int64_t>(value);
+        }
+        if (flags & COMPACT_STATUS_EXTRA_) {
+            if (pos >= len) return Result::Invalid;
+            sample.extras = data[pos++];
+            if (sample.extras >> COMPACT_EXTRA_COUNT_) return Result::Invalid;
+            int32_t values[COMPACT_EXTRA_COUNT_] = {};
+            for (uint8_t i = 0; i < COMPACT_EXTRA_COUNT_; ++i) {
+                if (!(sample.extras & (1u << i))) continue;
+                if (!GetVarint(data, len, pos, value)) return Result::Invalid;
+                values[i] = static_cast<int32_t>(ZigZagDecode(value));
+            }
+            sample.current_ma = values[0];
+            sample.temperature_dc = values[1];
+            sample.position = values[2];
+        }
+
+        last_ = sample;
+        last_seq_ = seq;
+        has_last_ = true;
+        need_key_ = false;
+        if (!ref) {
+            ack_now_ = true;
+        }
+        if (since_ack_ < UINT8_MAX) since_ack_++;
+        out = sample;
+        return Result::Ok;
+    }
+
+    /// An ack is owed: after a key frame, every COMPACT_STATUS_ACK_EVERY_ samples, or to ask for a key
+    bool AckDue() const noexcept
+    {
+        return need_key_ || (has_last_ && (ack_now_ || since_ack_ >= COMPACT_STATUS_ACK_EVERY_));
+    }
+
+    /// Fill in the ack; the acknowledged sample becomes a reference
+    void BuildAck(espnow::StatusCompactAckPayload& ack) noexcept
+    {
+        ack = {};
+        if (need_key_ || !has_last_) {
+            ack.flags = espnow::STATUS_ACK_NEED_KEY_;
+            need_key_ = false;
+            return;
+        }
+        Ref& slot = refs_[next_ref_];
+        next_ref_ = static_cast<uint8_t>((next_ref_ + 1) % COMPACT_STATUS_REFS_);
+        slot.sample = last_;
+        slot.seq = last_seq_;
+        slot.valid = true;
+        ack.seq = last_seq_;
+        ack_now_ = false;
+        since_ack_ = 0;
+    }
+
+    /// Forget all references (the device rebooted or was re-paired)
+    void Reset() noexcept { *this = CompactStatusDecoder{}; }
+
+private:
+    struct Ref {
+        FatigueTestStatusSample sample;
+        uint8_t seq;
+        bool    valid;
+    };
+
+    const FatigueTestStatusSample* findRef(uint8_t seq) const noexcept
+    {
+        for (const Ref& ref : refs_) {
+            if (ref.valid && ref.seq == seq) return &ref.sample;
+        }
+        return nullptr;
+    }
+
+    Ref     refs_[COMPACT_STATUS_REFS_] = {};
+    uint8_t next_ref_ = 0;
+    FatigueTestStatusSample last_{};
+    uint8_t last_seq_ = 0;
+    bool    has_last_ = false;
+    bool    ack_now_ = false;
+    bool    need_key_ = false;
+    uint8_t since_ack_ = 0;
+};
+
+/**
+ * @brief Device side of StatusCompact, for firmware and host tests.
+ *
+ * Encodes against the newest acked sample it still remembers; until the
+ * first ack, and after STATUS_ACK_NEED_KEY_, every sample is a key frame.
+ */
+class CompactStatusEncoder {
+public:
+    size_t Encode(const FatigueTestStatusSample& sample, uint8_t* out, size_t cap) noexcept
+    {
+        uint8_t seq = next_seq_;
+        size_t len = EncodeCompactStatus(sample, seq, has_ref_ ? &ref_ : nullptr, ref_seq_, out, cap);
+        if (len == 0) return 0;
+        Sent& slot = sent_[seq % SENT_HISTORY_];
+        slot.sample = sample;
+        slot.seq = seq;
+        slot.valid = true;
+        next_seq_++;
+        return len;
+    }
+
+    void OnAck(const espnow::StatusCompactAckPayload& ack) noexcept
+    {
+        if (ack.flags & espnow::STATUS_ACK_NEED_KEY_) {
+            has_ref_ = false;
+            return;
+        }
+        const Sent& slot = sent_[ack.seq % SENT_HISTORY_];
+        if (!slot.valid || slot.seq != ack.seq) return;     // Too old to remember; keep the current one
+        ref_ = slot.sample;
+        ref_seq_ = ack.seq;
+        has_ref_ = true;
+    }
+
+    void Reset() noexcept { *this = CompactStatusEncoder{}; }
+
+private:
+    /// Acks arrive within a couple of samples; older ones are ignored
+    static constexpr uint8_t SENT_HISTORY_ = 2 * COMPACT_STATUS_ACK_EVERY_;
+
+    struct Sent {
+        FatigueTestStatusSample sample;
+        uint8_t seq;
+        bool    valid;
+    };
+
+    Sent    sent_[SENT_HISTORY_] = {};
+    uint8_t next_seq_ = 0;
+    FatigueTestStatusSample ref_{};
+    uint8_t ref_seq_ = 0;
+    bool    has_ref_ = false;
+};
 
 // ============================================================================
 // Mock Device Payloads (for demonstration/testing)
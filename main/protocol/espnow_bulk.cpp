@@ -0,0 +1,703 @@
+/**
+ * @file espnow_bulk.cpp
+ * @brief Windowed bulk transfer with selective acknowledgement
+ */
+
+#include "espnow_bulk.hpp"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstring>
+
+static const char* TAG = "BulkTransfer";
+
+namespace {
+
+constexpr size_t FLASH_SECTOR_SIZE = 4096;
+
+/// A bulk frame handed from the receive task to the transfer task
+struct Frame {
+    uint8_t         mac[6];
+    espnow::MsgType type;
+    uint8_t         len;
+    uint8_t         payload[espnow::MAX_PAYLOAD_SIZE_];
+};
+
+QueueHandle_t s_frames = nullptr;
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+BulkTransfer::Progress s_progress = {};     // Guarded by s_mux
+volatile bool s_abort = false;
+
+// Transfer parameters, set before the task starts
+uint8_t s_peer[6] = {};
+uint8_t s_transfer_id = 0;
+espnow::BulkDirection s_direction = espnow::BulkDirection::Download;
+espnow::BulkObject s_object = espnow::BulkObject::CycleHistory;
+uint32_t s_total_len = 0;
+uint8_t s_window = BulkTransfer::WINDOW_;
+BulkTransfer::Sink s_sink = {};
+BulkTransfer::Source s_source = {};
+int64_t s_start_us = 0;
+
+// Window state, transfer task only
+BulkTransfer::Receiver s_receiver;
+BulkTransfer::Sender s_sender;
+
+bool busy() noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    BulkTransfer::State state = s_progress.state;
+    taskEXIT_CRITICAL(&s_mux);
+    return state == BulkTransfer::State::Starting || state == BulkTransfer::State::Running;
+}
+
+/// Receive task: pass frames of the running transfer to the transfer task.
+void onFrame(const uint8_t src_mac[6], espnow::MsgType type, const uint8_t* payload, size_t len)
+{
+    if (!busy() || len == 0 || len > espnow::MAX_PAYLOAD_SIZE_ ||
+        payload[0] != s_transfer_id || !MacEquals(src_mac, s_peer)) {
+        return;
+    }
+    Frame frame{};
+    std::memcpy(frame.mac, src_mac, 6);
+    frame.type = type;
+    frame.len = static_cast<uint8_t>(len);
+    std::memcpy(frame.payload, payload, len);
+    xQueueSend(s_frames, &frame, 0);   // A full queue loses the frame; the window recovers it
+}
+
+TickType_t ticksUntil(int64_t deadline_us) noexcept
+{
+    int64_t remaining_us = deadline_us - esp_timer_get_time();
+    if (remaining_us <= 0) {
+        return 0;
+    }
+    TickType_t ticks = pdMS_TO_TICKS(static_cast<uint32_t>(remaining_us / 1000));
+    return ticks > 0 ? ticks : 1;
+}
+
+void setStatus(BulkTransfer::State state, espnow::BulkStatus status) noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    s_progress.state = state;
+    s_progress.status = status;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void updateProgress() noexcept
+{
+    int64_t now_us = esp_timer_get_time();
+    bool download = s_direction == espnow::BulkDirection::Download;
+
+    taskENTER_CRITICAL(&s_mux);
+    s_progress.done_bytes = download ? s_receiver.BytesDone() : s_sender.BytesAcked();
+    if (!download) {
+        s_progress.chunks_sent = s_sender.ChunksSent();
+        s_progress.retransmissions = s_sender.Retransmissions();
+        s_progress.srtt_us = s_sender.SrttUs();
+    } else {
+        s_progress.duplicates = s_receiver.Duplicates();
+    }
+    s_progress.elapsed_ms = static_cast<uint32_t>((now_us - s_start_us) / 1000);
+    s_progress.bytes_per_second = s_progress.elapsed_ms
+        ? static_cast<uint32_t>(static_cast<uint64_t>(s_progress.done_bytes) * 1000 / s_progress.elapsed_ms) : 0;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void countProgress(uint32_t BulkTransfer::Progress::* field) noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    s_progress.*field += 1;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+/// Download side: our window state as a BulkAck (or an abort with status).
+void sendAck(espnow::BulkStatus status) noexcept
+{
+    espnow::BulkAckPayload ack{};
+    s_receiver.BuildAck(ack);
+    ack.transfer_id = s_transfer_id;
+    ack.status = static_cast<uint8_t>(status);
+    if (espnow::SendBulkFrame(s_peer, espnow::MsgType::BulkAck, &ack, sizeof(ack), espnow::TxPriority::Polling)) {
+        countProgress(&BulkTransfer::Progress::acks);
+    }
+}
+
+void sendAbort(espnow::BulkStatus status) noexcept
+{
+    espnow::BulkAckPayload ack{};
+    ack.transfer_id = s_transfer_id;
+    ack.status = static_cast<uint8_t>(status);
+    espnow::SendBulkFrame(s_peer, espnow::MsgType::BulkAck, &ack, sizeof(ack), espnow::TxPriority::Polling);
+}
+
+/// A peer's BulkAck with a non-Ok status ends the transfer
+bool peerAborted(const Frame& frame, espnow::BulkAckPayload& ack) noexcept
+{
+    if (frame.type != espnow::MsgType::BulkAck || frame.len < sizeof(ack)) {
+        return false;
+    }
+    std::memcpy(&ack, frame.payload, sizeof(ack));
+    return ack.status != static_cast<uint8_t>(espnow::BulkStatus::Ok);
+}
+
+bool handshake() noexcept
+{
+    espnow::BulkStartPayload req{};
+    req.transfer_id = s_transfer_id;
+    req.direction = static_cast<uint8_t>(s_direction);
+    req.object_id = static_cast<uint16_t>(s_object);
+    req.total_len = (s_direction == espnow::BulkDirection::Upload) ? s_total_len : 0;
+    req.window = BulkTransfer::WINDOW_;
+
+    for (uint8_t attempt = 0; attempt < BulkTransfer::START_ATTEMPTS_ && !s_abort; ++attempt) {
+        int64_t deadline_us = esp_timer_get_time() + BulkTransfer::START_TIMEOUT_MS_ * 1000;
+        if (!espnow::SendBulkFrame(s_peer, espnow::MsgType::BulkStart, &req, sizeof(req),
+                                   espnow::TxPriority::Polling)) {
+            vTaskDelay(ticksUntil(deadline_us));
+            continue;
+        }
+        Frame frame{};
+        while (!s_abort && xQueueReceive(s_frames, &frame, ticksUntil(deadline_us)) == pdTRUE) {
+            espnow::BulkStartPayload answer{};
+            if (frame.type != espnow::MsgType::BulkStart || frame.len < sizeof(answer)) {
+                continue;
+            }
+            std::memcpy(&answer, frame.payload, sizeof(answer));
+            if (answer.window == 0 || answer.status != static_cast<uint8_t>(espnow::BulkStatus::Ok)) {
+                espnow::BulkStatus status = static_cast<espnow::BulkStatus>(answer.status);
+                setStatus(BulkTransfer::State::Failed,
+                          status == espnow::BulkStatus::Ok ? espnow::BulkStatus::Busy : status);
+                return false;
+            }
+            s_window = answer.window < BulkTransfer::WINDOW_ ? answer.window : BulkTransfer::WINDOW_;
+            if (s_direction == espnow::BulkDirection::Download) {
+                s_total_len = answer.total_len;
+            }
+            taskENTER_CRITICAL(&s_mux);
+            s_progress.state = BulkTransfer::State::Running;
+            s_progress.total_bytes = s_total_len;
+            taskEXIT_CRITICAL(&s_mux);
+            return true;
+        }
+    }
+    setStatus(BulkTransfer::State::Failed, s_abort ? espnow::BulkStatus::Aborted : espnow::BulkStatus::Timeout);
+    return false;
+}
+
+bool runDownload() noexcept
+{
+    if (!s_sink.open(s_sink.ctx, s_total_len)) {
+        sendAbort(espnow::BulkStatus::StorageError);
+        setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::StorageError);
+        return false;
+    }
+    s_receiver.Start(s_total_len, s_window);
+    int64_t last_rx_us = esp_timer_get_time();
+
+    while (!s_receiver.Complete()) {
+        if (s_abort) {
+            sendAck(espnow::BulkStatus::Aborted);
+            setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Aborted);
+            return false;
+        }
+        Frame frame{};
+        int64_t now_us = esp_timer_get_time();
+        if (xQueueReceive(s_frames, &frame, pdMS_TO_TICKS(BulkTransfer::ACK_DELAY_MS_)) == pdTRUE) {
+            now_us = esp_timer_get_time();
+            last_rx_us = now_us;
+            espnow::BulkAckPayload ack{};
+            if (peerAborted(frame, ack)) {
+                setStatus(BulkTransfer::State::Failed, static_cast<espnow::BulkStatus>(ack.status));
+                return false;
+            }
+            espnow::BulkDataHeader hdr{};
+            if (frame.type == espnow::MsgType::BulkData && frame.len >= sizeof(hdr)) {
+                std::memcpy(&hdr, frame.payload, sizeof(hdr));
+                countProgress(&BulkTransfer::Progress::chunks_received);
+                if (s_receiver.OnData(hdr.seq, frame.payload + sizeof(hdr), frame.len - sizeof(hdr),
+                                      s_sink, now_us) == BulkTransfer::Receiver::Result::SinkFailed) {
+                    sendAck(espnow::BulkStatus::StorageError);
+                    setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::StorageError);
+                    return false;
+                }
+            }
+        } else if (now_us - last_rx_us > static_cast<int64_t>(BulkTransfer::IDLE_TIMEOUT_MS_) * 1000) {
+            sendAck(espnow::BulkStatus::Aborted);
+            setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Timeout);
+            return false;
+        }
+        if (s_receiver.AckDue(now_us)) {
+            sendAck(espnow::BulkStatus::Ok);
+        }
+        updateProgress();
+    }
+
+    // The device may not have our last ack yet: answer its retransmissions for a while
+    int64_t linger_end_us = esp_timer_get_time() + BulkTransfer::LINGER_MS_ * 1000;
+    Frame frame{};
+    while (xQueueReceive(s_frames, &frame, ticksUntil(linger_end_us)) == pdTRUE) {
+        if (frame.type == espnow::MsgType::BulkData) {
+            sendAck(espnow::BulkStatus::Ok);
+        }
+    }
+    return true;
+}
+
+bool runUpload() noexcept
+{
+    s_sender.Start(s_total_len, s_window, esp_timer_get_time());
+    int64_t last_rx_us = esp_timer_get_time();
+
+    while (!s_sender.Complete()) {
+        if (s_abort) {
+            sendAbort(espnow::BulkStatus::Aborted);
+            setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Aborted);
+            return false;
+        }
+
+        // Fill the window; a full TX queue stops us until the next ack or tick
+        int64_t now_us = esp_timer_get_time();
+        uint32_t seq = 0;
+        while (s_sender.NextChunk(now_us, seq)) {
+            uint8_t payload[espnow::MAX_PAYLOAD_SIZE_];
+            espnow::BulkDataHeader hdr{};
+            hdr.transfer_id = s_transfer_id;
+            hdr.seq = seq;
+            size_t len = BulkTransfer::ChunkLength(s_total_len, seq);
+            std::memcpy(payload, &hdr, sizeof(hdr));
+            if (!s_source.read(s_source.ctx, seq * espnow::BULK_CHUNK_SIZE_, payload + sizeof(hdr), len)) {
+                sendAbort(espnow::BulkStatus::StorageError);
+                setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::StorageError);
+                return false;
+            }
+            if (!espnow::SendBulkFrame(s_peer, espnow::MsgType::BulkData, payload, sizeof(hdr) + len)) {
+                break;
+            }
+            s_sender.OnSent(seq, now_us);
+            now_us = esp_timer_get_time();
+        }
+        if (s_sender.Failed()) {
+            sendAbort(espnow::BulkStatus::Aborted);
+            setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Timeout);
+            return false;
+        }
+
+        Frame frame{};
+        if (xQueueReceive(s_frames, &frame, 1) == pdTRUE) {
+            now_us = esp_timer_get_time();
+            espnow::BulkAckPayload ack{};
+            if (peerAborted(frame, ack)) {
+                setStatus(BulkTransfer::State::Failed, static_cast<espnow::BulkStatus>(ack.status));
+                return false;
+            }
+            if (frame.type == espnow::MsgType::BulkAck && frame.len >= sizeof(ack)) {
+                last_rx_us = now_us;
+                countProgress(&BulkTransfer::Progress::acks);
+                s_sender.OnAck(ack.next_seq, ack.sack, now_us);
+            }
+        } else if (esp_timer_get_time() - last_rx_us > static_cast<int64_t>(BulkTransfer::IDLE_TIMEOUT_MS_) * 1000) {
+            sendAbort(espnow::BulkStatus::Aborted);
+            setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Timeout);
+            return false;
+        }
+        updateProgress();
+    }
+    return true;
+}
+
+void transferTask(void* arg) noexcept
+{
+    (void)arg;
+    bool download = s_direction == espnow::BulkDirection::Download;
+    bool ok = handshake();
+    bool sink_opened = ok && download;
+    if (ok) {
+        ok = download ? runDownload() : runUpload();
+    }
+    if (sink_opened) {
+        s_sink.close(s_sink.ctx, ok);
+    }
+
+    updateProgress();
+    if (ok) {
+        setStatus(BulkTransfer::State::Done, espnow::BulkStatus::Ok);
+    }
+    BulkTransfer::Progress progress = BulkTransfer::GetProgress();
+    ESP_LOGI(TAG, "%s of object %u %s: %lu/%lu bytes in %lu ms (%lu B/s), %lu retransmitted, %lu duplicates",
+             download ? "Download" : "Upload", progress.object_id, ok ? "done" : "failed",
+             static_cast<unsigned long>(progress.done_bytes), static_cast<unsigned long>(progress.total_bytes),
+             static_cast<unsigned long>(progress.elapsed_ms), static_cast<unsigned long>(progress.bytes_per_second),
+             static_cast<unsigned long>(progress.retransmissions), static_cast<unsigned long>(progress.duplicates));
+    vTaskDelete(nullptr);
+}
+
+bool startTransfer(const uint8_t mac[6], espnow::BulkDirection direction, espnow::BulkObject object,
+                   uint32_t total_len) noexcept
+{
+    if (s_frames == nullptr || busy()) {
+        return false;
+    }
+    espnow::PeerCapabilities caps{};
+    if (!espnow::GetPeerCapabilities(mac, caps) || !caps.Has(espnow::CAP_BULK_TRANSFER_)) {
+        ESP_LOGW(TAG, "Peer does not support bulk transfer");
+        return false;
+    }
+
+    xQueueReset(s_frames);
+    std::memcpy(s_peer, mac, 6);
+    s_direction = direction;
+    s_object = object;
+    s_total_len = total_len;
+    s_window = BulkTransfer::WINDOW_;
+    s_abort = false;
+    s_start_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_mux);
+    if (++s_transfer_id == 0) s_transfer_id = 1;
+    s_progress = BulkTransfer::Progress{};
+    s_progress.state = BulkTransfer::State::Starting;
+    s_progress.direction = direction;
+    s_progress.object_id = static_cast<uint16_t>(object);
+    s_progress.total_bytes = total_len;
+    taskEXIT_CRITICAL(&s_mux);
+
+    if (xTaskCreate(transferTask, "bulk_xfer", 4096, nullptr, 3, nullptr) != pdPASS) {
+        setStatus(BulkTransfer::State::Failed, espnow::BulkStatus::Busy);
+        return false;
+    }
+    return true;
+}
+
+// Sinks and sources
+
+bool streamOpen(void* ctx, uint32_t total_len) { (void)ctx; (void)total_len; return true; }
+
+bool streamWrite(void* ctx, uint32_t offset, const uint8_t* data, size_t len)
+{
+    (void)offset;
+    auto buffer = static_cast<StreamBufferHandle_t>(ctx);
+    return xStreamBufferSend(buffer, data, len, pdMS_TO_TICKS(BulkTransfer::SINK_TIMEOUT_MS_)) == len;
+}
+
+void streamClose(void* ctx, bool complete) { (void)ctx; (void)complete; }
+
+bool partitionOpen(void* ctx, uint32_t total_len)
+{
+    auto partition = static_cast<const esp_partition_t*>(ctx);
+    if (total_len > partition->size) {
+        ESP_LOGW(TAG, "Object of %lu bytes does not fit partition '%s'",
+                 static_cast<unsigned long>(total_len), partition->label);
+        return false;
+    }
+    size_t erase_len = (total_len + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+    return erase_len == 0 || esp_partition_erase_range(partition, 0, erase_len) == ESP_OK;
+}
+
+bool partitionWrite(void* ctx, uint32_t offset, const uint8_t* data, size_t len)
+{
+    return esp_partition_write(static_cast<const esp_partition_t*>(ctx), offset, data, len) == ESP_OK;
+}
+
+void partitionClose(void* ctx, bool complete) { (void)ctx; (void)complete; }
+
+bool partitionRead(void* ctx, uint32_t offset, uint8_t* out, size_t len)
+{
+    return esp_partition_read(static_cast<const esp_partition_t*>(ctx), offset, out, len) == ESP_OK;
+}
+
+bool memoryRead(void* ctx, uint32_t offset, uint8_t* out, size_t len)
+{
+    std::memcpy(out, static_cast<const uint8_t*>(ctx) + offset, len);
+    return true;
+}
+
+} // namespace
+
+size_t BulkTransfer::ChunkLength(uint32_t total_len, uint32_t seq) noexcept
+{
+    uint64_t offset = static_cast<uint64_t>(seq) * espnow::BULK_CHUNK_SIZE_;
+    if (offset >= total_len) {
+        return 0;
+    }
+    uint64_t left = total_len - offset;
+    return left < espnow::BULK_CHUNK_SIZE_ ? static_cast<size_t>(left) : espnow::BULK_CHUNK_SIZE_;
+}
+
+uint32_t BulkTransfer::ChunkCount(uint32_t total_len) noexcept
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(total_len) + espnow::BULK_CHUNK_SIZE_ - 1) /
+                                 espnow::BULK_CHUNK_SIZE_);
+}
+
+// ============================================================================
+// RECEIVER
+// ============================================================================
+
+void BulkTransfer::Receiver::Start(uint32_t total_len, uint8_t window) noexcept
+{
+    total_len_ = total_len;
+    chunks_ = ChunkCount(total_len);
+    next_ = 0;
+    sack_ = 0;
+    window_ = (window == 0 || window > WINDOW_) ? WINDOW_ : window;
+    unacked_ = 0;
+    ack_now_ = false;
+    first_unacked_us_ = 0;
+    duplicates_ = 0;
+}
+
+BulkTransfer::Receiver::Result BulkTransfer::Receiver::OnData(uint32_t seq, const uint8_t* data, size_t len,
+                                                              const Sink& sink, int64_t now_us) noexcept
+{
+    if (seq >= chunks_ || len != ChunkLength(total_len_, seq)) {
+        return Result::Invalid;
+    }
+    if (seq < next_) {
+        // Our ack was lost or is late: repeat it
+        duplicates_++;
+        ack_now_ = true;
+        return Result::Duplicate;
+    }
+    uint32_t offset = seq - next_;
+    if (offset >= window_) {
+        ack_now_ = true;
+        return Result::OutOfWindow;
+    }
+
+    if (unacked_++ == 0) {
+        first_unacked_us_ = now_us;
+    }
+
+    if (offset > 0) {
+        uint32_t bit = 1u << (offset - 1);
+        if (sack_ & bit) {
+            duplicates_++;
+            ack_now_ = true;
+            return Result::Duplicate;
+        }
+        std::memcpy(held_[seq % WINDOW_], data, len);
+        sack_ |= bit;
+        ack_now_ = true;    // A gap: tell the sender now
+        return Result::Stored;
+    }
+
+    if (!sink.write(sink.ctx, seq * espnow::BULK_CHUNK_SIZE_, data, len)) {
+        return Result::SinkFailed;
+    }
+    next_++;
+    // Each step moves bit 0 onto next_ itself: a held chunk there goes out too
+    while (sack_ & 1) {
+        sack_ >>= 1;
+        if (!sink.write(sink.ctx, next_ * espnow::BULK_CHUNK_SIZE_, held_[next_ % WINDOW_],
+                        ChunkLength(total_len_, next_))) {
+            return Result::SinkFailed;
+        }
+        next_++;
+    }
+    sack_ >>= 1;
+
+    if (Complete()) {
+        ack_now_ = true;
+    }
+    return Result::Stored;
+}
+
+bool BulkTransfer::Receiver::AckDue(int64_t now_us) const noexcept
+{
+    return ack_now_ || unacked_ >= ACK_EVERY_ ||
+           (unacked_ > 0 && now_us - first_unacked_us_ >= static_cast<int64_t>(ACK_DELAY_MS_) * 1000);
+}
+
+void BulkTransfer::Receiver::BuildAck(espnow::BulkAckPayload& ack) noexcept
+{
+    ack.status = static_cast<uint8_t>(espnow::BulkStatus::Ok);
+    ack.next_seq = next_;
+    ack.sack = sack_;
+    unacked_ = 0;
+    ack_now_ = false;
+}
+
+uint32_t BulkTransfer::Receiver::BytesDone() const noexcept
+{
+    return Complete() ? total_len_ : next_ * espnow::BULK_CHUNK_SIZE_;
+}
+
+// ============================================================================
+// SENDER
+// ============================================================================
+
+void BulkTransfer::Sender::Start(uint32_t total_len, uint8_t window, int64_t now_us) noexcept
+{
+    (void)now_us;
+    total_len_ = total_len;
+    chunks_ = ChunkCount(total_len);
+    base_ = 0;
+    next_new_ = 0;
+    window_ = (window == 0 || window > WINDOW_) ? WINDOW_ : window;
+    rack_sent_us_ = 0;
+    srtt_us_ = 0;
+    rto_us_ = INITIAL_RTO_MS_ * 1000;
+    failed_ = false;
+    bytes_acked_ = 0;
+    chunks_sent_ = 0;
+    retransmissions_ = 0;
+    for (auto& chunk : chunks_in_flight_) {
+        chunk = Chunk{};
+    }
+}
+
+bool BulkTransfer::Sender::NextChunk(int64_t now_us, uint32_t& seq) noexcept
+{
+    if (failed_) {
+        return false;
+    }
+
+    // Lost: a chunk sent after it was delivered (the link keeps order), or its timer ran out
+    for (uint32_t s = base_; s < next_new_; ++s) {
+        Chunk& chunk = chunks_in_flight_[s % WINDOW_];
+        if (chunk.acked) {
+            continue;
+        }
+        bool overtaken = chunk.sent_us < rack_sent_us_;
+        bool timed_out = now_us - chunk.sent_us >= static_cast<int64_t>(rto_us_);
+        if (!overtaken && !timed_out) {
+            continue;
+        }
+        if (chunk.transmissions > MAX_RETRANSMITS_) {
+            failed_ = true;
+            return false;
+        }
+        if (timed_out && !overtaken && s == base_) {
+            // Nothing newer got through either: back off
+            rto_us_ = (rto_us_ * 2 > MAX_RTO_MS_ * 1000) ? MAX_RTO_MS_ * 1000 : rto_us_ * 2;
+        }
+        seq = s;
+        return true;
+    }
+
+    if (next_new_ < chunks_ && next_new_ < base_ + window_) {
+        seq = next_new_;
+        return true;
+    }
+    return false;
+}
+
+void BulkTransfer::Sender::OnSent(uint32_t seq, int64_t now_us) noexcept
+{
+    Chunk& chunk = chunks_in_flight_[seq % WINDOW_];
+    if (seq == next_new_) {
+        chunk = Chunk{};
+        next_new_++;
+    } else {
+        retransmissions_++;
+    }
+    chunk.sent_us = now_us;
+    chunk.transmissions++;
+    chunks_sent_++;
+}
+
+void BulkTransfer::Sender::OnAck(uint32_t next_seq, uint32_t sack, int64_t now_us) noexcept
+{
+    if (next_seq > next_new_ || next_seq < base_) {
+        return;     // Acks data never sent, or an old ack overtaken by a newer one
+    }
+    for (uint32_t s = base_; s < next_seq; ++s) {
+        markAcked(s, now_us);
+    }
+    base_ = next_seq;
+    for (uint32_t i = 0; i < 32; ++i) {
+        uint32_t s = next_seq + 1 + i;
+        if ((sack & (1u << i)) && s < next_new_) {
+            markAcked(s, now_us);
+        }
+    }
+}
+
+void BulkTransfer::Sender::markAcked(uint32_t seq, int64_t now_us) noexcept
+{
+    Chunk& chunk = chunks_in_flight_[seq % WINDOW_];
+    if (chunk.acked) {
+        return;
+    }
+    chunk.acked = true;
+    bytes_acked_ += ChunkLength(total_len_, seq);
+
+    // Retransmitted chunks are ambiguous (which copy was acked?) and give no sample
+    if (chunk.transmissions == 1) {
+        uint32_t sample_us = static_cast<uint32_t>(now_us - chunk.sent_us);
+        srtt_us_ = srtt_us_ ? (7 * srtt_us_ + sample_us) / 8 : sample_us;
+        uint32_t rto = 2 * srtt_us_ + ACK_DELAY_MS_ * 1000;
+        if (rto < MIN_RTO_MS_ * 1000) rto = MIN_RTO_MS_ * 1000;
+        if (rto > MAX_RTO_MS_ * 1000) rto = MAX_RTO_MS_ * 1000;
+        rto_us_ = rto;
+        if (chunk.sent_us > rack_sent_us_) {
+            rack_sent_us_ = chunk.sent_us;
+        }
+    }
+}
+
+// ============================================================================
+// TRANSFERS
+// ============================================================================
+
+void BulkTransfer::Init() noexcept
+{
+    if (s_frames == nullptr) {
+        s_frames = xQueueCreate(WINDOW_, sizeof(Frame));
+    }
+    espnow::SetBulkFrameHandler(onFrame);
+}
+
+bool BulkTransfer::StartDownload(const uint8_t mac[6], espnow::BulkObject object, const Sink& sink) noexcept
+{
+    if (busy()) {
+        return false;
+    }
+    s_sink = sink;
+    return startTransfer(mac, espnow::BulkDirection::Download, object, 0);
+}
+
+bool BulkTransfer::StartUpload(const uint8_t mac[6], espnow::BulkObject object, uint32_t total_len,
+                               const Source& source) noexcept
+{
+    if (busy()) {
+        return false;
+    }
+    s_source = source;
+    return startTransfer(mac, espnow::BulkDirection::Upload, object, total_len);
+}
+
+void BulkTransfer::Abort() noexcept
+{
+    s_abort = true;
+}
+
+BulkTransfer::Progress BulkTransfer::GetProgress() noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    Progress progress = s_progress;
+    taskEXIT_CRITICAL(&s_mux);
+    return progress;
+}
+
+BulkTransfer::Sink BulkTransfer::StreamBufferSink(StreamBufferHandle_t buffer) noexcept
+{
+    return Sink{ streamOpen, streamWrite, streamClose, buffer };
+}
+
+BulkTransfer::Sink BulkTransfer::PartitionSink(const esp_partition_t* partition) noexcept
+{
+    return Sink{ partitionOpen, partitionWrite, partitionClose, const_cast<esp_partition_t*>(partition) };
+}
+
+BulkTransfer::Source BulkTransfer::MemorySource(const uint8_t* data) noexcept
+{
+    return Source{ memoryRead, const_cast<uint8_t*>(data) };
+}
+
+BulkTransfer::Source BulkTransfer::PartitionSource(const esp_partition_t* partition) noexcept
+{
+    return Source{ partitionRead, const_cast<esp_partition_t*>(partition) };
+}
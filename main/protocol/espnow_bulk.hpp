@@ -0,0 +1,220 @@
+/**
+ * @file espnow_bulk.hpp
+ * @brief Windowed bulk transfer with selective acknowledgement
+ *
+ * Moves an object (a device's cycle or error history, a config bundle) as a
+ * stream of BULK_CHUNK_SIZE_ chunks with up to WINDOW_ of them in flight.
+ * The receiver acks cumulatively plus a 32-chunk SACK bitmap, every
+ * ACK_EVERY_ chunks, after ACK_DELAY_MS_, or at once when a gap opens. The
+ * sender resends a chunk when one sent after it has been acked (a hole the
+ * SACK shows), or after its retransmit timeout. So one loss costs one extra
+ * frame, not a window.
+ *
+ * Data never sits in RAM as a whole. The receiver holds at most a window of
+ * out-of-order chunks and writes everything else in order to a Sink (a
+ * stream buffer the application drains, a flash partition). The sender reads
+ * chunks on demand from a Source, including for retransmissions.
+ *
+ * Sender and Receiver are the window logic alone (no radio, no clock) so
+ * they can be run against a lossy simulated link on the host. The transfer
+ * itself runs in a "bulk_xfer" task, one transfer at a time.
+ */
+
+#pragma once
+
+#include "espnow_protocol.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+#include "esp_partition.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace BulkTransfer {
+
+static constexpr uint8_t  WINDOW_ = 16;              ///< Chunks in flight (the SACK covers 32)
+static constexpr uint8_t  ACK_EVERY_ = 4;            ///< In-order chunks per ack
+static constexpr uint32_t ACK_DELAY_MS_ = 10;        ///< Longest a received chunk waits for its ack
+static constexpr uint32_t INITIAL_RTO_MS_ = 200;     ///< Before the first round-trip sample
+static constexpr uint32_t MIN_RTO_MS_ = 30;
+static constexpr uint32_t MAX_RTO_MS_ = 1000;
+static constexpr uint8_t  MAX_RETRANSMITS_ = 8;      ///< Per chunk, then the transfer fails
+static constexpr uint32_t IDLE_TIMEOUT_MS_ = 3000;   ///< Nothing from the peer for this long: fail
+static constexpr uint32_t START_TIMEOUT_MS_ = 300;   ///< Per BulkStart attempt
+static constexpr uint8_t  START_ATTEMPTS_ = 3;
+static constexpr uint32_t LINGER_MS_ = 500;          ///< Receiver re-acks a finished download this long
+static constexpr uint32_t SINK_TIMEOUT_MS_ = 1000;   ///< Stream buffer sink waits this long for room
+
+static_assert(WINDOW_ <= 32, "SACK bitmap covers 32 chunks");
+
+/// Where received data goes, written strictly in order
+struct Sink {
+    bool (*open)(void* ctx, uint32_t total_len);
+    bool (*write)(void* ctx, uint32_t offset, const uint8_t* data, size_t len);
+    void (*close)(void* ctx, bool complete);
+    void* ctx;
+};
+
+/// Where sent data comes from; read at any offset (retransmissions)
+struct Source {
+    bool (*read)(void* ctx, uint32_t offset, uint8_t* out, size_t len);
+    void* ctx;
+};
+
+/// Bytes in chunk seq of a total_len object
+size_t ChunkLength(uint32_t total_len, uint32_t seq) noexcept;
+
+/// Chunks in a total_len object
+uint32_t ChunkCount(uint32_t total_len) noexcept;
+
+// ============================================================================
+// WINDOW LOGIC
+// ============================================================================
+
+class Receiver {
+public:
+    enum class Result : uint8_t {
+        Stored,         ///< New chunk (written, or held until the gap before it fills)
+        Duplicate,      ///< Already had it
+        OutOfWindow,    ///< Beyond the window; the sender should not have sent it
+        Invalid,        ///< Past the end, or the wrong length
+        SinkFailed,
+    };
+
+    void Start(uint32_t total_len, uint8_t window) noexcept;
+
+    Result OnData(uint32_t seq, const uint8_t* data, size_t len, const Sink& sink, int64_t now_us) noexcept;
+
+    /// An ack is owed: ACK_EVERY_ chunks, ACK_DELAY_MS_, a gap, a duplicate, or the end
+    bool AckDue(int64_t now_us) const noexcept;
+
+    /// Fill in next_seq/sack and reset the ack timer
+    void BuildAck(espnow::BulkAckPayload& ack) noexcept;
+
+    bool Complete() const noexcept { return next_ == chunks_; }
+    uint32_t BytesDone() const noexcept;
+    uint32_t Duplicates() const noexcept { return duplicates_; }
+
+private:
+    uint32_t total_len_ = 0;
+    uint32_t chunks_ = 0;
+    uint32_t next_ = 0;             ///< First chunk not written to the sink
+    uint32_t sack_ = 0;             ///< Bit i: chunk next_ + 1 + i is held
+    uint8_t  window_ = WINDOW_;
+    uint8_t  unacked_ = 0;          ///< Chunks since the last ack
+    bool     ack_now_ = false;
+    int64_t  first_unacked_us_ = 0;
+    uint32_t duplicates_ = 0;
+    uint8_t  held_[WINDOW_][espnow::BULK_CHUNK_SIZE_] = {};
+};
+
+class Sender {
+public:
+    void Start(uint32_t total_len, uint8_t window, int64_t now_us) noexcept;
+
+    /**
+     * @brief Chunk to transmit now: a lost one first, then new data if the window has room.
+     * @return false if nothing is due (or the transfer failed)
+     */
+    bool NextChunk(int64_t now_us, uint32_t& seq) noexcept;
+
+    /// The chunk NextChunk returned has been queued
+    void OnSent(uint32_t seq, int64_t now_us) noexcept;
+
+    void OnAck(uint32_t next_seq, uint32_t sack, int64_t now_us) noexcept;
+
+    bool Complete() const noexcept { return base_ == chunks_; }
+    bool Failed() const noexcept { return failed_; }
+    uint32_t BytesAcked() const noexcept { return bytes_acked_; }
+    uint32_t ChunksSent() const noexcept { return chunks_sent_; }
+    uint32_t Retransmissions() const noexcept { return retransmissions_; }
+    uint32_t SrttUs() const noexcept { return srtt_us_; }
+
+private:
+    struct Chunk {
+        int64_t sent_us;
+        uint8_t transmissions;
+        bool    acked;
+    };
+
+    void markAcked(uint32_t seq, int64_t now_us) noexcept;
+
+    uint32_t total_len_ = 0;
+    uint32_t chunks_ = 0;
+    uint32_t base_ = 0;             ///< Oldest chunk not cumulatively acked
+    uint32_t next_new_ = 0;         ///< First chunk never sent
+    uint8_t  window_ = WINDOW_;
+    int64_t  rack_sent_us_ = 0;     ///< Send time of the latest-sent chunk known delivered
+    uint32_t srtt_us_ = 0;
+    uint32_t rto_us_ = INITIAL_RTO_MS_ * 1000;
+    bool     failed_ = false;
+    uint32_t bytes_acked_ = 0;
+    uint32_t chunks_sent_ = 0;
+    uint32_t retransmissions_ = 0;
+    Chunk    chunks_in_flight_[WINDOW_] = {};   ///< Indexed by seq % WINDOW_
+};
+
+// ============================================================================
+// TRANSFERS
+// ============================================================================
+
+enum class State : uint8_t {
+    Idle,
+    Starting,   ///< BulkStart sent, waiting for the answer
+    Running,
+    Done,
+    Failed,
+};
+
+struct Progress {
+    State    state;
+    espnow::BulkDirection direction;
+    uint16_t object_id;
+    espnow::BulkStatus status;  ///< Why it failed (or the peer's refusal)
+    uint32_t total_bytes;
+    uint32_t done_bytes;        ///< Written to the sink / acked by the device
+    uint32_t chunks_sent;       ///< Upload: data frames including retransmissions
+    uint32_t retransmissions;   ///< Upload: chunks sent again
+    uint32_t chunks_received;   ///< Download: data frames that arrived
+    uint32_t duplicates;        ///< Download: chunks that arrived more than once
+    uint32_t acks;              ///< Download: acks sent. Upload: acks received
+    uint32_t elapsed_ms;
+    uint32_t bytes_per_second;
+    uint32_t srtt_us;           ///< Upload: chunk-to-ack round trip
+};
+
+/**
+ * @brief Register for bulk frames. Call after espnow::Init.
+ */
+void Init() noexcept;
+
+/**
+ * @brief Fetch an object from a device into a sink, in the background.
+ * @return false if a transfer is running or the peer lacks CAP_BULK_TRANSFER_
+ */
+bool StartDownload(const uint8_t mac[6], espnow::BulkObject object, const Sink& sink) noexcept;
+
+/**
+ * @brief Send total_len bytes from a source to a device, in the background.
+ */
+bool StartUpload(const uint8_t mac[6], espnow::BulkObject object, uint32_t total_len,
+                 const Source& source) noexcept;
+
+/**
+ * @brief Cancel the running transfer; the device is told with an Aborted ack.
+ */
+void Abort() noexcept;
+
+Progress GetProgress() noexcept;
+
+/// Sink into a stream buffer the application drains (waits up to SINK_TIMEOUT_MS_ for room)
+Sink StreamBufferSink(StreamBufferHandle_t buffer) noexcept;
+
+/// Sink into a data partition, erased as far as the object needs and written in order
+Sink PartitionSink(const esp_partition_t* partition) noexcept;
+
+/// Source over memory that stays valid until the upload ends
+Source MemorySource(const uint8_t* data) noexcept;
+
+Source PartitionSource(const esp_partition_t* partition) noexcept;
+
+} // namespace BulkTransfer
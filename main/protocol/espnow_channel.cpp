@@ -0,0 +1,339 @@
+/**
+ * @file espnow_channel.cpp
+ * @brief Channel survey and coordinated channel migration
+ */
+
+#include "espnow_channel.hpp"
+#include "espnow_protocol.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include <cstring>
+
+static const char* TAG = "Channel";
+
+namespace {
+
+const char* NVS_NAMESPACE = "espnow_chan";
+const char* KEY_CHANNEL = "channel";
+
+constexpr uint32_t SETTLE_MS = 20;              // After our own switch, before probing
+constexpr uint32_t ROLLBACK_MARGIN_MS = 1000;
+constexpr size_t   MAX_PEERS = 16;
+constexpr size_t   MAX_SCORES = ChannelManager::MAX_CHANNEL_;
+
+const ChannelManager::Radio ESPNOW_RADIO = {
+    []() { return espnow::GetChannel(); },
+    [](uint8_t channel) { return espnow::SetChannel(channel); },
+    [](const uint8_t mac[6], uint8_t channel, uint16_t delay_ms, uint16_t rollback_ms) {
+        return espnow::SendChannelSwitch(mac, channel, delay_ms, rollback_ms);
+    },
+    [](const uint8_t mac[6], uint8_t channel, uint32_t timeout_ms) {
+        return espnow::CommitChannelSwitch(mac, channel, timeout_ms);
+    },
+    [](const uint8_t mac[6], uint32_t timeout_ms, uint32_t& rtt_us) {
+        return espnow::ProbePeer(mac, timeout_ms, rtt_us);
+    },
+    [](uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); },
+};
+
+const ChannelManager::Radio* s_radio = &ESPNOW_RADIO;
+volatile ChannelManager::State s_state = ChannelManager::State::Idle;
+ChannelManager::ChannelScore s_scores[MAX_SCORES] = {};
+size_t s_score_count = 0;
+uint16_t s_task_mask = 0;
+bool s_task_migrate = false;
+
+bool validChannel(uint8_t channel) noexcept
+{
+    return channel >= ChannelManager::MIN_CHANNEL_ && channel <= ChannelManager::MAX_CHANNEL_;
+}
+
+/// Long enough for a whole trial on the candidate channel, so peers never leave mid-probe
+uint16_t trialRollbackMs(size_t peer_count) noexcept
+{
+    uint32_t ms = ChannelManager::SWITCH_DELAY_MS_ + SETTLE_MS + ROLLBACK_MARGIN_MS +
+                  static_cast<uint32_t>(peer_count) * ChannelManager::PROBES_PER_PEER_ *
+                  ChannelManager::PROBE_TIMEOUT_MS_;
+    if (ms < ChannelManager::ROLLBACK_MS_) ms = ChannelManager::ROLLBACK_MS_;
+    return static_cast<uint16_t>(ms > UINT16_MAX ? UINT16_MAX : ms);
+}
+
+void saveChannel(uint8_t channel) noexcept
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS");
+        return;
+    }
+    if (nvs_set_u8(h, KEY_CHANNEL, channel) == ESP_OK) {
+        nvs_commit(h);
+    }
+    nvs_close(h);
+}
+
+/// Send every peer to a channel, then follow. Peers that miss it roll back (or never left).
+bool moveAll(const uint8_t (*peers)[6], size_t peer_count, uint8_t channel, uint16_t rollback_ms) noexcept
+{
+    for (size_t i = 0; i < peer_count; ++i) {
+        s_radio->send_switch(peers[i], channel, ChannelManager::SWITCH_DELAY_MS_, rollback_ms);
+    }
+    s_radio->delay_ms(ChannelManager::SWITCH_DELAY_MS_);
+    if (!s_radio->set_channel(channel)) {
+        return false;
+    }
+    s_radio->delay_ms(SETTLE_MS);
+    return true;
+}
+
+ChannelManager::ChannelScore scoreChannel(const uint8_t (*peers)[6], size_t peer_count, uint8_t channel) noexcept
+{
+    ChannelManager::ChannelScore score{};
+    score.channel = channel;
+    uint64_t rtt_sum_us = 0;
+
+    for (size_t i = 0; i < peer_count; ++i) {
+        bool reached = false;
+        for (uint8_t n = 0; n < ChannelManager::PROBES_PER_PEER_; ++n) {
+            uint32_t rtt_us = 0;
+            score.probes_sent++;
+            if (s_radio->probe(peers[i], ChannelManager::PROBE_TIMEOUT_MS_, rtt_us)) {
+                score.probes_ok++;
+                rtt_sum_us += rtt_us;
+                reached = true;
+            }
+        }
+        if (reached) score.peers_reached++;
+    }
+
+    if (score.probes_ok > 0) {
+        score.mean_rtt_us = static_cast<uint32_t>(rtt_sum_us / score.probes_ok);
+    }
+    int32_t answered_permille = score.probes_sent ? score.probes_ok * 1000 / score.probes_sent : 0;
+    score.score = answered_permille * 100 - static_cast<int32_t>(score.mean_rtt_us / 100);
+    return score;
+}
+
+/// Lead the peers back to home; if one does not answer there, wait out its rollback timer.
+void returnHome(const uint8_t (*peers)[6], size_t peer_count, uint8_t home) noexcept
+{
+    moveAll(peers, peer_count, home, 0);
+    for (size_t i = 0; i < peer_count; ++i) {
+        uint32_t rtt_us = 0;
+        if (!s_radio->probe(peers[i], ChannelManager::PROBE_TIMEOUT_MS_, rtt_us)) {
+            s_radio->delay_ms(trialRollbackMs(peer_count));
+            return;
+        }
+    }
+}
+
+/// Commit every peer not yet in committed[] (the radio is on channel).
+/// @return true once all of them have acked
+bool commitAll(const uint8_t (*peers)[6], size_t peer_count, uint8_t channel, bool* committed) noexcept
+{
+    bool all = true;
+    for (size_t i = 0; i < peer_count; ++i) {
+        for (uint8_t n = 0; n < ChannelManager::COMMIT_ATTEMPTS_ && !committed[i]; ++n) {
+            committed[i] = s_radio->commit(peers[i], channel, ChannelManager::COMMIT_TIMEOUT_MS_);
+        }
+        all &= committed[i];
+    }
+    return all;
+}
+
+/// An unconfirmed peer may have rolled back already: look for it on the old
+/// channel, start a fresh trial there, and come back to the new one.
+void retrialFromHome(const uint8_t (*peers)[6], size_t peer_count, const bool* committed,
+                     uint8_t home, uint8_t channel) noexcept
+{
+    s_radio->set_channel(home);
+    s_radio->delay_ms(SETTLE_MS);
+    uint16_t rollback_ms = trialRollbackMs(peer_count);
+    for (size_t i = 0; i < peer_count; ++i) {
+        uint32_t rtt_us = 0;
+        if (!committed[i] && s_radio->probe(peers[i], ChannelManager::PROBE_TIMEOUT_MS_, rtt_us)) {
+            s_radio->send_switch(peers[i], channel, ChannelManager::SWITCH_DELAY_MS_, rollback_ms);
+        }
+    }
+    s_radio->delay_ms(ChannelManager::SWITCH_DELAY_MS_);
+    s_radio->set_channel(channel);
+    s_radio->delay_ms(SETTLE_MS);
+}
+
+/// Committed peers never roll back on their own, so commit them back to home first.
+void revertCommits(const uint8_t (*peers)[6], size_t peer_count, const bool* committed, uint8_t home) noexcept
+{
+    for (size_t i = 0; i < peer_count; ++i) {
+        bool reverted = !committed[i];
+        for (uint8_t n = 0; n < ChannelManager::COMMIT_ATTEMPTS_ && !reverted; ++n) {
+            reverted = s_radio->commit(peers[i], home, ChannelManager::COMMIT_TIMEOUT_MS_);
+        }
+        if (!reverted) {
+            ESP_LOGE(TAG, "Peer %u did not ack its return to channel %u", static_cast<unsigned>(i), home);
+        }
+    }
+}
+
+void surveyTask(void* arg) noexcept
+{
+    (void)arg;
+
+    espnow::SessionInfo sessions[MAX_PEERS];
+    size_t session_count = espnow::GetSessions(sessions, MAX_PEERS);
+    uint8_t peers[MAX_PEERS][6];
+    size_t peer_count = 0;
+    for (size_t i = 0; i < session_count; ++i) {
+        if (sessions[i].connected) {
+            std::memcpy(peers[peer_count++], sessions[i].mac, 6);
+        }
+    }
+
+    if (peer_count == 0) {
+        ESP_LOGW(TAG, "No connected peers to survey with");
+        s_state = ChannelManager::State::Failed;
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    ChannelManager::ChannelScore scores[MAX_SCORES];
+    size_t count = ChannelManager::Survey(peers, peer_count, s_task_mask, scores, MAX_SCORES);
+    std::memcpy(s_scores, scores, count * sizeof(scores[0]));
+    s_score_count = count;
+
+    const ChannelManager::ChannelScore* best = &scores[0];
+    for (size_t i = 1; i < count; ++i) {
+        if (scores[i].score > best->score) best = &scores[i];
+    }
+
+    bool ok = true;
+    if (s_task_migrate && best != &scores[0] && best->score - scores[0].score >= ChannelManager::MIGRATE_MARGIN_) {
+        s_state = ChannelManager::State::Migrating;
+        ok = ChannelManager::Migrate(peers, peer_count, best->channel);
+    }
+    s_state = ok ? ChannelManager::State::Done : ChannelManager::State::Failed;
+    vTaskDelete(nullptr);
+}
+
+} // namespace
+
+void ChannelManager::Init(const Radio* radio) noexcept
+{
+    s_radio = radio ? radio : &ESPNOW_RADIO;
+
+    nvs_handle_t h;
+    uint8_t channel = 0;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_u8(h, KEY_CHANNEL, &channel);
+        nvs_close(h);
+    }
+    if (validChannel(channel) && channel != s_radio->get_channel()) {
+        ESP_LOGI(TAG, "Restoring channel %u", channel);
+        s_radio->set_channel(channel);
+    }
+}
+
+size_t ChannelManager::Survey(const uint8_t (*peers)[6], size_t peer_count, uint16_t channel_mask,
+                              ChannelScore* out, size_t max_scores) noexcept
+{
+    if (max_scores == 0) {
+        return 0;
+    }
+    uint8_t home = s_radio->get_channel();
+    uint16_t rollback_ms = trialRollbackMs(peer_count);
+
+    size_t count = 0;
+    out[count++] = scoreChannel(peers, peer_count, home);
+
+    for (uint8_t channel = MIN_CHANNEL_; channel <= MAX_CHANNEL_ && count < max_scores; ++channel) {
+        if (channel == home || !(channel_mask & (1u << channel))) {
+            continue;
+        }
+        if (!moveAll(peers, peer_count, channel, rollback_ms)) {
+            continue;
+        }
+        out[count++] = scoreChannel(peers, peer_count, channel);
+        returnHome(peers, peer_count, home);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        ESP_LOGI(TAG, "Channel %2u: %u/%u probes, %u peers, rtt %lu us, score %ld",
+                 out[i].channel, out[i].probes_ok, out[i].probes_sent, out[i].peers_reached,
+                 static_cast<unsigned long>(out[i].mean_rtt_us), static_cast<long>(out[i].score));
+    }
+    return count;
+}
+
+bool ChannelManager::Migrate(const uint8_t (*peers)[6], size_t peer_count, uint8_t channel) noexcept
+{
+    uint8_t home = s_radio->get_channel();
+    if (!validChannel(channel) || channel == home || peer_count > MAX_PEERS) {
+        return false;
+    }
+
+    if (!moveAll(peers, peer_count, channel, trialRollbackMs(peer_count))) {
+        s_radio->set_channel(home);
+        return false;
+    }
+
+    // Everyone must be reachable before anyone commits
+    for (size_t i = 0; i < peer_count; ++i) {
+        uint32_t rtt_us = 0;
+        bool reached = false;
+        for (uint8_t n = 0; n < PROBES_PER_PEER_ && !reached; ++n) {
+            reached = s_radio->probe(peers[i], PROBE_TIMEOUT_MS_, rtt_us);
+        }
+        if (!reached) {
+            ESP_LOGW(TAG, "Peer %u not reachable on channel %u, rolling back",
+                     static_cast<unsigned>(i), channel);
+            returnHome(peers, peer_count, home);
+            return false;
+        }
+    }
+
+    // The channel is saved only once every peer has acked its commit
+    bool committed[MAX_PEERS] = {};
+    bool all = commitAll(peers, peer_count, channel, committed);
+    for (uint8_t round = 0; round < COMMIT_ROUNDS_ && !all; ++round) {
+        ESP_LOGW(TAG, "Commit to channel %u not acked by every peer, retrying from channel %u", channel, home);
+        retrialFromHome(peers, peer_count, committed, home, channel);
+        all = commitAll(peers, peer_count, channel, committed);
+    }
+    if (!all) {
+        ESP_LOGW(TAG, "Not every peer committed to channel %u, rolling back", channel);
+        revertCommits(peers, peer_count, committed, home);
+        returnHome(peers, peer_count, home);
+        return false;
+    }
+
+    saveChannel(channel);
+    ESP_LOGI(TAG, "Moved from channel %u to %u", home, channel);
+    return true;
+}
+
+bool ChannelManager::StartSurvey(uint16_t channel_mask, bool migrate) noexcept
+{
+    if (s_state == State::Surveying || s_state == State::Migrating) {
+        return false;
+    }
+    s_task_mask = channel_mask;
+    s_task_migrate = migrate;
+    s_state = State::Surveying;
+    if (xTaskCreate(surveyTask, "chan_survey", 4096, nullptr, 3, nullptr) != pdPASS) {
+        s_state = State::Failed;
+        return false;
+    }
+    return true;
+}
+
+ChannelManager::State ChannelManager::GetState() noexcept
+{
+    return s_state;
+}
+
+const ChannelManager::ChannelScore* ChannelManager::GetResults(size_t& count) noexcept
+{
+    count = s_score_count;
+    return s_scores;
+}
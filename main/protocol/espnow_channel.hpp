@@ -0,0 +1,99 @@
+/**
+ * @file espnow_channel.hpp
+ * @brief Channel survey and coordinated channel migration
+ *
+ * A survey tries each candidate channel with the peers that currently talk to
+ * us: every peer is sent a ChannelSwitch with a rollback timeout, the
+ * controller follows, and each peer is probed (ChannelProbe/Ack) for answer
+ * rate and round trip. The controller then leads the peers back with a
+ * ChannelSwitch without rollback; peers that miss it fall back on their own
+ * when the rollback timer runs out. Migration is the same trial followed by a
+ * commit (ChannelSwitch to the new channel, rollback_ms = 0), only if every
+ * peer answered on the new channel. The new channel is saved only once every
+ * peer has acked its commit; a peer that has not is looked for on the old
+ * channel, sent on a fresh trial and committed again, up to COMMIT_ROUNDS_
+ * times, after which everyone is led back.
+ *
+ * The radio is reached through a Radio table so the sequencing can run against
+ * a simulated multi-channel radio on the host; Init() without one uses espnow.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ChannelManager {
+
+static constexpr uint8_t  MIN_CHANNEL_ = 1;
+static constexpr uint8_t  MAX_CHANNEL_ = 13;
+static constexpr uint16_t SWITCH_DELAY_MS_ = 100;   ///< Peer acks, then switches after this
+static constexpr uint16_t ROLLBACK_MS_ = 3000;      ///< Peer returns if the trial is not committed
+static constexpr uint8_t  PROBES_PER_PEER_ = 5;
+static constexpr uint32_t PROBE_TIMEOUT_MS_ = 50;
+static constexpr int32_t  MIGRATE_MARGIN_ = 2000;   ///< Score a channel must beat the current one by
+static constexpr uint32_t COMMIT_TIMEOUT_MS_ = 100; ///< Wait for one commit's ChannelSwitchAck
+static constexpr uint8_t  COMMIT_ATTEMPTS_ = 3;     ///< Commits per peer per round
+static constexpr uint8_t  COMMIT_ROUNDS_ = 3;       ///< Old-channel retries for unconfirmed peers
+
+struct Radio {
+    uint8_t (*get_channel)();
+    bool (*set_channel)(uint8_t channel);
+    bool (*send_switch)(const uint8_t mac[6], uint8_t channel, uint16_t switch_delay_ms, uint16_t rollback_ms);
+    bool (*commit)(const uint8_t mac[6], uint8_t channel, uint32_t timeout_ms);    ///< true once acked
+    bool (*probe)(const uint8_t mac[6], uint32_t timeout_ms, uint32_t& rtt_us);
+    void (*delay_ms)(uint32_t ms);
+};
+
+struct ChannelScore {
+    uint8_t  channel;
+    uint8_t  probes_sent;
+    uint8_t  probes_ok;
+    uint8_t  peers_reached;     ///< Peers that answered at least one probe
+    uint32_t mean_rtt_us;
+    int32_t  score;             ///< 100 per 0.1 % answered, minus 1 per 100 us mean RTT
+};
+
+enum class State : uint8_t {
+    Idle,
+    Surveying,
+    Migrating,
+    Done,       ///< Last run finished (results valid)
+    Failed,     ///< No peers, or a channel switch failed
+};
+
+/**
+ * @brief Restore the saved channel (or WIFI_CHANNEL_) after espnow::Init.
+ * @param radio nullptr for the ESP-NOW radio; must outlive the manager
+ */
+void Init(const Radio* radio = nullptr) noexcept;
+
+/**
+ * @brief Survey candidate channels in a background task.
+ * @param channel_mask Bit n set to try channel n (the current channel is always scored)
+ * @param migrate Move to the best channel if it beats the current one by MIGRATE_MARGIN_
+ * @return false if a run is already in progress
+ */
+bool StartSurvey(uint16_t channel_mask, bool migrate) noexcept;
+
+/**
+ * @brief Synchronous survey over the given peers (what the task runs).
+ * @return Number of scores written to out (current channel first)
+ */
+size_t Survey(const uint8_t (*peers)[6], size_t peer_count, uint16_t channel_mask,
+              ChannelScore* out, size_t max_scores) noexcept;
+
+/**
+ * @brief Trial a channel and commit it if every peer answers there; otherwise roll back.
+ * @return true once every peer acked the commit and the channel was saved
+ */
+bool Migrate(const uint8_t (*peers)[6], size_t peer_count, uint8_t channel) noexcept;
+
+State GetState() noexcept;
+
+/**
+ * @brief Scores from the last survey.
+ */
+const ChannelScore* GetResults(size_t& count) noexcept;
+
+} // namespace ChannelManager
@@ -0,0 +1,212 @@
+/**
+ * @file espnow_crc.hpp
+ * @brief CRC16-CCITT engines for ESP-NOW frame validation
+ *
+ * Every engine computes CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no
+ * reflection, no final XOR) and is bit-exact with the original bit-at-a-time
+ * implementation. The engine behind crc16_ccitt() is chosen at compile time
+ * with CRC16_ENGINE_:
+ *
+ * | Engine  | Flash cost | Work per byte                  |
+ * |---------|------------|--------------------------------|
+ * | Bitwise | 0 B        | 8 shift/xor iterations         |
+ * | Nibble  | 32 B       | 2 table lookups                |
+ * | Table   | 512 B      | 1 table lookup                 |
+ * | Rom     | 0 B        | ROM routine (target only)      |
+ *
+ * The software engines are checked against the bitwise reference at compile
+ * time (static_assert below). The ROM engine can only be checked on target,
+ * see Crc16SelfTest().
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(ESP_PLATFORM)
+#include "esp_rom_crc.h"
+#endif
+
+namespace espnow {
+
+// ============================================================================
+// CRC CONSTANTS
+// ============================================================================
+
+static constexpr uint16_t CRC16_POLYNOMIAL_ = 0x1021;
+static constexpr uint16_t CRC16_INIT_ = 0xFFFF;
+
+/// CRC-16/CCITT-FALSE of the ASCII string "123456789" (standard check value)
+static constexpr uint16_t CRC16_CHECK_VALUE_ = 0x29B1;
+
+enum class Crc16Engine : uint8_t {
+    Bitwise,    ///< Reference implementation, no tables
+    Nibble,     ///< 16-entry table, for flash-constrained builds
+    Table,      ///< 256-entry table
+    Rom,        ///< esp_rom_crc16_be (falls back to Table on host builds)
+};
+
+#if defined(ESP_PLATFORM)
+static constexpr Crc16Engine CRC16_ENGINE_ = Crc16Engine::Rom;
+#else
+static constexpr Crc16Engine CRC16_ENGINE_ = Crc16Engine::Table;
+#endif
+
+// ============================================================================
+// SOFTWARE ENGINES
+// ============================================================================
+
+constexpr uint16_t crc16_ccitt_bitwise(const uint8_t* data, size_t len,
+                                       uint16_t crc = CRC16_INIT_) noexcept
+{
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= static_cast<uint16_t>(data[i] << 8);
+        for (int j = 0; j < 8; ++j) {
+            if (crc & 0x8000)
+                crc = static_cast<uint16_t>((crc << 1) ^ CRC16_POLYNOMIAL_);
+            else
+                crc = static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/// Build a table of CRC remainders for all values of a `bits`-wide index.
+template <size_t N>
+constexpr std::array<uint16_t, N> makeCrc16Table(int bits) noexcept
+{
+    std::array<uint16_t, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i << 8 << (8 - bits));
+        for (int j = 0; j < bits; ++j) {
+            if (crc & 0x8000)
+                crc = static_cast<uint16_t>((crc << 1) ^ CRC16_POLYNOMIAL_);
+            else
+                crc = static_cast<uint16_t>(crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 16> CRC16_NIBBLE_TABLE_ = makeCrc16Table<16>(4);
+inline constexpr std::array<uint16_t, 256> CRC16_TABLE_ = makeCrc16Table<256>(8);
+
+constexpr uint16_t crc16_ccitt_nibble(const uint8_t* data, size_t len,
+                                      uint16_t crc = CRC16_INIT_) noexcept
+{
+    for (size_t i = 0; i < len; ++i) {
+        crc = static_cast<uint16_t>((crc << 4) ^ CRC16_NIBBLE_TABLE_[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = static_cast<uint16_t>((crc << 4) ^ CRC16_NIBBLE_TABLE_[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+constexpr uint16_t crc16_ccitt_table(const uint8_t* data, size_t len,
+                                     uint16_t crc = CRC16_INIT_) noexcept
+{
+    for (size_t i = 0; i < len; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE_[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+// ============================================================================
+// ROM ENGINE
+// ============================================================================
+
+inline uint16_t crc16_ccitt_rom(const uint8_t* data, size_t len,
+                                uint16_t crc = CRC16_INIT_) noexcept
+{
+#if defined(ESP_PLATFORM)
+    // The ROM routine inverts the CRC on entry and exit; undo both so the
+    // result matches CRC-16/CCITT-FALSE with an explicit initial value.
+    return static_cast<uint16_t>(~esp_rom_crc16_be(static_cast<uint16_t>(~crc), data,
+                                                   static_cast<uint32_t>(len)));
+#else
+    return crc16_ccitt_table(data, len, crc);
+#endif
+}
+
+// ============================================================================
+// SELECTED ENGINE
+// ============================================================================
+
+inline uint16_t crc16_ccitt(const uint8_t* data, size_t len) noexcept
+{
+    if constexpr (CRC16_ENGINE_ == Crc16Engine::Bitwise) {
+        return crc16_ccitt_bitwise(data, len);
+    } else if constexpr (CRC16_ENGINE_ == Crc16Engine::Nibble) {
+        return crc16_ccitt_nibble(data, len);
+    } else if constexpr (CRC16_ENGINE_ == Crc16Engine::Table) {
+        return crc16_ccitt_table(data, len);
+    } else {
+        return crc16_ccitt_rom(data, len);
+    }
+}
+
+// ============================================================================
+// VERIFICATION
+// ============================================================================
+
+namespace crc_check {
+
+inline constexpr uint8_t CHECK_INPUT_[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+/// Longer vector that exercises every table index in both nibble positions
+constexpr std::array<uint8_t, 300> makeSweep() noexcept
+{
+    std::array<uint8_t, 300> buf{};
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>((i * 37u) ^ (i >> 3));
+    }
+    return buf;
+}
+
+inline constexpr std::array<uint8_t, 300> SWEEP_ = makeSweep();
+
+} // namespace crc_check
+
+static_assert(crc16_ccitt_bitwise(crc_check::CHECK_INPUT_, sizeof(crc_check::CHECK_INPUT_)) == CRC16_CHECK_VALUE_,
+              "Bitwise CRC16 does not match the CCITT-FALSE check value");
+static_assert(crc16_ccitt_nibble(crc_check::CHECK_INPUT_, sizeof(crc_check::CHECK_INPUT_)) == CRC16_CHECK_VALUE_,
+              "Nibble CRC16 does not match the CCITT-FALSE check value");
+static_assert(crc16_ccitt_table(crc_check::CHECK_INPUT_, sizeof(crc_check::CHECK_INPUT_)) == CRC16_CHECK_VALUE_,
+              "Table CRC16 does not match the CCITT-FALSE check value");
+static_assert(crc16_ccitt_nibble(crc_check::SWEEP_.data(), crc_check::SWEEP_.size()) ==
+              crc16_ccitt_bitwise(crc_check::SWEEP_.data(), crc_check::SWEEP_.size()),
+              "Nibble CRC16 diverges from the bitwise reference");
+static_assert(crc16_ccitt_table(crc_check::SWEEP_.data(), crc_check::SWEEP_.size()) ==
+              crc16_ccitt_bitwise(crc_check::SWEEP_.data(), crc_check::SWEEP_.size()),
+              "Table CRC16 diverges from the bitwise reference");
+
+/**
+ * @brief Runtime check of the selected engine against the bitwise reference.
+ *
+ * Needed for the ROM engine, which cannot be evaluated at compile time.
+ * Also covers an empty buffer and a non-default seed.
+ *
+ * @return true if the selected engine is bit-exact with the reference
+ */
+inline bool Crc16SelfTest() noexcept
+{
+    const uint8_t* sweep = crc_check::SWEEP_.data();
+    const size_t sweep_len = crc_check::SWEEP_.size();
+
+    if (crc16_ccitt(crc_check::CHECK_INPUT_, sizeof(crc_check::CHECK_INPUT_)) != CRC16_CHECK_VALUE_) {
+        return false;
+    }
+    if (crc16_ccitt(sweep, 0) != crc16_ccitt_bitwise(sweep, 0)) {
+        return false;
+    }
+    for (size_t len = 1; len <= sweep_len; len += 37) {
+        if (crc16_ccitt(sweep, len) != crc16_ccitt_bitwise(sweep, len)) {
+            return false;
+        }
+    }
+    return crc16_ccitt_rom(sweep, sweep_len, 0x1D0F) == crc16_ccitt_bitwise(sweep, sweep_len, 0x1D0F);
+}
+
+} // namespace espnow
@@ -0,0 +1,183 @@
+/**
+ * @file espnow_fragment.cpp
+ * @brief Splitting and reassembly of messages larger than one frame
+ */
+
+#include "espnow_fragment.hpp"
+#include <cstring>
+
+namespace {
+
+/// Bytes fragment index of a total_len message carries
+size_t pieceLength(uint16_t total_len, uint8_t index) noexcept
+{
+    size_t offset = static_cast<size_t>(index) * espnow::FRAGMENT_DATA_SIZE_;
+    size_t left = total_len - offset;
+    return left < espnow::FRAGMENT_DATA_SIZE_ ? left : espnow::FRAGMENT_DATA_SIZE_;
+}
+
+} // namespace
+
+uint8_t espnow::FragmentCount(size_t len) noexcept
+{
+    if (len == 0 || len > MAX_MESSAGE_SIZE_) {
+        return 0;
+    }
+    return static_cast<uint8_t>((len + FRAGMENT_DATA_SIZE_ - 1) / FRAGMENT_DATA_SIZE_);
+}
+
+uint8_t espnow::BuildFragment(MsgType type, uint8_t msg_id, const uint8_t* data, size_t len,
+                              uint8_t index, uint8_t* out) noexcept
+{
+    uint8_t count = FragmentCount(len);
+    if (index >= count) {
+        return 0;
+    }
+    FragmentHeader header{};
+    header.type = static_cast<uint8_t>(type);
+    header.msg_id = msg_id;
+    header.index = index;
+    header.count = count;
+    header.total_len = static_cast<uint16_t>(len);
+
+    size_t piece = pieceLength(header.total_len, index);
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), data + static_cast<size_t>(index) * FRAGMENT_DATA_SIZE_, piece);
+    return static_cast<uint8_t>(sizeof(header) + piece);
+}
+
+// ============================================================================
+// REASSEMBLY
+// ============================================================================
+
+espnow::Reassembler::Result espnow::Reassembler::Add(const uint8_t mac[6], const uint8_t* payload,
+                                                     size_t len, int64_t now_us,
+                                                     const FragmentHeader*& header,
+                                                     const uint8_t*& out, size_t& out_len) noexcept
+{
+    header = nullptr;
+    out = nullptr;
+    out_len = 0;
+    stats_.fragments_received++;
+
+    FragmentHeader frag{};
+    if (len < sizeof(frag)) {
+        stats_.invalid++;
+        return Result::Invalid;
+    }
+    std::memcpy(&frag, payload, sizeof(frag));
+    size_t piece = len - sizeof(frag);
+    if (frag.count == 0 || frag.count > MAX_FRAGMENTS_ || frag.index >= frag.count ||
+        FragmentCount(frag.total_len) != frag.count || piece != pieceLength(frag.total_len, frag.index)) {
+        stats_.invalid++;
+        return Result::Invalid;
+    }
+
+    Expire(now_us);
+    if (isDone(mac, frag.msg_id)) {
+        stats_.duplicates++;
+        return Result::Duplicate;
+    }
+    Slot* slot = claimSlot(mac, frag.msg_id, now_us);
+    if (slot == nullptr) {
+        stats_.no_buffer++;
+        return Result::NoBuffer;
+    }
+    if (slot->received == 0) {
+        slot->header = frag;
+    } else if (slot->header.type != frag.type || slot->header.count != frag.count ||
+               slot->header.total_len != frag.total_len) {
+        stats_.invalid++;
+        return Result::Invalid;
+    }
+
+    uint16_t bit = static_cast<uint16_t>(1u << frag.index);
+    if (slot->received & bit) {
+        stats_.duplicates++;
+        return Result::Duplicate;
+    }
+    std::memcpy(slot->data + static_cast<size_t>(frag.index) * FRAGMENT_DATA_SIZE_,
+                payload + sizeof(frag), piece);
+    slot->received |= bit;
+    slot->last_us = now_us;
+
+    if (slot->received != static_cast<uint16_t>((1u << frag.count) - 1)) {
+        return Result::Incomplete;
+    }
+    // Free the slot but leave the data in place for the caller
+    slot->used = false;
+    Done& done = done_[done_head_];
+    done_head_ = static_cast<uint8_t>((done_head_ + 1) % DONE_DEPTH_);
+    done.valid = true;
+    std::memcpy(done.mac, mac, 6);
+    done.msg_id = frag.msg_id;
+    stats_.messages_received++;
+    header = &slot->header;
+    out = slot->data;
+    out_len = slot->header.total_len;
+    return Result::Complete;
+}
+
+espnow::Reassembler::Slot* espnow::Reassembler::claimSlot(const uint8_t mac[6], uint8_t msg_id,
+                                                          int64_t now_us) noexcept
+{
+    Slot* free_slot = nullptr;
+    for (auto& slot : slots_) {
+        if (!slot.used) {
+            if (!free_slot) free_slot = &slot;
+            continue;
+        }
+        if (!MacEquals(slot.mac, mac)) {
+            continue;
+        }
+        if (slot.header.msg_id == msg_id) {
+            return &slot;
+        }
+        // One message per sender at a time: it has moved on, so the old one will not complete
+        stats_.replaced++;
+        slot.used = false;
+        if (!free_slot) free_slot = &slot;
+    }
+    if (free_slot == nullptr) {
+        return nullptr;
+    }
+    free_slot->used = true;
+    std::memcpy(free_slot->mac, mac, 6);
+    free_slot->header = FragmentHeader{};
+    free_slot->header.msg_id = msg_id;
+    free_slot->received = 0;
+    free_slot->last_us = now_us;
+    return free_slot;
+}
+
+bool espnow::Reassembler::isDone(const uint8_t mac[6], uint8_t msg_id) const noexcept
+{
+    for (const auto& done : done_) {
+        if (done.valid && done.msg_id == msg_id && MacEquals(done.mac, mac)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t espnow::Reassembler::Expire(int64_t now_us) noexcept
+{
+    size_t dropped = 0;
+    for (auto& slot : slots_) {
+        if (slot.used && now_us - slot.last_us >= static_cast<int64_t>(REASSEMBLY_TIMEOUT_MS_) * 1000) {
+            slot.used = false;
+            stats_.timeouts++;
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+size_t espnow::Reassembler::InFlight() const noexcept
+{
+    size_t count = 0;
+    for (const auto& slot : slots_) {
+        if (slot.used) count++;
+    }
+    return count;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file espnow_fragment.hpp
+ * @brief Splitting and reassembly of messages larger than one frame
+ *
+ * A message of up to MAX_MESSAGE_SIZE_ bytes is cut into FRAGMENT_DATA_SIZE_
+ * pieces, each sent as a Fragment frame led by a FragmentHeader. The receiver
+ * collects the pieces per (sender, msg_id) in one of REASSEMBLY_SLOTS_ static
+ * buffers, in any order, and hands the message on when the last one arrives.
+ * A partial message is dropped when it makes no progress for
+ * REASSEMBLY_TIMEOUT_MS_, or when the same sender starts another message.
+ *
+ * Nothing here touches the radio or the clock, so the reassembler can be run
+ * against reordered and lossy fragment streams on the host.
+ */
+
+#pragma once
+
+#include "espnow_protocol.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace espnow {
+
+/// Fragments needed for len bytes (0 if len is over MAX_MESSAGE_SIZE_)
+uint8_t FragmentCount(size_t len) noexcept;
+
+/**
+ * @brief Build the Fragment payload for one piece of a message.
+ * @param out At least MAX_PAYLOAD_SIZE_ bytes
+ * @return Payload length, 0 if index is out of range
+ */
+uint8_t BuildFragment(MsgType type, uint8_t msg_id, const uint8_t* data, size_t len,
+                      uint8_t index, uint8_t* out) noexcept;
+
+class Reassembler {
+public:
+    enum class Result : uint8_t {
+        Incomplete,     ///< Stored, more fragments to come
+        Complete,       ///< Message whole; see out/out_len
+        Duplicate,      ///< Fragment already held, or its message already completed
+        Invalid,        ///< Fields disagree with each other or with the message so far
+        NoBuffer,       ///< First fragment of a message while every slot is busy
+    };
+
+    /**
+     * @brief Add one Fragment payload (header included).
+     * @param out On Complete, the whole message; valid until the next call
+     */
+    Result Add(const uint8_t mac[6], const uint8_t* payload, size_t len, int64_t now_us,
+               const FragmentHeader*& header, const uint8_t*& out, size_t& out_len) noexcept;
+
+    /**
+     * @brief Drop partial messages that made no progress for REASSEMBLY_TIMEOUT_MS_.
+     * @return Number dropped
+     */
+    size_t Expire(int64_t now_us) noexcept;
+
+    /// Partial messages currently held
+    size_t InFlight() const noexcept;
+
+    /// Receive-side counters (the send-side fields stay 0)
+    const FragmentStats& Stats() const noexcept { return stats_; }
+
+private:
+    struct Slot {
+        bool           used;
+        uint8_t        mac[6];
+        FragmentHeader header;      ///< From the first fragment seen; index unused
+        uint16_t       received;    ///< Bit i: fragment i stored
+        int64_t        last_us;
+        uint8_t        data[MAX_MESSAGE_SIZE_];
+    };
+    static_assert(MAX_FRAGMENTS_ <= 16, "received bitmap is 16 bits");
+
+    /// A completed message, so late copies of its fragments do not start it again
+    struct Done {
+        bool    valid;
+        uint8_t mac[6];
+        uint8_t msg_id;
+    };
+    static constexpr size_t DONE_DEPTH_ = 4;
+
+    Slot* claimSlot(const uint8_t mac[6], uint8_t msg_id, int64_t now_us) noexcept;
+    bool isDone(const uint8_t mac[6], uint8_t msg_id) const noexcept;
+
+    Slot slots_[REASSEMBLY_SLOTS_] = {};
+    Done done_[DONE_DEPTH_] = {};
+    uint8_t done_head_ = 0;
+    FragmentStats stats_{};
+};
+
+} // namespace espnow
@@ -0,0 +1,382 @@
+/**
+ * @file espnow_groups.cpp
+ * @brief Peer groups and fan-out group commands
+ */
+
+#include "espnow_groups.hpp"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cstring>
+
+static const char* TAG = "PeerGroups";
+
+namespace {
+
+const char* NVS_NAMESPACE = "espnow_groups";
+
+/// A group command in flight
+struct Pending {
+    bool     active;
+    uint8_t  group;
+    uint8_t  device_id;
+    uint8_t  command_id;
+    espnow::TxPriority priority;
+    PeerGroups::Fanout fanout;
+    uint8_t  payload[espnow::MAX_PAYLOAD_SIZE_];
+    size_t   payload_len;
+    int64_t  start_us;
+    int64_t  deadline_us;
+    uint16_t member_mask;       ///< Members still approved when the command started
+    uint16_t sent_mask;         ///< Members whose Command is queued (or covered by the broadcast)
+    uint16_t ack_mask;
+    bool     unicast_retry;     ///< Broadcast: silent members have been re-sent unicast
+    uint32_t first_ack_us;
+    uint32_t last_ack_us;
+};
+
+PeerGroups::Group s_groups[PeerGroups::MAX_GROUPS_] = {};
+Pending s_pending{};
+PeerGroups::Result s_last_result{};
+bool s_has_result = false;
+PeerGroups::ResultCallback s_result_cb = nullptr;
+PeerGroups::Stats s_stats{};
+
+uint16_t bit(size_t i) noexcept
+{
+    return static_cast<uint16_t>(1u << i);
+}
+
+uint8_t popcount(uint16_t mask) noexcept
+{
+    return static_cast<uint8_t>(__builtin_popcount(mask));
+}
+
+void groupKey(uint8_t index, char out[4]) noexcept
+{
+    snprintf(out, 4, "g%u", index);
+}
+
+void saveGroup(uint8_t index) noexcept
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    char key[4];
+    groupKey(index, key);
+    if (s_groups[index].valid) {
+        err = nvs_set_blob(h, key, &s_groups[index], sizeof(s_groups[index]));
+    } else {
+        err = nvs_erase_key(h, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    }
+    if (err == ESP_OK) {
+        nvs_commit(h);
+    } else {
+        ESP_LOGE(TAG, "Failed to save group %u: %s", index, esp_err_to_name(err));
+    }
+    nvs_close(h);
+}
+
+bool isApproved(const uint8_t mac[6]) noexcept
+{
+    espnow::SessionInfo info{};
+    return espnow::GetSession(mac, info);
+}
+
+/**
+ * @brief A broadcast reaches every device in range, and ESP-NOW never encrypts
+ * it. Only allowed when the group is every approved peer and none of them has
+ * a link key; otherwise the command goes unicast.
+ */
+bool broadcastAllowed(const PeerGroups::Group& group, uint16_t member_mask) noexcept
+{
+    if (popcount(member_mask) < espnow::GetApprovedPeerCount()) {
+        return false;
+    }
+    for (size_t i = 0; i < group.member_count; ++i) {
+        if ((member_mask & bit(i)) && espnow::IsPeerEncrypted(group.members[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Queue Commands for members not yet sent, each with a reserved reliable
+ * slot so none silently goes out best-effort. Stops when the reliable table or
+ * the TX queue is full; the rest go out on the next Service(), which the acks
+ * freeing those slots wake the UI loop for.
+ */
+void sendPending() noexcept
+{
+    const PeerGroups::Group& group = s_groups[s_pending.group];
+    for (size_t i = 0; i < group.member_count; ++i) {
+        uint16_t b = bit(i);
+        if (!(s_pending.member_mask & b) || (s_pending.sent_mask & b) || (s_pending.ack_mask & b)) {
+            continue;
+        }
+        if (!espnow::ReserveReliable(group.members[i], espnow::MsgType::Command, 1)) {
+            break;
+        }
+        if (!espnow::SendCommandTo(group.members[i], s_pending.device_id, s_pending.command_id,
+                                   s_pending.payload, s_pending.payload_len, s_pending.priority)) {
+            espnow::ReleaseReliable(group.members[i], espnow::MsgType::Command, 1);
+            break;
+        }
+        s_pending.sent_mask |= b;
+    }
+}
+
+void collectAcks() noexcept
+{
+    const PeerGroups::Group& group = s_groups[s_pending.group];
+    for (size_t i = 0; i < group.member_count; ++i) {
+        uint16_t b = bit(i);
+        if (!(s_pending.member_mask & b) || (s_pending.ack_mask & b)) {
+            continue;
+        }
+        // Only an OK ack for this command counts; a rejection or an ack for something else does not
+        espnow::SessionInfo info{};
+        if (!espnow::GetSession(group.members[i], info) || info.last_ack_us < s_pending.start_us ||
+            info.last_ack_command != s_pending.command_id || !info.last_ack_ok) {
+            continue;
+        }
+        uint32_t at_us = static_cast<uint32_t>(info.last_ack_us - s_pending.start_us);
+        if (s_pending.ack_mask == 0 || at_us < s_pending.first_ack_us) s_pending.first_ack_us = at_us;
+        if (at_us > s_pending.last_ack_us) s_pending.last_ack_us = at_us;
+        s_pending.ack_mask |= b;
+    }
+}
+
+void finish() noexcept
+{
+    PeerGroups::Result& r = s_last_result;
+    r = PeerGroups::Result{};
+    r.group = s_pending.group;
+    r.command_id = s_pending.command_id;
+    r.fanout = s_pending.fanout;
+    r.members = popcount(s_pending.member_mask);
+    r.acked = popcount(s_pending.ack_mask);
+    r.ack_mask = s_pending.ack_mask;
+    r.complete = (r.acked == r.members);
+    if (r.acked > 0) {
+        r.first_ack_us = s_pending.first_ack_us;
+        r.last_ack_us = s_pending.last_ack_us;
+        r.skew_us = r.last_ack_us - r.first_ack_us;
+    }
+    s_pending.active = false;
+    s_has_result = true;
+
+    if (r.complete) {
+        s_stats.complete++;
+        s_stats.completion.Add(r.last_ack_us);
+    } else {
+        s_stats.partial++;
+    }
+    if (r.acked > 1) {
+        s_stats.skew.Add(r.skew_us);
+        s_stats.skew_sum_us[r.members] += r.skew_us;
+        s_stats.skew_samples[r.members]++;
+    }
+
+    ESP_LOGI(TAG, "Group '%s' cmd %u (%s): %u/%u acked, last %lu us, skew %lu us",
+             s_groups[r.group].name, r.command_id,
+             r.fanout == PeerGroups::Fanout::Broadcast ? "bcast" : "unicast",
+             r.acked, r.members,
+             static_cast<unsigned long>(r.last_ack_us), static_cast<unsigned long>(r.skew_us));
+
+    if (s_result_cb) {
+        s_result_cb(r);
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// GROUP DEFINITIONS
+// ============================================================================
+
+void PeerGroups::Init() noexcept
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return;     // Nothing saved yet
+    }
+    for (uint8_t i = 0; i < MAX_GROUPS_; ++i) {
+        char key[4];
+        groupKey(i, key);
+        size_t size = sizeof(s_groups[i]);
+        if (nvs_get_blob(h, key, &s_groups[i], &size) != ESP_OK || size != sizeof(s_groups[i]) ||
+            s_groups[i].member_count > MAX_MEMBERS_) {
+            s_groups[i] = Group{};
+            continue;
+        }
+        s_groups[i].name[NAME_LEN_ - 1] = '\0';
+        ESP_LOGI(TAG, "Group %u '%s': %u members", i, s_groups[i].name, s_groups[i].member_count);
+    }
+    nvs_close(h);
+}
+
+bool PeerGroups::SetGroup(uint8_t index, const char* name, const uint8_t (*members)[6], size_t count) noexcept
+{
+    if (index >= MAX_GROUPS_ || count > MAX_MEMBERS_ || (s_pending.active && s_pending.group == index)) {
+        return false;
+    }
+
+    Group group{};
+    for (size_t i = 0; i < count; ++i) {
+        if (!isApproved(members[i])) {
+            ESP_LOGW(TAG, "Skipping unapproved member %u", static_cast<unsigned>(i));
+            continue;
+        }
+        bool duplicate = false;
+        for (size_t j = 0; j < group.member_count; ++j) {
+            duplicate = duplicate || MacEquals(group.members[j], members[i]);
+        }
+        if (!duplicate) {
+            std::memcpy(group.members[group.member_count++], members[i], 6);
+        }
+    }
+    if (group.member_count == 0) {
+        return false;
+    }
+    group.valid = true;
+    std::strncpy(group.name, name ? name : "", NAME_LEN_ - 1);
+
+    s_groups[index] = group;
+    saveGroup(index);
+    return true;
+}
+
+bool PeerGroups::GetGroup(uint8_t index, Group& out) noexcept
+{
+    if (index >= MAX_GROUPS_ || !s_groups[index].valid) {
+        return false;
+    }
+    out = s_groups[index];
+    return true;
+}
+
+void PeerGroups::ClearGroup(uint8_t index) noexcept
+{
+    if (index >= MAX_GROUPS_ || !s_groups[index].valid || (s_pending.active && s_pending.group == index)) {
+        return;
+    }
+    s_groups[index] = Group{};
+    saveGroup(index);
+}
+
+// ============================================================================
+// GROUP COMMANDS
+// ============================================================================
+
+bool PeerGroups::SendCommand(uint8_t index, uint8_t device_id, uint8_t command_id,
+                             const void* payload, size_t payload_len,
+                             espnow::TxPriority priority, Fanout fanout, uint32_t deadline_ms) noexcept
+{
+    if (index >= MAX_GROUPS_ || !s_groups[index].valid || payload_len >= espnow::MAX_PAYLOAD_SIZE_) {
+        return false;
+    }
+    if (s_pending.active) {
+        if (priority != espnow::TxPriority::Safety) {
+            ESP_LOGW(TAG, "Group command %u still running", s_pending.command_id);
+            return false;
+        }
+        collectAcks();
+        finish();
+    }
+
+    const Group& group = s_groups[index];
+    uint16_t member_mask = 0;
+    for (size_t i = 0; i < group.member_count; ++i) {
+        if (isApproved(group.members[i])) {
+            member_mask |= bit(i);
+        }
+    }
+    if (member_mask == 0) {
+        return false;
+    }
+
+    if (fanout == Fanout::Broadcast && !broadcastAllowed(group, member_mask)) {
+        ESP_LOGI(TAG, "Group '%s' is not every approved peer, or has link keys: unicast", group.name);
+        fanout = Fanout::Unicast;
+    }
+
+    s_pending = Pending{};
+    s_pending.active = true;
+    s_pending.group = index;
+    s_pending.device_id = device_id;
+    s_pending.command_id = command_id;
+    s_pending.priority = priority;
+    s_pending.fanout = fanout;
+    if (payload && payload_len > 0) {
+        std::memcpy(s_pending.payload, payload, payload_len);
+        s_pending.payload_len = payload_len;
+    }
+    s_pending.member_mask = member_mask;
+    s_pending.start_us = esp_timer_get_time();
+    s_pending.deadline_us = s_pending.start_us + static_cast<int64_t>(deadline_ms) * 1000;
+    s_stats.commands++;
+
+    if (fanout == Fanout::Broadcast &&
+        espnow::SendCommandTo(BROADCAST_MAC, device_id, command_id,
+                              s_pending.payload, s_pending.payload_len, priority)) {
+        s_pending.sent_mask = member_mask;
+    } else {
+        sendPending();
+    }
+    return true;
+}
+
+void PeerGroups::Service() noexcept
+{
+    if (!s_pending.active) {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    collectAcks();
+
+    if (s_pending.ack_mask == s_pending.member_mask || now_us >= s_pending.deadline_us) {
+        finish();
+        return;
+    }
+
+    // Broadcast is unacknowledged at the link level: re-send to whoever stayed silent
+    if (s_pending.fanout == Fanout::Broadcast && !s_pending.unicast_retry &&
+        now_us - s_pending.start_us >= (s_pending.deadline_us - s_pending.start_us) / 2) {
+        s_pending.unicast_retry = true;
+        s_pending.sent_mask = s_pending.ack_mask;
+    }
+    sendPending();
+}
+
+bool PeerGroups::IsBusy() noexcept
+{
+    return s_pending.active;
+}
+
+bool PeerGroups::GetLastResult(Result& out) noexcept
+{
+    if (!s_has_result) {
+        return false;
+    }
+    out = s_last_result;
+    return true;
+}
+
+void PeerGroups::SetResultCallback(ResultCallback callback) noexcept
+{
+    s_result_cb = callback;
+}
+
+const PeerGroups::Stats& PeerGroups::GetStats() noexcept
+{
+    return s_stats;
+}
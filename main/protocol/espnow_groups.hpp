@@ -0,0 +1,114 @@
+/**
+ * @file espnow_groups.hpp
+ * @brief Named groups of approved peers and fan-out group commands
+ *
+ * A group command is sent to every member either as unicast reliable
+ * Commands (queued in bursts as reliable slots and TX queue space allow; the
+ * rest follow as acks free slots) or as one broadcast
+ * frame with unicast retries for members that have not acked by half the
+ * deadline. A member counts once its session holds an OK CommandAck for this
+ * command_id. Acks are read from the per-peer sessions, so ack times are the
+ * receive times, not the time the UI got round to the event. At the deadline
+ * (or once every member acked) a Result with completion latency and the skew
+ * between the first and last ack is reported.
+ *
+ * All functions run on the UI task.
+ */
+
+#pragma once
+
+#include "espnow_protocol.hpp"
+#include "latency_histogram.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace PeerGroups {
+
+static constexpr size_t   MAX_GROUPS_ = 4;
+static constexpr size_t   MAX_MEMBERS_ = 16;
+static constexpr size_t   NAME_LEN_ = 16;
+static constexpr uint32_t DEFAULT_DEADLINE_MS_ = 1000;
+
+enum class Fanout : uint8_t {
+    Unicast,    ///< One reliable Command per member
+    Broadcast,  ///< One broadcast frame; unicast retry for members silent at half the deadline.
+                ///< Falls back to Unicast unless the group is every approved peer and none has a link key.
+};
+
+struct Group {
+    bool    valid;
+    char    name[NAME_LEN_];
+    uint8_t member_count;
+    uint8_t members[MAX_MEMBERS_][6];
+};
+
+struct Result {
+    uint8_t  group;
+    uint8_t  command_id;
+    Fanout   fanout;
+    uint8_t  members;
+    uint8_t  acked;
+    uint16_t ack_mask;          ///< Bit i set if members[i] acked
+    uint32_t first_ack_us;      ///< From the first transmission
+    uint32_t last_ack_us;       ///< Completion latency when complete
+    uint32_t skew_us;           ///< last_ack_us - first_ack_us
+    bool     complete;          ///< Every member acked before the deadline
+};
+
+using ResultCallback = void (*)(const Result& result);
+
+struct Stats {
+    uint32_t commands;
+    uint32_t complete;
+    uint32_t partial;                           ///< Deadline passed with members missing
+    espnow::LatencyHistogram completion;        ///< Complete commands only
+    espnow::LatencyHistogram skew;
+    uint32_t skew_sum_us[MAX_MEMBERS_ + 1];     ///< By group size, for skew vs. size
+    uint16_t skew_samples[MAX_MEMBERS_ + 1];
+};
+
+/**
+ * @brief Load group definitions from NVS.
+ */
+void Init() noexcept;
+
+/**
+ * @brief Define (or redefine) a group. Members must be approved peers.
+ * @return false if the index is out of range, no member is approved, or count > MAX_MEMBERS_
+ */
+bool SetGroup(uint8_t index, const char* name, const uint8_t (*members)[6], size_t count) noexcept;
+
+bool GetGroup(uint8_t index, Group& out) noexcept;
+
+void ClearGroup(uint8_t index) noexcept;
+
+/**
+ * @brief Send a command to every member of a group.
+ *
+ * One group command is in flight at a time. A Safety command (stop) cuts the
+ * running one short and reports it; anything else is rejected while busy.
+ */
+bool SendCommand(uint8_t index, uint8_t device_id, uint8_t command_id,
+                 const void* payload, size_t payload_len,
+                 espnow::TxPriority priority = espnow::TxPriority::Control,
+                 Fanout fanout = Fanout::Unicast,
+                 uint32_t deadline_ms = DEFAULT_DEADLINE_MS_) noexcept;
+
+/**
+ * @brief Send pending members, collect acks, finish at the deadline. Call from the UI loop.
+ */
+void Service() noexcept;
+
+bool IsBusy() noexcept;
+
+/**
+ * @brief Result of the last finished group command.
+ * @return false if none has finished yet
+ */
+bool GetLastResult(Result& out) noexcept;
+
+void SetResultCallback(ResultCallback callback) noexcept;
+
+const Stats& GetStats() noexcept;
+
+} // namespace PeerGroups
@@ -8,6 +8,9 @@
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <cstdio>
 #include <cstring>
 
 static const char* TAG = "PeerStore";
@@ -15,12 +18,291 @@ static const char* TAG = "PeerStore";
 namespace {
 
 const char* NVS_NAMESPACE = "espnow_peers";
-const char* KEY_PEERS = "peers";
+
+// One blob per peer, key "p" + 12 lowercase hex digits of the MAC. NVS writes
+// each entry atomically, so a power loss can lose at most the peer being
+// written. Everything else in the namespace is ignored on load.
+constexpr char   PEER_KEY_PREFIX = 'p';
+constexpr size_t PEER_KEY_LEN = 13;
+
+// Link keys (ESP-NOW LMK) live beside the records under "k" + the same MAC
+// digits, so ApprovedPeer and the legacy blob layouts stay unchanged.
+constexpr char   LINK_KEY_PREFIX = 'k';
+
+// Whole-table blobs from earlier firmware; migrated to per-peer keys and erased
+const char* KEY_PEERS = "peers";            // LEGACY_PEER_SLOTS entries, layout of the v1 SecuritySettings
 const char* KEY_CRC = "peers_crc";
+const char* KEY_PEERS_EXT = "peers_ext";    // Entries LEGACY_PEER_SLOTS.. up to the last valid one
+const char* KEY_EXT_CRC = "peers_ext_crc";
+
+constexpr size_t LEGACY_BLOB_SIZE = sizeof(ApprovedPeer) * LEGACY_PEER_SLOTS;
+constexpr size_t EXT_PEER_SLOTS = MAX_APPROVED_PEERS - LEGACY_PEER_SLOTS;
+
+constexpr size_t NVS_ENTRY_SIZE = 32;
+
+PeerStore::Stats s_stats{};
 
 ApprovedPeer s_preconfigured_peer{};
 bool s_has_preconfigured = false;
 
+// The receive task looks peers up while the UI and pairing code add and remove
+// them. s_mux guards peer_index, the lookup caches below and the fields lookups
+// read (valid, mac, device_type); the index is rebuilt aside and swapped in.
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Lookup caches (entry + 1, 0 = none). Checked against the entry's MAC before
+// use, so a stale value only costs a miss; cleared whenever the index changes.
+uint8_t s_last_hit = 0;
+uint8_t s_type_hit = 0;
+uint8_t s_type_hit_type = 0;
+
+size_t macHash(const uint8_t mac[6]) noexcept
+{
+    // FNV-1a; vendor prefixes repeat across a bench, so mix all six bytes
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; ++i) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    return h & (PEER_INDEX_SLOTS - 1);
+}
+
+void rebuildIndex(SecuritySettings& sec) noexcept
+{
+    uint8_t index[PEER_INDEX_SLOTS] = {};
+    taskENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < MAX_APPROVED_PEERS; ++i) {
+        const ApprovedPeer& peer = sec.approved_peers[i];
+        if (!peer.valid) continue;
+        size_t slot = macHash(peer.mac);
+        while (index[slot] != 0) {
+            slot = (slot + 1) & (PEER_INDEX_SLOTS - 1);
+        }
+        index[slot] = static_cast<uint8_t>(i + 1);
+    }
+    std::memcpy(sec.peer_index, index, sizeof(sec.peer_index));
+    s_last_hit = 0;
+    s_type_hit = 0;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+/// Index of the approved peer with this MAC, or -1. O(1) expected. Caller holds s_mux.
+int findEntry(const SecuritySettings& sec, const uint8_t mac[6]) noexcept
+{
+    if (s_last_hit != 0) {
+        const ApprovedPeer& peer = sec.approved_peers[s_last_hit - 1];
+        if (peer.valid && MacEquals(peer.mac, mac)) {
+            return s_last_hit - 1;
+        }
+    }
+
+    size_t slot = macHash(mac);
+    for (size_t probes = 0; probes < PEER_INDEX_SLOTS; ++probes) {
+        uint8_t entry = sec.peer_index[slot];
+        if (entry == 0) {
+            return -1;
+        }
+        const ApprovedPeer& peer = sec.approved_peers[entry - 1];
+        if (peer.valid && MacEquals(peer.mac, mac)) {
+            s_last_hit = entry;
+            return entry - 1;
+        }
+        slot = (slot + 1) & (PEER_INDEX_SLOTS - 1);
+    }
+    return -1;
+}
+
+/// Load a blob guarded by a CRC key into buf. Returns the blob size, 0 if missing or corrupt.
+size_t loadBlob(nvs_handle_t h, const char* key, const char* crc_key, void* buf, size_t max_size) noexcept
+{
+    size_t size = 0;
+    if (nvs_get_blob(h, key, nullptr, &size) != ESP_OK || size == 0 || size > max_size) {
+        return 0;
+    }
+    if (nvs_get_blob(h, key, buf, &size) != ESP_OK) {
+        return 0;
+    }
+    uint32_t stored_crc = 0;
+    if (nvs_get_u32(h, crc_key, &stored_crc) != ESP_OK ||
+        esp_crc32_le(0, static_cast<const uint8_t*>(buf), size) != stored_crc) {
+        ESP_LOGW(TAG, "CRC mismatch on '%s', ignoring", key);
+        return 0;
+    }
+    return size;
+}
+
+void macKey(char prefix, const uint8_t mac[6], char out[PEER_KEY_LEN + 1]) noexcept
+{
+    snprintf(out, PEER_KEY_LEN + 1, "%c%02x%02x%02x%02x%02x%02x", prefix,
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void peerKey(const uint8_t mac[6], char out[PEER_KEY_LEN + 1]) noexcept
+{
+    macKey(PEER_KEY_PREFIX, mac, out);
+}
+
+bool isPeerKey(const char* key) noexcept
+{
+    return key[0] == PEER_KEY_PREFIX && std::strlen(key) == PEER_KEY_LEN;
+}
+
+/// Flash written by an NVS blob: data header + data spans + blob index entry
+size_t nvsBlobBytes(size_t len) noexcept
+{
+    return NVS_ENTRY_SIZE * (2 + (len + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE);
+}
+
+bool writeRecord(nvs_handle_t h, const ApprovedPeer& peer) noexcept
+{
+    char key[PEER_KEY_LEN + 1];
+    peerKey(peer.mac, key);
+    esp_err_t err = nvs_set_blob(h, key, &peer, sizeof(peer));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write %s: %s", key, esp_err_to_name(err));
+        return false;
+    }
+    s_stats.records_written++;
+    s_stats.bytes_written += nvsBlobBytes(sizeof(peer));
+    return true;
+}
+
+/// Open the namespace, run one record operation, commit.
+template <typename Fn>
+void withNvs(Fn&& fn) noexcept
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    if (fn(h)) {
+        nvs_commit(h);
+    }
+    nvs_close(h);
+}
+
+void saveRecord(const ApprovedPeer& peer) noexcept
+{
+    withNvs([&](nvs_handle_t h) { return writeRecord(h, peer); });
+}
+
+void eraseRecord(const uint8_t mac[6]) noexcept
+{
+    withNvs([&](nvs_handle_t h) {
+        char key[PEER_KEY_LEN + 1];
+        macKey(LINK_KEY_PREFIX, mac, key);
+        nvs_erase_key(h, key);  // Usually absent
+        peerKey(mac, key);
+        if (nvs_erase_key(h, key) != ESP_OK) {
+            return false;
+        }
+        s_stats.records_erased++;
+        return true;
+    });
+}
+
+bool recordMatchesKey(const ApprovedPeer& peer, const char* key) noexcept
+{
+    char expected[PEER_KEY_LEN + 1];
+    peerKey(peer.mac, expected);
+    return std::strcmp(expected, key) == 0;
+}
+
+/**
+ * @brief Fill sec from the per-peer records in a single pass over the namespace.
+ * @param visited Receives the number of NVS entries looked at
+ * @param legacy Set if whole-table blobs from earlier firmware are present
+ * @return Number of peers loaded
+ */
+size_t loadRecords(nvs_handle_t h, SecuritySettings& sec, uint16_t& visited, bool& legacy) noexcept
+{
+    size_t loaded = 0;
+    visited = 0;
+    legacy = false;
+
+    nvs_iterator_t it = nullptr;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVS_NAMESPACE, NVS_TYPE_BLOB, &it);
+    while (res == ESP_OK) {
+        nvs_entry_info_t info{};
+        nvs_entry_info(it, &info);
+        visited++;
+
+        if (isPeerKey(info.key) && loaded < MAX_APPROVED_PEERS) {
+            ApprovedPeer& slot = sec.approved_peers[loaded];
+            size_t size = sizeof(slot);
+            if (nvs_get_blob(h, info.key, &slot, &size) == ESP_OK && size == sizeof(slot) &&
+                slot.valid && recordMatchesKey(slot, info.key)) {
+                ++loaded;
+            } else {
+                ESP_LOGW(TAG, "Ignoring bad peer record %s", info.key);
+                slot = ApprovedPeer{};
+            }
+        } else if (std::strcmp(info.key, KEY_PEERS) == 0 || std::strcmp(info.key, KEY_PEERS_EXT) == 0) {
+            legacy = true;
+        }
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    return loaded;
+}
+
+/**
+ * @brief Move peers from the whole-table blobs to per-peer records.
+ *
+ * The old keys are erased only once every valid peer has been written and
+ * committed. A missing or corrupt blob, or a failed write, leaves them in
+ * place so the migration runs again on the next boot.
+ */
+void migrateLegacyBlobs(nvs_handle_t h, SecuritySettings& sec) noexcept
+{
+    std::memset(sec.approved_peers, 0, sizeof(sec.approved_peers));
+    bool ok = loadBlob(h, KEY_PEERS, KEY_CRC, sec.approved_peers, LEGACY_BLOB_SIZE) == LEGACY_BLOB_SIZE;
+    if (!ok) {
+        ESP_LOGW(TAG, "Legacy peer table unreadable, keeping it");
+    }
+
+    size_t migrated = 0;
+    if (ok) {
+        // The extension blob is optional (absent with <= LEGACY_PEER_SLOTS peers), but must be whole
+        size_t ext_size = 0;
+        if (nvs_get_blob(h, KEY_PEERS_EXT, nullptr, &ext_size) == ESP_OK) {
+            ApprovedPeer* ext = &sec.approved_peers[LEGACY_PEER_SLOTS];
+            ext_size = loadBlob(h, KEY_PEERS_EXT, KEY_EXT_CRC, ext, EXT_PEER_SLOTS * sizeof(ApprovedPeer));
+            if (ext_size == 0 || ext_size % sizeof(ApprovedPeer) != 0) {
+                ESP_LOGW(TAG, "Legacy peer extension unreadable, keeping it");
+                ok = false;
+            }
+        }
+    }
+    if (ok) {
+        for (const auto& peer : sec.approved_peers) {
+            if (!peer.valid || IsZeroMac(peer.mac)) continue;
+            if (!writeRecord(h, peer)) {
+                ok = false;
+                break;
+            }
+            ++migrated;
+        }
+    }
+    if (ok && nvs_commit(h) != ESP_OK) {
+        ok = false;
+    }
+
+    if (ok) {
+        nvs_erase_key(h, KEY_PEERS);
+        nvs_erase_key(h, KEY_CRC);
+        nvs_erase_key(h, KEY_PEERS_EXT);
+        nvs_erase_key(h, KEY_EXT_CRC);
+        nvs_commit(h);
+        ESP_LOGI(TAG, "Migrated %zu peers to per-peer NVS records", migrated);
+    } else {
+        ESP_LOGW(TAG, "Peer migration incomplete (%zu written), retrying next boot", migrated);
+    }
+    std::memset(sec.approved_peers, 0, sizeof(sec.approved_peers));
+}
+
 } // namespace
 
 void PeerStore::Init(SecuritySettings& sec,
@@ -56,34 +338,26 @@ void PeerStore::Init(SecuritySettings& sec,
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        rebuildIndex(sec);
         return;
     }
     
-    size_t required_size = sizeof(SecuritySettings);
-    size_t blob_size = 0;
-    
-    err = nvs_get_blob(h, KEY_PEERS, nullptr, &blob_size);
-    
-    if (err == ESP_OK && blob_size == required_size) {
-        SecuritySettings loaded{};
-        err = nvs_get_blob(h, KEY_PEERS, &loaded, &blob_size);
-        
-        if (err == ESP_OK) {
-            uint32_t stored_crc = 0;
-            if (nvs_get_u32(h, KEY_CRC, &stored_crc) == ESP_OK) {
-                uint32_t calc_crc = esp_crc32_le(0, (const uint8_t*)&loaded, 
-                                                  sizeof(SecuritySettings));
-                if (calc_crc == stored_crc) {
-                    sec = loaded;
-                    ESP_LOGI(TAG, "Loaded peer list from NVS");
-                }
-            }
-        }
-    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGI(TAG, "No saved peers, starting fresh");
+    int64_t start_us = esp_timer_get_time();
+    uint16_t visited = 0;
+    bool legacy = false;
+    size_t loaded = loadRecords(h, sec, visited, legacy);
+    if (legacy) {
+        migrateLegacyBlobs(h, sec);
+        loaded = loadRecords(h, sec, visited, legacy);
     }
+
+    s_stats.load_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+    s_stats.load_entries = visited;
+    ESP_LOGI(TAG, "Loaded %zu peers from %u NVS entries in %lu us",
+             loaded, visited, static_cast<unsigned long>(s_stats.load_us));
     
     nvs_close(h);
+    rebuildIndex(sec);
     LogPeers(sec);
 }
 
@@ -92,16 +366,19 @@ bool PeerStore::AddPeer(SecuritySettings& sec, const uint8_t mac[6],
 {
     if (IsZeroMac(mac)) return false;
     
-    for (auto& peer : sec.approved_peers) {
-        if (peer.valid && MacEquals(peer.mac, mac)) {
-            peer.device_type = static_cast<uint8_t>(type);
-            if (name) {
-                strncpy(peer.name, name, sizeof(peer.name) - 1);
-                peer.name[sizeof(peer.name) - 1] = '\0';
-            }
-            Save(sec);
-            return true;
+    taskENTER_CRITICAL(&s_mux);
+    int existing = findEntry(sec, mac);
+    if (existing >= 0) {
+        ApprovedPeer& peer = sec.approved_peers[existing];
+        peer.device_type = static_cast<uint8_t>(type);
+        if (name) {
+            strncpy(peer.name, name, sizeof(peer.name) - 1);
+            peer.name[sizeof(peer.name) - 1] = '\0';
         }
+        s_type_hit = 0;
+        taskEXIT_CRITICAL(&s_mux);
+        saveRecord(peer);
+        return true;
     }
     
     for (auto& peer : sec.approved_peers) {
@@ -116,29 +393,36 @@ bool PeerStore::AddPeer(SecuritySettings& sec, const uint8_t mac[6],
             } else {
                 strncpy(peer.name, "Unknown", sizeof(peer.name) - 1);
             }
+            taskEXIT_CRITICAL(&s_mux);
             
             ESP_LOGI(TAG, "Added peer: %02X:%02X:%02X:%02X:%02X:%02X (%s)",
                      mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], peer.name);
-            Save(sec);
+            rebuildIndex(sec);
+            saveRecord(peer);
             return true;
         }
     }
     
+    taskEXIT_CRITICAL(&s_mux);
     ESP_LOGW(TAG, "No room for new peer");
     return false;
 }
 
 bool PeerStore::RemovePeer(SecuritySettings& sec, const uint8_t mac[6]) noexcept
 {
-    for (auto& peer : sec.approved_peers) {
-        if (peer.valid && MacEquals(peer.mac, mac)) {
-            peer.valid = false;
-            std::memset(&peer, 0, sizeof(peer));
-            Save(sec);
-            return true;
-        }
+    taskENTER_CRITICAL(&s_mux);
+    int entry = findEntry(sec, mac);
+    if (entry >= 0) {
+        std::memset(&sec.approved_peers[entry], 0, sizeof(ApprovedPeer));
     }
-    return false;
+    taskEXIT_CRITICAL(&s_mux);
+    if (entry < 0) {
+        return false;
+    }
+    // Rebuild rather than delete in place: keeps probe chains intact, and removal is rare
+    rebuildIndex(sec);
+    eraseRecord(mac);
+    return true;
 }
 
 bool PeerStore::IsPeerApproved(const SecuritySettings& sec, const uint8_t mac[6]) noexcept
@@ -149,13 +433,10 @@ bool PeerStore::IsPeerApproved(const SecuritySettings& sec, const uint8_t mac[6]
         return true;
     }
     
-    for (const auto& peer : sec.approved_peers) {
-        if (peer.valid && MacEquals(peer.mac, mac)) {
-            return true;
-        }
-    }
-    
-    return false;
+    taskENTER_CRITICAL(&s_mux);
+    bool approved = findEntry(sec, mac) >= 0;
+    taskEXIT_CRITICAL(&s_mux);
+    return approved;
 }
 
 const ApprovedPeer* PeerStore::GetPeer(const SecuritySettings& sec, 
@@ -165,12 +446,23 @@ const ApprovedPeer* PeerStore::GetPeer(const SecuritySettings& sec,
         return &s_preconfigured_peer;
     }
     
-    for (const auto& peer : sec.approved_peers) {
-        if (peer.valid && MacEquals(peer.mac, mac)) {
-            return &peer;
-        }
+    taskENTER_CRITICAL(&s_mux);
+    int entry = findEntry(sec, mac);
+    taskEXIT_CRITICAL(&s_mux);
+    return (entry >= 0) ? &sec.approved_peers[entry] : nullptr;
+}
+
+int PeerStore::GetPeerSlot(const SecuritySettings& sec, const uint8_t mac[6]) noexcept
+{
+    if (IsZeroMac(mac)) return -1;
+
+    if (s_has_preconfigured && MacEquals(s_preconfigured_peer.mac, mac)) {
+        return static_cast<int>(MAX_APPROVED_PEERS);
     }
-    return nullptr;
+    taskENTER_CRITICAL(&s_mux);
+    int entry = findEntry(sec, mac);
+    taskEXIT_CRITICAL(&s_mux);
+    return entry;
 }
 
 bool PeerStore::GetFirstPeerOfType(const SecuritySettings& sec, DeviceType type,
@@ -182,37 +474,106 @@ bool PeerStore::GetFirstPeerOfType(const SecuritySettings& sec, DeviceType type,
         std::memcpy(mac_out, s_preconfigured_peer.mac, 6);
         return true;
     }
+
+    bool found = false;
+    taskENTER_CRITICAL(&s_mux);
+    // Called for every send to the current target: remember the answer
+    if (s_type_hit != 0 && s_type_hit_type == type_val) {
+        const ApprovedPeer& peer = sec.approved_peers[s_type_hit - 1];
+        if (peer.valid && peer.device_type == type_val) {
+            std::memcpy(mac_out, peer.mac, 6);
+            found = true;
+        }
+    }
     
-    for (const auto& peer : sec.approved_peers) {
+    for (size_t i = 0; i < MAX_APPROVED_PEERS && !found; ++i) {
+        const ApprovedPeer& peer = sec.approved_peers[i];
         if (peer.valid && peer.device_type == type_val) {
+            s_type_hit = static_cast<uint8_t>(i + 1);
+            s_type_hit_type = type_val;
             std::memcpy(mac_out, peer.mac, 6);
-            return true;
+            found = true;
         }
     }
-    return false;
+    taskEXIT_CRITICAL(&s_mux);
+    return found;
 }
 
-void PeerStore::Save(const SecuritySettings& sec) noexcept
+size_t PeerStore::GetPeersOfType(const SecuritySettings& sec, DeviceType type,
+                                 ApprovedPeer* out, size_t max_count) noexcept
 {
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
-        return;
+    uint8_t type_val = static_cast<uint8_t>(type);
+    size_t count = 0;
+
+    if (s_has_preconfigured && s_preconfigured_peer.device_type == type_val && count < max_count) {
+        out[count++] = s_preconfigured_peer;
     }
-    
-    uint32_t crc = esp_crc32_le(0, (const uint8_t*)&sec, sizeof(SecuritySettings));
-    
-    err = nvs_set_blob(h, KEY_PEERS, &sec, sizeof(SecuritySettings));
-    if (err == ESP_OK) {
-        err = nvs_set_u32(h, KEY_CRC, crc);
+
+    taskENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < MAX_APPROVED_PEERS && count < max_count; ++i) {
+        const ApprovedPeer& peer = sec.approved_peers[i];
+        if (peer.valid && peer.device_type == type_val) {
+            out[count++] = peer;
+        }
     }
-    
-    if (err == ESP_OK) {
-        nvs_commit(h);
+    taskEXIT_CRITICAL(&s_mux);
+    return count;
+}
+
+bool PeerStore::SetLinkKey(const SecuritySettings& sec, const uint8_t mac[6],
+                           const uint8_t key[LINK_KEY_SIZE]) noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    bool paired = findEntry(sec, mac) >= 0;
+    taskEXIT_CRITICAL(&s_mux);
+    if (!paired) {
+        return false;   // Only paired peers have a link key
     }
-    
+    bool ok = false;
+    withNvs([&](nvs_handle_t h) {
+        char nvs_key[PEER_KEY_LEN + 1];
+        macKey(LINK_KEY_PREFIX, mac, nvs_key);
+        ok = nvs_set_blob(h, nvs_key, key, LINK_KEY_SIZE) == ESP_OK;
+        if (ok) {
+            s_stats.records_written++;
+            s_stats.bytes_written += nvsBlobBytes(LINK_KEY_SIZE);
+        }
+        return ok;
+    });
+    return ok;
+}
+
+bool PeerStore::GetLinkKey(const uint8_t mac[6], uint8_t key_out[LINK_KEY_SIZE]) noexcept
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    char nvs_key[PEER_KEY_LEN + 1];
+    macKey(LINK_KEY_PREFIX, mac, nvs_key);
+    size_t size = LINK_KEY_SIZE;
+    bool ok = nvs_get_blob(h, nvs_key, key_out, &size) == ESP_OK && size == LINK_KEY_SIZE;
     nvs_close(h);
+    return ok;
+}
+
+void PeerStore::Save(const SecuritySettings& sec) noexcept
+{
+    // Full rewrite; AddPeer/RemovePeer only touch their own record
+    withNvs([&](nvs_handle_t h) {
+        bool ok = true;
+        for (const auto& peer : sec.approved_peers) {
+            if (peer.valid && !writeRecord(h, peer)) {
+                ok = false;
+            }
+        }
+        return ok;
+    });
+}
+
+PeerStore::Stats PeerStore::GetStats() noexcept
+{
+    return s_stats;
 }
 
 size_t PeerStore::GetPeerCount(const SecuritySettings& sec) noexcept
@@ -226,11 +587,16 @@ size_t PeerStore::GetPeerCount(const SecuritySettings& sec) noexcept
 
 void PeerStore::ClearAll(SecuritySettings& sec) noexcept
 {
+    taskENTER_CRITICAL(&s_mux);
     for (auto& peer : sec.approved_peers) {
         peer.valid = false;
         std::memset(&peer, 0, sizeof(peer));
     }
-    Save(sec);
+    taskEXIT_CRITICAL(&s_mux);
+    rebuildIndex(sec);
+
+    // Nothing else lives in this namespace
+    withNvs([](nvs_handle_t h) { return nvs_erase_all(h) == ESP_OK; });
 }
 
 void PeerStore::LogPeers(const SecuritySettings& sec) noexcept
@@ -1,6 +1,14 @@
 /**
  * @file espnow_peer_store.hpp
  * @brief NVS-based storage for approved ESP-NOW peers
+ *
+ * Peers are looked up through a MAC-keyed hash index (SecuritySettings::peer_index)
+ * with a last-hit cache, since IsPeerApproved runs for every received frame.
+ * Lookups and changes take a short spinlock, so the receive task may look peers
+ * up while the UI or pairing code adds and removes them.
+ * Each peer is its own NVS record, so pairing or unpairing writes or erases
+ * exactly one entry, and boot loads the table in one pass over the namespace.
+ * Whole-table blobs from earlier firmware are migrated on first boot.
  */
 
 #pragma once
@@ -10,6 +18,14 @@
 
 namespace PeerStore {
 
+struct Stats {
+    uint32_t records_written;   ///< Per-peer NVS records written
+    uint32_t records_erased;
+    uint32_t bytes_written;     ///< Estimated flash bytes (32-byte NVS entries)
+    uint32_t load_us;           ///< Duration of the last Init() load
+    uint16_t load_entries;      ///< NVS entries visited by that load
+};
+
 void Init(SecuritySettings& sec, 
           const uint8_t* preconfigured_mac = nullptr,
           DeviceType preconfigured_type = DeviceType::Unknown,
@@ -24,11 +40,43 @@ bool IsPeerApproved(const SecuritySettings& sec, const uint8_t mac[6]) noexcept;
 
 const ApprovedPeer* GetPeer(const SecuritySettings& sec, const uint8_t mac[6]) noexcept;
 
+/**
+ * @brief Stable slot of an approved peer, for per-peer state arrays of PEER_SLOTS.
+ * @return Table index, MAX_APPROVED_PEERS for the pre-configured peer, -1 if not approved
+ */
+int GetPeerSlot(const SecuritySettings& sec, const uint8_t mac[6]) noexcept;
+
 bool GetFirstPeerOfType(const SecuritySettings& sec, DeviceType type, 
                         uint8_t mac_out[6]) noexcept;
 
+/**
+ * @brief Copy every approved peer of one type, the pre-configured peer first.
+ * @return Number written to out
+ */
+size_t GetPeersOfType(const SecuritySettings& sec, DeviceType type,
+                      ApprovedPeer* out, size_t max_count) noexcept;
+
+/**
+ * @brief Persist the ESP-NOW link key (LMK) of an approved peer.
+ *
+ * Stored as its own record; RemovePeer and ClearAll erase it with the peer.
+ */
+bool SetLinkKey(const SecuritySettings& sec, const uint8_t mac[6],
+                const uint8_t key[LINK_KEY_SIZE]) noexcept;
+
+/**
+ * @brief Read a peer's link key from NVS.
+ * @return false if the peer paired without one (older firmware, or no LMK slot left)
+ */
+bool GetLinkKey(const uint8_t mac[6], uint8_t key_out[LINK_KEY_SIZE]) noexcept;
+
+/**
+ * @brief Rewrite every peer record (AddPeer/RemovePeer already persist their own change).
+ */
 void Save(const SecuritySettings& sec) noexcept;
 
+Stats GetStats() noexcept;
+
 size_t GetPeerCount(const SecuritySettings& sec) noexcept;
 
 void ClearAll(SecuritySettings& sec) noexcept;
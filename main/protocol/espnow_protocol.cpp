@@ -8,12 +8,20 @@
 
 #include "espnow_protocol.hpp"
 #include "espnow_peer_store.hpp"
+#include "espnow_replay.hpp"
+#include "espnow_fragment.hpp"
 #include "../config.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "esp_netif.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 
 static const char* TAG_ = "espnow";
@@ -23,9 +31,13 @@ static const char* TAG_ = "espnow";
 // ============================================================================
 
 static QueueHandle_t s_proto_event_queue_ = nullptr;
-static uint8_t s_next_msg_id_ = 1;
 static QueueHandle_t s_raw_recv_queue_ = nullptr;
 
+/// TX task state. s_next_msg_id_ (ids for peers without a link, e.g. broadcast) is only touched by the TX task.
+static QueueHandle_t s_tx_queues_[espnow::TX_PRIORITY_COUNT_] = {};
+static TaskHandle_t s_tx_task_ = nullptr;
+static uint8_t s_next_msg_id_ = 1;
+
 /// Security settings with approved peer list
 static SecuritySettings s_security_{};
 
@@ -35,6 +47,67 @@ static uint8_t s_my_challenge_[CHALLENGE_SIZE] = {0};
 static uint8_t s_pending_responder_mac_[6] = {0};
 static TickType_t s_pairing_timeout_tick_ = 0;
 
+/// Peers registered with encrypt = true (the driver caps this at MAX_ENCRYPTED_PEERS)
+static size_t s_encrypted_peers_ = 0;
+
+/// Unicast peers registered with the driver; the broadcast peer takes the remaining slot.
+/// Encrypted ones stay (the driver needs their key to decrypt), the rest are evicted
+/// least recently used. Guarded by s_driver_peer_mutex_, as is s_encrypted_peers_.
+struct DriverPeer {
+    bool     used;
+    bool     encrypted;
+    uint8_t  mac[6];
+    uint32_t last_use;      ///< s_driver_peer_clock_ at the last send
+    uint32_t generation;    ///< s_driver_peer_clock_ at registration
+};
+static DriverPeer s_driver_peers_[ESP_NOW_MAX_TOTAL_PEER_NUM - 1] = {};
+static uint32_t s_driver_peer_clock_ = 0;
+static SemaphoreHandle_t s_driver_peer_mutex_ = nullptr;
+
+/// How long pairing waits for the MAC-level ack of PairingConfirm before installing the LMK
+static constexpr uint32_t CONFIRM_ACK_TIMEOUT_MS_ = 200;
+
+/// Raw frames between the Wi-Fi callback and the receive task; deep enough for a
+/// full pairing sweep answering one broadcast at once
+static constexpr UBaseType_t RAW_RECV_QUEUE_DEPTH_ = espnow::PAIRING_SWEEP_MAX_;
+
+/// Reliable delivery state (guarded by s_reliable_mutex_)
+static SemaphoreHandle_t s_reliable_mutex_ = nullptr;
+static espnow::DeliveryCallback s_delivery_cb_ = nullptr;
+static espnow::ReliabilityStats s_reliability_stats_{};
+
+/// Send completion state (guarded by s_send_mux_, also touched from the Wi-Fi task)
+static portMUX_TYPE s_send_mux_ = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t s_send_events_ = nullptr;   ///< Bit i set when slot i completes
+static constexpr EventBits_t PROBE_ACK_BIT_ = 1u << 23;  ///< Above every send slot bit
+static constexpr EventBits_t SWITCH_ACK_BIT_ = 1u << 22; ///< ChannelSwitchAck for the pending commit
+
+/// Current radio channel and the outstanding ChannelProbe (ProbePeer is single-caller)
+static uint8_t  s_channel_ = espnow::WIFI_CHANNEL_;
+static uint8_t  s_probe_mac_[6] = {};
+static uint32_t s_probe_token_ = 0;
+static int64_t  s_probe_rx_us_ = 0;
+static uint8_t  s_commit_mac_[6] = {};      ///< Peer CommitChannelSwitch waits for
+static volatile bool s_commit_pending_ = false;
+static volatile uint8_t s_commit_ack_id_ = 0;   ///< Header id of its latest ChannelSwitchAck
+static espnow::SendCompleteCallback s_send_complete_cb_ = nullptr;
+static uint8_t s_send_slot_cursor_ = 0;
+static uint32_t s_send_tx_order_ = 0;
+
+/// Aggregation settings/counters (TX task writes, others read)
+static uint32_t s_aggregation_flush_us_ = espnow::AGGREGATION_FLUSH_MS_ * 1000;
+static espnow::AggregationStats s_aggregation_stats_{};
+
+/// Fragmentation (reassembler: receive task only)
+static espnow::Reassembler s_reassembler_;
+static espnow::LargeMessageCallback s_large_message_cb_ = nullptr;
+static uint8_t s_fragment_msg_id_ = 0;
+static uint32_t s_large_messages_sent_ = 0;
+static uint32_t s_fragments_sent_ = 0;
+
+static espnow::BulkFrameHandler s_bulk_handler_ = nullptr;
+static espnow::TimeSyncHandler s_time_sync_handler_ = nullptr;
+
 // ============================================================================
 // INTERNAL STRUCTURES
 // ============================================================================
@@ -43,8 +116,120 @@ struct RawMsg {
     uint8_t data[sizeof(espnow::EspNowPacket)];
     int     len;
     uint8_t src_mac[6];
+    int8_t  rssi;
+    bool    has_rssi;
+    int64_t rx_us;      ///< Taken in the receive callback, before any queueing
+};
+
+/// A message queued for the TX task. The header id is assigned at transmit time.
+struct TxRequest {
+    uint8_t         dst_mac[6];
+    uint8_t         device_id;
+    espnow::MsgType type;
+    espnow::TxPriority priority;
+    bool            reliable;
+    int16_t         echo_id;        ///< Header id to reuse (acks echo the request's), -1 for the next one
+    int8_t          send_slot;      ///< Reserved send slot, -1 if untracked
+    uint8_t         payload_len;
+    uint8_t         payload[espnow::MAX_PAYLOAD_SIZE_];
+};
+
+/// Per-peer link and session state: RTT estimate for retransmit timing, recent-frame
+/// memory for dedup, capabilities, and what the application sees as the session.
+struct PeerLink {
+    bool     in_use;
+    uint8_t  mac[6];
+    bool     aggregation;     ///< Peer understands Aggregate frames
+    bool     rtt_valid;
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+    uint32_t rto_us;
+    uint32_t rx_recent[espnow::RX_DEDUP_DEPTH_];     ///< (type, id, first payload byte) of accepted echoed-id/legacy frames
+    int64_t  rx_recent_us[espnow::RX_DEDUP_DEPTH_];
+    uint8_t  rx_recent_head;
+    espnow::ReplayWindow rx_window;                  ///< Peer's own ids (peers with a capability block)
+    uint32_t rx_duplicates;
+    espnow::PeerCapabilities caps;
+    bool     caps_legacy;     ///< Answered DeviceDiscovery without a capability block
+    uint8_t  caps_queries;
+    int64_t  caps_queried_us;
+    uint8_t  tx_next_id;      ///< Header ids run per peer (TX task)
+    uint8_t  device_id;
+    uint8_t  last_rx_id;
+    uint32_t rx_messages;
+    int64_t  last_rx_us;
+    int64_t  last_ack_us;
+    uint8_t  last_ack_command;
+    bool     last_ack_ok;
+    uint8_t  pending_command;
+    uint8_t  status_len;
+    int64_t  status_us;
+    uint8_t  status[espnow::SESSION_STATUS_MAX_];
+    int16_t  rssi_avg_x16;    ///< EWMA in 1/16 dBm
+    int8_t   rssi_last;
+    int8_t   rssi_min;
+    uint32_t rssi_samples;
+    uint32_t rx_gaps;
+    uint32_t rx_lost;
+    espnow::LatencyHistogram rtt;
+};
+
+/// A reliable message waiting for its ack.
+struct OutstandingMsg {
+    bool            in_use;
+    bool            reserved;           ///< Free, but held for dst_mac/type until reserved_until_us
+    int64_t         reserved_until_us;
+    uint8_t         dst_mac[6];
+    uint8_t         device_id;
+    uint8_t         msg_id;
+    espnow::MsgType type;
+    espnow::MsgType ack_type;
+    uint8_t         frame[sizeof(espnow::EspNowPacket)];
+    uint8_t         frame_len;
+    uint8_t         attempts;
+    int64_t         first_tx_us;
+    int64_t         next_tx_us;
+    uint32_t        rto_us;
+};
+
+// Indexed by PeerStore::GetPeerSlot, so finding a peer's link is a hash lookup
+static constexpr size_t MAX_LINKS_ = PEER_SLOTS;
+static PeerLink s_links_[MAX_LINKS_] = {};
+
+/// A frame handed to esp_now_send, completed by espnowSendCb (FIFO per destination).
+struct SendSlot {
+    uint16_t               generation;   ///< 1..4095, bumped on every reuse
+    bool                   submitted;    ///< Handed to esp_now_send (queued slots are not)
+    uint32_t               tx_order;     ///< Submission order, for FIFO matching in the send callback
+    espnow::SendCompletion completion;
+};
+
+/// Driver-level TX stats per destination MAC.
+struct TxLink {
+    bool                in_use;
+    uint8_t             mac[6];
+    espnow::TxLinkStats stats;
 };
 
+static_assert(espnow::SEND_SLOTS_ <= 16, "Slot index must fit in 4 bits and an event group");
+static SendSlot s_send_slots_[espnow::SEND_SLOTS_] = {};
+
+/// Sub-messages collected for one peer until the flush deadline. TX task only.
+struct TxBatch {
+    bool    active;
+    uint8_t dst_mac[6];
+    uint8_t buf[espnow::MAX_PAYLOAD_SIZE_];
+    uint8_t len;
+    uint8_t count;
+    int8_t  slots[espnow::SEND_SLOTS_];
+    uint8_t slot_count;
+    int64_t deadline_us;
+};
+
+static TxBatch s_tx_batch_ = {};
+static TxLink s_tx_links_[MAX_LINKS_ + 1] = {};   // + broadcast
+static OutstandingMsg s_outstanding_[espnow::RELIABLE_MAX_OUTSTANDING_] = {};
+
 // ============================================================================
 // FORWARD DECLARATIONS
 // ============================================================================
@@ -55,25 +240,157 @@ static void recvTask(void*);
 static void handlePacket(const RawMsg& msg, const uint8_t* data, int len);
 static void handlePairingResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt);
 static void handlePairingReject(const uint8_t* src_mac, const espnow::EspNowPacket& pkt);
+static void collectSweepResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt);
 static bool sendPacketTo(const uint8_t* dst_mac, uint8_t device_id, 
-                         espnow::MsgType type, const void* payload, uint8_t payload_len);
+                         espnow::MsgType type, const void* payload, uint8_t payload_len,
+                         espnow::TxPriority priority, bool reliable = false,
+                         espnow::SendHandle* handle_out = nullptr, int echo_id = -1);
+static void txTask(void*);
+static int reserveSendSlot(const uint8_t* dst_mac, espnow::MsgType type);
+static esp_err_t transmitFrame(const uint8_t* dst_mac, const uint8_t* frame, size_t frame_len,
+                               const int8_t* slots, uint8_t slot_count);
+static bool registerReliable(const TxRequest& req, uint8_t msg_id);
+static uint8_t aggregationLimit(const uint8_t* mac);
+static uint8_t nextMsgId(const uint8_t* dst_mac);
+static PeerLink* findLink(const uint8_t* mac, bool create);
+static void flushTxBatch();
+static void dispatchMessage(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload,
+                            int64_t rx_us);
+static void handleAggregate(const uint8_t* src_mac, const uint8_t* payload, uint8_t len, int64_t rx_us);
+static void handleFragment(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload);
+static void maybeQueryCapabilities(const uint8_t* src_mac);
+static void learnCapabilities(const uint8_t* src_mac, const uint8_t* payload, uint8_t len);
+static int64_t serviceRetransmissions();
+static void handleReliableAck(const uint8_t* src_mac, const espnow::EspNowHeader& hdr);
+static bool isDuplicateFrame(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload);
+static void updateSession(PeerLink& link, const espnow::EspNowHeader& hdr,
+                          const uint8_t* payload, int64_t now_us, bool count_gaps);
+static void recordRxRssi(const uint8_t* src_mac, int8_t rssi);
 
 // ============================================================================
 // HELPER FUNCTIONS
 // ============================================================================
 
-static void tryAddEspNowPeer(const uint8_t mac[6])
+/// Caller holds s_driver_peer_mutex_
+static DriverPeer* findDriverPeer(const uint8_t mac[6])
+{
+    for (auto& entry : s_driver_peers_) {
+        if (entry.used && MacEquals(entry.mac, mac)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Make sure the driver knows a unicast peer, evicting the least recently
+ * used unencrypted one if the driver table is full. Registers unencrypted.
+ */
+static bool ensureDriverPeer(const uint8_t mac[6])
 {
-    if (IsZeroMac(mac)) return;
+    if (IsZeroMac(mac) || IsBroadcastMac(mac)) return false;
+
+    xSemaphoreTake(s_driver_peer_mutex_, portMAX_DELAY);
+    DriverPeer* entry = findDriverPeer(mac);
+    if (entry) {
+        entry->last_use = ++s_driver_peer_clock_;
+        xSemaphoreGive(s_driver_peer_mutex_);
+        return true;
+    }
+
+    DriverPeer* victim = nullptr;
+    for (auto& candidate : s_driver_peers_) {
+        if (!candidate.used) {
+            victim = &candidate;
+            break;
+        }
+        if (!candidate.encrypted && (!victim || candidate.last_use < victim->last_use)) {
+            victim = &candidate;
+        }
+    }
+    if (!victim) {
+        xSemaphoreGive(s_driver_peer_mutex_);
+        ESP_LOGW(TAG_, "Driver peer table full of encrypted peers");
+        return false;
+    }
+    if (victim->used) {
+        ESP_LOGD(TAG_, "Evicting driver peer %02X:%02X:%02X:%02X:%02X:%02X",
+                 victim->mac[0], victim->mac[1], victim->mac[2], victim->mac[3], victim->mac[4], victim->mac[5]);
+        esp_now_del_peer(victim->mac);
+        victim->used = false;
+    }
 
     esp_now_peer_info_t peer{};
     std::memcpy(peer.peer_addr, mac, 6);
-    peer.channel = espnow::WIFI_CHANNEL_;
+    peer.channel = 0;   // Current channel, so a channel switch needs no re-registration
     peer.ifidx = WIFI_IF_STA;
     peer.encrypt = false;
     esp_err_t err = esp_now_add_peer(&peer);
     if (err != ESP_OK && err != ESP_ERR_ESPNOW_EXIST) {
+        xSemaphoreGive(s_driver_peer_mutex_);
         ESP_LOGW(TAG_, "Failed to add peer: %s", esp_err_to_name(err));
+        return false;
+    }
+    victim->used = true;
+    victim->encrypted = false;
+    std::memcpy(victim->mac, mac, 6);
+    victim->last_use = ++s_driver_peer_clock_;
+    victim->generation = s_driver_peer_clock_;
+    xSemaphoreGive(s_driver_peer_mutex_);
+    return true;
+}
+
+/**
+ * @brief Switch a registered peer to hardware encryption with lmk, or back to plain (nullptr).
+ * @return false if the driver refused, or every encrypted slot is taken
+ */
+static bool setPeerLinkKey(const uint8_t mac[6], const uint8_t* lmk)
+{
+    if (lmk && !ensureDriverPeer(mac)) {
+        return false;
+    }
+    xSemaphoreTake(s_driver_peer_mutex_, portMAX_DELAY);
+    DriverPeer* entry = findDriverPeer(mac);
+    esp_now_peer_info_t peer{};
+    if (!entry || esp_now_get_peer(mac, &peer) != ESP_OK) {
+        xSemaphoreGive(s_driver_peer_mutex_);
+        return false;
+    }
+    bool was_encrypted = peer.encrypt;
+    if (lmk && !was_encrypted && s_encrypted_peers_ >= MAX_ENCRYPTED_PEERS) {
+        xSemaphoreGive(s_driver_peer_mutex_);
+        ESP_LOGW(TAG_, "No encrypted peer slot left");
+        return false;
+    }
+
+    peer.channel = 0;
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = (lmk != nullptr);
+    if (lmk) {
+        std::memcpy(peer.lmk, lmk, LINK_KEY_SIZE);
+    } else {
+        std::memset(peer.lmk, 0, sizeof(peer.lmk));
+    }
+    esp_err_t err = esp_now_mod_peer(&peer);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_driver_peer_mutex_);
+        ESP_LOGW(TAG_, "Failed to update peer encryption: %s", esp_err_to_name(err));
+        return false;
+    }
+    if (was_encrypted) s_encrypted_peers_--;
+    if (lmk) s_encrypted_peers_++;
+    entry->encrypted = (lmk != nullptr);
+    xSemaphoreGive(s_driver_peer_mutex_);
+    return true;
+}
+
+/// Register a stored peer that paired with a link key. Peers without one are
+/// registered when something is first sent to them.
+static void restoreEspNowPeer(const uint8_t mac[6])
+{
+    uint8_t lmk[LINK_KEY_SIZE];
+    if (PeerStore::GetLinkKey(mac, lmk)) {
+        setPeerLinkKey(mac, lmk);
     }
 }
 
@@ -84,7 +401,21 @@ static void tryAddEspNowPeer(const uint8_t mac[6])
 bool espnow::Init(QueueHandle_t event_queue) noexcept
 {
     s_proto_event_queue_ = event_queue;
-    s_raw_recv_queue_ = xQueueCreate(10, sizeof(RawMsg));
+    s_raw_recv_queue_ = xQueueCreate(RAW_RECV_QUEUE_DEPTH_, sizeof(RawMsg));
+    s_reliable_mutex_ = xSemaphoreCreateMutex();
+    s_driver_peer_mutex_ = xSemaphoreCreateMutex();
+    s_send_events_ = xEventGroupCreate();
+
+    if (!Crc16SelfTest()) {
+        ESP_LOGE(TAG_, "CRC16 engine %u is not bit-exact with the reference implementation",
+                 static_cast<unsigned>(CRC16_ENGINE_));
+        return false;
+    }
+
+    if (!HmacSelfTest()) {
+        ESP_LOGE(TAG_, "Cached HMAC key schedule does not match mbedtls HMAC");
+        return false;
+    }
 
     // Initialize peer storage with pre-configured MAC (backward compatibility)
     PeerStore::Init(s_security_, TEST_UNIT_MAC_, DeviceType::FatigueTester, "Pre-configured");
@@ -127,12 +458,19 @@ bool espnow::Init(QueueHandle_t event_queue) noexcept
         return false;
     }
 
-    err = esp_wifi_set_channel(WIFI_CHANNEL_, WIFI_SECOND_CHAN_NONE);
+    err = esp_wifi_set_channel(s_channel_, WIFI_SECOND_CHAN_NONE);
     if (err != ESP_OK) {
         ESP_LOGE(TAG_, "esp_wifi_set_channel failed: %s", esp_err_to_name(err));
         return false;
     }
 
+    // LR alongside b/g/n: RateControl may move weak peers to long-range rates
+    err = esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G |
+                                             WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG_, "esp_wifi_set_protocol failed: %s", esp_err_to_name(err));
+    }
+
     // Get and print our MAC address
     uint8_t mac_addr[6];
     esp_wifi_get_mac(WIFI_IF_STA, mac_addr);
@@ -148,6 +486,14 @@ bool espnow::Init(QueueHandle_t event_queue) noexcept
         return false;
     }
 
+    // PMK wraps the per-peer LMKs; every device of a deployment derives the same one
+    uint8_t pmk[LINK_KEY_SIZE];
+    DerivePrimaryKey(pmk);
+    err = esp_now_set_pmk(pmk);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG_, "esp_now_set_pmk failed: %s", esp_err_to_name(err));
+    }
+
     err = esp_now_register_recv_cb(espnowRecvCb);
     if (err != ESP_OK) {
         ESP_LOGE(TAG_, "esp_now_register_recv_cb failed: %s", esp_err_to_name(err));
@@ -163,32 +509,36 @@ bool espnow::Init(QueueHandle_t event_queue) noexcept
     // Add broadcast peer for pairing discovery
     esp_now_peer_info_t broadcast_peer{};
     std::memcpy(broadcast_peer.peer_addr, BROADCAST_MAC, 6);
-    broadcast_peer.channel = WIFI_CHANNEL_;
+    broadcast_peer.channel = 0;
     broadcast_peer.ifidx = WIFI_IF_STA;
     broadcast_peer.encrypt = false;
     esp_now_add_peer(&broadcast_peer);  // OK if already exists
 
     // Add pre-configured peer (backward compatibility)
     if (!IsZeroMac(TEST_UNIT_MAC_)) {
-        tryAddEspNowPeer(TEST_UNIT_MAC_);
+        ensureDriverPeer(TEST_UNIT_MAC_);   // Never paired, so never encrypted
         ESP_LOGI(TAG_, "Pre-configured test unit: %02X:%02X:%02X:%02X:%02X:%02X",
                  TEST_UNIT_MAC_[0], TEST_UNIT_MAC_[1], TEST_UNIT_MAC_[2],
                  TEST_UNIT_MAC_[3], TEST_UNIT_MAC_[4], TEST_UNIT_MAC_[5]);
     }
 
-    // Add any previously paired peers
+    // Previously paired peers: those with a link key are registered now, the rest on first send
     for (size_t i = 0; i < MAX_APPROVED_PEERS; ++i) {
         const auto& peer = s_security_.approved_peers[i];
         if (peer.valid && !IsZeroMac(peer.mac)) {
-            tryAddEspNowPeer(peer.mac);
+            restoreEspNowPeer(peer.mac);
             ESP_LOGI(TAG_, "Restored paired peer: %02X:%02X:%02X:%02X:%02X:%02X (%s)",
                      peer.mac[0], peer.mac[1], peer.mac[2],
                      peer.mac[3], peer.mac[4], peer.mac[5], peer.name);
         }
     }
 
-    // Launch receive task
+    // Launch receive and transmit tasks
+    for (uint8_t i = 0; i < TX_PRIORITY_COUNT_; ++i) {
+        s_tx_queues_[i] = xQueueCreate(TX_QUEUE_DEPTH_[i], sizeof(TxRequest));
+    }
     xTaskCreate(recvTask, "espnow_recv", 4096, nullptr, 5, nullptr);
+    xTaskCreate(txTask, "espnow_tx", 4096, nullptr, 6, &s_tx_task_);
 
     ESP_LOGI(TAG_, "ESP-NOW initialized (protocol v%u)", PROTOCOL_VERSION_);
     ESP_LOGI(TAG_, "Approved peers: %zu", PeerStore::GetPeerCount(s_security_));
@@ -200,129 +550,1568 @@ bool espnow::Init(QueueHandle_t event_queue) noexcept
 // PACKET SEND HELPERS
 // ============================================================================
 
-static bool sendPacketTo(const uint8_t* dst_mac, uint8_t device_id,
-                         espnow::MsgType type, const void* payload, uint8_t payload_len)
+/// Build a complete frame (header + payload + CRC) into buf. Returns the frame length.
+static size_t buildFrame(uint8_t* buf, uint8_t device_id, espnow::MsgType type,
+                         uint8_t msg_id, const void* payload, uint8_t payload_len)
 {
-    if (payload_len > espnow::MAX_PAYLOAD_SIZE_) {
-        ESP_LOGE(TAG_, "Payload too big: %d", payload_len);
-        return false;
-    }
-
-    // Build packet in linear buffer
-    uint8_t send_buf[sizeof(espnow::EspNowHeader) + espnow::MAX_PAYLOAD_SIZE_ + sizeof(uint16_t)];
-    
-    espnow::EspNowHeader* hdr = reinterpret_cast<espnow::EspNowHeader*>(send_buf);
+    espnow::EspNowHeader* hdr = reinterpret_cast<espnow::EspNowHeader*>(buf);
     hdr->sync = espnow::SYNC_BYTE_;
     hdr->version = espnow::PROTOCOL_VERSION_;
     hdr->device_id = device_id;
     hdr->type = static_cast<uint8_t>(type);
-    hdr->id = s_next_msg_id_++;
+    hdr->id = msg_id;
     hdr->len = payload_len;
 
     if (payload_len > 0 && payload != nullptr) {
-        std::memcpy(send_buf + sizeof(espnow::EspNowHeader), payload, payload_len);
+        std::memcpy(buf + sizeof(espnow::EspNowHeader), payload, payload_len);
     }
 
     size_t crc_data_len = sizeof(espnow::EspNowHeader) + payload_len;
-    uint16_t crc = espnow::crc16_ccitt(send_buf, crc_data_len);
-    std::memcpy(send_buf + crc_data_len, &crc, sizeof(uint16_t));
+    uint16_t crc = espnow::crc16_ccitt(buf, crc_data_len);
+    std::memcpy(buf + crc_data_len, &crc, sizeof(uint16_t));
 
-    size_t total_len = crc_data_len + sizeof(uint16_t);
-    esp_err_t err = esp_now_send(dst_mac, send_buf, total_len);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG_, "esp_now_send error: %s", esp_err_to_name(err));
+    return crc_data_len + sizeof(uint16_t);
+}
+
+/**
+ * @brief Queue a message for the TX task.
+ *
+ * Never blocks: returns false if the queue for this priority is full. The send
+ * slot is reserved here so the caller gets its handle immediately and the
+ * latency histogram covers queueing time as well as driver time.
+ */
+static bool sendPacketTo(const uint8_t* dst_mac, uint8_t device_id,
+                         espnow::MsgType type, const void* payload, uint8_t payload_len,
+                         espnow::TxPriority priority, bool reliable,
+                         espnow::SendHandle* handle_out, int echo_id)
+{
+    if (payload_len > espnow::MAX_PAYLOAD_SIZE_) {
+        ESP_LOGE(TAG_, "Payload too big: %d", payload_len);
+        return false;
+    }
+
+    TxRequest req{};
+    std::memcpy(req.dst_mac, dst_mac, 6);
+    req.device_id = device_id;
+    req.type = type;
+    req.priority = priority;
+    req.reliable = reliable;
+    req.echo_id = static_cast<int16_t>(echo_id);
+    req.payload_len = payload_len;
+    if (payload_len > 0 && payload != nullptr) {
+        std::memcpy(req.payload, payload, payload_len);
+    }
+    req.send_slot = static_cast<int8_t>(reserveSendSlot(dst_mac, type));
+    espnow::SendHandle handle = (req.send_slot >= 0) ? s_send_slots_[req.send_slot].completion.handle
+                                                     : espnow::INVALID_SEND_HANDLE_;
+
+    QueueHandle_t queue = s_tx_queues_[static_cast<uint8_t>(priority)];
+    if (queue == nullptr || xQueueSend(queue, &req, 0) != pdTRUE) {
+        ESP_LOGW(TAG_, "TX queue %u full, dropping type=%u",
+                 static_cast<unsigned>(priority), static_cast<unsigned>(type));
+        if (req.send_slot >= 0) {
+            taskENTER_CRITICAL(&s_send_mux_);
+            s_send_slots_[req.send_slot].completion.status = espnow::SendStatus::Failed;
+            taskEXIT_CRITICAL(&s_send_mux_);
+        }
         return false;
     }
 
-    ESP_LOGD(TAG_, "TX: type=%u, id=%u, len=%u", static_cast<unsigned>(type), hdr->id, payload_len);
+    if (handle_out) {
+        *handle_out = handle;
+    }
+    xTaskNotifyGive(s_tx_task_);
     return true;
 }
 
-static bool sendPacketToTarget(uint8_t device_id, espnow::MsgType type, 
-                               const void* payload, uint8_t payload_len)
+/// Dequeue the next request, highest priority first. TX task only.
+static bool dequeueTxRequest(TxRequest& req)
 {
-    uint8_t target_mac[6];
-    if (!espnow::GetTargetDeviceMac(target_mac)) {
-        ESP_LOGW(TAG_, "No target device configured");
-        return false;
+    for (auto queue : s_tx_queues_) {
+        if (queue && xQueueReceive(queue, &req, 0) == pdTRUE) {
+            return true;
+        }
     }
-    return sendPacketTo(target_mac, device_id, type, payload, payload_len);
+    return false;
 }
 
-// ============================================================================
-// PUBLIC SEND FUNCTIONS
-// ============================================================================
+/// Frames whose send time is measured; held in a batch they would read late
+static bool isTimingFrame(espnow::MsgType type)
+{
+    return type == espnow::MsgType::ChannelProbe || type == espnow::MsgType::ChannelProbeAck ||
+           type == espnow::MsgType::TimeSync || type == espnow::MsgType::TimeSyncReply;
+}
 
-bool espnow::SendDeviceDiscovery() noexcept
+/// Take a time sync send time (t1, or t3 in a reply) here, so TX queueing is not part of it. TX task only.
+static void stampTimeSync(TxRequest& req)
 {
-    return sendPacketTo(BROADCAST_MAC, 0, MsgType::DeviceDiscovery, nullptr, 0);
+    size_t offset = 0;
+    if (req.type == espnow::MsgType::TimeSync) {
+        offset = offsetof(espnow::TimeSyncPayload, t1_us);
+    } else if (req.type == espnow::MsgType::TimeSyncReply) {
+        offset = offsetof(espnow::TimeSyncPayload, t3_us);
+    } else {
+        return;
+    }
+    if (req.payload_len >= sizeof(espnow::TimeSyncPayload)) {
+        int64_t now_us = esp_timer_get_time();
+        std::memcpy(req.payload + offset, &now_us, sizeof(now_us));
+    }
 }
 
-bool espnow::SendConfigRequest(uint8_t device_id) noexcept
+/**
+ * @brief Assign the header id and either send the message or add it to the
+ *        pending aggregate batch. TX task only.
+ */
+static void transmitRequest(TxRequest& req)
+{
+    stampTimeSync(req);
+    uint8_t msg_id = (req.echo_id >= 0) ? static_cast<uint8_t>(req.echo_id) : nextMsgId(req.dst_mac);
+    if (req.send_slot >= 0) {
+        taskENTER_CRITICAL(&s_send_mux_);
+        s_send_slots_[req.send_slot].completion.msg_id = msg_id;
+        taskEXIT_CRITICAL(&s_send_mux_);
+    }
+    if (req.reliable && !registerReliable(req, msg_id)) {
+        ESP_LOGW(TAG_, "Reliable table full, sending type=%u best-effort", static_cast<unsigned>(req.type));
+    }
+
+    // A batch only ever holds one peer's traffic; anything else flushes it first.
+    if (s_tx_batch_.active && !MacEquals(s_tx_batch_.dst_mac, req.dst_mac)) {
+        flushTxBatch();
+    }
+
+    size_t sub_len = sizeof(espnow::AggregateSubHeader) + req.payload_len;
+    uint8_t batch_limit = aggregationLimit(req.dst_mac);
+    if (sub_len <= batch_limit) {
+        if (s_tx_batch_.active && s_tx_batch_.len + sub_len > batch_limit) {
+            flushTxBatch();
+        }
+        if (!s_tx_batch_.active) {
+            s_tx_batch_.active = true;
+            std::memcpy(s_tx_batch_.dst_mac, req.dst_mac, 6);
+            s_tx_batch_.len = 0;
+            s_tx_batch_.count = 0;
+            s_tx_batch_.slot_count = 0;
+            s_tx_batch_.deadline_us = esp_timer_get_time() + s_aggregation_flush_us_;
+        }
+
+        espnow::AggregateSubHeader sub{};
+        sub.type = static_cast<uint8_t>(req.type);
+        sub.device_id = req.device_id;
+        sub.id = msg_id;
+        sub.len = req.payload_len;
+        std::memcpy(s_tx_batch_.buf + s_tx_batch_.len, &sub, sizeof(sub));
+        std::memcpy(s_tx_batch_.buf + s_tx_batch_.len + sizeof(sub), req.payload, req.payload_len);
+        s_tx_batch_.len = static_cast<uint8_t>(s_tx_batch_.len + sub_len);
+        s_tx_batch_.count++;
+        if (req.send_slot >= 0) {
+            s_tx_batch_.slots[s_tx_batch_.slot_count++] = req.send_slot;
+        }
+
+        if (req.priority == espnow::TxPriority::Safety || isTimingFrame(req.type)) {
+            flushTxBatch();
+        }
+        return;
+    }
+
+    uint8_t frame[sizeof(espnow::EspNowHeader) + espnow::MAX_PAYLOAD_SIZE_ + sizeof(uint16_t)];
+    size_t frame_len = buildFrame(frame, req.device_id, req.type, msg_id, req.payload, req.payload_len);
+
+    uint8_t slot_count = (req.send_slot >= 0) ? 1 : 0;
+    esp_err_t err = transmitFrame(req.dst_mac, frame, frame_len, &req.send_slot, slot_count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_, "esp_now_send error: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGD(TAG_, "TX: type=%u, id=%u, len=%u", static_cast<unsigned>(req.type), msg_id, req.payload_len);
+}
+
+/**
+ * @brief Send the pending batch. TX task only.
+ *
+ * A batch holding a single message goes out as a plain v1 frame.
+ */
+static void flushTxBatch()
 {
-    return sendPacketToTarget(device_id, MsgType::ConfigRequest, nullptr, 0);
+    if (!s_tx_batch_.active) {
+        return;
+    }
+    s_tx_batch_.active = false;
+
+    uint8_t frame[sizeof(espnow::EspNowHeader) + espnow::MAX_PAYLOAD_SIZE_ + sizeof(uint16_t)];
+    size_t frame_len = 0;
+
+    if (s_tx_batch_.count == 1) {
+        espnow::AggregateSubHeader sub{};
+        std::memcpy(&sub, s_tx_batch_.buf, sizeof(sub));
+        frame_len = buildFrame(frame, sub.device_id, static_cast<espnow::MsgType>(sub.type), sub.id,
+                               s_tx_batch_.buf + sizeof(sub), sub.len);
+    } else {
+        // The wrapper reuses the first sub-message's id so the peer sees consecutive ids
+        espnow::AggregateSubHeader first{};
+        std::memcpy(&first, s_tx_batch_.buf, sizeof(first));
+        frame_len = buildFrame(frame, 0, espnow::MsgType::Aggregate, first.id,
+                               s_tx_batch_.buf, s_tx_batch_.len);
+        s_aggregation_stats_.frames_sent++;
+        s_aggregation_stats_.messages_aggregated += s_tx_batch_.count;
+    }
+
+    esp_err_t err = transmitFrame(s_tx_batch_.dst_mac, frame, frame_len,
+                                  s_tx_batch_.slots, s_tx_batch_.slot_count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_, "esp_now_send error: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGD(TAG_, "TX batch: %u messages, %u bytes", s_tx_batch_.count, s_tx_batch_.len);
 }
 
-bool espnow::SendConfigSet(uint8_t device_id, const void* config_data, size_t config_len) noexcept
+/// Ticks to block until deadline_us (at least one if it is still ahead)
+static TickType_t ticksUntil(int64_t deadline_us)
 {
-    if (config_len > MAX_PAYLOAD_SIZE_) {
-        ESP_LOGE(TAG_, "Config data too large: %zu", config_len);
-        return false;
+    int64_t remaining_us = deadline_us - esp_timer_get_time();
+    if (remaining_us <= 0) {
+        return 0;
     }
-    return sendPacketToTarget(device_id, MsgType::ConfigSet, config_data, 
-                              static_cast<uint8_t>(config_len));
+    TickType_t ticks = pdMS_TO_TICKS(static_cast<uint32_t>((remaining_us + 999) / 1000));
+    return ticks ? ticks : 1;   // sub-tick deadline: wake on the next tick
 }
 
-bool espnow::SendCommand(uint8_t device_id, uint8_t command_id, 
-                         const void* payload, size_t payload_len) noexcept
+/**
+ * @brief Single owner of esp_now_send and of header id assignment.
+ *
+ * Messages for one peer that are queued together share an Aggregate frame,
+ * which goes out once the queues are empty (or at the flush deadline when
+ * one is set). Wakes on producer notification, at that deadline, or when the
+ * next reliable message is due for retransmission. With nothing batched or
+ * outstanding it blocks until a producer notifies it. After each message
+ * the queues are re-checked from the top, so a Safety message never waits
+ * behind more than one lower-priority message.
+ */
+static void txTask(void* arg)
 {
-    uint8_t cmd_buf[espnow::MAX_PAYLOAD_SIZE_];
-    cmd_buf[0] = command_id;
-    
-    size_t total_payload = 1;
-    if (payload != nullptr && payload_len > 0) {
-        if (1 + payload_len > MAX_PAYLOAD_SIZE_) {
-            ESP_LOGE(TAG_, "Command payload too large: %zu", payload_len);
+    (void)arg;
+    TxRequest req{};
+    int64_t next_retransmit_us = INT64_MAX;
+
+    while (true) {
+        int64_t wake_us = next_retransmit_us;
+        if (s_tx_batch_.active && s_tx_batch_.deadline_us < wake_us) {
+            wake_us = s_tx_batch_.deadline_us;
+        }
+        TickType_t wait = (wake_us == INT64_MAX) ? portMAX_DELAY : ticksUntil(wake_us);
+
+        ulTaskNotifyTake(pdTRUE, wait);
+        while (dequeueTxRequest(req)) {
+            transmitRequest(req);
+        }
+        // The queues are empty: a lone message has nothing to wait for
+        if (s_tx_batch_.active &&
+            (s_tx_batch_.count == 1 || esp_timer_get_time() >= s_tx_batch_.deadline_us)) {
+            flushTxBatch();
+        }
+        next_retransmit_us = serviceRetransmissions();
+    }
+}
+
+/// Send to dst_mac, or to the current target if dst_mac is nullptr.
+static bool sendPacketToPeer(const uint8_t* dst_mac, uint8_t device_id, espnow::MsgType type,
+                             const void* payload, uint8_t payload_len,
+                             espnow::TxPriority priority, bool reliable = false,
+                             espnow::SendHandle* handle_out = nullptr)
+{
+    uint8_t target_mac[6];
+    if (dst_mac == nullptr) {
+        if (!espnow::GetTargetDeviceMac(target_mac)) {
+            ESP_LOGW(TAG_, "No target device configured");
             return false;
         }
-        std::memcpy(cmd_buf + 1, payload, payload_len);
-        total_payload = 1 + payload_len;
+        dst_mac = target_mac;
     }
-    
-    return sendPacketToTarget(device_id, MsgType::Command, cmd_buf, 
-                              static_cast<uint8_t>(total_payload));
+    return sendPacketTo(dst_mac, device_id, type, payload, payload_len, priority, reliable, handle_out);
 }
 
 // ============================================================================
-// PAIRING FUNCTIONS
+// SEND COMPLETION
+// ============================================================================
+//
+// Every frame handed to esp_now_send gets a slot. The driver reports send
+// results in submission order, so espnowSendCb completes the oldest pending
+// slot for the destination MAC. Completed slots stay readable until reused
+// (round-robin); a reused slot bumps its generation so stale handles read as
+// Expired instead of returning another frame's result.
 // ============================================================================
 
-bool espnow::StartPairing() noexcept
+static espnow::SendHandle makeSendHandle(uint8_t slot, uint16_t generation)
 {
-    if (s_pairing_state_ != PairingState::Idle) {
-        ESP_LOGW(TAG_, "Pairing already in progress");
-        return false;
+    return static_cast<espnow::SendHandle>((generation << 4) | slot);
+}
+
+/// Resolve a handle to its slot, or nullptr if invalid/reused. Caller holds s_send_mux_.
+static SendSlot* lookupSendSlot(espnow::SendHandle handle)
+{
+    if (handle == espnow::INVALID_SEND_HANDLE_) {
+        return nullptr;
     }
+    uint8_t index = handle & 0x0F;
+    if (index >= espnow::SEND_SLOTS_ || s_send_slots_[index].generation != (handle >> 4)) {
+        return nullptr;
+    }
+    return &s_send_slots_[index];
+}
 
-    // Generate random challenge
-    GenerateChallenge(s_my_challenge_);
+/// Find TX stats for a MAC, optionally claiming a free entry. Caller holds s_send_mux_.
+static TxLink* findTxLink(const uint8_t* mac, bool create)
+{
+    TxLink* free_slot = nullptr;
+    for (auto& link : s_tx_links_) {
+        if (link.in_use && MacEquals(link.mac, mac)) {
+            return &link;
+        }
+        if (!link.in_use && free_slot == nullptr) {
+            free_slot = &link;
+        }
+    }
+    if (!create || free_slot == nullptr) {
+        return nullptr;
+    }
+    *free_slot = TxLink{};
+    free_slot->in_use = true;
+    std::memcpy(free_slot->mac, mac, 6);
+    return free_slot;
+}
 
-    // Build pairing request
-    PairingRequestPayload req{};
-    esp_wifi_get_mac(WIFI_IF_STA, req.requester_mac);
-    req.device_type = static_cast<uint8_t>(DeviceType::RemoteController);
-    req.expected_peer_type = static_cast<uint8_t>(DeviceType::FatigueTester);
-    std::memcpy(req.challenge, s_my_challenge_, CHALLENGE_SIZE);
-    req.protocol_version = PROTOCOL_VERSION_;
+/// Mark a slot complete and record its latency. Caller holds s_send_mux_.
+static void completeSendSlotLocked(uint8_t index, espnow::SendStatus status, int64_t now_us)
+{
+    espnow::SendCompletion& c = s_send_slots_[index].completion;
+    c.status = status;
+    c.complete_us = now_us;
+
+    TxLink* link = findTxLink(c.dst_mac, true);
+    if (link) {
+        link->stats.latency.Add(static_cast<uint32_t>(now_us - c.enqueue_us));
+        if (status == espnow::SendStatus::Success) {
+            link->stats.send_ok++;
+        } else {
+            link->stats.send_fail++;
+        }
+    }
+}
 
-    // Send broadcast
-    if (!sendPacketTo(BROADCAST_MAC, 0, MsgType::PairingRequest, &req, sizeof(req))) {
-        ESP_LOGE(TAG_, "Failed to send pairing request");
+static void notifySendComplete(uint8_t index, const espnow::SendCompletion& completion)
+{
+    if (s_send_events_) {
+        xEventGroupSetBits(s_send_events_, 1u << index);
+    }
+    if (s_send_complete_cb_) {
+        s_send_complete_cb_(completion);
+    }
+}
+
+/**
+ * @brief Reserve a send slot for a frame that is about to be queued.
+ * @return Slot index, or -1 if every slot is still pending (frame goes untracked)
+ */
+static int reserveSendSlot(const uint8_t* dst_mac, espnow::MsgType type)
+{
+    int slot = -1;
+
+    taskENTER_CRITICAL(&s_send_mux_);
+    for (uint8_t n = 0; n < espnow::SEND_SLOTS_; ++n) {
+        uint8_t index = static_cast<uint8_t>((s_send_slot_cursor_ + n) % espnow::SEND_SLOTS_);
+        SendSlot& candidate = s_send_slots_[index];
+        if (candidate.generation != 0 && candidate.completion.status == espnow::SendStatus::Pending) {
+            continue;
+        }
+        candidate.generation = static_cast<uint16_t>((candidate.generation % 0x0FFF) + 1);
+        candidate.submitted = false;
+        candidate.completion = espnow::SendCompletion{};
+        candidate.completion.handle = makeSendHandle(index, candidate.generation);
+        std::memcpy(candidate.completion.dst_mac, dst_mac, 6);
+        candidate.completion.type = type;
+        candidate.completion.status = espnow::SendStatus::Pending;
+        candidate.completion.enqueue_us = esp_timer_get_time();
+        slot = index;
+        s_send_slot_cursor_ = static_cast<uint8_t>((index + 1) % espnow::SEND_SLOTS_);
+        break;
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+
+    if (slot >= 0 && s_send_events_) {
+        xEventGroupClearBits(s_send_events_, 1u << slot);
+    }
+    return slot;
+}
+
+/**
+ * @brief Hand a built frame to the driver. TX task only.
+ *
+ * All listed send slots (one per message carried in the frame) complete
+ * together in the send callback. Untracked frames, such as retransmissions,
+ * try to reserve a slot now so they are measured too. On a driver error the
+ * slots are completed as Failed.
+ */
+static esp_err_t transmitFrame(const uint8_t* dst_mac, const uint8_t* frame, size_t frame_len,
+                               const int8_t* slots, uint8_t slot_count)
+{
+    int8_t own_slot = -1;
+    if (slot_count == 0) {
+        const auto* hdr = reinterpret_cast<const espnow::EspNowHeader*>(frame);
+        own_slot = static_cast<int8_t>(reserveSendSlot(dst_mac, static_cast<espnow::MsgType>(hdr->type)));
+        if (own_slot >= 0) {
+            s_send_slots_[own_slot].completion.msg_id = hdr->id;
+            slots = &own_slot;
+            slot_count = 1;
+        }
+    }
+
+    // The driver holds fewer peers than may be approved: register on demand
+    if (!IsBroadcastMac(dst_mac)) {
+        ensureDriverPeer(dst_mac);
+    }
+
+    // Mark submitted before sending: the send callback may fire before esp_now_send returns.
+    taskENTER_CRITICAL(&s_send_mux_);
+    uint32_t tx_order = s_send_tx_order_++;
+    for (uint8_t i = 0; i < slot_count; ++i) {
+        s_send_slots_[slots[i]].submitted = true;
+        s_send_slots_[slots[i]].tx_order = tx_order;
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+
+    esp_err_t err = esp_now_send(dst_mac, frame, frame_len);
+
+    if (err != ESP_OK) {
+        for (uint8_t i = 0; i < slot_count; ++i) {
+            espnow::SendCompletion completion{};
+            taskENTER_CRITICAL(&s_send_mux_);
+            completeSendSlotLocked(static_cast<uint8_t>(slots[i]), espnow::SendStatus::Failed,
+                                   esp_timer_get_time());
+            completion = s_send_slots_[slots[i]].completion;
+            taskEXIT_CRITICAL(&s_send_mux_);
+            notifySendComplete(static_cast<uint8_t>(slots[i]), completion);
+        }
+    }
+    return err;
+}
+
+espnow::SendStatus espnow::GetSendStatus(SendHandle handle) noexcept
+{
+    SendStatus status = SendStatus::Expired;
+    taskENTER_CRITICAL(&s_send_mux_);
+    SendSlot* slot = lookupSendSlot(handle);
+    if (slot) {
+        status = slot->completion.status;
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+    return status;
+}
+
+espnow::SendStatus espnow::WaitSendComplete(SendHandle handle, uint32_t timeout_ms,
+                                            SendCompletion* out) noexcept
+{
+    if (handle == INVALID_SEND_HANDLE_ || (handle & 0x0F) >= SEND_SLOTS_) {
+        return SendStatus::Expired;
+    }
+    uint8_t index = handle & 0x0F;
+
+    SendStatus status = GetSendStatus(handle);
+    if (status == SendStatus::Pending) {
+        xEventGroupWaitBits(s_send_events_, 1u << index, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    }
+
+    taskENTER_CRITICAL(&s_send_mux_);
+    SendSlot* slot = lookupSendSlot(handle);
+    if (slot == nullptr) {
+        status = SendStatus::Expired;
+    } else if (slot->completion.status == SendStatus::Pending) {
+        status = SendStatus::Timeout;
+    } else {
+        status = slot->completion.status;
+        if (out) {
+            *out = slot->completion;
+        }
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+    return status;
+}
+
+void espnow::SetSendCompleteCallback(SendCompleteCallback callback) noexcept
+{
+    s_send_complete_cb_ = callback;
+}
+
+static void recordRxRssi(const uint8_t* src_mac, int8_t rssi)
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(src_mac, true);
+    if (link) {
+        if (link->rssi_samples == 0) {
+            link->rssi_avg_x16 = static_cast<int16_t>(rssi * 16);
+            link->rssi_min = rssi;
+        } else {
+            link->rssi_avg_x16 = static_cast<int16_t>(link->rssi_avg_x16 + (rssi * 16 - link->rssi_avg_x16) / 8);
+            if (rssi < link->rssi_min) link->rssi_min = rssi;
+        }
+        link->rssi_last = rssi;
+        link->rssi_samples++;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+}
+
+bool espnow::GetLinkStats(const uint8_t mac[6], LinkStats& out) noexcept
+{
+    if (PeerStore::GetPeerSlot(s_security_, mac) < 0) {
+        return false;
+    }
+    out = LinkStats{};
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(mac, false);
+    if (link) {
+        out.rssi_last = link->rssi_last;
+        out.rssi_avg = static_cast<int8_t>(link->rssi_avg_x16 / 16);
+        out.rssi_min = link->rssi_min;
+        out.rssi_samples = link->rssi_samples;
+        out.rx_messages = link->rx_messages;
+        out.rx_gaps = link->rx_gaps;
+        out.rx_lost = link->rx_lost;
+        out.rx_duplicates = link->rx_duplicates;
+        out.srtt_us = link->rtt_valid ? link->srtt_us : 0;
+        out.rtt = link->rtt;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+
+    taskENTER_CRITICAL(&s_send_mux_);
+    TxLink* tx = findTxLink(mac, false);
+    if (tx) {
+        out.tx_frames = tx->stats.send_ok + tx->stats.send_fail;
+        out.tx_failures = tx->stats.send_fail;
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+    return true;
+}
+
+// ============================================================================
+// CHANNEL CONTROL
+// ============================================================================
+
+uint8_t espnow::GetChannel() noexcept
+{
+    return s_channel_;
+}
+
+bool espnow::SetChannel(uint8_t channel) noexcept
+{
+    esp_err_t err = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_, "esp_wifi_set_channel(%u) failed: %s", channel, esp_err_to_name(err));
+        return false;
+    }
+    s_channel_ = channel;
+    return true;
+}
+
+bool espnow::SendChannelSwitch(const uint8_t mac[6], uint8_t channel, uint16_t switch_delay_ms,
+                               uint16_t rollback_ms) noexcept
+{
+    ChannelSwitchPayload req{};
+    req.channel = channel;
+    req.switch_delay_ms = switch_delay_ms;
+    req.rollback_ms = rollback_ms;
+    return sendPacketTo(mac, 0, MsgType::ChannelSwitch, &req, sizeof(req), TxPriority::Control, true);
+}
+
+bool espnow::CommitChannelSwitch(const uint8_t mac[6], uint8_t channel, uint32_t timeout_ms) noexcept
+{
+    ChannelSwitchPayload req{};
+    req.channel = channel;
+    std::memcpy(s_commit_mac_, mac, 6);
+    xEventGroupClearBits(s_send_events_, SWITCH_ACK_BIT_);
+    s_commit_pending_ = true;
+
+    // Not reliable: the caller retries, possibly after moving the radio
+    int64_t deadline_us = esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+    SendHandle handle = INVALID_SEND_HANDLE_;
+    SendCompletion sent{};
+    if (!sendPacketTo(mac, 0, MsgType::ChannelSwitch, &req, sizeof(req), TxPriority::Control, false, &handle) ||
+        WaitSendComplete(handle, timeout_ms, &sent) != SendStatus::Success) {
+        s_commit_pending_ = false;
+        return false;
+    }
+
+    // Only the ack echoing this frame's id counts; a late ack of an earlier
+    // trial switch to the same peer does not
+    bool acked = false;
+    while (!acked) {
+        TickType_t wait = ticksUntil(deadline_us);
+        EventBits_t bits = xEventGroupWaitBits(s_send_events_, SWITCH_ACK_BIT_, pdTRUE, pdTRUE, wait);
+        if (!(bits & SWITCH_ACK_BIT_)) {
+            break;
+        }
+        acked = (s_commit_ack_id_ == sent.msg_id);
+    }
+    s_commit_pending_ = false;
+    return acked;
+}
+
+bool espnow::ProbePeer(const uint8_t mac[6], uint32_t timeout_ms, uint32_t& rtt_us) noexcept
+{
+    static uint32_t s_probe_seq = 0;
+
+    ChannelProbePayload probe{};
+    probe.token = ++s_probe_seq;
+    std::memcpy(s_probe_mac_, mac, 6);
+    s_probe_token_ = probe.token;
+    xEventGroupClearBits(s_send_events_, PROBE_ACK_BIT_);
+
+    int64_t sent_us = esp_timer_get_time();
+    if (!sendPacketTo(mac, 0, MsgType::ChannelProbe, &probe, sizeof(probe), TxPriority::Control)) {
+        s_probe_token_ = 0;
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_send_events_, PROBE_ACK_BIT_, pdTRUE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    s_probe_token_ = 0;
+    if (!(bits & PROBE_ACK_BIT_)) {
+        return false;
+    }
+    rtt_us = static_cast<uint32_t>(s_probe_rx_us_ - sent_us);
+    return true;
+}
+
+bool espnow::GetTxLinkStats(const uint8_t mac[6], TxLinkStats& out) noexcept
+{
+    bool found = false;
+    taskENTER_CRITICAL(&s_send_mux_);
+    TxLink* link = findTxLink(mac, false);
+    if (link) {
+        out = link->stats;
+        found = true;
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+    return found;
+}
+
+// ============================================================================
+// RELIABLE DELIVERY
+// ============================================================================
+//
+// Command, ConfigSet and ConfigFieldSet are tracked until the matching
+// CommandAck/ConfigAck/ConfigFieldAck arrives. Every retransmission reuses
+// the original frame (same header id) so the receiver can suppress duplicates. The retransmit timeout follows
+// RFC 6298: SRTT/RTTVAR per peer, RTT sampled only from first transmissions
+// (Karn), doubled on every timeout up to RELIABLE_MAX_RTO_MS_.
+//
+// Acks are matched by source MAC and ack type. Responders should echo the
+// request's header id in the ack; if no outstanding request carries that id
+// (older firmware with its own counter), the oldest outstanding request of
+// that type to that peer is completed.
+// ============================================================================
+
+static espnow::MsgType ackTypeFor(espnow::MsgType type)
+{
+    switch (type) {
+        case espnow::MsgType::Command:   return espnow::MsgType::CommandAck;
+        case espnow::MsgType::ConfigSet: return espnow::MsgType::ConfigAck;
+        case espnow::MsgType::ConfigFieldSet: return espnow::MsgType::ConfigFieldAck;
+        case espnow::MsgType::ChannelSwitch: return espnow::MsgType::ChannelSwitchAck;
+        case espnow::MsgType::Fragment:  return espnow::MsgType::FragmentAck;
+        default:                         return type;
+    }
+}
+
+/// Find the link of an approved peer, optionally (re)initialising it. Caller holds s_reliable_mutex_.
+static PeerLink* findLink(const uint8_t* mac, bool create)
+{
+    int slot = PeerStore::GetPeerSlot(s_security_, mac);
+    if (slot < 0) {
+        return nullptr;
+    }
+    PeerLink& link = s_links_[slot];
+    if (link.in_use && MacEquals(link.mac, mac)) {
+        return &link;
+    }
+    if (!create) {
+        return nullptr;
+    }
+    // Free slot, or one left behind by a removed peer
+    link = PeerLink{};
+    link.in_use = true;
+    std::memcpy(link.mac, mac, 6);
+    link.rto_us = espnow::RELIABLE_INITIAL_RTO_MS_ * 1000;
+    link.tx_next_id = 1;
+    return &link;
+}
+
+/// Next header id for a destination. TX task only.
+static uint8_t nextMsgId(const uint8_t* dst_mac)
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(dst_mac, true);
+    uint8_t id = link ? link->tx_next_id++ : s_next_msg_id_++;
+    xSemaphoreGive(s_reliable_mutex_);
+    return id;
+}
+
+static void updateRtt(PeerLink& link, uint32_t sample_us)
+{
+    if (!link.rtt_valid) {
+        link.srtt_us = sample_us;
+        link.rttvar_us = sample_us / 2;
+        link.rtt_valid = true;
+    } else {
+        uint32_t err = (link.srtt_us > sample_us) ? link.srtt_us - sample_us : sample_us - link.srtt_us;
+        link.rttvar_us = (3 * link.rttvar_us + err) / 4;
+        link.srtt_us = (7 * link.srtt_us + sample_us) / 8;
+    }
+
+    uint32_t rto = link.srtt_us + 4 * link.rttvar_us;
+    if (rto < espnow::RELIABLE_MIN_RTO_MS_ * 1000) rto = espnow::RELIABLE_MIN_RTO_MS_ * 1000;
+    if (rto > espnow::RELIABLE_MAX_RTO_MS_ * 1000) rto = espnow::RELIABLE_MAX_RTO_MS_ * 1000;
+    link.rto_us = rto;
+}
+
+static void reportDelivery(const OutstandingMsg& msg, bool delivered, int64_t now_us)
+{
+    espnow::DeliveryReport report{};
+    std::memcpy(report.dst_mac, msg.dst_mac, 6);
+    report.device_id = msg.device_id;
+    report.msg_id = msg.msg_id;
+    report.type = msg.type;
+    report.delivered = delivered;
+    report.attempts = msg.attempts;
+    report.latency_ms = static_cast<uint32_t>((now_us - msg.first_tx_us) / 1000);
+
+    if (msg.type == espnow::MsgType::Command) {
+        xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+        PeerLink* link = findLink(msg.dst_mac, false);
+        if (link) {
+            link->pending_command = 0;
+        }
+        xSemaphoreGive(s_reliable_mutex_);
+    }
+
+    if (s_delivery_cb_) {
+        s_delivery_cb_(report);
+    }
+
+    if (!delivered && s_proto_event_queue_) {
+        espnow::ProtoEvent evt{};
+        evt.type = espnow::MsgType::DeliveryFailed;
+        evt.device_id = msg.device_id;
+        evt.sequence_id = msg.msg_id;
+        std::memcpy(evt.src_mac, msg.dst_mac, 6);
+        std::memcpy(evt.payload, &report, sizeof(report));
+        evt.payload_len = sizeof(report);
+        xQueueSend(s_proto_event_queue_, &evt, 0);
+    }
+}
+
+/// Neither tracking a message nor held by a live reservation. Caller holds s_reliable_mutex_.
+static bool isFreeSlot(const OutstandingMsg& msg, int64_t now_us)
+{
+    return !msg.in_use && (!msg.reserved || now_us >= msg.reserved_until_us);
+}
+
+/**
+ * @brief Start tracking a reliable message. TX task only.
+ *
+ * Keeps a standalone v1 frame for retransmissions, so a message first sent
+ * inside an Aggregate frame is retried on its own with the same id.
+ *
+ * @return false if the outstanding table is full (message goes best-effort)
+ */
+static bool registerReliable(const TxRequest& req, uint8_t msg_id)
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    int64_t now_us = esp_timer_get_time();
+
+    // A slot reserved for this message, otherwise one nobody holds
+    OutstandingMsg* slot = nullptr;
+    for (auto& msg : s_outstanding_) {
+        if (!msg.in_use && msg.reserved && msg.type == req.type && MacEquals(msg.dst_mac, req.dst_mac)) {
+            slot = &msg;
+            break;
+        }
+    }
+    for (size_t i = 0; i < espnow::RELIABLE_MAX_OUTSTANDING_ && slot == nullptr; ++i) {
+        if (isFreeSlot(s_outstanding_[i], now_us)) {
+            slot = &s_outstanding_[i];
+        }
+    }
+    if (slot == nullptr) {
+        s_reliability_stats_.untracked_sends++;
+        xSemaphoreGive(s_reliable_mutex_);
+        return false;
+    }
+
+    PeerLink* link = findLink(req.dst_mac, true);
+
+    *slot = OutstandingMsg{};
+    std::memcpy(slot->dst_mac, req.dst_mac, 6);
+    slot->device_id = req.device_id;
+    slot->msg_id = msg_id;
+    slot->type = req.type;
+    slot->ack_type = ackTypeFor(req.type);
+    slot->frame_len = static_cast<uint8_t>(buildFrame(slot->frame, req.device_id, req.type, msg_id,
+                                                      req.payload, req.payload_len));
+    slot->attempts = 1;
+    slot->first_tx_us = now_us;
+    slot->rto_us = link ? link->rto_us : espnow::RELIABLE_INITIAL_RTO_MS_ * 1000;
+    // The first transmission may sit in a batch for up to the flush deadline.
+    slot->next_tx_us = now_us + slot->rto_us + s_aggregation_flush_us_;
+    slot->in_use = true;
+    s_reliability_stats_.reliable_sent++;
+    xSemaphoreGive(s_reliable_mutex_);
+
+    ESP_LOGD(TAG_, "TX reliable: type=%u, id=%u, len=%u",
+             static_cast<unsigned>(req.type), msg_id, req.payload_len);
+    return true;
+}
+
+/// Largest Aggregate payload the peer accepts, 0 if it does not take aggregates.
+static uint8_t aggregationLimit(const uint8_t* mac)
+{
+    uint8_t limit = 0;
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(mac, false);
+    if (link && link->aggregation) {
+        limit = espnow::MAX_PAYLOAD_SIZE_;
+        if (link->caps.valid && link->caps.max_payload < limit) {
+            limit = link->caps.max_payload;
+        }
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return limit;
+}
+
+void espnow::SetAggregation(const uint8_t mac[6], bool enabled) noexcept
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(mac, true);
+    if (link) {
+        link->aggregation = enabled;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+}
+
+void espnow::SetAggregationFlushMs(uint32_t flush_ms) noexcept
+{
+    s_aggregation_flush_us_ = flush_ms * 1000;
+}
+
+espnow::AggregationStats espnow::GetAggregationStats() noexcept
+{
+    return s_aggregation_stats_;
+}
+
+// ============================================================================
+// CAPABILITY EXCHANGE
+// ============================================================================
+//
+// The first frame from an approved peer triggers a unicast DeviceDiscovery
+// carrying our capability block; the peer answers with DeviceInfo carrying its
+// own. The answer is cached in the peer's PeerLink and turns on the optional
+// encodings both sides support. Legacy peers answer with a name-only
+// DeviceInfo and are not asked again.
+// ============================================================================
+
+/// Message types the controller handles on receive
+static constexpr espnow::MsgType LOCAL_RX_TYPES_[] = {
+    espnow::MsgType::DeviceDiscovery, espnow::MsgType::DeviceInfo,
+    espnow::MsgType::ConfigResponse, espnow::MsgType::ConfigAck,
+    espnow::MsgType::CommandAck, espnow::MsgType::StatusUpdate,
+    espnow::MsgType::Error, espnow::MsgType::ErrorClear,
+    espnow::MsgType::TestComplete, espnow::MsgType::BoundsResult,
+    espnow::MsgType::SubscribeAck, espnow::MsgType::ConfigFieldAck,
+    espnow::MsgType::ConfigFieldReport, espnow::MsgType::PairingResponse,
+    espnow::MsgType::PairingReject, espnow::MsgType::Aggregate,
+    espnow::MsgType::ChannelSwitchAck, espnow::MsgType::ChannelProbe,
+    espnow::MsgType::ChannelProbeAck, espnow::MsgType::Fragment,
+    espnow::MsgType::FragmentAck, espnow::MsgType::BulkStart,
+    espnow::MsgType::BulkData, espnow::MsgType::BulkAck,
+    espnow::MsgType::TimeSync, espnow::MsgType::TimeSyncReply,
+    espnow::MsgType::StatusCompact,
+};
+
+static void fillLocalCapabilities(espnow::CapabilityPayload& caps)
+{
+    caps = {};
+    caps.magic = espnow::CAPABILITY_MAGIC_;
+    caps.device_type = static_cast<uint8_t>(DeviceType::RemoteController);
+    caps.proto_min = espnow::PROTOCOL_VERSION_MIN_;
+    caps.proto_max = espnow::PROTOCOL_VERSION_;
+    caps.max_payload = espnow::MAX_PAYLOAD_SIZE_;
+    caps.features = espnow::LOCAL_CAPABILITIES_;
+    for (auto type : LOCAL_RX_TYPES_) {
+        uint8_t t = static_cast<uint8_t>(type);
+        caps.msg_types[t / 8] |= static_cast<uint8_t>(1u << (t % 8));
+    }
+}
+
+bool espnow::ParseCapabilities(const uint8_t* payload, size_t len, PeerCapabilities& out) noexcept
+{
+    out = {};
+    if (payload == nullptr || len < sizeof(CapabilityPayload) || payload[0] != CAPABILITY_MAGIC_) {
+        return false;
+    }
+    CapabilityPayload caps{};
+    std::memcpy(&caps, payload, sizeof(caps));
+
+    out.valid = true;
+    out.device_type = caps.device_type;
+    out.proto_min = caps.proto_min;
+    out.proto_max = caps.proto_max;
+    out.max_payload = caps.max_payload;
+    out.features = caps.features;
+    std::memcpy(out.msg_types, caps.msg_types, sizeof(out.msg_types));
+
+    // Highest version inside both ranges
+    uint8_t hi = (caps.proto_max < PROTOCOL_VERSION_) ? caps.proto_max : PROTOCOL_VERSION_;
+    uint8_t lo = (caps.proto_min > PROTOCOL_VERSION_MIN_) ? caps.proto_min : PROTOCOL_VERSION_MIN_;
+    out.version = (hi >= lo) ? hi : 0;
+    return true;
+}
+
+bool espnow::GetPeerCapabilities(const uint8_t mac[6], PeerCapabilities& out) noexcept
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(mac, false);
+    bool found = link && link->caps.valid;
+    if (found) {
+        out = link->caps;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return found;
+}
+
+/// Ask an approved peer for its capabilities unless known, legacy, or asked recently. Receive task.
+static void maybeQueryCapabilities(const uint8_t* src_mac)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool query = false;
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(src_mac, true);
+    if (link && !link->caps.valid && !link->caps_legacy &&
+        link->caps_queries < espnow::CAPABILITY_QUERY_ATTEMPTS_ &&
+        (link->caps_queries == 0 ||
+         now_us - link->caps_queried_us >= static_cast<int64_t>(espnow::CAPABILITY_QUERY_INTERVAL_MS_) * 1000)) {
+        link->caps_queries++;
+        link->caps_queried_us = now_us;
+        query = true;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+
+    if (query) {
+        espnow::CapabilityPayload caps{};
+        fillLocalCapabilities(caps);
+        sendPacketTo(src_mac, 0, espnow::MsgType::DeviceDiscovery, &caps, sizeof(caps),
+                     espnow::TxPriority::Polling);
+    }
+}
+
+/// Cache the capability block of a DeviceInfo/DeviceDiscovery. Receive task.
+static void learnCapabilities(const uint8_t* src_mac, const uint8_t* payload, uint8_t len)
+{
+    espnow::PeerCapabilities caps{};
+    bool parsed = espnow::ParseCapabilities(payload, len, caps);
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(src_mac, true);
+    if (link) {
+        if (parsed) {
+            link->caps = caps;
+            link->caps_legacy = false;
+            if (caps.Has(espnow::CAP_AGGREGATION_)) {
+                link->aggregation = true;
+            }
+        } else {
+            link->caps_legacy = true;
+        }
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+
+    if (!parsed) {
+        ESP_LOGI(TAG_, "Peer %02X:%02X:%02X:%02X:%02X:%02X has no capability block (legacy)",
+                 src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5]);
+    } else if (caps.version == 0) {
+        ESP_LOGE(TAG_, "Peer %02X:%02X:%02X:%02X:%02X:%02X speaks v%u-%u, we speak v%u-%u",
+                 src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
+                 caps.proto_min, caps.proto_max, espnow::PROTOCOL_VERSION_MIN_, espnow::PROTOCOL_VERSION_);
+    } else {
+        ESP_LOGI(TAG_, "Peer %02X:%02X:%02X:%02X:%02X:%02X: v%u, max payload %u, features 0x%08lX",
+                 src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
+                 caps.version, caps.max_payload, static_cast<unsigned long>(caps.features));
+    }
+}
+
+/**
+ * @brief Retransmit or fail every reliable message that is due. TX task only.
+ * @return When the next outstanding message is due, INT64_MAX if there is none
+ */
+static int64_t serviceRetransmissions()
+{
+    OutstandingMsg failed[espnow::RELIABLE_MAX_OUTSTANDING_];
+    size_t failed_count = 0;
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_due_us = INT64_MAX;
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    for (auto& msg : s_outstanding_) {
+        if (!msg.in_use) {
+            continue;
+        }
+        if (now_us < msg.next_tx_us) {
+            next_due_us = std::min(next_due_us, msg.next_tx_us);
+            continue;
+        }
+
+        if (msg.attempts >= espnow::RELIABLE_MAX_ATTEMPTS_) {
+            failed[failed_count++] = msg;
+            msg.in_use = false;
+            s_reliability_stats_.failed++;
+            continue;
+        }
+
+        msg.attempts++;
+        msg.rto_us *= 2;
+        if (msg.rto_us > espnow::RELIABLE_MAX_RTO_MS_ * 1000) {
+            msg.rto_us = espnow::RELIABLE_MAX_RTO_MS_ * 1000;
+        }
+        msg.next_tx_us = now_us + msg.rto_us;
+        next_due_us = std::min(next_due_us, msg.next_tx_us);
+        s_reliability_stats_.retransmissions++;
+
+        esp_err_t err = transmitFrame(msg.dst_mac, msg.frame, msg.frame_len, nullptr, 0);
+        ESP_LOGD(TAG_, "Retransmit type=%u id=%u attempt=%u (%s)",
+                 static_cast<unsigned>(msg.type), msg.msg_id, msg.attempts,
+                 err == ESP_OK ? "ok" : esp_err_to_name(err));
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+
+    for (size_t i = 0; i < failed_count; ++i) {
+        ESP_LOGW(TAG_, "Delivery FAILED: type=%u id=%u after %u attempts",
+                 static_cast<unsigned>(failed[i].type), failed[i].msg_id, failed[i].attempts);
+        reportDelivery(failed[i], false, now_us);
+    }
+    return next_due_us;
+}
+
+/**
+ * @brief Complete the outstanding message an ack is for.
+ *
+ * Peers advertising CAP_RELIABLE_ACK_ echo the request's header id, so only
+ * that id matches; an ack for nothing outstanding is a late copy of one
+ * already delivered and must not complete a later message. Legacy peers do
+ * not echo ids, so their ack completes the oldest message of that type.
+ */
+static void handleReliableAck(const uint8_t* src_mac, const espnow::EspNowHeader& hdr)
+{
+    espnow::MsgType ack_type = static_cast<espnow::MsgType>(hdr.type);
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* peer = findLink(src_mac, false);
+    bool echoes_id = peer && peer->caps.valid && (peer->caps.features & espnow::CAP_RELIABLE_ACK_);
+
+    OutstandingMsg* match = nullptr;
+    for (auto& msg : s_outstanding_) {
+        if (!msg.in_use || msg.ack_type != ack_type || !MacEquals(msg.dst_mac, src_mac)) {
+            continue;
+        }
+        if (msg.msg_id == hdr.id) {
+            match = &msg;
+            break;
+        }
+        if (!echoes_id && (match == nullptr || msg.first_tx_us < match->first_tx_us)) {
+            match = &msg;
+        }
+    }
+
+    if (match == nullptr) {
+        if (echoes_id) {
+            s_reliability_stats_.unmatched_acks++;
+            ESP_LOGD(TAG_, "Ack type=%u id=%u matches nothing outstanding", hdr.type, hdr.id);
+        }
+        xSemaphoreGive(s_reliable_mutex_);
+        return;
+    }
+
+    OutstandingMsg done = *match;
+    match->in_use = false;
+    s_reliability_stats_.delivered++;
+
+    if (done.attempts == 1) {
+        PeerLink* link = findLink(src_mac, true);
+        if (link) {
+            uint32_t sample_us = static_cast<uint32_t>(now_us - done.first_tx_us);
+            updateRtt(*link, sample_us);
+            link->rtt.Add(sample_us);
+        }
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+
+    ESP_LOGD(TAG_, "Delivered type=%u id=%u in %lld us (%u attempts)",
+             static_cast<unsigned>(done.type), done.msg_id,
+             static_cast<long long>(now_us - done.first_tx_us), done.attempts);
+    reportDelivery(done, true, now_us);
+}
+
+/// Acks carry the id of our request, not one from the peer's own sequence
+static bool echoesRequestId(espnow::MsgType type)
+{
+    return type == espnow::MsgType::CommandAck || type == espnow::MsgType::ConfigAck ||
+           type == espnow::MsgType::ConfigFieldAck || type == espnow::MsgType::ChannelSwitchAck ||
+           type == espnow::MsgType::FragmentAck;
+}
+
+/**
+ * Time-limited (type, id) memory: echoed-id acks, and peers that sent no capability block.
+ * An ack to a broadcast echoes an id from the broadcast counter, which can equal a recent
+ * unicast id to the same peer; the first payload byte (a CommandAck's command_id) keeps
+ * the two apart.
+ */
+static bool isRecentDuplicate(PeerLink& link, const espnow::EspNowHeader& hdr, const uint8_t* payload,
+                              int64_t now_us)
+{
+    uint32_t key = (static_cast<uint32_t>(hdr.type) << 16) | (static_cast<uint32_t>(hdr.id) << 8) |
+                   (hdr.len > 0 ? payload[0] : 0u);
+    const int64_t window_us = static_cast<int64_t>(espnow::RX_DEDUP_WINDOW_MS_) * 1000;
+
+    for (uint8_t i = 0; i < espnow::RX_DEDUP_DEPTH_; ++i) {
+        if (link.rx_recent_us[i] != 0 && link.rx_recent[i] == key &&
+            now_us - link.rx_recent_us[i] < window_us) {
+            return true;
+        }
+    }
+    link.rx_recent[link.rx_recent_head] = key;
+    link.rx_recent_us[link.rx_recent_head] = now_us;
+    link.rx_recent_head = static_cast<uint8_t>((link.rx_recent_head + 1) % espnow::RX_DEDUP_DEPTH_);
+    return false;
+}
+
+/// DeviceInfo, or DeviceDiscovery, carrying a capability block: what a peer sends when it (re)starts
+static bool announcesCapabilities(const espnow::EspNowHeader& hdr, const uint8_t* payload)
+{
+    espnow::MsgType type = static_cast<espnow::MsgType>(hdr.type);
+    return (type == espnow::MsgType::DeviceInfo || type == espnow::MsgType::DeviceDiscovery) &&
+           hdr.len >= sizeof(espnow::CapabilityPayload) && payload[0] == espnow::CAPABILITY_MAGIC_;
+}
+
+/// Sliding window over the peer's own ids. Also keeps the loss counters.
+static bool isReplayed(PeerLink& link, const espnow::EspNowHeader& hdr, const uint8_t* payload, int64_t now_us)
+{
+    int32_t lost_delta = 0;
+    espnow::ReplayWindow::Verdict verdict = link.rx_window.Check(hdr.id, lost_delta);
+
+    if (verdict != espnow::ReplayWindow::Verdict::Accept) {
+        // Ids from the past after a capability exchange or a long silence: the peer
+        // restarted its counter. The silence is longer than any retransmission can
+        // be delayed, so that case cannot readmit a retry.
+        bool silent = link.rx_messages > 0 &&
+                      now_us - link.last_rx_us >= static_cast<int64_t>(espnow::REPLAY_RESYNC_MS_) * 1000;
+        if (!silent && !announcesCapabilities(hdr, payload)) {
+            if (verdict == espnow::ReplayWindow::Verdict::Duplicate) {
+                s_reliability_stats_.duplicates_dropped++;
+            } else {
+                s_reliability_stats_.stale_dropped++;
+            }
+            link.rx_duplicates++;
+            return true;
+        }
+        s_reliability_stats_.window_resyncs++;
+        link.rx_window.Reset();
+        link.rx_window.Check(hdr.id, lost_delta);
+    }
+
+    if (lost_delta > 0) {
+        link.rx_gaps++;
+        link.rx_lost += static_cast<uint32_t>(lost_delta);
+    } else if (lost_delta < 0 && link.rx_lost > 0) {
+        link.rx_lost--;     // Late, not lost
+    }
+    return false;
+}
+
+/// Drop frames seen recently; record the rest against the peer's session.
+static bool isDuplicateFrame(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(src_mac, true);
+    if (link == nullptr) {
+        xSemaphoreGive(s_reliable_mutex_);
+        return false;
+    }
+
+    bool sequenced = link->caps.valid && !echoesRequestId(static_cast<espnow::MsgType>(hdr.type));
+    bool duplicate = sequenced ? isReplayed(*link, hdr, payload, now_us) : isRecentDuplicate(*link, hdr, payload, now_us);
+    if (duplicate) {
+        if (!sequenced) {
+            s_reliability_stats_.duplicates_dropped++;
+            link->rx_duplicates++;
+        }
+        xSemaphoreGive(s_reliable_mutex_);
+        return true;
+    }
+
+    updateSession(*link, hdr, payload, now_us, !sequenced);
+    xSemaphoreGive(s_reliable_mutex_);
+    return false;
+}
+
+void espnow::SetDeliveryCallback(DeliveryCallback callback) noexcept
+{
+    s_delivery_cb_ = callback;
+}
+
+espnow::ReliabilityStats espnow::GetReliabilityStats() noexcept
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    ReliabilityStats stats = s_reliability_stats_;
+    xSemaphoreGive(s_reliable_mutex_);
+    return stats;
+}
+
+bool espnow::ReserveReliable(const uint8_t mac[6], MsgType type, uint8_t count) noexcept
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    int64_t now_us = esp_timer_get_time();
+    uint8_t free_slots = 0;
+    for (const auto& msg : s_outstanding_) {
+        if (isFreeSlot(msg, now_us)) {
+            free_slots++;
+        }
+    }
+    if (free_slots < count) {
+        xSemaphoreGive(s_reliable_mutex_);
+        return false;
+    }
+    for (auto& msg : s_outstanding_) {
+        if (count == 0) {
+            break;
+        }
+        if (isFreeSlot(msg, now_us)) {
+            msg = OutstandingMsg{};
+            msg.reserved = true;
+            msg.reserved_until_us = now_us + static_cast<int64_t>(RELIABLE_RESERVE_MS_) * 1000;
+            std::memcpy(msg.dst_mac, mac, 6);
+            msg.type = type;
+            count--;
+        }
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return true;
+}
+
+void espnow::ReleaseReliable(const uint8_t mac[6], MsgType type, uint8_t count) noexcept
+{
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    for (auto& msg : s_outstanding_) {
+        if (count == 0) {
+            break;
+        }
+        if (!msg.in_use && msg.reserved && msg.type == type && MacEquals(msg.dst_mac, mac)) {
+            msg.reserved = false;
+            count--;
+        }
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+}
+
+// ============================================================================
+// PUBLIC SEND FUNCTIONS
+// ============================================================================
+
+bool espnow::SendDeviceDiscovery() noexcept
+{
+    CapabilityPayload caps{};
+    fillLocalCapabilities(caps);
+    return sendPacketTo(BROADCAST_MAC, 0, MsgType::DeviceDiscovery, &caps, sizeof(caps), TxPriority::Polling);
+}
+
+bool espnow::SendConfigRequest(uint8_t device_id) noexcept
+{
+    return SendConfigRequestTo(nullptr, device_id);
+}
+
+bool espnow::SendConfigRequestTo(const uint8_t* dst_mac, uint8_t device_id) noexcept
+{
+    return sendPacketToPeer(dst_mac, device_id, MsgType::ConfigRequest, nullptr, 0, TxPriority::Polling);
+}
+
+bool espnow::SendConfigSet(uint8_t device_id, const void* config_data, size_t config_len,
+                           SendHandle* handle_out) noexcept
+{
+    return SendConfigSetTo(nullptr, device_id, config_data, config_len, handle_out);
+}
+
+bool espnow::SendConfigSetTo(const uint8_t* dst_mac, uint8_t device_id, const void* config_data,
+                             size_t config_len, SendHandle* handle_out) noexcept
+{
+    if (config_len > MAX_PAYLOAD_SIZE_) {
+        return SendLargeMessageTo(dst_mac, device_id, MsgType::ConfigSet, config_data, config_len,
+                                  TxPriority::Control, handle_out);
+    }
+    return sendPacketToPeer(dst_mac, device_id, MsgType::ConfigSet, config_data,
+                            static_cast<uint8_t>(config_len), TxPriority::Control, true, handle_out);
+}
+
+bool espnow::SendConfigFields(uint8_t device_id, const void* records, size_t records_len,
+                              SendHandle* handle_out) noexcept
+{
+    return SendConfigFieldsTo(nullptr, device_id, records, records_len, handle_out);
+}
+
+bool espnow::SendConfigFieldsTo(const uint8_t* dst_mac, uint8_t device_id, const void* records,
+                                size_t records_len, SendHandle* handle_out) noexcept
+{
+    if (records_len == 0 || records_len > MAX_PAYLOAD_SIZE_) {
+        ESP_LOGE(TAG_, "Bad config field payload: %zu", records_len);
+        return false;
+    }
+    return sendPacketToPeer(dst_mac, device_id, MsgType::ConfigFieldSet, records,
+                            static_cast<uint8_t>(records_len), TxPriority::Control, true, handle_out);
+}
+
+bool espnow::SendStatusSubscribe(uint8_t device_id, uint16_t period_ms, uint16_t lease_ms) noexcept
+{
+    return SendStatusSubscribeTo(nullptr, device_id, period_ms, lease_ms);
+}
+
+bool espnow::SendStatusSubscribeTo(const uint8_t* dst_mac, uint8_t device_id,
+                                   uint16_t period_ms, uint16_t lease_ms) noexcept
+{
+    StatusSubscribePayload req{};
+    req.period_ms = period_ms;
+    req.lease_ms = lease_ms;
+    return sendPacketToPeer(dst_mac, device_id, MsgType::StatusSubscribe, &req, sizeof(req), TxPriority::Polling);
+}
+
+bool espnow::SendStatusCompactAckTo(const uint8_t* dst_mac, uint8_t device_id,
+                                    const StatusCompactAckPayload& ack) noexcept
+{
+    return sendPacketToPeer(dst_mac, device_id, MsgType::StatusCompactAck, &ack, sizeof(ack), TxPriority::Polling);
+}
+
+bool espnow::InjectLocalEvent(const ProtoEvent& event) noexcept
+{
+    if (s_proto_event_queue_ == nullptr) {
+        return false;
+    }
+    return xQueueSend(s_proto_event_queue_, &event, 0) == pdTRUE;
+}
+
+bool espnow::SendCommand(uint8_t device_id, uint8_t command_id, 
+                         const void* payload, size_t payload_len, TxPriority priority,
+                         SendHandle* handle_out) noexcept
+{
+    return SendCommandTo(nullptr, device_id, command_id, payload, payload_len, priority, handle_out);
+}
+
+bool espnow::SendCommandTo(const uint8_t* dst_mac, uint8_t device_id, uint8_t command_id,
+                           const void* payload, size_t payload_len, TxPriority priority,
+                           SendHandle* handle_out) noexcept
+{
+    uint8_t cmd_buf[espnow::MAX_PAYLOAD_SIZE_];
+    cmd_buf[0] = command_id;
+    
+    size_t total_payload = 1;
+    if (payload != nullptr && payload_len > 0) {
+        if (1 + payload_len > MAX_PAYLOAD_SIZE_) {
+            ESP_LOGE(TAG_, "Command payload too large: %zu", payload_len);
+            return false;
+        }
+        std::memcpy(cmd_buf + 1, payload, payload_len);
+        total_payload = 1 + payload_len;
+    }
+
+    uint8_t target_mac[6];
+    if (dst_mac == nullptr) {
+        if (!GetTargetDeviceMac(target_mac)) {
+            ESP_LOGW(TAG_, "No target device configured");
+            return false;
+        }
+        dst_mac = target_mac;
+    }
+
+    // Nobody in particular acks a broadcast, so it goes out once, best-effort
+    bool reliable = !IsBroadcastMac(dst_mac);
+    if (!sendPacketTo(dst_mac, device_id, MsgType::Command, cmd_buf,
+                      static_cast<uint8_t>(total_payload), priority, reliable, handle_out)) {
+        return false;
+    }
+    if (!reliable) {
+        return true;
+    }
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(dst_mac, true);
+    if (link) {
+        link->pending_command = command_id;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return true;
+}
+
+// ============================================================================
+// PEER SESSIONS
+// ============================================================================
+
+/// Record an accepted frame against its peer's session. Caller holds s_reliable_mutex_.
+static void updateSession(PeerLink& link, const espnow::EspNowHeader& hdr,
+                          const uint8_t* payload, int64_t now_us, bool count_gaps)
+{
+    // Legacy peers: a jump from the last id means frames were lost (a step back
+    // is a reordered or restarted peer and is not counted). Sequenced peers get
+    // exact counts from the replay window instead.
+    if (count_gaps && link.rx_messages > 0) {
+        uint8_t skipped = static_cast<uint8_t>(hdr.id - link.last_rx_id - 1);
+        if (skipped != 0 && skipped < 128) {
+            link.rx_gaps++;
+            link.rx_lost += skipped;
+        }
+    }
+
+    link.last_rx_us = now_us;
+    link.last_rx_id = hdr.id;
+    link.device_id = hdr.device_id;
+    link.rx_messages++;
+
+    espnow::MsgType type = static_cast<espnow::MsgType>(hdr.type);
+    if (type == espnow::MsgType::StatusUpdate) {
+        link.status_len = hdr.len < espnow::SESSION_STATUS_MAX_ ? hdr.len : espnow::SESSION_STATUS_MAX_;
+        std::memcpy(link.status, payload, link.status_len);
+        link.status_us = now_us;
+    } else if (type == espnow::MsgType::CommandAck) {
+        if (hdr.len >= sizeof(espnow::CommandAckPayload)) {
+            espnow::CommandAckPayload ack{};
+            std::memcpy(&ack, payload, sizeof(ack));
+            link.last_ack_command = ack.command_id;
+            link.last_ack_ok = (ack.result == espnow::COMMAND_RESULT_OK_);
+        } else {
+            // Legacy ack: it can only be for the unicast command we are waiting on
+            link.last_ack_command = link.pending_command;
+            link.last_ack_ok = (link.pending_command != 0);
+        }
+        if (link.last_ack_command == link.pending_command) {
+            link.pending_command = 0;
+        }
+        link.last_ack_us = now_us;
+    }
+}
+
+static void fillSessionInfo(const PeerLink& link, int64_t now_us, espnow::SessionInfo& out)
+{
+    out = espnow::SessionInfo{};
+    std::memcpy(out.mac, link.mac, 6);
+    out.device_id = link.device_id;
+    out.rx_messages = link.rx_messages;
+    out.last_rx_id = link.last_rx_id;
+    out.tx_next_id = link.tx_next_id;
+    out.pending_command = link.pending_command;
+    out.last_ack_us = link.last_ack_us;
+    out.last_ack_command = link.last_ack_command;
+    out.last_ack_ok = link.last_ack_ok;
+
+    if (link.rx_messages == 0) {
+        out.last_rx_age_ms = UINT32_MAX;
+    } else {
+        out.last_rx_age_ms = static_cast<uint32_t>((now_us - link.last_rx_us) / 1000);
+        out.connected = out.last_rx_age_ms < espnow::SESSION_TIMEOUT_MS_;
+    }
+
+    out.status_len = link.status_len;
+    if (link.status_len > 0) {
+        out.status_age_ms = static_cast<uint32_t>((now_us - link.status_us) / 1000);
+        std::memcpy(out.status, link.status, link.status_len);
+    }
+}
+
+bool espnow::GetSession(const uint8_t mac[6], SessionInfo& out) noexcept
+{
+    if (PeerStore::GetPeerSlot(s_security_, mac) < 0) {
+        return false;
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    PeerLink* link = findLink(mac, false);
+    if (link) {
+        fillSessionInfo(*link, now_us, out);
+    } else {
+        // Approved but silent so far
+        out = SessionInfo{};
+        std::memcpy(out.mac, mac, 6);
+        out.last_rx_age_ms = UINT32_MAX;
+        out.tx_next_id = 1;
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return true;
+}
+
+size_t espnow::GetSessions(SessionInfo* out, size_t max_sessions) noexcept
+{
+    int64_t now_us = esp_timer_get_time();
+    size_t count = 0;
+
+    xSemaphoreTake(s_reliable_mutex_, portMAX_DELAY);
+    for (size_t i = 0; i < MAX_LINKS_ && count < max_sessions; ++i) {
+        const PeerLink& link = s_links_[i];
+        if (!link.in_use || PeerStore::GetPeerSlot(s_security_, link.mac) != static_cast<int>(i)) {
+            continue;
+        }
+        fillSessionInfo(link, now_us, out[count++]);
+    }
+    xSemaphoreGive(s_reliable_mutex_);
+    return count;
+}
+
+// ============================================================================
+// PAIRING FUNCTIONS
+// ============================================================================
+
+/// Broadcast a PairingRequest with a fresh challenge.
+static bool sendPairingRequest()
+{
+    using namespace espnow;
+
+    // Generate random challenge
+    GenerateChallenge(s_my_challenge_);
+
+    // Build pairing request
+    PairingRequestPayload req{};
+    esp_wifi_get_mac(WIFI_IF_STA, req.requester_mac);
+    req.device_type = static_cast<uint8_t>(DeviceType::RemoteController);
+    req.expected_peer_type = static_cast<uint8_t>(DeviceType::FatigueTester);
+    std::memcpy(req.challenge, s_my_challenge_, CHALLENGE_SIZE);
+    req.protocol_version = PROTOCOL_VERSION_;
+
+    // Send broadcast
+    if (!sendPacketTo(BROADCAST_MAC, 0, MsgType::PairingRequest, &req, sizeof(req), TxPriority::Control)) {
+        ESP_LOGE(TAG_, "Failed to send pairing request");
+        return false;
+    }
+    return true;
+}
+
+bool espnow::StartPairing() noexcept
+{
+    if (s_pairing_state_ != PairingState::Idle) {
+        ESP_LOGW(TAG_, "Pairing already in progress");
         return false;
     }
-
-    s_pairing_state_ = PairingState::WaitingForResponse;
+    // Waiting before the request goes out, so no early response is dropped
     s_pairing_timeout_tick_ = xTaskGetTickCount() + pdMS_TO_TICKS(PAIRING_RESPONSE_TIMEOUT_MS);
+    s_pairing_state_ = PairingState::WaitingForResponse;
+    if (!sendPairingRequest()) {
+        s_pairing_state_ = PairingState::Idle;
+        return false;
+    }
     
     ESP_LOGI(TAG_, "╔═══════════════════════════════════════════════════════════════════════════════╗");
     ESP_LOGI(TAG_, "║ PAIRING STARTED - Searching for devices...                                    ║");
@@ -366,14 +2155,37 @@ bool espnow::AddApprovedPeer(const uint8_t mac[6], DeviceType type, const char*
 {
     bool result = PeerStore::AddPeer(s_security_, mac, type, name);
     if (result) {
-        tryAddEspNowPeer(mac);
+        ensureDriverPeer(mac);
     }
     return result;
 }
 
 bool espnow::RemoveApprovedPeer(const uint8_t mac[6]) noexcept
 {
-    return PeerStore::RemovePeer(s_security_, mac);
+    if (!PeerStore::RemovePeer(s_security_, mac)) {
+        return false;
+    }
+    // Frees the encrypted slot (the key record is gone) and makes the peer evictable
+    setPeerLinkKey(mac, nullptr);
+    return true;
+}
+
+uint32_t espnow::GetDriverPeerGeneration(const uint8_t mac[6]) noexcept
+{
+    xSemaphoreTake(s_driver_peer_mutex_, portMAX_DELAY);
+    const DriverPeer* entry = findDriverPeer(mac);
+    uint32_t generation = entry ? entry->generation : 0;
+    xSemaphoreGive(s_driver_peer_mutex_);
+    return generation;
+}
+
+bool espnow::IsPeerEncrypted(const uint8_t mac[6]) noexcept
+{
+    xSemaphoreTake(s_driver_peer_mutex_, portMAX_DELAY);
+    const DriverPeer* entry = findDriverPeer(mac);
+    bool encrypted = entry && entry->encrypted;
+    xSemaphoreGive(s_driver_peer_mutex_);
+    return encrypted;
 }
 
 size_t espnow::GetApprovedPeerCount() noexcept
@@ -381,6 +2193,11 @@ size_t espnow::GetApprovedPeerCount() noexcept
     return PeerStore::GetPeerCount(s_security_);
 }
 
+size_t espnow::GetApprovedPeersOfType(DeviceType type, ApprovedPeer* out, size_t max_count) noexcept
+{
+    return PeerStore::GetPeersOfType(s_security_, type, out, max_count);
+}
+
 bool espnow::GetTargetDeviceMac(uint8_t mac_out[6]) noexcept
 {
     return PeerStore::GetFirstPeerOfType(s_security_, DeviceType::FatigueTester, mac_out);
@@ -390,21 +2207,31 @@ bool espnow::GetTargetDeviceMac(uint8_t mac_out[6]) noexcept
 // PAIRING MESSAGE HANDLERS
 // ============================================================================
 
-static void handlePairingResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt)
-{
-    if (s_pairing_state_ != espnow::PairingState::WaitingForResponse) {
-        ESP_LOGW(TAG_, "Unexpected PairingResponse");
-        return;
-    }
+/// A verified responder on its way through confirm and approval
+struct PairingCandidate {
+    PairingResponsePayload resp;
+    uint8_t  flags;             ///< PAIRING_FLAG_* the responder appended
+    bool     use_link_key;
+    uint8_t  lmk[LINK_KEY_SIZE];
+    espnow::SendHandle confirm_handle;
+};
+
+enum class ResponseCheck : uint8_t { Verified, Ignored, Rejected };
 
+/// Parse a PairingResponse and check device type and HMAC.
+static ResponseCheck verifyPairingResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt,
+                                           PairingCandidate& out)
+{
     if (pkt.hdr.len < sizeof(PairingResponsePayload)) {
         ESP_LOGW(TAG_, "PairingResponse too short");
-        s_pairing_state_ = espnow::PairingState::Failed;
-        return;
+        return ResponseCheck::Rejected;
     }
 
-    PairingResponsePayload resp;
-    std::memcpy(&resp, pkt.payload, sizeof(resp));
+    out = PairingCandidate{};
+    std::memcpy(&out.resp, pkt.payload, sizeof(out.resp));
+    out.resp.device_name[MAX_DEVICE_NAME_LEN - 1] = '\0';
+    out.flags = (pkt.hdr.len > sizeof(out.resp)) ? pkt.payload[sizeof(out.resp)] : 0;
+    const PairingResponsePayload& resp = out.resp;
 
     ESP_LOGI(TAG_, "Received pairing response from '%s' (%02X:%02X:%02X:%02X:%02X:%02X)",
              resp.device_name,
@@ -413,20 +2240,44 @@ static void handlePairingResponse(const uint8_t* src_mac, const espnow::EspNowPa
     // SECURITY CHECK 1: Verify device type
     if (resp.device_type != static_cast<uint8_t>(DeviceType::FatigueTester)) {
         ESP_LOGW(TAG_, "Ignoring response from wrong device type: %u", resp.device_type);
-        return;
+        return ResponseCheck::Ignored;
+    }
+
+    // SECURITY CHECK 2: The claimed MAC is the sender's (it is what gets approved)
+    if (!MacEquals(resp.responder_mac, src_mac)) {
+        ESP_LOGE(TAG_, "PairingResponse MAC does not match its sender");
+        return ResponseCheck::Rejected;
     }
 
-    // SECURITY CHECK 2: Verify HMAC - proves they know the shared secret
-    if (!VerifyPairingHmac(s_my_challenge_, CHALLENGE_SIZE, resp.hmac_response)) {
+    // SECURITY CHECK 3: Verify HMAC - proves they know the shared secret. Bound to their MAC
+    // if they advertise it; test units on older firmware sign the challenge alone.
+    bool mac_bound = (out.flags & PAIRING_FLAG_MAC_BOUND) != 0;
+    bool hmac_ok = mac_bound ? VerifyResponseHmac(s_my_challenge_, resp.responder_mac, resp.hmac_response)
+                             : VerifyPairingHmac(s_my_challenge_, CHALLENGE_SIZE, resp.hmac_response);
+    if (!hmac_ok) {
         ESP_LOGE(TAG_, "HMAC verification FAILED - unauthorized device!");
-        s_pairing_state_ = espnow::PairingState::Failed;
-        return;
+        return ResponseCheck::Rejected;
+    }
+    if (!mac_bound) {
+        ESP_LOGW(TAG_, "Device '%s' signs the challenge only (older firmware)", resp.device_name);
     }
 
     ESP_LOGI(TAG_, "Device '%s' passed HMAC verification", resp.device_name);
+    return ResponseCheck::Verified;
+}
+
+/**
+ * @brief Queue the PairingConfirm for a verified responder.
+ * @param key_slots Encrypted peer slots still free for this batch (decremented if one is used)
+ */
+static bool sendPairingConfirm(PairingCandidate& c, size_t& key_slots)
+{
+    const PairingResponsePayload& resp = c.resp;
 
-    // Add as ESP-NOW peer for sending confirm
-    tryAddEspNowPeer(resp.responder_mac);
+    // Add as ESP-NOW peer for sending confirm; a re-pairing device has dropped
+    // its old key, so the confirm must go out in the clear
+    ensureDriverPeer(resp.responder_mac);
+    setPeerLinkKey(resp.responder_mac, nullptr);
     std::memcpy(s_pending_responder_mac_, resp.responder_mac, 6);
 
     // Compute our HMAC response for their challenge
@@ -439,47 +2290,271 @@ static void handlePairingResponse(const uint8_t* src_mac, const espnow::EspNowPa
     std::memcpy(confirm.hmac_response, my_hmac, HMAC_SIZE);
     confirm.success = 1;
 
-    if (!sendPacketTo(resp.responder_mac, 0, espnow::MsgType::PairingConfirm, 
-                      &confirm, sizeof(confirm))) {
+    // Link key: only if the responder offered one and the driver has an encrypted slot
+    c.use_link_key = (c.flags & PAIRING_FLAG_LINK_KEY) && key_slots > 0;
+    if (c.use_link_key) {
+        DeriveLinkKey(s_my_challenge_, resp.challenge, confirm.confirmer_mac, resp.responder_mac, c.lmk);
+        key_slots--;
+    }
+
+    uint8_t confirm_buf[sizeof(confirm) + 1];
+    std::memcpy(confirm_buf, &confirm, sizeof(confirm));
+    confirm_buf[sizeof(confirm)] = PAIRING_FLAG_LINK_KEY;
+    c.confirm_handle = espnow::INVALID_SEND_HANDLE_;
+    if (!sendPacketTo(resp.responder_mac, 0, espnow::MsgType::PairingConfirm,
+                      confirm_buf, c.use_link_key ? sizeof(confirm_buf) : sizeof(confirm),
+                      espnow::TxPriority::Control, false, &c.confirm_handle)) {
         ESP_LOGE(TAG_, "Failed to send pairing confirm");
-        s_pairing_state_ = espnow::PairingState::Failed;
-        return;
+        if (c.use_link_key) key_slots++;
+        return false;
+    }
+    return true;
+}
+
+/// Wait for the confirm's MAC ack, then approve the responder, install its link key and tell the application.
+static bool completePairing(const PairingCandidate& c)
+{
+    const PairingResponsePayload& resp = c.resp;
+
+    // Only a device known to hold our confirm is approved
+    if (espnow::WaitSendComplete(c.confirm_handle, CONFIRM_ACK_TIMEOUT_MS_) != espnow::SendStatus::Success) {
+        ESP_LOGW(TAG_, "PairingConfirm to '%s' not acked; not approved", resp.device_name);
+        return false;
     }
 
     // Add to approved peers
-    bool added = PeerStore::AddPeer(s_security_, resp.responder_mac,
-                                    DeviceType::FatigueTester, resp.device_name);
-    
-    if (added) {
-        s_pairing_state_ = espnow::PairingState::Complete;
-        
-        ESP_LOGI(TAG_, "╔═══════════════════════════════════════════════════════════════════════════════╗");
-        ESP_LOGI(TAG_, "║ PAIRING SUCCESSFUL!                                                           ║");
-        ESP_LOGI(TAG_, "║ Device: %s                                                             ║", resp.device_name);
-        ESP_LOGI(TAG_, "║ MAC: %02X:%02X:%02X:%02X:%02X:%02X                                                      ║",
-                 resp.responder_mac[0], resp.responder_mac[1], resp.responder_mac[2],
-                 resp.responder_mac[3], resp.responder_mac[4], resp.responder_mac[5]);
-        ESP_LOGI(TAG_, "╚═══════════════════════════════════════════════════════════════════════════════╝");
-
-        // Notify application layer
-        if (s_proto_event_queue_) {
-            espnow::ProtoEvent evt{};
-            evt.type = espnow::MsgType::PairingResponse;  // Reuse as "pairing complete" event
-            evt.device_id = resp.device_type;
-            std::memcpy(evt.src_mac, resp.responder_mac, 6);
-            std::memcpy(evt.payload, resp.device_name, sizeof(resp.device_name));
-            evt.payload_len = sizeof(resp.device_name);
-            xQueueSend(s_proto_event_queue_, &evt, 0);
-        }
-    } else {
+    if (!PeerStore::AddPeer(s_security_, resp.responder_mac, DeviceType::FatigueTester, resp.device_name)) {
         ESP_LOGE(TAG_, "Failed to add peer to approved list");
+        return false;
+    }
+
+    // The device installs the key once it has the confirm, which is acked by now
+    if (c.use_link_key) {
+        if (PeerStore::SetLinkKey(s_security_, resp.responder_mac, c.lmk) &&
+            setPeerLinkKey(resp.responder_mac, c.lmk)) {
+            ESP_LOGI(TAG_, "Link key installed, traffic is encrypted");
+        } else {
+            ESP_LOGW(TAG_, "Link key not installed; re-pair if the device stops answering");
+        }
+    }
+
+    ESP_LOGI(TAG_, "╔═══════════════════════════════════════════════════════════════════════════════╗");
+    ESP_LOGI(TAG_, "║ PAIRING SUCCESSFUL!                                                           ║");
+    ESP_LOGI(TAG_, "║ Device: %s                                                             ║", resp.device_name);
+    ESP_LOGI(TAG_, "║ MAC: %02X:%02X:%02X:%02X:%02X:%02X                                                      ║",
+             resp.responder_mac[0], resp.responder_mac[1], resp.responder_mac[2],
+             resp.responder_mac[3], resp.responder_mac[4], resp.responder_mac[5]);
+    ESP_LOGI(TAG_, "╚═══════════════════════════════════════════════════════════════════════════════╝");
+
+    // Notify application layer
+    if (s_proto_event_queue_) {
+        espnow::ProtoEvent evt{};
+        evt.type = espnow::MsgType::PairingResponse;  // Reuse as "pairing complete" event
+        evt.device_id = resp.device_type;
+        std::memcpy(evt.src_mac, resp.responder_mac, 6);
+        std::memcpy(evt.payload, resp.device_name, sizeof(resp.device_name));
+        evt.payload_len = sizeof(resp.device_name);
+        xQueueSend(s_proto_event_queue_, &evt, 0);
+    }
+    return true;
+}
+
+/// The responder StartPairing() settled on, handed from the receive task to pairingConfirmTask
+static PairingCandidate s_confirm_candidate_;
+
+/// Confirm and approve s_confirm_candidate_. Runs in its own task so waiting for
+/// the confirm's MAC ack never holds up the receive task.
+static void pairingConfirmTask(void* arg)
+{
+    (void)arg;
+    size_t key_slots = MAX_ENCRYPTED_PEERS - s_encrypted_peers_;
+    bool paired = sendPairingConfirm(s_confirm_candidate_, key_slots) &&
+                  completePairing(s_confirm_candidate_);
+
+    // CancelPairing() may have reset the state meanwhile
+    if (s_pairing_state_ == espnow::PairingState::Confirming) {
+        s_pairing_state_ = paired ? espnow::PairingState::Complete : espnow::PairingState::Failed;
+    }
+    vTaskDelete(nullptr);
+}
+
+static void handlePairingResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt)
+{
+    if (s_pairing_state_ == espnow::PairingState::Sweeping) {
+        collectSweepResponse(src_mac, pkt);
+        return;
+    }
+    if (s_pairing_state_ != espnow::PairingState::WaitingForResponse) {
+        ESP_LOGW(TAG_, "Unexpected PairingResponse");
+        return;
+    }
+
+    PairingCandidate candidate;
+    ResponseCheck check = verifyPairingResponse(src_mac, pkt, candidate);
+    if (check != ResponseCheck::Verified) {
+        if (check == ResponseCheck::Rejected) {
+            s_pairing_state_ = espnow::PairingState::Failed;
+        }
+        return;
+    }
+
+    // Further responses are ignored from here
+    s_confirm_candidate_ = candidate;
+    s_pairing_state_ = espnow::PairingState::Confirming;
+    if (xTaskCreate(pairingConfirmTask, "pair_confirm", 4096, nullptr, 4, nullptr) != pdPASS) {
         s_pairing_state_ = espnow::PairingState::Failed;
     }
 }
 
+// ============================================================================
+// PAIRING SWEEP
+// ============================================================================
+// One PairingRequest, then every valid responder within the window is
+// collected (the receive task verifies HMACs as responses arrive). When the
+// window closes the sweep task confirms them PAIRING_CONFIRM_BATCH_ at a
+// time: queue the confirms, then approve each one as its MAC ack comes in.
+// ============================================================================
+
+static PairingCandidate s_sweep_candidates_[espnow::PAIRING_SWEEP_MAX_];
+static uint8_t s_sweep_count_ = 0;
+static espnow::PairingSweepResult s_sweep_result_{};
+static uint32_t s_sweep_window_ms_ = 0;
+static portMUX_TYPE s_sweep_mux_ = portMUX_INITIALIZER_UNLOCKED;
+
+/// Receive task: verify a response and keep it for the batch confirm.
+static void collectSweepResponse(const uint8_t* src_mac, const espnow::EspNowPacket& pkt)
+{
+    PairingCandidate candidate{};
+    ResponseCheck check = verifyPairingResponse(src_mac, pkt, candidate);
+
+    taskENTER_CRITICAL(&s_sweep_mux_);
+    if (s_pairing_state_ == espnow::PairingState::Sweeping) {
+        s_sweep_result_.responses++;
+        if (check == ResponseCheck::Rejected) {
+            s_sweep_result_.rejected++;
+        } else if (check == ResponseCheck::Verified) {
+            // Only a verified response has a responder MAC worth comparing
+            bool known = false;
+            for (uint8_t i = 0; i < s_sweep_count_; ++i) {
+                known |= MacEquals(s_sweep_candidates_[i].resp.responder_mac, candidate.resp.responder_mac);
+            }
+            if (!known && s_sweep_count_ < espnow::PAIRING_SWEEP_MAX_) {
+                s_sweep_candidates_[s_sweep_count_++] = candidate;
+                s_sweep_result_.verified++;
+            } else if (!known) {
+                s_sweep_result_.overflow++;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&s_sweep_mux_);
+}
+
+static void pairingSweepTask(void* arg)
+{
+    (void)arg;
+    int64_t start_us = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(s_sweep_window_ms_));
+
+    // Close the window: the receive task stops adding once the state changes
+    taskENTER_CRITICAL(&s_sweep_mux_);
+    bool cancelled = (s_pairing_state_ != espnow::PairingState::Sweeping);
+    if (!cancelled) {
+        s_pairing_state_ = espnow::PairingState::Confirming;   // Late responses are ignored from here
+    }
+    uint8_t count = s_sweep_count_;
+    taskEXIT_CRITICAL(&s_sweep_mux_);
+    if (cancelled) {
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    size_t key_slots = MAX_ENCRYPTED_PEERS - s_encrypted_peers_;
+    for (uint8_t first = 0; first < count; first += espnow::PAIRING_CONFIRM_BATCH_) {
+        uint8_t last = first + espnow::PAIRING_CONFIRM_BATCH_;
+        if (last > count) last = count;
+
+        bool sent[espnow::PAIRING_CONFIRM_BATCH_] = {};
+        for (uint8_t i = first; i < last; ++i) {
+            sent[i - first] = sendPairingConfirm(s_sweep_candidates_[i], key_slots);
+        }
+        for (uint8_t i = first; i < last; ++i) {
+            bool paired = sent[i - first] && completePairing(s_sweep_candidates_[i]);
+            taskENTER_CRITICAL(&s_sweep_mux_);
+            if (paired) {
+                s_sweep_result_.paired++;
+            } else {
+                s_sweep_result_.failed++;
+            }
+            taskEXIT_CRITICAL(&s_sweep_mux_);
+        }
+    }
+
+    // Finish the result and publish it with the state, so a reader never sees half of it
+    uint32_t duration_ms = static_cast<uint32_t>((esp_timer_get_time() - start_us) / 1000);
+    taskENTER_CRITICAL(&s_sweep_mux_);
+    s_sweep_result_.duration_ms = duration_ms;
+    s_sweep_result_.confirm_ms = duration_ms - s_sweep_window_ms_;
+    if (duration_ms > 0) {
+        s_sweep_result_.devices_per_minute = s_sweep_result_.paired * 60000u / duration_ms;
+    }
+    if (s_pairing_state_ == espnow::PairingState::Confirming) {
+        s_pairing_state_ = s_sweep_result_.paired > 0 ? espnow::PairingState::Complete
+                                                      : espnow::PairingState::Failed;
+    }
+    espnow::PairingSweepResult result = s_sweep_result_;
+    taskEXIT_CRITICAL(&s_sweep_mux_);
+
+    ESP_LOGI(TAG_, "Pairing sweep: %u responses, %u verified, %u rejected, %u paired in %lu ms (%lu/min)",
+             result.responses, result.verified, result.rejected,
+             result.paired, static_cast<unsigned long>(result.duration_ms),
+             static_cast<unsigned long>(result.devices_per_minute));
+    vTaskDelete(nullptr);
+}
+
+bool espnow::StartPairingSweep(uint32_t window_ms) noexcept
+{
+    if (s_pairing_state_ != PairingState::Idle) {
+        ESP_LOGW(TAG_, "Pairing already in progress");
+        return false;
+    }
+
+    s_sweep_count_ = 0;
+    s_sweep_result_ = PairingSweepResult{};
+    s_sweep_window_ms_ = window_ms;
+
+    // Collecting before the request goes out, so no early response is dropped
+    s_pairing_state_ = PairingState::Sweeping;
+    if (!sendPairingRequest()) {
+        s_pairing_state_ = PairingState::Idle;
+        return false;
+    }
+    if (xTaskCreate(pairingSweepTask, "pair_sweep", 4096, nullptr, 4, nullptr) != pdPASS) {
+        s_pairing_state_ = PairingState::Failed;
+        return false;
+    }
+    ESP_LOGI(TAG_, "Pairing sweep started, collecting responders for %lu ms",
+             static_cast<unsigned long>(window_ms));
+    return true;
+}
+
+bool espnow::GetPairingSweepResult(PairingSweepResult& out) noexcept
+{
+    taskENTER_CRITICAL(&s_sweep_mux_);
+    bool done = (s_pairing_state_ == PairingState::Complete || s_pairing_state_ == PairingState::Failed);
+    if (done) {
+        out = s_sweep_result_;
+    }
+    taskEXIT_CRITICAL(&s_sweep_mux_);
+    return done;
+}
+
 static void handlePairingReject(const uint8_t* src_mac, const espnow::EspNowPacket& pkt)
 {
-    if (s_pairing_state_ != espnow::PairingState::WaitingForResponse) {
+    if (s_pairing_state_ == espnow::PairingState::Sweeping) {
+        taskENTER_CRITICAL(&s_sweep_mux_);
+        s_sweep_result_.rejected++;
+        taskEXIT_CRITICAL(&s_sweep_mux_);
+    } else if (s_pairing_state_ != espnow::PairingState::WaitingForResponse) {
         return;
     }
 
@@ -522,9 +2597,49 @@ static void handlePairingReject(const uint8_t* src_mac, const espnow::EspNowPack
 
 static void espnowSendCb(const wifi_tx_info_t* info, esp_now_send_status_t status)
 {
-    (void)info;
     ESP_LOGD(TAG_, "ESP-NOW send status=%s",
              status == ESP_NOW_SEND_SUCCESS ? "OK" : "FAIL");
+    if (info == nullptr || info->des_addr == nullptr) {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    espnow::SendStatus result = (status == ESP_NOW_SEND_SUCCESS) ? espnow::SendStatus::Success
+                                                                 : espnow::SendStatus::Failed;
+    auto isPendingFor = [&](const SendSlot& slot) {
+        return slot.generation != 0 && slot.submitted &&
+               slot.completion.status == espnow::SendStatus::Pending &&
+               MacEquals(slot.completion.dst_mac, info->des_addr);
+    };
+
+    // Complete every slot of the oldest submitted frame to this MAC (several for an Aggregate frame)
+    espnow::SendCompletion completions[espnow::SEND_SLOTS_];
+    uint8_t indices[espnow::SEND_SLOTS_];
+    uint8_t count = 0;
+
+    taskENTER_CRITICAL(&s_send_mux_);
+    int oldest = -1;
+    for (uint8_t i = 0; i < espnow::SEND_SLOTS_; ++i) {
+        if (isPendingFor(s_send_slots_[i]) &&
+            (oldest < 0 || static_cast<int32_t>(s_send_slots_[i].tx_order - s_send_slots_[oldest].tx_order) < 0)) {
+            oldest = i;
+        }
+    }
+    if (oldest >= 0) {
+        uint32_t tx_order = s_send_slots_[oldest].tx_order;
+        for (uint8_t i = 0; i < espnow::SEND_SLOTS_; ++i) {
+            if (isPendingFor(s_send_slots_[i]) && s_send_slots_[i].tx_order == tx_order) {
+                completeSendSlotLocked(i, result, now_us);
+                completions[count] = s_send_slots_[i].completion;
+                indices[count++] = i;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&s_send_mux_);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        notifySendComplete(indices[i], completions[i]);
+    }
 }
 
 static void espnowRecvCb(const esp_now_recv_info_t* info, const uint8_t* data, int len)
@@ -535,9 +2650,14 @@ static void espnowRecvCb(const esp_now_recv_info_t* info, const uint8_t* data, i
     }
 
     RawMsg msg{};
+    msg.rx_us = esp_timer_get_time();
     msg.len = len;
     std::memcpy(msg.data, data, len);
     std::memcpy(msg.src_mac, info->src_addr, 6);
+    if (info->rx_ctrl) {
+        msg.rssi = static_cast<int8_t>(info->rx_ctrl->rssi);
+        msg.has_rssi = true;
+    }
 
     BaseType_t hpw = pdFALSE;
     xQueueSendFromISR(s_raw_recv_queue_, &msg, &hpw);
@@ -559,7 +2679,12 @@ static void handlePacket(const RawMsg& msg, const uint8_t* data, int len)
         ESP_LOGW(TAG_, "Bad SYNC 0x%02X", hdr.sync);
         return;
     }
-    if (hdr.version != espnow::PROTOCOL_VERSION_) {
+    // The header layout is the same in every version. Newer peers are still
+    // heard for the capability exchange so they can learn to fall back to ours.
+    bool capability_msg = hdr.type == static_cast<uint8_t>(espnow::MsgType::DeviceInfo) ||
+                          hdr.type == static_cast<uint8_t>(espnow::MsgType::DeviceDiscovery);
+    if (hdr.version < espnow::PROTOCOL_VERSION_MIN_ ||
+        (hdr.version > espnow::PROTOCOL_VERSION_ && !capability_msg)) {
         ESP_LOGW(TAG_, "Unsupported protocol version: %d", hdr.version);
         return;
     }
@@ -616,15 +2741,116 @@ static void handlePacket(const RawMsg& msg, const uint8_t* data, int len)
         return;
     }
 
+    if (msg.has_rssi) {
+        recordRxRssi(msg.src_mac, msg.rssi);
+    }
+    maybeQueryCapabilities(msg.src_mac);
+
+    if (type == espnow::MsgType::Aggregate) {
+        handleAggregate(msg.src_mac, pkt.payload, hdr.len, msg.rx_us);
+        return;
+    }
+
+    dispatchMessage(msg.src_mac, hdr, pkt.payload, msg.rx_us);
+}
+
+/// Deliver one logical message from an approved peer (standalone or unpacked from an Aggregate).
+static void dispatchMessage(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload,
+                            int64_t rx_us)
+{
+    espnow::MsgType type = static_cast<espnow::MsgType>(hdr.type);
+
+    // A repeated fragment means our ack was lost, so every copy is acked
+    if (type == espnow::MsgType::Fragment) {
+        sendPacketTo(src_mac, hdr.device_id, espnow::MsgType::FragmentAck, nullptr, 0,
+                     espnow::TxPriority::Control, false, nullptr, hdr.id);
+    }
+
+    // Retransmitted or replayed frames are processed once
+    if (isDuplicateFrame(src_mac, hdr, payload)) {
+        ESP_LOGD(TAG_, "Duplicate frame type=%u id=%u dropped", hdr.type, hdr.id);
+        return;
+    }
+
+    if (echoesRequestId(type)) {
+        handleReliableAck(src_mac, hdr);
+    }
+    if (type == espnow::MsgType::Fragment) {
+        handleFragment(src_mac, hdr, payload);
+        return;
+    }
+    if (type == espnow::MsgType::BulkStart || type == espnow::MsgType::BulkData ||
+        type == espnow::MsgType::BulkAck) {
+        if (s_bulk_handler_) {
+            s_bulk_handler_(src_mac, type, payload, hdr.len);
+        }
+        return;
+    }
+
+    if (type == espnow::MsgType::ChannelSwitchAck && s_commit_pending_ && MacEquals(src_mac, s_commit_mac_)) {
+        s_commit_ack_id_ = hdr.id;
+        xEventGroupSetBits(s_send_events_, SWITCH_ACK_BIT_);
+    }
+
+    // Channel probes are link plumbing; the application never sees them
+    if (type == espnow::MsgType::ChannelProbe) {
+        sendPacketTo(src_mac, 0, espnow::MsgType::ChannelProbeAck, payload, hdr.len, espnow::TxPriority::Control);
+        return;
+    }
+    if (type == espnow::MsgType::ChannelProbeAck) {
+        espnow::ChannelProbePayload probe{};
+        if (hdr.len >= sizeof(probe)) {
+            std::memcpy(&probe, payload, sizeof(probe));
+            if (probe.token == s_probe_token_ && MacEquals(src_mac, s_probe_mac_)) {
+                s_probe_rx_us_ = esp_timer_get_time();
+                xEventGroupSetBits(s_send_events_, PROBE_ACK_BIT_);
+            }
+        }
+        return;
+    }
+
+    // Time sync is plumbing too: answer requests, hand replies to TimeSync
+    if (type == espnow::MsgType::TimeSync) {
+        espnow::TimeSyncPayload sync{};
+        if (hdr.len >= sizeof(sync)) {
+            std::memcpy(&sync, payload, sizeof(sync));
+            sync.t2_us = rx_us;
+            sendPacketTo(src_mac, 0, espnow::MsgType::TimeSyncReply, &sync, sizeof(sync),
+                         espnow::TxPriority::Polling);
+        }
+        return;
+    }
+    if (type == espnow::MsgType::TimeSyncReply) {
+        espnow::TimeSyncPayload sync{};
+        if (hdr.len >= sizeof(sync) && s_time_sync_handler_) {
+            std::memcpy(&sync, payload, sizeof(sync));
+            s_time_sync_handler_(src_mac, sync, rx_us);
+        }
+        return;
+    }
+
+    if (type == espnow::MsgType::DeviceInfo) {
+        learnCapabilities(src_mac, payload, hdr.len);
+    } else if (type == espnow::MsgType::DeviceDiscovery) {
+        // A peer asking for ours: cache what it sent and answer
+        if (hdr.len >= sizeof(espnow::CapabilityPayload)) {
+            learnCapabilities(src_mac, payload, hdr.len);
+        }
+        espnow::CapabilityPayload caps{};
+        fillLocalCapabilities(caps);
+        sendPacketTo(src_mac, 0, espnow::MsgType::DeviceInfo, &caps, sizeof(caps), espnow::TxPriority::Polling);
+    }
+
     // Create event for higher layers
     espnow::ProtoEvent evt{};
     evt.type = type;
     evt.device_id = hdr.device_id;
     evt.sequence_id = hdr.id;
     evt.payload_len = hdr.len;
-    std::memcpy(evt.src_mac, msg.src_mac, 6);
+    std::memcpy(evt.src_mac, src_mac, 6);
+    evt.rx_us = rx_us;
     if (hdr.len > 0) {
-        std::memcpy(evt.payload, pkt.payload, hdr.len);
+        std::memcpy(evt.payload, payload, hdr.len);
     }
 
     if (s_proto_event_queue_) {
@@ -632,6 +2858,188 @@ static void handlePacket(const RawMsg& msg, const uint8_t* data, int len)
     }
 }
 
+/**
+ * @brief Unpack an Aggregate frame (CRC already checked over the whole frame).
+ *
+ * Stops at the first truncated sub-message. Pairing and nested Aggregate
+ * messages are not allowed inside an aggregate and are skipped.
+ */
+static void handleAggregate(const uint8_t* src_mac, const uint8_t* payload, uint8_t len, int64_t rx_us)
+{
+    // A peer that sends aggregates can receive them
+    espnow::SetAggregation(src_mac, true);
+    s_aggregation_stats_.frames_received++;
+
+    size_t offset = 0;
+    while (offset + sizeof(espnow::AggregateSubHeader) <= len) {
+        espnow::AggregateSubHeader sub{};
+        std::memcpy(&sub, payload + offset, sizeof(sub));
+        offset += sizeof(sub);
+        if (offset + sub.len > len) {
+            ESP_LOGW(TAG_, "Truncated aggregate sub-message (type=%u)", sub.type);
+            return;
+        }
+
+        espnow::MsgType type = static_cast<espnow::MsgType>(sub.type);
+        bool allowed = type != espnow::MsgType::Aggregate &&
+                       !(sub.type >= static_cast<uint8_t>(espnow::MsgType::PairingRequest) &&
+                         sub.type <= static_cast<uint8_t>(espnow::MsgType::Unpair));
+        if (allowed) {
+            espnow::EspNowHeader hdr{};
+            hdr.sync = espnow::SYNC_BYTE_;
+            hdr.version = espnow::PROTOCOL_VERSION_;
+            hdr.device_id = sub.device_id;
+            hdr.type = sub.type;
+            hdr.id = sub.id;
+            hdr.len = sub.len;
+            dispatchMessage(src_mac, hdr, payload + offset, rx_us);
+            s_aggregation_stats_.messages_unpacked++;
+        }
+        offset += sub.len;
+    }
+}
+
+// ============================================================================
+// FRAGMENTATION
+// ============================================================================
+//
+// Messages over MAX_PAYLOAD_SIZE_ travel as Fragment frames, each an ordinary
+// reliable message acked with FragmentAck. Retransmission, dedup and the
+// replay window all work per fragment, so the reassembler only has to put
+// pieces in order and give up on messages that stop making progress.
+// ============================================================================
+
+bool espnow::SendLargeMessageTo(const uint8_t* dst_mac, uint8_t device_id, MsgType type,
+                                const void* data, size_t len, TxPriority priority,
+                                SendHandle* handle_out) noexcept
+{
+    if (len <= MAX_PAYLOAD_SIZE_) {
+        return sendPacketToPeer(dst_mac, device_id, type, data, static_cast<uint8_t>(len),
+                                priority, true, handle_out);
+    }
+    if (len > MAX_MESSAGE_SIZE_) {
+        ESP_LOGE(TAG_, "Message too large: %zu (max %u)", len, MAX_MESSAGE_SIZE_);
+        return false;
+    }
+
+    uint8_t target_mac[6];
+    if (dst_mac == nullptr) {
+        if (!GetTargetDeviceMac(target_mac)) {
+            ESP_LOGW(TAG_, "No target device configured");
+            return false;
+        }
+        dst_mac = target_mac;
+    }
+    PeerCapabilities caps{};
+    if (IsBroadcastMac(dst_mac) || !GetPeerCapabilities(dst_mac, caps) || !caps.Has(CAP_FRAGMENTATION_)) {
+        ESP_LOGW(TAG_, "Peer cannot reassemble a %zu-byte message", len);
+        return false;
+    }
+
+    // All or nothing: a message cut short, or a fragment sent best-effort, would
+    // only time out at the receiver. Hold a reliable slot for every fragment first.
+    uint8_t count = FragmentCount(len);
+    QueueHandle_t queue = s_tx_queues_[static_cast<uint8_t>(priority)];
+    if (queue == nullptr || uxQueueSpacesAvailable(queue) < count) {
+        ESP_LOGW(TAG_, "TX queue %u has no room for %u fragments", static_cast<unsigned>(priority), count);
+        return false;
+    }
+    if (!ReserveReliable(dst_mac, MsgType::Fragment, count)) {
+        ESP_LOGW(TAG_, "No reliable slots for %u fragments", count);
+        return false;
+    }
+
+    uint8_t msg_id = ++s_fragment_msg_id_;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint8_t payload[MAX_PAYLOAD_SIZE_];
+    for (uint8_t i = 0; i < count; ++i) {
+        uint8_t payload_len = BuildFragment(type, msg_id, bytes, len, i, payload);
+        if (!sendPacketTo(dst_mac, device_id, MsgType::Fragment, payload, payload_len, priority, true,
+                          (i + 1 == count) ? handle_out : nullptr)) {
+            // Another producer took the queue space after the check
+            ReleaseReliable(dst_mac, MsgType::Fragment, static_cast<uint8_t>(count - i));
+            return false;
+        }
+        s_fragments_sent_++;
+    }
+    s_large_messages_sent_++;
+    ESP_LOGD(TAG_, "TX large: type=%u, %zu bytes in %u fragments", static_cast<unsigned>(type), len, count);
+    return true;
+}
+
+void espnow::SetLargeMessageCallback(LargeMessageCallback callback) noexcept
+{
+    s_large_message_cb_ = callback;
+}
+
+espnow::FragmentStats espnow::GetFragmentStats() noexcept
+{
+    FragmentStats stats = s_reassembler_.Stats();
+    stats.messages_sent = s_large_messages_sent_;
+    stats.fragments_sent = s_fragments_sent_;
+    return stats;
+}
+
+void espnow::SetBulkFrameHandler(BulkFrameHandler handler) noexcept
+{
+    s_bulk_handler_ = handler;
+}
+
+bool espnow::SendBulkFrame(const uint8_t mac[6], MsgType type, const void* payload, size_t len,
+                           TxPriority priority) noexcept
+{
+    // A full queue is the bulk window's flow control: fail quietly, without taking a send slot
+    QueueHandle_t queue = s_tx_queues_[static_cast<uint8_t>(priority)];
+    if (len > MAX_PAYLOAD_SIZE_ || queue == nullptr || uxQueueSpacesAvailable(queue) == 0) {
+        return false;
+    }
+    return sendPacketTo(mac, 0, type, payload, static_cast<uint8_t>(len), priority);
+}
+
+void espnow::SetTimeSyncHandler(TimeSyncHandler handler) noexcept
+{
+    s_time_sync_handler_ = handler;
+}
+
+bool espnow::SendTimeSync(const uint8_t mac[6]) noexcept
+{
+    // t1 is taken as the frame leaves the TX task, so queueing costs no accuracy
+    TimeSyncPayload sync{};
+    return sendPacketTo(mac, 0, MsgType::TimeSync, &sync, sizeof(sync), TxPriority::Polling);
+}
+
+/// Store one fragment; hand a completed message to the application. Receive task only.
+static void handleFragment(const uint8_t* src_mac, const espnow::EspNowHeader& hdr, const uint8_t* payload)
+{
+    const espnow::FragmentHeader* frag = nullptr;
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    espnow::Reassembler::Result result = s_reassembler_.Add(src_mac, payload, hdr.len, esp_timer_get_time(),
+                                                            frag, data, len);
+    if (result == espnow::Reassembler::Result::Invalid || result == espnow::Reassembler::Result::NoBuffer) {
+        ESP_LOGW(TAG_, "Fragment id=%u dropped (%s)", hdr.id,
+                 result == espnow::Reassembler::Result::Invalid ? "invalid" : "no buffer");
+        return;
+    }
+    if (result != espnow::Reassembler::Result::Complete) {
+        return;
+    }
+
+    espnow::MsgType type = static_cast<espnow::MsgType>(frag->type);
+    if (type == espnow::MsgType::Fragment || type == espnow::MsgType::Aggregate ||
+        (frag->type >= static_cast<uint8_t>(espnow::MsgType::PairingRequest) &&
+         frag->type <= static_cast<uint8_t>(espnow::MsgType::Unpair))) {
+        ESP_LOGW(TAG_, "Reassembled message of type %u not allowed", frag->type);
+        return;
+    }
+    ESP_LOGD(TAG_, "RX large: type=%u, %zu bytes", frag->type, len);
+    if (s_large_message_cb_) {
+        s_large_message_cb_(src_mac, hdr.device_id, type, data, len);
+    } else {
+        ESP_LOGW(TAG_, "No receiver for a %zu-byte message (type=%u)", len, frag->type);
+    }
+}
+
 static void recvTask(void* arg)
 {
     (void)arg;
@@ -16,6 +16,8 @@
 #include "esp_wifi.h"
 #include "esp_log.h"
 #include "espnow_security.hpp"
+#include "espnow_crc.hpp"
+#include "latency_histogram.hpp"
 
 namespace espnow {
 
@@ -24,10 +26,10 @@ namespace espnow {
 // ============================================================================
 
 static constexpr uint8_t SYNC_BYTE_ = 0xAA;
-static constexpr uint8_t PROTOCOL_VERSION_ = 1;
+static constexpr uint8_t PROTOCOL_VERSION_ = 1;       ///< Newest header version we speak
+static constexpr uint8_t PROTOCOL_VERSION_MIN_ = 1;   ///< Oldest header version we still accept
 static constexpr uint8_t MAX_PAYLOAD_SIZE_ = 200;
-static constexpr uint16_t CRC16_POLYNOMIAL_ = 0x1021;
-static constexpr uint8_t WIFI_CHANNEL_ = 1;
+static constexpr uint8_t WIFI_CHANNEL_ = 1;           ///< Boot channel until ChannelManager restores the saved one
 
 // ============================================================================
 // MESSAGE TYPES
@@ -49,6 +51,15 @@ enum class MsgType : uint8_t {
 
     // Fatigue-test extensions
     BoundsResult,
+
+    // Status streaming
+    StatusSubscribe = 14,   ///< Controller → Device (payload: StatusSubscribePayload)
+    SubscribeAck    = 15,   ///< Device → Controller (payload: StatusSubscribePayload, granted values)
+
+    // Per-field configuration (payload format in config_fields.hpp)
+    ConfigFieldSet    = 16, ///< Controller → Device (payload: TLV records, changed fields only)
+    ConfigFieldAck    = 17, ///< Device → Controller (payload: ConfigFieldStatus per received record)
+    ConfigFieldReport = 18, ///< Device → Controller (payload: TLV records, all fields; reply to ConfigRequest)
     
     // Security / Pairing messages (20-29 range)
     PairingRequest  = 20,
@@ -56,8 +67,185 @@ enum class MsgType : uint8_t {
     PairingConfirm  = 22,
     PairingReject   = 23,
     Unpair          = 24,
+
+    // Transport (30-39 range)
+    Aggregate       = 30,   ///< Several sub-messages in one frame (payload: AggregateSubHeader + data, repeated)
+    ChannelSwitch   = 31,   ///< Controller → Device (payload: ChannelSwitchPayload)
+    ChannelSwitchAck = 32,  ///< Device → Controller, sent before switching (no payload)
+    ChannelProbe    = 33,   ///< Either direction (payload: ChannelProbePayload)
+    ChannelProbeAck = 34,   ///< Reply to ChannelProbe (payload: the probe's ChannelProbePayload)
+    Fragment        = 35,   ///< Part of a message over MAX_PAYLOAD_SIZE_ (payload: FragmentHeader + data)
+    FragmentAck     = 36,   ///< Receipt of one Fragment frame (echoes its header id, no payload)
+    BulkStart       = 37,   ///< Open a bulk transfer; the device answers in kind (payload: BulkStartPayload)
+    BulkData        = 38,   ///< One chunk of a bulk transfer (payload: BulkDataHeader + data)
+    BulkAck         = 39,   ///< Cumulative + selective ack, or abort (payload: BulkAckPayload)
+
+    // Time synchronization (40-49 range)
+    TimeSync        = 40,   ///< Either direction (payload: TimeSyncPayload, t1 set)
+    TimeSyncReply   = 41,   ///< Reply to TimeSync (payload: TimeSyncPayload, t1 echoed, t2/t3 set)
+
+    // Compact status (50-59 range, payload format in device_protocols.hpp)
+    StatusCompact    = 50,  ///< Device → Controller, instead of StatusUpdate (payload: varint-coded sample)
+    StatusCompactAck = 51,  ///< Controller → Device (payload: StatusCompactAckPayload)
+
+    // Local-only events (never transmitted), posted to the event queue
+    DeliveryFailed  = 0xF0,   ///< Reliable message exhausted its retries (payload: DeliveryReport)
 };
 
+// ============================================================================
+// RELIABLE DELIVERY
+// ============================================================================
+
+static constexpr uint32_t RELIABLE_INITIAL_RTO_MS_ = 100;   ///< RTO before any RTT sample
+static constexpr uint32_t RELIABLE_MIN_RTO_MS_ = 20;
+static constexpr uint32_t RELIABLE_MAX_RTO_MS_ = 500;       ///< Cap for exponential backoff
+static constexpr uint8_t  RELIABLE_MAX_ATTEMPTS_ = 6;       ///< First transmission + 5 retries
+static constexpr uint8_t  RELIABLE_MAX_OUTSTANDING_ = 8;
+static constexpr uint32_t RELIABLE_RESERVE_MS_ = 1000;     ///< Unclaimed reservations lapse after this
+static constexpr uint8_t  RX_DEDUP_DEPTH_ = 8;              ///< Recent frames remembered per peer
+static constexpr uint32_t RX_DEDUP_WINDOW_MS_ = 2000;
+
+/// Silence after which a peer's ids falling outside its replay window restart
+/// the window (peer rebooted) instead of being dropped. Above RELIABLE_MAX_DELIVERY_MS_.
+/// A DeviceInfo/DeviceDiscovery with a capability block restarts it at once.
+static constexpr uint32_t REPLAY_RESYNC_MS_ = 5000;
+
+/// Upper bound from first transmission until a reliable message is reported failed
+/// (every attempt waits at most RELIABLE_MAX_RTO_MS_ for its ack).
+static constexpr uint32_t RELIABLE_MAX_DELIVERY_MS_ = RELIABLE_MAX_ATTEMPTS_ * RELIABLE_MAX_RTO_MS_;
+static_assert(REPLAY_RESYNC_MS_ > RELIABLE_MAX_DELIVERY_MS_, "a resync must not readmit a retransmission");
+
+// ============================================================================
+// TRANSMIT QUEUES
+// ============================================================================
+
+/**
+ * @brief Transmit priority. All frames go through one TX task which always
+ *        drains a higher class before a lower one (FIFO within a class).
+ */
+enum class TxPriority : uint8_t {
+    Safety = 0,     ///< Stop / emergency commands only, so nothing else can fill the queue
+    Control,        ///< Commands, config writes, pairing, channel probes
+    Polling,        ///< Discovery, status/config requests, time sync
+    Bulk,           ///< Bulk transfer data, only sent when nothing else is queued
+};
+
+static constexpr uint8_t TX_PRIORITY_COUNT_ = 4;
+static constexpr uint8_t TX_QUEUE_DEPTH_[TX_PRIORITY_COUNT_] = { 4, 8, 4, 8 };
+
+// ============================================================================
+// FRAME AGGREGATION
+// ============================================================================
+
+/// Default time the TX task holds a batch of several messages for more traffic to
+/// the same peer. 0 aggregates only what is already queued: the batch goes out as
+/// soon as the TX queues are empty. A lone message and Safety messages never wait.
+static constexpr uint32_t AGGREGATION_FLUSH_MS_ = 0;
+
+// ============================================================================
+// SEND COMPLETION
+// ============================================================================
+
+static constexpr uint8_t SEND_SLOTS_ = 16;   ///< Frames tracked between esp_now_send and send callback
+
+/**
+ * @brief Handle for one transmitted frame, completed by the ESP-NOW send callback.
+ *
+ * Slot index and a generation counter packed into 16 bits; a handle whose slot
+ * has since been reused reports SendStatus::Expired. 0 is never a valid handle.
+ */
+using SendHandle = uint16_t;
+static constexpr SendHandle INVALID_SEND_HANDLE_ = 0;
+
+enum class SendStatus : uint8_t {
+    Pending,    ///< Queued to the driver, send callback not yet received
+    Success,    ///< MAC-layer ack received (always Success for broadcast)
+    Failed,     ///< No MAC-layer ack, or esp_now_send rejected the frame
+    Expired,    ///< Handle is invalid or its slot was reused
+    Timeout,    ///< WaitSendComplete gave up before the callback fired
+};
+
+struct SendCompletion {
+    SendHandle handle;
+    uint8_t    dst_mac[6];
+    MsgType    type;
+    uint8_t    msg_id;         ///< Header id of the frame (set once the TX task sends it)
+    SendStatus status;
+    int64_t    enqueue_us;     ///< esp_timer time when handed to esp_now_send
+    int64_t    complete_us;    ///< esp_timer time of the send callback
+};
+
+/**
+ * @brief Per-peer driver-level TX statistics (enqueue to send callback).
+ */
+struct TxLinkStats {
+    LatencyHistogram latency;
+    uint32_t send_ok;
+    uint32_t send_fail;
+};
+
+/**
+ * @brief Per-peer link quality as seen by the controller.
+ */
+struct LinkStats {
+    int8_t   rssi_last;         ///< dBm of the last frame received
+    int8_t   rssi_avg;          ///< EWMA over frames (weight 1/8), dBm
+    int8_t   rssi_min;
+    uint32_t rssi_samples;
+    uint32_t tx_frames;         ///< Frames completed by the driver
+    uint32_t tx_failures;       ///< Of those, not acked at the MAC layer
+    uint32_t rx_messages;
+    uint32_t rx_gaps;           ///< Times the peer's message id skipped ahead
+    uint32_t rx_lost;           ///< Ids skipped in total (messages we never saw)
+    uint32_t rx_duplicates;     ///< Frames dropped as duplicates or replays
+    uint32_t srtt_us;           ///< Smoothed request-to-ack RTT, 0 until measured
+    LatencyHistogram rtt;       ///< Request-to-ack RTT, first transmissions only
+};
+
+using SendCompleteCallback = void (*)(const SendCompletion& completion);
+
+struct AggregationStats {
+    uint32_t frames_sent;           ///< Aggregate frames transmitted
+    uint32_t messages_aggregated;   ///< Sub-messages carried in those frames
+    uint32_t frames_received;
+    uint32_t messages_unpacked;
+};
+
+// ============================================================================
+// CAPABILITIES
+// ============================================================================
+
+/// First payload byte of a capability block; legacy DeviceInfo carries a name string instead
+static constexpr uint8_t CAPABILITY_MAGIC_ = 0xCA;
+
+/// Optional features advertised in CapabilityPayload::features
+static constexpr uint32_t CAP_RELIABLE_ACK_    = 1u << 0;   ///< Echoes header ids in acks, drops retransmitted duplicates
+static constexpr uint32_t CAP_AGGREGATION_     = 1u << 1;   ///< Receives Aggregate frames
+static constexpr uint32_t CAP_STATUS_STREAM_   = 1u << 2;   ///< Answers StatusSubscribe
+static constexpr uint32_t CAP_CONFIG_FIELDS_   = 1u << 3;   ///< ConfigFieldSet/Ack/Report
+static constexpr uint32_t CAP_COMPRESSION_     = 1u << 4;   ///< StatusCompact/StatusCompactAck
+static constexpr uint32_t CAP_CHANNEL_SWITCH_  = 1u << 5;   ///< ChannelSwitch/ChannelProbe
+static constexpr uint32_t CAP_LONG_RANGE_      = 1u << 6;   ///< WIFI_PROTOCOL_LR enabled: may be sent LR rates
+static constexpr uint32_t CAP_FRAGMENTATION_   = 1u << 7;   ///< Fragment/FragmentAck, messages up to MAX_MESSAGE_SIZE_
+static constexpr uint32_t CAP_BULK_TRANSFER_   = 1u << 8;   ///< BulkStart/Data/Ack
+static constexpr uint32_t CAP_TIME_SYNC_       = 1u << 9;   ///< Answers TimeSync
+
+static constexpr uint32_t LOCAL_CAPABILITIES_ = CAP_RELIABLE_ACK_ | CAP_AGGREGATION_ |
+                                                CAP_STATUS_STREAM_ | CAP_CONFIG_FIELDS_ |
+                                                CAP_COMPRESSION_ | CAP_CHANNEL_SWITCH_ | CAP_LONG_RANGE_ |
+                                                CAP_FRAGMENTATION_ | CAP_BULK_TRANSFER_ |
+                                                CAP_TIME_SYNC_;
+
+static constexpr uint32_t CAPABILITY_QUERY_INTERVAL_MS_ = 10000;  ///< Re-ask a peer that did not answer
+static constexpr uint8_t  CAPABILITY_QUERY_ATTEMPTS_ = 3;
+
+// ============================================================================
+// PEER SESSIONS
+// ============================================================================
+
+static constexpr uint32_t SESSION_TIMEOUT_MS_ = 5000;   ///< No frame for this long: disconnected
+static constexpr uint8_t  SESSION_STATUS_MAX_ = 32;     ///< Bytes of the last StatusUpdate kept per peer
+
 // ============================================================================
 // PAIRING STATE
 // ============================================================================
@@ -65,10 +253,29 @@ enum class MsgType : uint8_t {
 enum class PairingState : uint8_t {
     Idle,               ///< Not pairing
     WaitingForResponse, ///< Sent request, waiting for response
+    Sweeping,           ///< Sweep: collecting every responder until the window closes
+    Confirming,         ///< Confirming the verified responder(s); a sweep does so in batches
     Complete,           ///< Pairing completed successfully
     Failed,             ///< Pairing failed
 };
 
+static constexpr uint8_t  PAIRING_SWEEP_MAX_ = 16;          ///< Responders one sweep collects
+static constexpr uint32_t PAIRING_SWEEP_WINDOW_MS_ = 3000;  ///< Default collection window
+static constexpr uint8_t  PAIRING_CONFIRM_BATCH_ = 4;       ///< Confirms in flight at once (TX queue room)
+
+/// Outcome of the last pairing sweep
+struct PairingSweepResult {
+    uint8_t  responses;         ///< PairingResponses received in the window
+    uint8_t  verified;          ///< Distinct responders that passed the HMAC check
+    uint8_t  rejected;          ///< Failed HMAC, or sent PairingReject
+    uint8_t  overflow;          ///< Verified but beyond PAIRING_SWEEP_MAX_
+    uint8_t  paired;            ///< Confirmed and approved
+    uint8_t  failed;            ///< Verified but the confirm or approval failed
+    uint32_t duration_ms;       ///< From the request to the last approval
+    uint32_t confirm_ms;        ///< Of that, spent confirming after the window
+    uint32_t devices_per_minute;
+};
+
 // ============================================================================
 // PACKET STRUCTURES
 // ============================================================================
@@ -88,8 +295,164 @@ struct EspNowPacket {
     uint8_t      payload[MAX_PAYLOAD_SIZE_];
     uint16_t     crc;
 };
+
+/**
+ * @brief Move to another channel.
+ *
+ * The device acks, waits switch_delay_ms, then changes channel. If rollback_ms
+ * is non-zero and no ChannelSwitch with rollback_ms = 0 for that channel
+ * arrives within rollback_ms, it returns to the channel it came from. A
+ * ChannelSwitch to the current channel with rollback_ms = 0 commits it.
+ */
+struct ChannelSwitchPayload {
+    uint8_t  channel;
+    uint8_t  reserved;
+    uint16_t switch_delay_ms;
+    uint16_t rollback_ms;
+};
+
+struct ChannelProbePayload {
+    uint32_t token;         ///< Echoed in ChannelProbeAck
+};
+
+/**
+ * @brief CommandAck payload. Devices that predate it ack with no payload, which
+ * only says that the unicast command it echoes the header id of arrived.
+ */
+struct CommandAckPayload {
+    uint8_t command_id;     ///< Command being acknowledged
+    uint8_t result;         ///< COMMAND_RESULT_OK_, or a device error code (command not executed)
+};
+
+static constexpr uint8_t COMMAND_RESULT_OK_ = 0;
+
+/// StatusSubscribe request / SubscribeAck grant.
+struct StatusSubscribePayload {
+    uint16_t period_ms;     ///< StatusUpdate period; 0 = unsubscribe (request) or rejected (ack)
+    uint16_t lease_ms;      ///< Device stops streaming this long after the last StatusSubscribe
+};
+
+static constexpr uint8_t STATUS_ACK_NEED_KEY_ = 1u << 0;   ///< Reference unknown: send an absolute sample next
+
+/// StatusCompactAck: the sample the device may encode against from now on
+struct StatusCompactAckPayload {
+    uint8_t seq;            ///< Sequence number of the acknowledged StatusCompact sample
+    uint8_t flags;          ///< STATUS_ACK_* bits
+};
+
+/**
+ * @brief Capability block, carried by DeviceInfo and DeviceDiscovery.
+ *
+ * Senders may append data after it (e.g. a name string); receivers ignore it.
+ */
+struct CapabilityPayload {
+    uint8_t  magic;             ///< CAPABILITY_MAGIC_
+    uint8_t  device_type;       ///< DeviceType of the sender
+    uint8_t  proto_min;         ///< Oldest header version the sender accepts
+    uint8_t  proto_max;         ///< Newest header version the sender speaks
+    uint8_t  max_payload;       ///< Largest payload the sender accepts
+    uint8_t  reserved;
+    uint32_t features;          ///< CAP_* bits
+    uint8_t  msg_types[16];     ///< Bit n set: sender handles MsgType n (0-127)
+};
+
+/// Sub-message header inside an Aggregate frame (no per-message sync/version/CRC).
+struct AggregateSubHeader {
+    uint8_t type;
+    uint8_t device_id;
+    uint8_t id;
+    uint8_t len;
+};
+
+/// Leads every Fragment payload. Fragment i carries bytes [i * FRAGMENT_DATA_SIZE_, ...).
+struct FragmentHeader {
+    uint8_t  type;          ///< MsgType of the whole message
+    uint8_t  msg_id;        ///< Same in every fragment of a message, per sender
+    uint8_t  index;         ///< 0 .. count - 1
+    uint8_t  count;
+    uint16_t total_len;     ///< Bytes in the whole message
+};
+
+enum class BulkDirection : uint8_t {
+    Download = 0,   ///< Device sends, controller acks
+    Upload   = 1,   ///< Controller sends, device acks
+};
+
+/// Objects a bulk transfer can move
+enum class BulkObject : uint16_t {
+    CycleHistory = 1,   ///< Device's per-cycle log (download)
+    ErrorHistory = 2,   ///< Device's error log (download)
+    ConfigBundle = 3,   ///< Complete configuration set (either direction)
+};
+
+enum class BulkStatus : uint8_t {
+    Ok = 0,
+    UnknownObject,  ///< Device has no such object
+    Busy,           ///< Another transfer is running
+    TooLarge,       ///< Upload does not fit on the device
+    StorageError,   ///< Reading or writing the object failed
+    Aborted,        ///< Cancelled by either side
+    Timeout,        ///< Local only: the peer stopped answering
+};
+
+/**
+ * @brief BulkStart. The controller's request, and the device's answer with
+ *        the same transfer_id (window 0 and a status refuse it).
+ */
+struct BulkStartPayload {
+    uint8_t  transfer_id;
+    uint8_t  direction;     ///< BulkDirection
+    uint16_t object_id;     ///< BulkObject
+    uint32_t total_len;     ///< Upload request: bytes to come. Download answer: object size
+    uint8_t  window;        ///< Request: chunks in flight we allow. Answer: granted
+    uint8_t  status;        ///< Answer: BulkStatus
+};
+
+/// Leads every BulkData payload; chunk seq holds bytes [seq * BULK_CHUNK_SIZE_, ...)
+struct BulkDataHeader {
+    uint8_t  transfer_id;
+    uint8_t  reserved;
+    uint32_t seq;
+};
+
+/// Sent by the receiving side. A status other than Ok (from either side) ends the transfer.
+struct BulkAckPayload {
+    uint8_t  transfer_id;
+    uint8_t  status;        ///< BulkStatus
+    uint32_t next_seq;      ///< Every chunk below this arrived
+    uint32_t sack;          ///< Bit i: chunk next_seq + 1 + i arrived
+};
+
+/**
+ * @brief TimeSync request and reply (NTP-style). Times are each side's
+ *        esp_timer clock in microseconds; each is taken as close to the radio
+ *        as the sender can (t1/t3 in the TX task, t2 in the receive callback).
+ */
+struct TimeSyncPayload {
+    int64_t t1_us;          ///< Requester: request sent. Echoed in the reply
+    int64_t t2_us;          ///< Responder: request received (0 in the request)
+    int64_t t3_us;          ///< Responder: reply sent (0 in the request)
+};
 #pragma pack(pop)
 
+static constexpr uint8_t BULK_CHUNK_SIZE_ = MAX_PAYLOAD_SIZE_ - sizeof(BulkDataHeader);
+
+// ============================================================================
+// FRAGMENTATION
+// ============================================================================
+
+static constexpr uint8_t  FRAGMENT_DATA_SIZE_ = MAX_PAYLOAD_SIZE_ - sizeof(FragmentHeader);
+static constexpr uint8_t  MAX_FRAGMENTS_ = 8;
+static constexpr uint16_t MAX_MESSAGE_SIZE_ = FRAGMENT_DATA_SIZE_ * MAX_FRAGMENTS_;
+static constexpr uint8_t  REASSEMBLY_SLOTS_ = 2;    ///< Messages reassembled at once (MAX_MESSAGE_SIZE_ each)
+
+/// A partial message is dropped when no fragment of it arrived for this long;
+/// long enough for one fragment to use all its retransmissions.
+static constexpr uint32_t REASSEMBLY_TIMEOUT_MS_ = RELIABLE_MAX_DELIVERY_MS_;
+static_assert(MAX_FRAGMENTS_ <= RELIABLE_MAX_OUTSTANDING_, "every fragment of a message must be trackable");
+static_assert(MAX_FRAGMENTS_ <= TX_QUEUE_DEPTH_[static_cast<uint8_t>(TxPriority::Bulk)],
+              "a whole fragmented message must fit the default queue");
+
 // ============================================================================
 // EVENT STRUCTURES
 // ============================================================================
@@ -100,13 +463,116 @@ struct ProtoEvent {
     uint8_t sequence_id;
     uint8_t payload[MAX_PAYLOAD_SIZE_];
     size_t payload_len;
-    uint8_t src_mac[6];  ///< Source MAC address (for pairing events)
+    uint8_t src_mac[6];  ///< Source MAC address (all zero for locally injected events)
+    int64_t rx_us;       ///< esp_timer time the radio delivered the frame; 0 for local events
+};
+
+/**
+ * @brief Outcome of a reliable (acknowledged) message.
+ */
+struct DeliveryReport {
+    uint8_t  dst_mac[6];
+    uint8_t  device_id;
+    uint8_t  msg_id;        ///< Header id used for every (re)transmission
+    MsgType  type;          ///< Message type that was sent
+    bool     delivered;     ///< true = ack received, false = retries exhausted
+    uint8_t  attempts;      ///< Number of transmissions
+    uint32_t latency_ms;    ///< First transmission to ack (or to giving up)
+};
+
+/**
+ * @brief Counters for the reliable delivery layer.
+ */
+struct ReliabilityStats {
+    uint32_t reliable_sent;       ///< Reliable messages accepted for delivery
+    uint32_t retransmissions;     ///< Extra transmissions caused by timeouts
+    uint32_t delivered;
+    uint32_t failed;
+    uint32_t duplicates_dropped;  ///< Received frames suppressed as duplicates
+    uint32_t stale_dropped;       ///< Received frames older than the peer's replay window, or an unconfirmed jump
+    uint32_t window_resyncs;      ///< Replay windows restarted by a capability exchange or after silence
+    uint32_t untracked_sends;     ///< Reliable sends downgraded because the table was full
+    uint32_t unmatched_acks;      ///< Acks from id-echoing peers for nothing outstanding (late or duplicate)
+};
+
+using DeliveryCallback = void (*)(const DeliveryReport& report);
+
+/**
+ * @brief Counters for fragmentation and reassembly.
+ */
+struct FragmentStats {
+    uint32_t messages_sent;       ///< Large messages split and queued
+    uint32_t fragments_sent;
+    uint32_t messages_received;   ///< Reassembled completely
+    uint32_t fragments_received;
+    uint32_t duplicates;          ///< Fragments already held
+    uint32_t invalid;             ///< Inconsistent index, count or length
+    uint32_t timeouts;            ///< Partial messages dropped after REASSEMBLY_TIMEOUT_MS_
+    uint32_t replaced;            ///< Partial messages abandoned when the sender started another
+    uint32_t no_buffer;           ///< New messages dropped: every reassembly slot busy
+};
+
+/**
+ * @brief Receives a reassembled message (too large for a ProtoEvent).
+ *
+ * Runs in the receive task; data is only valid during the call.
+ */
+using LargeMessageCallback = void (*)(const uint8_t src_mac[6], uint8_t device_id, MsgType type,
+                                      const uint8_t* data, size_t len);
+
+/**
+ * @brief Snapshot of one peer's session, kept by the protocol layer for every
+ *        approved peer independently of which device the UI shows.
+ */
+struct SessionInfo {
+    uint8_t  mac[6];
+    uint8_t  device_id;         ///< From the last frame received
+    bool     connected;         ///< A frame arrived within SESSION_TIMEOUT_MS_
+    uint32_t last_rx_age_ms;    ///< UINT32_MAX if nothing received yet
+    uint32_t rx_messages;
+    uint8_t  last_rx_id;        ///< Header id of the last accepted message
+    uint8_t  tx_next_id;        ///< Header id the next message to this peer will carry
+    uint8_t  pending_command;   ///< command_id awaiting CommandAck, 0 = none
+    int64_t  last_ack_us;       ///< esp_timer time of the last CommandAck, 0 = none
+    uint8_t  last_ack_command;  ///< command_id that CommandAck was for, 0 = unknown
+    bool     last_ack_ok;       ///< It reported COMMAND_RESULT_OK_
+    uint8_t  status_len;        ///< 0 if no StatusUpdate seen
+    uint32_t status_age_ms;
+    uint8_t  status[SESSION_STATUS_MAX_];   ///< Start of the last StatusUpdate payload
+};
+
+/**
+ * @brief What a peer advertised, and the header version both sides will use.
+ */
+struct PeerCapabilities {
+    bool     valid;             ///< false: no capability block seen (legacy or not asked yet)
+    uint8_t  device_type;
+    uint8_t  proto_min;
+    uint8_t  proto_max;
+    uint8_t  version;           ///< Negotiated header version, 0 if the ranges do not overlap
+    uint8_t  max_payload;
+    uint32_t features;
+    uint8_t  msg_types[16];
+
+    bool Has(uint32_t feature) const noexcept { return valid && (features & feature) == feature; }
+
+    bool Handles(MsgType type) const noexcept
+    {
+        uint8_t t = static_cast<uint8_t>(type);
+        return valid && t < 128 && (msg_types[t / 8] & (1u << (t % 8))) != 0;
+    }
 };
 
 // ============================================================================
 // PUBLIC FUNCTIONS
 // ============================================================================
 
+/*
+ * Send functions never block on the radio: they queue the message for the TX
+ * task and return false only if the message was rejected (no target, too
+ * large, queue full). Driver results are reported through the send handle.
+ */
+
 /**
  * @brief Initialize ESP-NOW with peer storage.
  * @param event_queue Queue to receive ProtoEvent messages
@@ -115,10 +581,24 @@ struct ProtoEvent {
 bool Init(QueueHandle_t event_queue) noexcept;
 
 /**
- * @brief Send device discovery broadcast.
+ * @brief Send device discovery broadcast (carries our capability block).
  */
 bool SendDeviceDiscovery() noexcept;
 
+/**
+ * @brief Decode a capability block from a DeviceInfo/DeviceDiscovery payload.
+ * @return false for legacy payloads without one
+ */
+bool ParseCapabilities(const uint8_t* payload, size_t len, PeerCapabilities& out) noexcept;
+
+/**
+ * @brief Capabilities cached for a peer.
+ * 
+ * Peers are asked once they first send us a frame (DeviceDiscovery carrying our
+ * own block, answered with DeviceInfo). Returns false until an answer arrived.
+ */
+bool GetPeerCapabilities(const uint8_t mac[6], PeerCapabilities& out) noexcept;
+
 /**
  * @brief Request configuration from a device.
  */
@@ -126,13 +606,254 @@ bool SendConfigRequest(uint8_t device_id) noexcept;
 
 /**
  * @brief Send configuration to a device.
+ * 
+ * Delivered reliably: retransmitted until a ConfigAck arrives or
+ * RELIABLE_MAX_ATTEMPTS_ is reached. Config over MAX_PAYLOAD_SIZE_ goes out
+ * fragmented (SendLargeMessageTo); each fragment is acked instead.
  */
-bool SendConfigSet(uint8_t device_id, const void* config_data, size_t config_len) noexcept;
+bool SendConfigSet(uint8_t device_id, const void* config_data, size_t config_len,
+                   SendHandle* handle_out = nullptr) noexcept;
+
+/**
+ * @brief Send TLV-encoded config fields to a device.
+ * 
+ * Delivered reliably like SendConfigSet; completes on ConfigFieldAck. Only use
+ * for devices that have shown ConfigField support (ConfigFieldReport/Ack).
+ */
+bool SendConfigFields(uint8_t device_id, const void* records, size_t records_len,
+                      SendHandle* handle_out = nullptr) noexcept;
 
 /**
  * @brief Send a command to a device.
+ * 
+ * Delivered reliably: retransmitted until a CommandAck arrives or
+ * RELIABLE_MAX_ATTEMPTS_ is reached.
+ * 
+ * @param priority TX class; use TxPriority::Safety for stop commands
+ * @param handle_out Optional; receives the send handle of the first transmission
+ *                   (INVALID_SEND_HANDLE_ if all slots were busy)
+ */
+bool SendCommand(uint8_t device_id, uint8_t command_id, const void* payload, size_t payload_len,
+                 TxPriority priority = TxPriority::Control, SendHandle* handle_out = nullptr) noexcept;
+
+/**
+ * @brief Ask a device to stream StatusUpdate every period_ms for lease_ms.
+ * 
+ * The device answers with SubscribeAck carrying the granted values. Send again
+ * before the lease ends to keep the stream; period_ms = 0 unsubscribes.
+ */
+bool SendStatusSubscribe(uint8_t device_id, uint16_t period_ms, uint16_t lease_ms) noexcept;
+
+/*
+ * MAC-addressed variants for running several devices side by side. dst_mac =
+ * nullptr sends to the current target (GetTargetDeviceMac), which is what the
+ * functions above do.
+ */
+bool SendConfigRequestTo(const uint8_t* dst_mac, uint8_t device_id) noexcept;
+bool SendConfigSetTo(const uint8_t* dst_mac, uint8_t device_id, const void* config_data, size_t config_len,
+                     SendHandle* handle_out = nullptr) noexcept;
+bool SendConfigFieldsTo(const uint8_t* dst_mac, uint8_t device_id, const void* records, size_t records_len,
+                        SendHandle* handle_out = nullptr) noexcept;
+// SendCommandTo(BROADCAST_MAC, ...) is sent once without retransmission
+bool SendCommandTo(const uint8_t* dst_mac, uint8_t device_id, uint8_t command_id,
+                   const void* payload, size_t payload_len,
+                   TxPriority priority = TxPriority::Control, SendHandle* handle_out = nullptr) noexcept;
+bool SendStatusSubscribeTo(const uint8_t* dst_mac, uint8_t device_id,
+                           uint16_t period_ms, uint16_t lease_ms) noexcept;
+// Best-effort: a lost ack only keeps the device on its older reference
+bool SendStatusCompactAckTo(const uint8_t* dst_mac, uint8_t device_id,
+                            const StatusCompactAckPayload& ack) noexcept;
+
+/**
+ * @brief Send a message of up to MAX_MESSAGE_SIZE_ bytes.
+ *
+ * Messages that fit one frame are sent as usual. Larger ones are split into
+ * Fragment frames, each delivered reliably (acked with FragmentAck), and
+ * require a peer that advertised CAP_FRAGMENTATION_. All fragments are
+ * queued at once, each with a reserved reliable slot: the call fails, queueing
+ * nothing, if the priority's TX queue or the reliable table lacks room for all.
+ *
+ * @param dst_mac nullptr for the current target; broadcast is not allowed
+ * @param priority A class whose queue holds MAX_FRAGMENTS_ (Control or Bulk)
+ * @param handle_out Optional; receives the handle of the last fragment
+ */
+bool SendLargeMessageTo(const uint8_t* dst_mac, uint8_t device_id, MsgType type,
+                        const void* data, size_t len, TxPriority priority = TxPriority::Bulk,
+                        SendHandle* handle_out = nullptr) noexcept;
+
+/**
+ * @brief Register the receiver of reassembled messages. Pass nullptr to unregister.
+ */
+void SetLargeMessageCallback(LargeMessageCallback callback) noexcept;
+
+FragmentStats GetFragmentStats() noexcept;
+
+// ============================================================================
+// BULK TRANSFER (used by BulkTransfer)
+// ============================================================================
+
+/// Receives BulkStart/BulkData/BulkAck from approved peers, in the receive task
+using BulkFrameHandler = void (*)(const uint8_t src_mac[6], MsgType type, const uint8_t* payload, size_t len);
+
+void SetBulkFrameHandler(BulkFrameHandler handler) noexcept;
+
+/**
+ * @brief Queue one bulk frame, best-effort: the bulk window does its own recovery.
+ * @param priority TxPriority::Bulk for data; acks and BulkStart use Polling
+ * @return false if the queue is full (try again once something drained)
+ */
+bool SendBulkFrame(const uint8_t mac[6], MsgType type, const void* payload, size_t len,
+                   TxPriority priority = TxPriority::Bulk) noexcept;
+
+// ============================================================================
+// TIME SYNCHRONIZATION (used by TimeSync)
+// ============================================================================
+
+/// Receives TimeSyncReply from approved peers, in the receive task; rx_us is t4
+using TimeSyncHandler = void (*)(const uint8_t src_mac[6], const TimeSyncPayload& reply, int64_t rx_us);
+
+void SetTimeSyncHandler(TimeSyncHandler handler) noexcept;
+
+/**
+ * @brief Queue a TimeSync request; t1 is stamped by the TX task as it sends.
+ */
+bool SendTimeSync(const uint8_t mac[6]) noexcept;
+
+/**
+ * @brief Session snapshot for one approved peer.
+ * @return false if the MAC is not approved
+ */
+bool GetSession(const uint8_t mac[6], SessionInfo& out) noexcept;
+
+/**
+ * @brief Snapshots of every peer that has exchanged traffic, for dashboards.
+ * @return Number written to out
+ */
+size_t GetSessions(SessionInfo* out, size_t max_sessions) noexcept;
+
+/**
+ * @brief Post an event to the application queue as if it had been received.
+ * 
+ * Used by simulated (local) devices. Returns false if the queue is full.
+ */
+bool InjectLocalEvent(const ProtoEvent& event) noexcept;
+
+/**
+ * @brief Register a callback for reliable delivery outcomes.
+ * 
+ * Called from the ESP-NOW protocol tasks for every delivered or failed reliable
+ * message. Failures are additionally posted to the event queue as
+ * MsgType::DeliveryFailed. Pass nullptr to unregister.
+ */
+void SetDeliveryCallback(DeliveryCallback callback) noexcept;
+
+/**
+ * @brief Get a snapshot of the reliable delivery counters.
+ */
+ReliabilityStats GetReliabilityStats() noexcept;
+
+/**
+ * @brief Hold slots in the reliable table for messages about to be queued.
+ *
+ * A reliable message that finds the table full goes out best-effort. Reserving
+ * first guarantees that the next count messages of this type to mac are
+ * tracked: other traffic cannot take the slots. A reservation not claimed
+ * within RELIABLE_RESERVE_MS_ lapses.
+ * @return false, reserving nothing, if fewer than count slots are free
+ */
+bool ReserveReliable(const uint8_t mac[6], MsgType type, uint8_t count) noexcept;
+
+/**
+ * @brief Give back reserved slots whose messages could not be queued.
+ */
+void ReleaseReliable(const uint8_t mac[6], MsgType type, uint8_t count) noexcept;
+
+/**
+ * @brief Current state of a send handle (non-blocking).
+ */
+SendStatus GetSendStatus(SendHandle handle) noexcept;
+
+/**
+ * @brief Block until the send callback for a handle fires.
+ * 
+ * Must not be called from the Wi-Fi task or from a SendCompleteCallback.
+ * 
+ * @param handle Handle returned by a send function
+ * @param timeout_ms Maximum time to wait
+ * @param out Optional; receives the completion record on Success/Failed
+ * @return Final status, SendStatus::Timeout if the callback did not fire in time
+ */
+SendStatus WaitSendComplete(SendHandle handle, uint32_t timeout_ms, SendCompletion* out = nullptr) noexcept;
+
+/**
+ * @brief Register a callback for every send completion.
+ * 
+ * Runs in the Wi-Fi task (in the sending task when esp_now_send itself fails):
+ * keep it short and never block. Pass nullptr to unregister.
+ */
+void SetSendCompleteCallback(SendCompleteCallback callback) noexcept;
+
+/**
+ * @brief Enable or disable frame aggregation towards a peer.
+ * 
+ * Off by default so v1-only peers never see an Aggregate frame. Enabled
+ * automatically for a peer once it sends us an Aggregate frame.
+ */
+void SetAggregation(const uint8_t mac[6], bool enabled) noexcept;
+
+/**
+ * @brief Set how long the TX task waits for more messages before flushing a batch.
+ *
+ * Only batches that already hold more than one message wait; anything above 0
+ * trades that much latency for fuller frames.
+ */
+void SetAggregationFlushMs(uint32_t flush_ms) noexcept;
+
+AggregationStats GetAggregationStats() noexcept;
+
+/**
+ * @brief Get TX latency histogram and send counters for a peer.
+ * @return false if no frame has been sent to that MAC yet
+ */
+bool GetTxLinkStats(const uint8_t mac[6], TxLinkStats& out) noexcept;
+
+/**
+ * @brief RSSI, loss and RTT for an approved peer.
+ * @return false if the MAC is not approved
+ */
+bool GetLinkStats(const uint8_t mac[6], LinkStats& out) noexcept;
+
+// ============================================================================
+// CHANNEL CONTROL (used by ChannelManager)
+// ============================================================================
+
+uint8_t GetChannel() noexcept;
+
+/**
+ * @brief Move the controller's radio. Peers are registered on "current channel",
+ *        so they follow without re-adding.
+ */
+bool SetChannel(uint8_t channel) noexcept;
+
+/**
+ * @brief Ask a peer to change channel (reliable, acked with ChannelSwitchAck).
+ */
+bool SendChannelSwitch(const uint8_t mac[6], uint8_t channel, uint16_t switch_delay_ms,
+                       uint16_t rollback_ms) noexcept;
+
+/**
+ * @brief Commit a peer to a channel (ChannelSwitch, no delay or rollback) and
+ *        wait for its ChannelSwitchAck. Sent once; the caller retries. One caller at a time.
+ * @return false if no ack arrived within timeout_ms
+ */
+bool CommitChannelSwitch(const uint8_t mac[6], uint8_t channel, uint32_t timeout_ms) noexcept;
+
+/**
+ * @brief Send a ChannelProbe and wait for its ChannelProbeAck. One caller at a time.
+ * @param rtt_us Receives the round trip on success
+ * @return false on timeout
  */
-bool SendCommand(uint8_t device_id, uint8_t command_id, const void* payload, size_t payload_len) noexcept;
+bool ProbePeer(const uint8_t mac[6], uint32_t timeout_ms, uint32_t& rtt_us) noexcept;
 
 // ============================================================================
 // PAIRING FUNCTIONS
@@ -149,6 +870,24 @@ bool SendCommand(uint8_t device_id, uint8_t command_id, const void* payload, siz
  */
 bool StartPairing() noexcept;
 
+/**
+ * @brief Pair every device that answers one PairingRequest (production line setup).
+ *
+ * Broadcasts a single request and collects every responder that passes the
+ * HMAC check for window_ms, then confirms and approves them in batches of
+ * PAIRING_CONFIRM_BATCH_ from a background task. GetPairingState() reports
+ * Sweeping, Confirming, then Complete (at least one paired) or Failed.
+ *
+ * @return false if pairing is already in progress or the request was not sent
+ */
+bool StartPairingSweep(uint32_t window_ms = PAIRING_SWEEP_WINDOW_MS_) noexcept;
+
+/**
+ * @brief Counts and pairing rate of the last sweep.
+ * @return false while a sweep is running (or before the first one)
+ */
+bool GetPairingSweepResult(PairingSweepResult& out) noexcept;
+
 /**
  * @brief Cancel an in-progress pairing attempt.
  */
@@ -179,11 +918,32 @@ bool AddApprovedPeer(const uint8_t mac[6], DeviceType type, const char* name) no
  */
 bool RemoveApprovedPeer(const uint8_t mac[6]) noexcept;
 
+/**
+ * @brief Current ESP-NOW driver registration of a peer.
+ *
+ * The driver holds fewer peers than may be approved, so peers without a link
+ * key are registered when something is sent to them and evicted least recently
+ * used. Per-peer driver settings (PHY rate) are lost with each eviction.
+ * @return Id that changes whenever the peer is registered again, 0 if not registered
+ */
+uint32_t GetDriverPeerGeneration(const uint8_t mac[6]) noexcept;
+
+/**
+ * @brief The peer paired with a link key, so the radio encrypts its unicast traffic.
+ */
+bool IsPeerEncrypted(const uint8_t mac[6]) noexcept;
+
 /**
  * @brief Get the number of approved peers.
  */
 size_t GetApprovedPeerCount() noexcept;
 
+/**
+ * @brief Copy the approved peers of one type, e.g. every FatigueTester for device selection.
+ * @return Number written to out
+ */
+size_t GetApprovedPeersOfType(DeviceType type, ApprovedPeer* out, size_t max_count) noexcept;
+
 /**
  * @brief Get the MAC of the active/target device.
  * 
@@ -194,23 +954,4 @@ size_t GetApprovedPeerCount() noexcept;
  */
 bool GetTargetDeviceMac(uint8_t mac_out[6]) noexcept;
 
-// ============================================================================
-// CRC FUNCTION
-// ============================================================================
-
-inline uint16_t crc16_ccitt(const uint8_t* data, size_t len) noexcept
-{
-    uint16_t crc = 0xFFFF;
-    for (size_t i = 0; i < len; ++i) {
-        crc ^= (uint16_t)data[i] << 8;
-        for (int j = 0; j < 8; ++j) {
-            if (crc & 0x8000)
-                crc = (crc << 1) ^ CRC16_POLYNOMIAL_;
-            else
-                crc <<= 1;
-        }
-    }
-    return crc;
-}
-
 } // namespace espnow
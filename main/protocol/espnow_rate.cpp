@@ -0,0 +1,311 @@
+/**
+ * @file espnow_rate.cpp
+ * @brief Per-peer PHY rate selection, including long-range mode
+ */
+
+#include "espnow_rate.hpp"
+#include "espnow_protocol.hpp"
+#include "esp_now.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstring>
+
+static const char* TAG = "RateControl";
+
+namespace {
+
+struct RateConfig {
+    wifi_phy_mode_t phymode;
+    wifi_phy_rate_t rate;
+};
+
+constexpr RateConfig RATE_CONFIGS[static_cast<size_t>(RateControl::PhyRate::Count)] = {
+    { WIFI_PHY_MODE_LR,  WIFI_PHY_RATE_LORA_250K },
+    { WIFI_PHY_MODE_LR,  WIFI_PHY_RATE_LORA_500K },
+    { WIFI_PHY_MODE_11B, WIFI_PHY_RATE_1M_L },
+    { WIFI_PHY_MODE_11G, WIFI_PHY_RATE_6M },
+    { WIFI_PHY_MODE_11G, WIFI_PHY_RATE_12M },
+    { WIFI_PHY_MODE_11G, WIFI_PHY_RATE_24M },
+};
+
+const char* RATE_NAMES[static_cast<size_t>(RateControl::PhyRate::Count)] = {
+    "LR 250k", "LR 500k", "1M", "6M", "12M", "24M",
+};
+
+bool espnowSetRate(const uint8_t mac[6], RateControl::PhyRate rate)
+{
+    const RateConfig& cfg = RATE_CONFIGS[static_cast<size_t>(rate)];
+    esp_now_rate_config_t config{};
+    config.phymode = cfg.phymode;
+    config.rate = cfg.rate;
+    config.ersu = false;
+    config.dcm = false;
+    esp_err_t err = esp_now_set_peer_rate_config(mac, &config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_now_set_peer_rate_config failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+const RateControl::Radio ESPNOW_RADIO = { espnowSetRate };
+
+/// A tracked peer and the driver counters at the end of its last window
+struct Entry {
+    bool     used;
+    bool     seen;              ///< Still has a session this round
+    uint8_t  mac[6];
+    RateControl::PeerRate state;
+    uint32_t tx_frames;
+    uint32_t tx_failures;
+    uint32_t changes;
+    uint32_t driver_generation; ///< Driver registration the rate was set on
+};
+
+const RateControl::Radio* s_radio = &ESPNOW_RADIO;
+Entry s_entries[RateControl::MAX_PEERS_] = {};
+espnow::SessionInfo s_sessions[RateControl::MAX_PEERS_];   // Service() snapshot, too large for the UI stack
+int64_t s_last_eval_us = 0;
+bool s_enabled = true;
+
+RateControl::PhyRate shift(RateControl::PhyRate rate, int delta) noexcept
+{
+    return static_cast<RateControl::PhyRate>(static_cast<int>(rate) + delta);
+}
+
+int8_t minRssi(RateControl::PhyRate rate) noexcept
+{
+    return RateControl::RATE_MIN_RSSI_[static_cast<size_t>(rate)];
+}
+
+Entry* findEntry(const uint8_t mac[6], bool create) noexcept
+{
+    Entry* free_entry = nullptr;
+    for (auto& entry : s_entries) {
+        if (entry.used && MacEquals(entry.mac, mac)) {
+            return &entry;
+        }
+        if (!entry.used && !free_entry) {
+            free_entry = &entry;
+        }
+    }
+    if (!create || !free_entry) {
+        return nullptr;
+    }
+    *free_entry = Entry{};
+    free_entry->used = true;
+    std::memcpy(free_entry->mac, mac, 6);
+    free_entry->state = RateControl::InitialState();
+
+    // Start the first window from the counters as they are now
+    espnow::LinkStats stats{};
+    if (espnow::GetLinkStats(mac, stats)) {
+        free_entry->tx_frames = stats.tx_frames;
+        free_entry->tx_failures = stats.tx_failures;
+    }
+    return free_entry;
+}
+
+/// Commit the policy's next state; a rate the radio refused is not recorded.
+void applyState(Entry& entry, const RateControl::PeerRate& next) noexcept
+{
+    RateControl::PhyRate old_rate = entry.state.rate;
+    RateControl::PhyRate rate = next.rate;
+    entry.state = next;
+
+    // An evicted and re-registered peer is back at the driver default
+    uint32_t generation = espnow::GetDriverPeerGeneration(entry.mac);
+    if (rate == old_rate) {
+        if (generation != 0 && generation != entry.driver_generation && rate != RateControl::DEFAULT_RATE_ &&
+            s_radio->set_rate(entry.mac, rate)) {
+            entry.driver_generation = generation;
+        }
+        return;
+    }
+    if (!s_radio->set_rate(entry.mac, rate)) {
+        entry.state.rate = old_rate;
+        entry.state.probing = false;
+        return;
+    }
+    entry.changes++;
+    entry.driver_generation = generation;
+    ESP_LOGI(TAG, "%02X:%02X:%02X:%02X:%02X:%02X %s -> %s",
+             entry.mac[0], entry.mac[1], entry.mac[2], entry.mac[3], entry.mac[4], entry.mac[5],
+             RateControl::RateName(old_rate), RateControl::RateName(rate));
+}
+
+void evaluate(Entry& entry, uint32_t elapsed_ms) noexcept
+{
+    espnow::LinkStats stats{};
+    if (!espnow::GetLinkStats(entry.mac, stats)) {
+        return;
+    }
+    espnow::PeerCapabilities caps{};
+    bool long_range = espnow::GetPeerCapabilities(entry.mac, caps) &&
+                      (caps.features & espnow::CAP_LONG_RANGE_);
+
+    RateControl::Window window{};
+    window.elapsed_ms = elapsed_ms;
+    window.frames = stats.tx_frames - entry.tx_frames;
+    window.failures = stats.tx_failures - entry.tx_failures;
+    window.has_rssi = stats.rssi_samples > 0;
+    window.rssi_avg = stats.rssi_avg;
+    window.long_range = long_range;
+    entry.tx_frames = stats.tx_frames;
+    entry.tx_failures = stats.tx_failures;
+
+    RateControl::PeerRate next = entry.state;
+    RateControl::Step(next, window);
+    applyState(entry, next);
+}
+
+} // namespace
+
+// ============================================================================
+// POLICY
+// ============================================================================
+
+RateControl::PeerRate RateControl::InitialState() noexcept
+{
+    PeerRate state{};
+    state.rate = DEFAULT_RATE_;
+    state.probing = false;
+    state.holdoff_ms = RATE_HOLDOFF_MIN_MS_;
+    state.holdoff_left_ms = 0;
+    return state;
+}
+
+RateControl::PhyRate RateControl::Step(PeerRate& state, const Window& window) noexcept
+{
+    const PhyRate floor = window.long_range ? PhyRate::Lr250k : PhyRate::Mbps1;
+    const PhyRate top = shift(PhyRate::Count, -1);
+
+    state.holdoff_left_ms = (state.holdoff_left_ms > window.elapsed_ms)
+                          ? state.holdoff_left_ms - window.elapsed_ms : 0;
+
+    if (state.rate < floor) {
+        // LR is no longer allowed (capabilities changed): back to the lowest normal rate
+        state.rate = floor;
+        state.probing = false;
+        return state.rate;
+    }
+
+    if (window.frames < RATE_MIN_FRAMES_) {
+        // Too little traffic to judge delivery: only follow a clearly falling RSSI
+        if (window.has_rssi && state.rate > floor &&
+            window.rssi_avg < minRssi(state.rate) - RATE_RSSI_HYSTERESIS_) {
+            state.rate = shift(state.rate, -1);
+            state.probing = false;
+        }
+        return state.rate;
+    }
+
+    uint32_t delivered = window.frames - (window.failures > window.frames ? window.frames : window.failures);
+    uint32_t permille = delivered * 1000 / window.frames;
+
+    if (permille < RATE_DOWN_PERMILLE_) {
+        if (state.probing) {
+            // The step up did not hold: wait longer before the next attempt
+            state.holdoff_left_ms = state.holdoff_ms;
+            state.holdoff_ms = (state.holdoff_ms * 2 > RATE_HOLDOFF_MAX_MS_)
+                             ? RATE_HOLDOFF_MAX_MS_ : state.holdoff_ms * 2;
+        }
+        state.probing = false;
+        if (state.rate > floor) {
+            state.rate = shift(state.rate, -1);
+        }
+        return state.rate;
+    }
+
+    if (state.probing) {
+        state.probing = false;
+        state.holdoff_ms = RATE_HOLDOFF_MIN_MS_;
+    }
+
+    if (permille >= RATE_UP_PERMILLE_ && state.holdoff_left_ms == 0 && state.rate < top &&
+        (!window.has_rssi || window.rssi_avg >= minRssi(shift(state.rate, 1)))) {
+        state.rate = shift(state.rate, 1);
+        state.probing = true;
+    }
+    return state.rate;
+}
+
+// ============================================================================
+// SERVICE
+// ============================================================================
+
+void RateControl::Init(const Radio* radio) noexcept
+{
+    s_radio = radio ? radio : &ESPNOW_RADIO;
+    s_last_eval_us = esp_timer_get_time();
+}
+
+void RateControl::Service() noexcept
+{
+    if (!s_enabled) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    uint32_t elapsed_ms = static_cast<uint32_t>((now_us - s_last_eval_us) / 1000);
+    if (elapsed_ms < RATE_EVAL_MS_) {
+        return;
+    }
+    s_last_eval_us = now_us;
+
+    size_t count = espnow::GetSessions(s_sessions, MAX_PEERS_);
+
+    for (auto& entry : s_entries) {
+        entry.seen = false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        Entry* entry = findEntry(s_sessions[i].mac, true);
+        if (!entry) {
+            continue;
+        }
+        entry->seen = true;
+        evaluate(*entry, elapsed_ms);
+    }
+    // Revoked peers: their ESP-NOW registration (and rate) is gone with them
+    for (auto& entry : s_entries) {
+        if (entry.used && !entry.seen) {
+            entry.used = false;
+        }
+    }
+}
+
+void RateControl::SetEnabled(bool enabled) noexcept
+{
+    if (enabled == s_enabled) {
+        return;
+    }
+    s_enabled = enabled;
+    if (!enabled) {
+        for (auto& entry : s_entries) {
+            if (entry.used) {
+                applyState(entry, InitialState());
+            }
+        }
+    }
+    s_last_eval_us = esp_timer_get_time();
+}
+
+size_t RateControl::GetRates(PeerReport* out, size_t max_count) noexcept
+{
+    size_t count = 0;
+    for (const auto& entry : s_entries) {
+        if (!entry.used || count >= max_count) {
+            continue;
+        }
+        std::memcpy(out[count].mac, entry.mac, 6);
+        out[count].rate = entry.state.rate;
+        out[count].changes = entry.changes;
+        count++;
+    }
+    return count;
+}
+
+const char* RateControl::RateName(PhyRate rate) noexcept
+{
+    size_t index = static_cast<size_t>(rate);
+    return index < static_cast<size_t>(PhyRate::Count) ? RATE_NAMES[index] : "?";
+}
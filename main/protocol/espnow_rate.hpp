@@ -0,0 +1,111 @@
+/**
+ * @file espnow_rate.hpp
+ * @brief Per-peer PHY rate selection, including long-range mode
+ *
+ * Every peer starts at the ESP-NOW default (802.11b 1 Mbps). Each evaluation
+ * window the measured MAC-level delivery ratio and RSSI of a peer move it
+ * along a ladder: up one rung when delivery is clean and the RSSI supports
+ * the next rate, down one rung when delivery drops. A step up that fails in
+ * the next window is undone and further steps up are held off for twice as
+ * long (up to RATE_HOLDOFF_MAX_MS_), so a marginal link does not oscillate.
+ * The two long-range (LR) rungs are only used for peers that advertise
+ * CAP_LONG_RANGE_, since both ends need WIFI_PROTOCOL_LR enabled.
+ *
+ * The rate is applied through a Radio table so the policy can run against a
+ * fake radio on the host; Init() without one uses esp_now_set_peer_rate_config.
+ * All functions run on the UI task.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "espnow_security.hpp"
+
+namespace RateControl {
+
+enum class PhyRate : uint8_t {
+    Lr250k,     ///< Long range, 250 kbps
+    Lr500k,     ///< Long range, 500 kbps
+    Mbps1,      ///< 802.11b 1 Mbps (ESP-NOW default)
+    Mbps6,      ///< 802.11g OFDM
+    Mbps12,
+    Mbps24,
+    Count,
+};
+
+static constexpr PhyRate  DEFAULT_RATE_ = PhyRate::Mbps1;
+static constexpr uint32_t RATE_EVAL_MS_ = 2000;
+static constexpr uint32_t RATE_MIN_FRAMES_ = 8;         ///< Frames a window needs before delivery counts
+static constexpr uint32_t RATE_UP_PERMILLE_ = 980;      ///< Delivery needed to try the next rate
+static constexpr uint32_t RATE_DOWN_PERMILLE_ = 900;    ///< Delivery below this drops a rate
+static constexpr int8_t   RATE_RSSI_HYSTERESIS_ = 5;    ///< dB below a rung's floor before an idle peer drops
+static constexpr uint32_t RATE_HOLDOFF_MIN_MS_ = 4000;
+static constexpr uint32_t RATE_HOLDOFF_MAX_MS_ = 64000;
+static constexpr size_t   MAX_PEERS_ = PEER_SLOTS;   ///< Every approved peer is tracked
+
+/// Weakest average RSSI (dBm) at which each rung is worth trying
+static constexpr int8_t RATE_MIN_RSSI_[static_cast<size_t>(PhyRate::Count)] = {
+    -128, -95, -88, -82, -79, -74,
+};
+
+struct Radio {
+    bool (*set_rate)(const uint8_t mac[6], PhyRate rate);
+};
+
+/// Per-peer policy state
+struct PeerRate {
+    PhyRate  rate;
+    bool     probing;           ///< Last change was a step up that has not been confirmed yet
+    uint32_t holdoff_ms;        ///< Next holdoff after a failed step up
+    uint32_t holdoff_left_ms;   ///< No step up until this runs out
+};
+
+/// What one evaluation window measured for a peer
+struct Window {
+    uint32_t elapsed_ms;
+    uint32_t frames;            ///< Frames completed by the driver in the window
+    uint32_t failures;          ///< Of those, not acked at the MAC layer
+    bool     has_rssi;
+    int8_t   rssi_avg;
+    bool     long_range;        ///< Peer may use the LR rungs
+};
+
+struct PeerReport {
+    uint8_t  mac[6];
+    PhyRate  rate;
+    uint32_t changes;           ///< Rate changes applied since the peer was first seen
+};
+
+/**
+ * @brief Fresh state at DEFAULT_RATE_.
+ */
+PeerRate InitialState() noexcept;
+
+/**
+ * @brief Advance one peer's policy by one window (pure, no radio access).
+ * @return The rate the peer should use from now on
+ */
+PhyRate Step(PeerRate& state, const Window& window) noexcept;
+
+/**
+ * @param radio nullptr for the ESP-NOW peer rate API; must outlive the policy
+ */
+void Init(const Radio* radio = nullptr) noexcept;
+
+/**
+ * @brief Evaluate every approved peer once per RATE_EVAL_MS_ and apply changes.
+ */
+void Service() noexcept;
+
+void SetEnabled(bool enabled) noexcept;
+
+/**
+ * @brief Current rate of each tracked peer.
+ * @return Number of entries written
+ */
+size_t GetRates(PeerReport* out, size_t max_count) noexcept;
+
+const char* RateName(PhyRate rate) noexcept;
+
+} // namespace RateControl
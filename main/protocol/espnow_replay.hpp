@@ -0,0 +1,109 @@
+/**
+ * @file espnow_replay.hpp
+ * @brief Per-peer sliding replay window over extended message ids
+ *
+ * Header ids are 8 bits. Each received id is extended to the 32-bit sequence
+ * number nearest the newest one accepted (within +-128), and a 64-bit bitmap
+ * remembers which of the last 64 sequence numbers arrived. A frame is
+ * accepted once: ahead of the window it slides the window (the ids it
+ * skipped count as lost), inside it fills its bit (a late, reordered frame),
+ * and a set bit or anything older than the window is rejected. This is the
+ * anti-replay scheme of IPsec (RFC 4303, 3.4.3) on a sequence space rebuilt
+ * from 8-bit ids.
+ *
+ * Eight bits cannot tell a frame 128-255 ids behind from one 1-128 ahead.
+ * A jump of more than SIZE_ is therefore held back until a second frame
+ * lands just after it, so a single old frame from 128-191 ids back cannot
+ * move the window. Frames 192-255 back read as at most 64 ahead and are
+ * accepted: the window only protects the last 128 ids.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace espnow {
+
+class ReplayWindow {
+public:
+    static constexpr uint32_t SIZE_ = 64;
+
+    enum class Verdict : uint8_t {
+        Accept,
+        Duplicate,  ///< Inside the window, already seen
+        Stale,      ///< Older than the window
+        Unconfirmed, ///< Too far ahead to tell from an old frame; held until a successor confirms it
+    };
+
+    /**
+     * @brief Check an id and, if accepted, record it.
+     * @param lost_delta Receives the change in lost-frame count: the ids skipped
+     *                   when the window slides, -1 when a late frame fills a gap
+     */
+    Verdict Check(uint8_t id, int32_t& lost_delta) noexcept
+    {
+        lost_delta = 0;
+        if (!valid_) {
+            valid_ = true;
+            top_ = id;
+            seen_ = 1;
+            return Verdict::Accept;
+        }
+
+        int32_t delta = static_cast<int8_t>(static_cast<uint8_t>(id - static_cast<uint8_t>(top_)));
+        if (delta > 0) {
+            uint32_t shift = static_cast<uint32_t>(delta);
+            if (shift > SIZE_) {
+                // Either a burst of loss or a frame from 256 - shift ids back
+                uint32_t seq = top_ + shift;
+                bool confirmed = pending_valid_ && seq > pending_ && seq - pending_ <= SIZE_;
+                if (!confirmed) {
+                    pending_ = seq;
+                    pending_valid_ = true;
+                    return Verdict::Unconfirmed;
+                }
+            }
+            pending_valid_ = false;
+            seen_ = (shift >= SIZE_) ? 1 : (seen_ << shift) | 1;
+            top_ += shift;
+            lost_delta = static_cast<int32_t>(shift) - 1;
+            return Verdict::Accept;
+        }
+
+        uint32_t back = static_cast<uint32_t>(-delta);
+        if (back >= SIZE_ || back > top_) {
+            return Verdict::Stale;
+        }
+        uint64_t bit = uint64_t{1} << back;
+        if (seen_ & bit) {
+            return Verdict::Duplicate;
+        }
+        seen_ |= bit;
+        lost_delta = -1;
+        return Verdict::Accept;
+    }
+
+    /// Forget the window; the next id is accepted as the new start (peer restarted)
+    void Reset() noexcept
+    {
+        valid_ = false;
+        top_ = 0;
+        seen_ = 0;
+        pending_valid_ = false;
+        pending_ = 0;
+    }
+
+    bool IsValid() const noexcept { return valid_; }
+
+    /// Newest accepted sequence number (meaningful once IsValid())
+    uint32_t Top() const noexcept { return top_; }
+
+private:
+    bool     valid_ = false;
+    uint32_t top_ = 0;
+    uint64_t seen_ = 0;     ///< Bit i: sequence number top_ - i was accepted
+    bool     pending_valid_ = false;
+    uint32_t pending_ = 0;  ///< Last unconfirmed jump target
+};
+
+} // namespace espnow
@@ -12,6 +12,8 @@
  * - Explicit pairing mode required (device must be put in pairing mode)
  * - Approved peers stored in NVS for persistence
  * - All non-pairing messages validated against approved peer list
+ * - Per-peer link key derived from both pairing challenges, installed as the
+ *   ESP-NOW LMK so the radio encrypts and authenticates (CCMP) every frame
  * 
  * Backward Compatibility:
  * - Pre-configured MAC addresses (hardcoded) are always trusted
@@ -25,6 +27,7 @@
 #include <cstring>
 #include "esp_random.h"
 #include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
 
 // ============================================================================
 // PAIRING SECRET CONFIGURATION
@@ -113,8 +116,25 @@ static constexpr size_t CHALLENGE_SIZE = 8;
 /// HMAC output size (truncated SHA-256)
 static constexpr size_t HMAC_SIZE = 16;
 
+/// ESP-NOW PMK / LMK size (ESP_NOW_KEY_LEN)
+static constexpr size_t LINK_KEY_SIZE = 16;
+
+/// Encrypted peers ESP-NOW accepts (CONFIG_ESP_WIFI_ESPNOW_MAX_ENCRYPT_NUM default);
+/// further peers pair without a link key
+static constexpr size_t MAX_ENCRYPTED_PEERS = 7;
+
 /// Maximum number of approved peers to store in NVS
-static constexpr size_t MAX_APPROVED_PEERS = 4;
+static constexpr size_t MAX_APPROVED_PEERS = 64;
+
+/// Per-peer state slots: one per approved peer entry, plus the pre-configured peer
+static constexpr size_t PEER_SLOTS = MAX_APPROVED_PEERS + 1;
+
+/// Entries kept in the original fixed-size "peers" NVS blob (the v1 capacity)
+static constexpr size_t LEGACY_PEER_SLOTS = 4;
+
+/// Hash index slots (power of two, at most half full)
+static constexpr size_t PEER_INDEX_SLOTS = 128;
+static_assert((PEER_INDEX_SLOTS & (PEER_INDEX_SLOTS - 1)) == 0 && PEER_INDEX_SLOTS >= 2 * MAX_APPROVED_PEERS);
 
 /// Maximum device name length
 static constexpr size_t MAX_DEVICE_NAME_LEN = 16;
@@ -177,13 +197,18 @@ struct PairingRequestPayload {
  * @brief Pairing response payload - sent by responder (unicast).
  */
 struct PairingResponsePayload {
-    uint8_t  responder_mac[6];
+    uint8_t  responder_mac[6];              ///< Must match the frame's source address
     uint8_t  device_type;
     uint8_t  challenge[CHALLENGE_SIZE];
-    uint8_t  hmac_response[HMAC_SIZE];
+    uint8_t  hmac_response[HMAC_SIZE];      ///< ComputeResponseHmac() with PAIRING_FLAG_MAC_BOUND, else ComputePairingHmac(challenge)
     char     device_name[MAX_DEVICE_NAME_LEN];
 };
 
+/// Optional flags byte after PairingResponsePayload and PairingConfirmPayload.
+/// Older firmware sends the bare struct, which reads as no flags.
+static constexpr uint8_t PAIRING_FLAG_LINK_KEY = 0x01;  ///< Response: can install a link key; Confirm: install it now
+static constexpr uint8_t PAIRING_FLAG_MAC_BOUND = 0x02; ///< Response: hmac_response also covers responder_mac
+
 /**
  * @brief Pairing confirmation payload.
  */
@@ -217,39 +242,260 @@ struct ApprovedPeer {
 
 struct SecuritySettings {
     ApprovedPeer approved_peers[MAX_APPROVED_PEERS];
+
+    /// Open-addressed (linear probing) index by MAC into approved_peers:
+    /// entry + 1, 0 = empty. Maintained by PeerStore; never persisted.
+    uint8_t peer_index[PEER_INDEX_SLOTS];
 };
 
 // ============================================================================
 // HMAC COMPUTATION FUNCTIONS
 // ============================================================================
 
-inline void ComputePairingHmac(const uint8_t* challenge, size_t challenge_len,
-                               uint8_t out[HMAC_SIZE]) noexcept
+/// Constant-time tag comparison
+inline bool HmacEquals(const uint8_t a[HMAC_SIZE], const uint8_t b[HMAC_SIZE]) noexcept
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < HMAC_SIZE; ++i) {
+        diff |= (a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief One-shot HMAC through mbedtls_md (context setup, both key pads and
+ *        teardown on every call). Reference for HmacKeySchedule.
+ */
+inline void ComputeHmacReference(const uint8_t* key, size_t key_len, const uint8_t* data, size_t len,
+                                 uint8_t out[HMAC_SIZE]) noexcept
 {
     uint8_t full_hmac[32];
     
     mbedtls_md_context_t ctx;
     mbedtls_md_init(&ctx);
     mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
-    mbedtls_md_hmac_starts(&ctx, PAIRING_SECRET, sizeof(PAIRING_SECRET));
-    mbedtls_md_hmac_update(&ctx, challenge, challenge_len);
+    mbedtls_md_hmac_starts(&ctx, key, key_len);
+    mbedtls_md_hmac_update(&ctx, data, len);
     mbedtls_md_hmac_finish(&ctx, full_hmac);
     mbedtls_md_free(&ctx);
     
     std::memcpy(out, full_hmac, HMAC_SIZE);
 }
 
+/**
+ * @brief HMAC-SHA256 (truncated to HMAC_SIZE) with the key pads hashed once.
+ *
+ * Init() absorbs key^ipad and key^opad into two SHA-256 states. A tag then
+ * costs two state copies, the message blocks and one outer block, with no
+ * context setup and no pad blocks. The cached states are only ever cloned,
+ * so one schedule can serve several tasks at once.
+ */
+class HmacKeySchedule {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    void Init(const uint8_t* key, size_t key_len) noexcept
+    {
+        uint8_t block[BLOCK_SIZE] = {};
+        if (key_len > BLOCK_SIZE) {
+            hash(key, key_len, block);      // RFC 2104: long keys are hashed first
+        } else {
+            std::memcpy(block, key, key_len);
+        }
+
+        uint8_t pad[BLOCK_SIZE];
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) pad[i] = block[i] ^ 0x36;
+        absorb(pad, inner_);
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) pad[i] = block[i] ^ 0x5C;
+        absorb(pad, outer_);
+        std::memset(block, 0, sizeof(block));
+        std::memset(pad, 0, sizeof(pad));
+    }
+
+    /// Tag over a | b (b may be empty), e.g. a header and its payload without copying
+    void Compute(const uint8_t* a, size_t a_len, const uint8_t* b, size_t b_len,
+                 uint8_t out[HMAC_SIZE]) const noexcept
+    {
+        uint8_t digest[32];
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_clone(&ctx, &inner_);
+        mbedtls_sha256_update(&ctx, a, a_len);
+        if (b_len > 0) {
+            mbedtls_sha256_update(&ctx, b, b_len);
+        }
+        mbedtls_sha256_finish(&ctx, digest);
+
+        mbedtls_sha256_clone(&ctx, &outer_);
+        mbedtls_sha256_update(&ctx, digest, sizeof(digest));
+        mbedtls_sha256_finish(&ctx, digest);
+        mbedtls_sha256_free(&ctx);
+
+        std::memcpy(out, digest, HMAC_SIZE);
+    }
+
+    void Compute(const uint8_t* data, size_t len, uint8_t out[HMAC_SIZE]) const noexcept
+    {
+        Compute(data, len, nullptr, 0, out);
+    }
+
+    bool Verify(const uint8_t* data, size_t len, const uint8_t tag[HMAC_SIZE]) const noexcept
+    {
+        uint8_t expected[HMAC_SIZE];
+        Compute(data, len, expected);
+        return HmacEquals(expected, tag);
+    }
+
+private:
+    static void hash(const uint8_t* data, size_t len, uint8_t out[32]) noexcept
+    {
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts(&ctx, 0);
+        mbedtls_sha256_update(&ctx, data, len);
+        mbedtls_sha256_finish(&ctx, out);
+        mbedtls_sha256_free(&ctx);
+    }
+
+    /// Hash one pad block into dst. Goes through a clone so dst holds a plain
+    /// software state and no hardware SHA engine stays claimed between tags.
+    static void absorb(const uint8_t pad[BLOCK_SIZE], mbedtls_sha256_context& dst) noexcept
+    {
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts(&ctx, 0);
+        mbedtls_sha256_update(&ctx, pad, BLOCK_SIZE);
+        mbedtls_sha256_init(&dst);
+        mbedtls_sha256_clone(&dst, &ctx);
+        mbedtls_sha256_free(&ctx);
+    }
+
+    mbedtls_sha256_context inner_;
+    mbedtls_sha256_context outer_;
+};
+
+/**
+ * @brief Key schedule for PAIRING_SECRET, built on first use.
+ */
+inline const HmacKeySchedule& PairingHmacKey() noexcept
+{
+    static const HmacKeySchedule schedule = [] {
+        HmacKeySchedule s;
+        s.Init(PAIRING_SECRET, sizeof(PAIRING_SECRET));
+        return s;
+    }();
+    return schedule;
+}
+
+inline void ComputePairingHmac(const uint8_t* challenge, size_t challenge_len,
+                               uint8_t out[HMAC_SIZE]) noexcept
+{
+    PairingHmacKey().Compute(challenge, challenge_len, out);
+}
+
 inline bool VerifyPairingHmac(const uint8_t* challenge, size_t challenge_len,
                               const uint8_t received_hmac[HMAC_SIZE]) noexcept
+{
+    return PairingHmacKey().Verify(challenge, challenge_len, received_hmac);
+}
+
+/**
+ * @brief Responder's proof in a PairingResponse: HMAC over the requester's
+ *        challenge followed by the responder's MAC.
+ *
+ * The MAC is bound in so a captured response cannot be replayed from another
+ * address within the same pairing. Responders say so with PAIRING_FLAG_MAC_BOUND;
+ * older firmware signs the challenge alone (VerifyPairingHmac).
+ */
+inline void ComputeResponseHmac(const uint8_t challenge[CHALLENGE_SIZE], const uint8_t responder_mac[6],
+                                uint8_t out[HMAC_SIZE]) noexcept
+{
+    PairingHmacKey().Compute(challenge, CHALLENGE_SIZE, responder_mac, 6, out);
+}
+
+inline bool VerifyResponseHmac(const uint8_t challenge[CHALLENGE_SIZE], const uint8_t responder_mac[6],
+                               const uint8_t received_hmac[HMAC_SIZE]) noexcept
 {
     uint8_t expected[HMAC_SIZE];
-    ComputePairingHmac(challenge, challenge_len, expected);
-    
-    uint8_t diff = 0;
-    for (size_t i = 0; i < HMAC_SIZE; ++i) {
-        diff |= (expected[i] ^ received_hmac[i]);
+    ComputeResponseHmac(challenge, responder_mac, expected);
+    return HmacEquals(expected, received_hmac);
+}
+
+/**
+ * @brief Check the cached schedule against mbedtls_md HMAC, including a
+ *        multi-block message and a key longer than one block.
+ */
+inline bool HmacSelfTest() noexcept
+{
+    uint8_t message[150];
+    for (size_t i = 0; i < sizeof(message); ++i) message[i] = static_cast<uint8_t>(i * 7 + 1);
+
+    uint8_t expected[HMAC_SIZE];
+    uint8_t actual[HMAC_SIZE];
+    const size_t lengths[] = { 0, CHALLENGE_SIZE, sizeof(message) };
+    for (size_t len : lengths) {
+        ComputeHmacReference(PAIRING_SECRET, sizeof(PAIRING_SECRET), message, len, expected);
+        ComputePairingHmac(message, len, actual);
+        if (!HmacEquals(expected, actual)) {
+            return false;
+        }
     }
-    return diff == 0;
+
+    HmacKeySchedule long_key;
+    long_key.Init(message, 100);
+    ComputeHmacReference(message, 100, message + 100, 50, expected);
+    long_key.Compute(message + 100, 20, message + 120, 30, actual);
+    return HmacEquals(expected, actual);
+}
+
+// ============================================================================
+// LINK KEY DERIVATION
+// ============================================================================
+
+/// Domain labels, so derived keys never coincide with a pairing HMAC
+static constexpr char LINK_KEY_LABEL[] = "espnow-lmk-v1";
+static constexpr char PRIMARY_KEY_LABEL[] = "espnow-pmk-v1";
+
+/**
+ * @brief Per-peer ESP-NOW LMK for one pairing.
+ *
+ * HMAC-SHA256(PAIRING_SECRET, label | requester challenge | responder challenge
+ * | requester MAC | responder MAC), truncated. Both sides hold every input once
+ * the response has been verified; the challenges are fresh per pairing, so
+ * re-pairing replaces the key. Nothing secret goes over the air.
+ */
+inline void DeriveLinkKey(const uint8_t requester_challenge[CHALLENGE_SIZE],
+                          const uint8_t responder_challenge[CHALLENGE_SIZE],
+                          const uint8_t requester_mac[6], const uint8_t responder_mac[6],
+                          uint8_t out[LINK_KEY_SIZE]) noexcept
+{
+    uint8_t material[sizeof(LINK_KEY_LABEL) - 1 + 2 * CHALLENGE_SIZE + 12];
+    size_t pos = 0;
+    std::memcpy(material + pos, LINK_KEY_LABEL, sizeof(LINK_KEY_LABEL) - 1);
+    pos += sizeof(LINK_KEY_LABEL) - 1;
+    std::memcpy(material + pos, requester_challenge, CHALLENGE_SIZE);
+    pos += CHALLENGE_SIZE;
+    std::memcpy(material + pos, responder_challenge, CHALLENGE_SIZE);
+    pos += CHALLENGE_SIZE;
+    std::memcpy(material + pos, requester_mac, 6);
+    pos += 6;
+    std::memcpy(material + pos, responder_mac, 6);
+
+    static_assert(LINK_KEY_SIZE <= HMAC_SIZE, "link key is a truncated pairing HMAC");
+    uint8_t full[HMAC_SIZE];
+    ComputePairingHmac(material, sizeof(material), full);
+    std::memcpy(out, full, LINK_KEY_SIZE);
+}
+
+/**
+ * @brief Deployment-wide ESP-NOW PMK (wraps the LMKs in the driver).
+ */
+inline void DerivePrimaryKey(uint8_t out[LINK_KEY_SIZE]) noexcept
+{
+    uint8_t full[HMAC_SIZE];
+    ComputePairingHmac(reinterpret_cast<const uint8_t*>(PRIMARY_KEY_LABEL),
+                       sizeof(PRIMARY_KEY_LABEL) - 1, full);
+    std::memcpy(out, full, LINK_KEY_SIZE);
 }
 
 // ============================================================================
@@ -0,0 +1,415 @@
+/**
+ * @file espnow_time.cpp
+ * @brief Per-peer clock mapping from NTP-style TimeSync exchanges
+ */
+
+#include "espnow_time.hpp"
+#include "espnow_protocol.hpp"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstring>
+
+static const char* TAG = "TimeSync";
+
+namespace {
+
+/// A tracked peer and where it is in its rounds
+struct Entry {
+    bool     used;
+    bool     seen;              ///< Still has a connected session this pass
+    uint8_t  mac[6];
+    TimeSync::ClockEstimator clock;
+    uint8_t  sent;              ///< Requests sent this round
+    int64_t  round_start_us;    ///< Replies to earlier requests are ignored
+    int64_t  next_us;           ///< Next request or end of round
+    uint32_t rounds;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;     // Guards s_entries
+Entry s_entries[TimeSync::MAX_PEERS_] = {};
+espnow::SessionInfo s_sessions[PEER_SLOTS];     // Service() snapshot, too large for the UI stack
+size_t s_skipped = 0;                           // Time-sync peers left without an entry last pass
+
+int64_t absDiff(int64_t a, int64_t b) noexcept
+{
+    return a > b ? a - b : b - a;
+}
+
+/// Caller holds s_mux
+Entry* findEntry(const uint8_t mac[6]) noexcept
+{
+    for (auto& entry : s_entries) {
+        if (entry.used && MacEquals(entry.mac, mac)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+/// Caller holds s_mux
+Entry* createEntry(const uint8_t mac[6], int64_t now_us) noexcept
+{
+    for (auto& entry : s_entries) {
+        if (!entry.used) {
+            entry = Entry{};
+            entry.used = true;
+            std::memcpy(entry.mac, mac, 6);
+            entry.next_us = now_us;
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+/// Receive task: one exchange of a peer's current round completed.
+void onReply(const uint8_t src_mac[6], const espnow::TimeSyncPayload& reply, int64_t rx_us)
+{
+    TimeSync::Exchange x{ reply.t1_us, reply.t2_us, reply.t3_us, rx_us };
+    taskENTER_CRITICAL(&s_mux);
+    Entry* entry = findEntry(src_mac);
+    if (entry && entry->sent > 0 && reply.t1_us >= entry->round_start_us && reply.t1_us <= rx_us) {
+        entry->clock.AddExchange(x);
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+/// UI task: send the next request of a due peer, or close its round.
+/// @return false if the peer has no entry and every entry is taken
+bool servicePeer(const uint8_t mac[6], int64_t now_us) noexcept
+{
+    taskENTER_CRITICAL(&s_mux);
+    Entry* entry = findEntry(mac);
+    if (!entry) {
+        entry = createEntry(mac, now_us);
+    }
+    if (!entry) {
+        taskEXIT_CRITICAL(&s_mux);
+        return false;
+    }
+    entry->seen = true;
+    if (now_us < entry->next_us) {
+        taskEXIT_CRITICAL(&s_mux);
+        return true;
+    }
+
+    if (entry->sent >= TimeSync::BURST_) {
+        // The fit is double precision, in software on this chip: run it on a copy
+        // outside the spinlock. sent = 0 closes the round, so late replies are dropped.
+        TimeSync::ClockEstimator clock = entry->clock;
+        entry->sent = 0;
+        taskEXIT_CRITICAL(&s_mux);
+
+        bool was_valid = clock.Valid();
+        uint32_t resets = clock.Resets();
+        clock.EndRound();
+        bool drift_known = clock.DriftKnown();
+        bool now_valid = clock.Valid();
+        bool reset = clock.Resets() != resets;
+        uint32_t error_us = clock.ErrorBoundUs();
+
+        taskENTER_CRITICAL(&s_mux);
+        entry = findEntry(mac);
+        if (entry) {
+            entry->clock = clock;
+            entry->rounds++;
+            entry->next_us = now_us + static_cast<int64_t>(drift_known ? TimeSync::ROUND_INTERVAL_MS_
+                                                                       : TimeSync::FAST_INTERVAL_MS_) * 1000;
+        }
+        taskEXIT_CRITICAL(&s_mux);
+
+        if (reset) {
+            ESP_LOGW(TAG, "%02X:%02X:%02X:%02X:%02X:%02X clock jumped, mapping restarted",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        } else if (now_valid && !was_valid) {
+            ESP_LOGI(TAG, "%02X:%02X:%02X:%02X:%02X:%02X synchronized (+-%lu us)",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], static_cast<unsigned long>(error_us));
+        }
+        return true;
+    }
+
+    if (entry->sent == 0) {
+        entry->round_start_us = now_us;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+
+    if (!espnow::SendTimeSync(mac)) {
+        return true;     // TX queue full: try again on the next call
+    }
+
+    taskENTER_CRITICAL(&s_mux);
+    entry = findEntry(mac);
+    if (entry && ++entry->sent >= TimeSync::BURST_) {
+        entry->next_us = now_us + static_cast<int64_t>(TimeSync::REPLY_WAIT_MS_) * 1000;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+} // namespace
+
+// ============================================================================
+// ESTIMATOR
+// ============================================================================
+
+bool TimeSync::ClockEstimator::AddExchange(const Exchange& x) noexcept
+{
+    int64_t rtt_us = (x.t4_us - x.t1_us) - (x.t3_us - x.t2_us);
+    if (x.t4_us < x.t1_us || x.t3_us < x.t2_us || rtt_us < 0 || rtt_us > static_cast<int64_t>(MAX_RTT_US_)) {
+        return false;
+    }
+    Point point{};
+    point.device_us = x.t2_us + (x.t3_us - x.t2_us) / 2;
+    point.offset_us = ((x.t2_us - x.t1_us) + (x.t3_us - x.t4_us)) / 2;
+    point.rtt_us = static_cast<uint32_t>(rtt_us);
+    if (count_ > 0 && point.device_us < points_[(head_ + HISTORY_ - 1) % HISTORY_].device_us) {
+        round_backwards_ = true;
+    }
+    if (!round_has_ || point.rtt_us < round_best_.rtt_us) {
+        round_best_ = point;
+        round_has_ = true;
+    }
+    return true;
+}
+
+bool TimeSync::ClockEstimator::EndRound() noexcept
+{
+    // Device time going backwards means the device rebooted, whatever the round trip
+    bool backwards = round_backwards_;
+    round_backwards_ = false;
+    if (!round_has_) {
+        if (backwards) {
+            restart();
+        }
+        return false;
+    }
+    round_has_ = false;
+    Point point = round_best_;
+
+    // So does a point further off the line than its round trip allows: its offset
+    // is off by at most half of it, so this holds for slow exchanges too
+    if (backwards || (valid_ && absDiff(point.offset_us, offsetAt(point.device_us)) >
+                                    static_cast<int64_t>(STEP_RESET_US_ + point.rtt_us / 2))) {
+        restart();
+    }
+
+    addPoint(point);
+    fit();
+    return true;
+}
+
+void TimeSync::ClockEstimator::Reset() noexcept
+{
+    *this = ClockEstimator{};
+}
+
+void TimeSync::ClockEstimator::restart() noexcept
+{
+    uint32_t resets = resets_;
+    Reset();
+    resets_ = resets + 1;
+}
+
+void TimeSync::ClockEstimator::addPoint(const Point& point) noexcept
+{
+    points_[head_] = point;
+    head_ = static_cast<uint8_t>((head_ + 1) % HISTORY_);
+    if (count_ < HISTORY_) {
+        count_++;
+    }
+}
+
+void TimeSync::ClockEstimator::fit() noexcept
+{
+    // The oldest slot of a full ring is at head_; of a partial one at 0
+    const uint8_t first = (count_ == HISTORY_) ? head_ : 0;
+
+    const Point* best = nullptr;
+    uint32_t rtts[HISTORY_];
+    for (uint8_t i = 0; i < count_; ++i) {
+        const Point& p = points_[(first + i) % HISTORY_];
+        if (!best || p.rtt_us < best->rtt_us) {
+            best = &p;
+        }
+        rtts[i] = p.rtt_us;
+    }
+
+    // Weighted least squares, relative to the best point so the sums stay small.
+    // A point loses weight with the square of its extra round trip over the best.
+    // The scale grows with the best round trip, since a slow link is noisy anyway,
+    // and always reaches the DRIFT_MIN_POINTS_-th fastest point: on a jittery link
+    // one lucky round would otherwise leave no other point to fit a slope with.
+    uint32_t scale_us = best->rtt_us / 2 > RTT_SLACK_US_ ? best->rtt_us / 2 : RTT_SLACK_US_;
+    if (count_ >= DRIFT_MIN_POINTS_) {
+        std::nth_element(rtts, rtts + DRIFT_MIN_POINTS_ - 1, rtts + count_);
+        if (rtts[DRIFT_MIN_POINTS_ - 1] - best->rtt_us > scale_us) {
+            scale_us = rtts[DRIFT_MIN_POINTS_ - 1] - best->rtt_us;
+        }
+    }
+    double slack = static_cast<double>(scale_us);
+    double sum_w = 0, sum_x = 0, sum_y = 0;
+    int64_t min_x = 0, max_x = 0;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        const Point& p = points_[(first + i) % HISTORY_];
+        double excess = static_cast<double>(p.rtt_us - best->rtt_us) / slack;
+        double w = 1.0 / (1.0 + excess * excess);
+        int64_t x = p.device_us - best->device_us;
+        sum_w += w;
+        sum_x += w * static_cast<double>(x);
+        sum_y += w * static_cast<double>(p.offset_us - best->offset_us);
+        if (excess <= 2.0) {
+            if (n == 0 || x < min_x) min_x = x;
+            if (n == 0 || x > max_x) max_x = x;
+            n++;
+        }
+    }
+
+    ref_device_us_ = best->device_us;
+    ref_offset_us_ = best->offset_us;
+    if (n >= DRIFT_MIN_POINTS_ && max_x - min_x >= static_cast<int64_t>(DRIFT_MIN_SPAN_MS_) * 1000) {
+        double mean_x = sum_x / sum_w;
+        double mean_y = sum_y / sum_w;
+        double sxx = 0, sxy = 0;
+        for (uint8_t i = 0; i < count_; ++i) {
+            const Point& p = points_[(first + i) % HISTORY_];
+            double excess = static_cast<double>(p.rtt_us - best->rtt_us) / slack;
+            double w = 1.0 / (1.0 + excess * excess);
+            double dx = static_cast<double>(p.device_us - best->device_us) - mean_x;
+            double dy = static_cast<double>(p.offset_us - best->offset_us) - mean_y;
+            sxx += w * dx * dx;
+            sxy += w * dx * dy;
+        }
+        double slope = sxy / sxx;
+        if (slope > MAX_DRIFT_PPB_ * 1e-9) slope = MAX_DRIFT_PPB_ * 1e-9;
+        if (slope < -MAX_DRIFT_PPB_ * 1e-9) slope = -MAX_DRIFT_PPB_ * 1e-9;
+        drift_ppb_ = static_cast<int32_t>(slope * 1e9);
+        drift_known_ = true;
+        // The line through the weighted mean, evaluated at the best point
+        ref_offset_us_ = best->offset_us + static_cast<int64_t>(mean_y - slope * mean_x);
+    }
+    // Too few good points for a slope: keep the last drift, anchored on the best point
+
+    best_rtt_us_ = best->rtt_us;
+    valid_ = true;
+}
+
+int64_t TimeSync::ClockEstimator::offsetAt(int64_t device_us) const noexcept
+{
+    return ref_offset_us_ + (device_us - ref_device_us_) * drift_ppb_ / 1000000000;
+}
+
+int64_t TimeSync::ClockEstimator::ToController(int64_t device_us) const noexcept
+{
+    return device_us - offsetAt(device_us);
+}
+
+int64_t TimeSync::ClockEstimator::ToDevice(int64_t controller_us) const noexcept
+{
+    // The drift term moves by nanoseconds over the offset itself, so one step is exact enough
+    return controller_us + offsetAt(controller_us + ref_offset_us_);
+}
+
+int64_t TimeSync::ClockEstimator::OffsetUs(int64_t now_us) const noexcept
+{
+    return ToDevice(now_us) - now_us;
+}
+
+// ============================================================================
+// SERVICE
+// ============================================================================
+
+void TimeSync::Init() noexcept
+{
+    espnow::SetTimeSyncHandler(onReply);
+}
+
+void TimeSync::Service() noexcept
+{
+    int64_t now_us = esp_timer_get_time();
+
+    size_t count = espnow::GetSessions(s_sessions, PEER_SLOTS);
+    size_t skipped = 0;
+
+    taskENTER_CRITICAL(&s_mux);
+    for (auto& entry : s_entries) {
+        entry.seen = false;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+
+    for (size_t i = 0; i < count; ++i) {
+        espnow::PeerCapabilities caps{};
+        if (!s_sessions[i].connected || !espnow::GetPeerCapabilities(s_sessions[i].mac, caps) ||
+            !caps.Has(espnow::CAP_TIME_SYNC_)) {
+            continue;
+        }
+        if (!servicePeer(s_sessions[i].mac, now_us)) {
+            skipped++;
+        }
+    }
+    if (skipped != s_skipped) {
+        if (skipped > 0) {
+            ESP_LOGW(TAG, "%u time-sync peer(s) beyond the %u tracked are not synchronized",
+                     static_cast<unsigned>(skipped), static_cast<unsigned>(MAX_PEERS_));
+        }
+        s_skipped = skipped;
+    }
+
+    // A peer that went away may come back rebooted: start it from scratch then
+    taskENTER_CRITICAL(&s_mux);
+    for (auto& entry : s_entries) {
+        if (entry.used && !entry.seen) {
+            entry.used = false;
+        }
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+bool TimeSync::IsBusy() noexcept
+{
+    bool busy = false;
+    taskENTER_CRITICAL(&s_mux);
+    for (const auto& entry : s_entries) {
+        busy = busy || (entry.used && entry.sent > 0);
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return busy;
+}
+
+bool TimeSync::ToControllerTime(const uint8_t mac[6], int64_t device_us, int64_t& controller_us) noexcept
+{
+    bool ok = false;
+    taskENTER_CRITICAL(&s_mux);
+    Entry* entry = findEntry(mac);
+    if (entry && entry->clock.Valid()) {
+        controller_us = entry->clock.ToController(device_us);
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+size_t TimeSync::GetClocks(PeerClock* out, size_t max_count) noexcept
+{
+    int64_t now_us = esp_timer_get_time();
+    size_t count = 0;
+    taskENTER_CRITICAL(&s_mux);
+    for (const auto& entry : s_entries) {
+        if (!entry.used || count >= max_count) {
+            continue;
+        }
+        PeerClock& clock = out[count++];
+        std::memcpy(clock.mac, entry.mac, 6);
+        clock.valid = entry.clock.Valid();
+        clock.offset_us = clock.valid ? entry.clock.OffsetUs(now_us) : 0;
+        clock.drift_ppb = entry.clock.DriftPpb();
+        clock.error_us = entry.clock.ErrorBoundUs();
+        clock.rtt_us = entry.clock.BestRttUs();
+        clock.points = entry.clock.Points();
+        clock.rounds = entry.rounds;
+        clock.resets = entry.clock.Resets();
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return count;
+}
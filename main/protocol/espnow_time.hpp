@@ -0,0 +1,157 @@
+/**
+ * @file espnow_time.hpp
+ * @brief Per-peer clock mapping from NTP-style TimeSync exchanges
+ *
+ * Each exchange gives four times: t1 (controller sends), t2 (device receives),
+ * t3 (device replies), t4 (controller receives). Its round trip is
+ * (t4 - t1) - (t3 - t2) and its offset (device minus controller) is
+ * ((t2 - t1) + (t3 - t4)) / 2, off by at most half the round trip. Queueing
+ * only ever adds delay, so the fastest exchange is the most accurate: a round
+ * of BURST_ exchanges keeps only its minimum-RTT one, and the last HISTORY_
+ * round results are fitted with a line, weighted by how close their round
+ * trip is to the best. The slope is the crystal drift between the two clocks.
+ *
+ * ClockEstimator is that arithmetic alone (no radio, no clock), so it can be
+ * driven by a simulated link with injected delay on the host. Service() runs
+ * the rounds for every peer advertising CAP_TIME_SYNC_; ToControllerTime()
+ * turns a device timestamp into controller esp_timer time.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "espnow_security.hpp"
+
+namespace TimeSync {
+
+static constexpr uint8_t  BURST_ = 4;                   ///< Exchanges per round, one per Service() call
+static constexpr uint32_t REPLY_WAIT_MS_ = 200;         ///< After the last request of a round
+static constexpr uint32_t FAST_INTERVAL_MS_ = 1000;     ///< Between rounds until the drift is known (DriftKnown())
+static constexpr uint32_t ROUND_INTERVAL_MS_ = 10000;   ///< Between rounds once synchronized
+static constexpr uint8_t  HISTORY_ = 16;                ///< Round results in the fit
+static constexpr uint8_t  DRIFT_MIN_POINTS_ = 3;        ///< Fitted points before the slope is trusted
+static constexpr uint32_t DRIFT_MIN_SPAN_MS_ = 2000;    ///< Device time the fitted points must span
+static constexpr uint32_t MAX_RTT_US_ = 50000;          ///< Slower exchanges are discarded
+static constexpr uint32_t RTT_SLACK_US_ = 500;          ///< Extra round trip at which a point counts half (at least)
+static constexpr int32_t  MAX_DRIFT_PPB_ = 200000;      ///< 200 ppm; more is a bad fit, not a crystal
+static constexpr uint32_t STEP_RESET_US_ = 20000;       ///< A round this far (plus half its RTT) off the line restarts the mapping
+/// Peers with a clock mapping (each estimator keeps HISTORY_ points, so not one per
+/// PEER_SLOTS); further time-sync peers go unsynchronized and Service() logs them
+static constexpr size_t   MAX_PEERS_ = 16;
+
+/// One request/reply: t1/t4 on the controller clock, t2/t3 on the device clock
+struct Exchange {
+    int64_t t1_us;
+    int64_t t2_us;
+    int64_t t3_us;
+    int64_t t4_us;
+};
+
+class ClockEstimator {
+public:
+    /**
+     * @brief Add one exchange to the current round.
+     * @return false if it is inconsistent or slower than MAX_RTT_US_
+     */
+    bool AddExchange(const Exchange& x) noexcept;
+
+    /**
+     * @brief Close the round: its fastest exchange joins the history and the line is refitted.
+     * @return false if the round had no usable exchange
+     */
+    bool EndRound() noexcept;
+
+    /// Forget everything (the device rebooted or was re-paired)
+    void Reset() noexcept;
+
+    bool Valid() const noexcept { return valid_; }
+
+    /// Device esp_timer time to controller esp_timer time (meaningful once Valid())
+    int64_t ToController(int64_t device_us) const noexcept;
+
+    int64_t ToDevice(int64_t controller_us) const noexcept;
+
+    /// Device minus controller at controller time now_us
+    int64_t OffsetUs(int64_t now_us) const noexcept;
+
+    /// Device clock rate relative to ours, parts per billion (0 until DriftKnown())
+    int32_t DriftPpb() const noexcept { return drift_ppb_; }
+
+    /// A slope has been fitted since the last reset
+    bool DriftKnown() const noexcept { return drift_known_; }
+
+    /// Half the best fitted round trip: the offset error if the path were fully one-sided
+    uint32_t ErrorBoundUs() const noexcept { return best_rtt_us_ / 2; }
+
+    uint32_t BestRttUs() const noexcept { return best_rtt_us_; }
+    uint8_t  Points() const noexcept { return count_; }
+    uint32_t Resets() const noexcept { return resets_; }
+
+private:
+    struct Point {
+        int64_t  device_us;     ///< Device time halfway through the exchange
+        int64_t  offset_us;     ///< Device minus controller
+        uint32_t rtt_us;
+    };
+
+    void addPoint(const Point& point) noexcept;
+    void restart() noexcept;
+    void fit() noexcept;
+    int64_t offsetAt(int64_t device_us) const noexcept;
+
+    Point    round_best_{};
+    bool     round_has_ = false;
+    bool     round_backwards_ = false;  ///< An exchange of this round predates the newest point
+    Point    points_[HISTORY_] = {};    ///< Ring, newest at head_ - 1
+    uint8_t  head_ = 0;
+    uint8_t  count_ = 0;
+    bool     valid_ = false;
+    int64_t  ref_device_us_ = 0;        ///< Mapping: offset = ref_offset_us_ + drift x (device - ref)
+    int64_t  ref_offset_us_ = 0;
+    int32_t  drift_ppb_ = 0;
+    bool     drift_known_ = false;
+    uint32_t best_rtt_us_ = 0;
+    uint32_t resets_ = 0;
+};
+
+struct PeerClock {
+    uint8_t  mac[6];
+    bool     valid;
+    int64_t  offset_us;         ///< Device minus controller, now
+    int32_t  drift_ppb;
+    uint32_t error_us;          ///< ErrorBoundUs()
+    uint32_t rtt_us;            ///< Best fitted round trip
+    uint8_t  points;
+    uint32_t rounds;
+    uint32_t resets;            ///< Mapping restarted (device clock jumped)
+};
+
+/**
+ * @brief Register for TimeSyncReply. Call after espnow::Init.
+ */
+void Init() noexcept;
+
+/**
+ * @brief Send the next exchange of each due peer and close finished rounds. UI task.
+ */
+void Service() noexcept;
+
+/**
+ * @brief A round is in progress: the UI loop should call Service() again soon.
+ */
+bool IsBusy() noexcept;
+
+/**
+ * @brief Map a device timestamp to controller esp_timer time.
+ * @return false if the peer is not synchronized yet
+ */
+bool ToControllerTime(const uint8_t mac[6], int64_t device_us, int64_t& controller_us) noexcept;
+
+/**
+ * @brief Mapping state of each tracked peer.
+ * @return Number of entries written
+ */
+size_t GetClocks(PeerClock* out, size_t max_count) noexcept;
+
+} // namespace TimeSync
@@ -0,0 +1,87 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief Fixed-size log2 latency histogram for link measurements
+ *
+ * Bucket i counts samples in [2^i, 2^(i+1)) microseconds (bucket 0 also
+ * holds 0 us, the last bucket is open-ended). 20 buckets cover up to ~0.5 s
+ * at constant memory and O(1) insert, which is enough resolution for
+ * per-peer percentiles on an embedded target.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace espnow {
+
+struct LatencyHistogram {
+    static constexpr size_t BUCKETS_ = 20;
+
+    uint32_t buckets[BUCKETS_];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+
+    static constexpr size_t BucketFor(uint32_t us) noexcept
+    {
+        size_t bucket = 0;
+        while (us > 1 && bucket < BUCKETS_ - 1) {
+            us >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    /// Upper edge of a bucket in microseconds
+    static constexpr uint32_t BucketLimitUs(size_t bucket) noexcept
+    {
+        return (bucket >= BUCKETS_ - 1) ? UINT32_MAX : (2u << bucket);
+    }
+
+    void Add(uint32_t us) noexcept
+    {
+        buckets[BucketFor(us)]++;
+        if (count == 0 || us < min_us) min_us = us;
+        if (us > max_us) max_us = us;
+        sum_us += us;
+        count++;
+    }
+
+    uint32_t MeanUs() const noexcept
+    {
+        return count ? static_cast<uint32_t>(sum_us / count) : 0;
+    }
+
+    /**
+     * @brief Approximate percentile (upper edge of the bucket holding it).
+     * @param pct Percentile 0..100
+     * @return Latency bound in microseconds, clamped to the observed maximum
+     */
+    uint32_t PercentileUs(uint8_t pct) const noexcept
+    {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t target = (static_cast<uint64_t>(count) * pct + 99) / 100;
+        if (target == 0) target = 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS_; ++i) {
+            seen += buckets[i];
+            if (seen >= target) {
+                uint32_t limit = BucketLimitUs(i);
+                return (limit < max_us) ? limit : max_us;
+            }
+        }
+        return max_us;
+    }
+};
+
+static_assert(LatencyHistogram::BucketFor(0) == 0 && LatencyHistogram::BucketFor(1) == 0);
+static_assert(LatencyHistogram::BucketFor(2) == 1 && LatencyHistogram::BucketFor(3) == 1);
+static_assert(LatencyHistogram::BucketFor(1000) == 9);
+static_assert(LatencyHistogram::BucketFor(UINT32_MAX) == LatencyHistogram::BUCKETS_ - 1);
+
+} // namespace espnow
@@ -4,10 +4,12 @@
  */
 
 #include "settings.hpp"
+#include "config.hpp"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_crc.h"
+#include "esp_timer.h"
 
 static const char* TAG_SET_ = "Settings";
 
@@ -17,6 +19,14 @@ const char* NVS_NAMESPACE_ = "remote_ctrl";
 const char* KEY_BLOB_      = "cfg_blob";
 const char* KEY_CRC_       = "cfg_crc";
 
+// Write-behind state
+Settings s_persisted_{};        // Image last read from / written to NVS
+Settings s_pending_{};          // Latest settings waiting for commit
+bool     s_dirty_ = false;
+int64_t  s_last_commit_us_ = 0;  // Last commit attempt, failed ones included
+uint32_t s_commit_interval_ms_ = SETTINGS_COMMIT_INTERVAL_MS_;
+SettingsStore::Stats s_stats_{};
+
 } // namespace
 
 // Helper to validate boolean values are strictly 0 or 1
@@ -104,14 +114,22 @@ void SettingsStore::Init(Settings& s) noexcept
     }
 
     nvs_close(h);
+
+    s_persisted_ = s;
+    s_pending_ = s;
+    s_dirty_ = false;
 }
 
 void SettingsStore::Save(const Settings& s) noexcept
 {
+    // A failed attempt also waits out the commit interval before Service() retries
+    s_last_commit_us_ = esp_timer_get_time();
+
     nvs_handle_t h;
     esp_err_t err = nvs_open(NVS_NAMESPACE_, NVS_READWRITE, &h);
     if (err != ESP_OK) {
         ESP_LOGE(TAG_SET_, "Failed to open NVS for write: %s", esp_err_to_name(err));
+        s_stats_.commit_failures++;
         return;
     }
 
@@ -128,13 +146,65 @@ void SettingsStore::Save(const Settings& s) noexcept
         err = nvs_commit(h);
         if (err == ESP_OK) {
             ESP_LOGI(TAG_SET_, "Settings saved (CRC: 0x%08lx)", crc);
+            s_persisted_ = s;
+            s_dirty_ = !(s_pending_ == s);
+            s_stats_.commits++;
         } else {
             ESP_LOGE(TAG_SET_, "NVS commit failed: %s", esp_err_to_name(err));
+            s_stats_.commit_failures++;
         }
     } else {
         ESP_LOGE(TAG_SET_, "NVS write failed: %s", esp_err_to_name(err));
+        s_stats_.commit_failures++;
     }
 
     nvs_close(h);
 }
 
+void SettingsStore::Update(const Settings& s) noexcept
+{
+    s_stats_.updates++;
+
+    if (s == s_persisted_) {
+        // No real change (or changed back before the commit happened)
+        s_pending_ = s;
+        s_dirty_ = false;
+        s_stats_.commits_avoided++;
+        return;
+    }
+
+    if (s_dirty_) {
+        // Folded into the commit that is already pending
+        s_stats_.commits_avoided++;
+    }
+    s_pending_ = s;
+    s_dirty_ = true;
+}
+
+void SettingsStore::Service() noexcept
+{
+    if (!s_dirty_) {
+        return;
+    }
+    int64_t elapsed_us = esp_timer_get_time() - s_last_commit_us_;
+    if (elapsed_us >= static_cast<int64_t>(s_commit_interval_ms_) * 1000) {
+        Save(s_pending_);
+    }
+}
+
+void SettingsStore::Flush() noexcept
+{
+    if (s_dirty_) {
+        Save(s_pending_);
+    }
+}
+
+void SettingsStore::SetCommitInterval(uint32_t interval_ms) noexcept
+{
+    s_commit_interval_ms_ = interval_ms;
+}
+
+SettingsStore::Stats SettingsStore::GetStats() noexcept
+{
+    return s_stats_;
+}
@@ -40,6 +40,8 @@ struct FatigueTestSettings {
     
     // UI-only settings (not synced to device)
     uint8_t  error_severity_min = 1; // Minimum error severity to display (1=low, 2=medium, 3=high)
+
+    bool operator==(const FatigueTestSettings&) const = default;
 };
 
 /**
@@ -51,6 +53,8 @@ struct UISettings {
     uint8_t last_device_id = 0;      // Last selected device ID before sleep
     // Note: sleep timestamp is stored in RTC memory (RTC_DATA_ATTR) for persistence
     // Future UI settings can be added here (e.g., brightness, contrast, etc.)
+
+    bool operator==(const UISettings&) const = default;
 };
 
 /**
@@ -59,11 +63,53 @@ struct UISettings {
 struct Settings {
     FatigueTestSettings fatigue_test;  // Fatigue test device settings
     UISettings          ui;             // UI board settings (local only)
+
+    // Field-wise comparison (a byte compare would also see struct padding)
+    bool operator==(const Settings&) const = default;
 };
 
 namespace SettingsStore {
 
+/**
+ * @brief Write-behind counters.
+ */
+struct Stats {
+    uint32_t updates;           ///< Update() calls
+    uint32_t commits;           ///< NVS commits actually performed
+    uint32_t commits_avoided;   ///< Updates that were unchanged or coalesced into a pending commit
+    uint32_t commit_failures;   ///< Saves that failed to open, write or commit NVS (retried after the interval)
+};
+
 void Init(Settings& s) noexcept;
+
+/**
+ * @brief Write settings to NVS immediately.
+ */
 void Save(const Settings& s) noexcept;
 
+/**
+ * @brief Write-behind save: record new settings, commit later.
+ * 
+ * Compares against the last persisted image and only marks the store dirty
+ * on a real change. Dirty settings are committed by Service() at most once
+ * per SETTINGS_COMMIT_INTERVAL_MS_, or by Flush(). UI task only.
+ */
+void Update(const Settings& s) noexcept;
+
+/**
+ * @brief Commit pending settings if the commit interval has elapsed. Call periodically.
+ *        UI task only.
+ */
+void Service() noexcept;
+
+/**
+ * @brief Commit pending settings now (e.g. before deep sleep). UI task only;
+ *        other tasks go through UiController::RequestSleep().
+ */
+void Flush() noexcept;
+
+void SetCommitInterval(uint32_t interval_ms) noexcept;
+
+Stats GetStats() noexcept;
+
 } // namespace SettingsStore
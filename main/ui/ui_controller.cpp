@@ -7,9 +7,14 @@
 #include "../devices/device_registry.hpp"
 #include "../devices/device_base.hpp"
 #include "../devices/fatigue_tester.hpp"
+#include "../devices/pairing_screen.hpp"
+#include "../devices/groups_screen.hpp"
 #include "../settings.hpp"
 #include "../button.hpp"
 #include "../protocol/espnow_protocol.hpp"
+#include "../protocol/espnow_groups.hpp"
+#include "../protocol/espnow_rate.hpp"
+#include "../protocol/espnow_time.hpp"
 #include "../components/Adafruit_SH1106_ESPIDF/Adafruit_SH1106.h"
 #include "../components/EC11_Encoder/inc/ec11_encoder.hpp"
 #include "../components/Adafruit_BusIO_ESPIDF/Wire.h"
@@ -19,6 +24,7 @@
 #include "esp_sleep.h"
 #include "esp_timer.h"
 #include "esp_private/esp_clk.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <vector>
@@ -29,6 +35,10 @@ static const char* TAG_ = "UiController";
 // RTC memory to persist across deep sleep - stores RTC time when entering sleep
 RTC_DATA_ATTR static uint64_t s_sleep_rtc_time_us = 0;
 
+// Tester the device screen was bound to when entering sleep (settings keep only the device id)
+RTC_DATA_ATTR static bool s_sleep_peer_bound = false;
+RTC_DATA_ATTR static uint8_t s_sleep_peer_mac[6] = {};
+
 static Adafruit_SH1106* s_display_ = nullptr;
 static EC11Encoder* s_encoder_ = nullptr;
 
@@ -86,16 +96,40 @@ namespace {
 extern QueueHandle_t g_button_queue_;
 extern QueueHandle_t g_proto_queue_;
 
+/// Map the UI state to what the operator can see of the current device.
+static ScreenVisibility visibilityFor(UiState state) noexcept
+{
+    switch (state) {
+        case UiState::DeviceMain:      return ScreenVisibility::Main;
+        case UiState::DeviceSettings:  return ScreenVisibility::Menu;
+        case UiState::DeviceControl:
+        case UiState::Popup:           return ScreenVisibility::Control;
+        case UiState::Splash:
+        case UiState::DeviceSelection: break;
+    }
+    return ScreenVisibility::Hidden;
+}
+
 bool UiController::Init(QueueHandle_t ui_queue, Settings* settings, 
                         uint32_t* inactivity_ticks_ptr) noexcept
 {
     ui_queue_ = ui_queue;
     settings_ = settings;
     last_activity_tick_ = inactivity_ticks_ptr;
-    selected_device_id_ = 0;
+    current_device_ = nullptr;
+    open_count_ = 0;
+    choice_count_ = 0;
+    selected_choice_ = 0;
+    restore_choice_ = DeviceChoice{};
     popup_active_ = false;
     last_encoder_button_state_ = false;
     last_encoder_pos_ = 0;
+    sleep_request_ = xSemaphoreCreateBinary();
+    sleep_done_ = xSemaphoreCreateBinary();
+    sleep_pending_ = false;
+    wake_set_ = nullptr;
+    wake_set_complete_ = false;
+    encoder_stale_events_ = 0;
     
     // Initialize display first (needed for device creation)
     Adafruit_I2CDevice::setDefaultPins(OLED_SDA_PIN_, OLED_SCL_PIN_);
@@ -159,36 +193,28 @@ bool UiController::Init(QueueHandle_t ui_queue, Settings* settings,
     if (should_restore_state) {
         // Restore last state
         current_state_ = static_cast<UiState>(settings_->ui.last_ui_state);
-        selected_device_id_ = settings_->ui.last_device_id;
+        restore_choice_.device_id = settings_->ui.last_device_id;
+        restore_choice_.bound = s_sleep_peer_bound;
+        std::memcpy(restore_choice_.mac, s_sleep_peer_mac, sizeof(restore_choice_.mac));
         
         // Restore device if we were on a device screen
-        if (selected_device_id_ > 0 && 
+        if (restore_choice_.device_id > 0 && 
             (current_state_ == UiState::DeviceMain || 
              current_state_ == UiState::DeviceSettings || 
              current_state_ == UiState::DeviceControl)) {
-            current_device_ = device_registry::CreateDevice(selected_device_id_, s_display_, settings_);
-            if (!current_device_) {
-                // Device creation failed, fall back to device selection
-                current_state_ = UiState::DeviceSelection;
-                selected_device_id_ = 0;
-            }
+            // Task() creates it: devices talk to the protocol, which app_main starts after this
         } else if (current_state_ == UiState::DeviceSelection) {
-            // Restore device selection state
-            const auto& device_ids = device_registry::GetAvailableDeviceIds();
-            if (selected_device_id_ == 0 && !device_ids.empty()) {
-                selected_device_id_ = device_ids[0];
-            }
+            // Task() lists the approved testers and highlights this row again
         } else {
             // Invalid state, fall back to splash
             current_state_ = UiState::Splash;
-            selected_device_id_ = 0;
+            restore_choice_ = DeviceChoice{};
         }
         ESP_LOGI(TAG_, "Restored state: %d, device: %d", 
-                 static_cast<int>(current_state_), selected_device_id_);
+                 static_cast<int>(current_state_), restore_choice_.device_id);
     } else {
         // Long sleep, cold boot, or no saved state - show splash screen
         current_state_ = UiState::Splash;
-        selected_device_id_ = 0;
         // Clear sleep timestamp
         s_sleep_rtc_time_us = 0;
         
@@ -199,22 +225,12 @@ bool UiController::Init(QueueHandle_t ui_queue, Settings* settings,
         }
     }
     
-    // Auto-select first device if only one available (for device selection)
-    const auto& device_ids = device_registry::GetAvailableDeviceIds();
-    if (current_state_ == UiState::DeviceSelection) {
-        if (selected_device_id_ == 0) {
-            if (device_ids.size() == 1) {
-                selected_device_id_ = device_ids[0];
-            } else if (!device_ids.empty()) {
-                // Default to first device for selection (ensures something is selected)
-                selected_device_id_ = device_ids[0];
-            }
-        }
-        // Ensure encoder position is synced with selection on next render
-    }
-    
+    // A queue joins a set only while empty: app_main runs this before starting the
+    // protocol and button producers
+    createWakeSet();
+
     ESP_LOGI(TAG_, "UI Controller initialized (state: %d, device: %d)", 
-             static_cast<int>(current_state_), selected_device_id_);
+             static_cast<int>(current_state_), restore_choice_.device_id);
     return true;
 }
 
@@ -222,97 +238,269 @@ void UiController::Task(void* arg) noexcept
 {
     (void)arg;
     
+    // The protocol is up now: list the approved testers, then reopen the row or
+    // device screen restored by Init()
+    buildDeviceChoices();
+    bool restored = false;
+    for (size_t i = 0; i < choice_count_; ++i) {
+        if (sameChoice(choices_[i], restore_choice_)) {
+            selected_choice_ = i;
+            restored = true;
+            break;
+        }
+    }
+    if (current_state_ != UiState::Splash && current_state_ != UiState::DeviceSelection) {
+        if (!restored || !openSelectedDevice()) {
+            // Tester no longer approved or device creation failed, fall back to device selection
+            current_state_ = UiState::DeviceSelection;
+        }
+    }
+
     // Initial render of splash screen
     renderCurrentScreen();
     
-    // Event handling - UI queue now contains ButtonEvent directly, or we check protocol queue
-    ButtonEvent button_evt{};
-    espnow::ProtoEvent proto_evt{};
-    
-    // Initialize encoder position tracking based on current selection
+    // Set encoder position to match selection index
     if (s_encoder_ && current_state_ == UiState::DeviceSelection) {
-        const auto& device_ids = device_registry::GetAvailableDeviceIds();
-        if (!device_ids.empty() && selected_device_id_ > 0) {
-            // Find current selection index and sync encoder position
-            size_t current_idx = 0;
-            for (size_t i = 0; i < device_ids.size(); ++i) {
-                if (device_ids[i] == selected_device_id_) {
-                    current_idx = i;
-                    break;
-                }
-            }
-            // Set encoder position to match selection index
-            resetEncoderTracking(static_cast<int32_t>(current_idx));
-        }
+        resetEncoderTracking(static_cast<int32_t>(selected_choice_));
     }
     
+    TickType_t last_render_tick = 0;
+
     while (true) {
-        // Process encoder events (event-based handling for reliable navigation)
-        processEncoderEvents();
-        
-        // Check for button events from UI queue (forwarded by button_task)
-        if (xQueueReceive(ui_queue_, &button_evt, pdMS_TO_TICKS(50)) == pdTRUE) {
-            handleButton(button_evt);
-            // renderCurrentScreen() is called by transitionToState() or explicitly in handleButton
+        // Sleep until input, a protocol event, or the next render/status/service is due
+        bool render = false;
+        QueueSetMemberHandle_t ready = waitForWork(nextWakeTicks(last_render_tick));
+
+        // Each wake-up names one source with one item waiting: take exactly that item,
+        // then every wake-up already pending, so streamed status is not throttled by
+        // the wait. Protocol events and rotation render once afterwards.
+        while (ready != nullptr) {
+            serviceSource(ready, render);
+            ready = xQueueSelectFromSet(wake_set_, 0);
         }
-        
-        // Check for protocol events (separate queue)
-        if (xQueueReceive(g_proto_queue_, &proto_evt, 0) == pdTRUE) {
-            handleProtocol(proto_evt);
+
+        // Sources that could not join the set are polled (the wait is short then)
+        for (size_t i = 0; i < WAKE_SOURCES_; ++i) {
+            if (wake_sources_[i] && !wake_joined_[i]) {
+                while (serviceSource(wake_sources_[i], render)) {
+                }
+            }
+        }
+
+        // The encoder button level is polled too; handleEncoderButton() debounces the two paths
+        pollEncoderButton(render);
+
+        if (render) {
             renderCurrentScreen();
         }
 
+        // Adaptive rates: the device picks its status and render periods from what is
+        // visible and its own state (e.g. fast while a test runs on the control screen,
+        // slow heartbeat on menus, nothing on the splash). Sessions left open in the
+        // background only keep a heartbeat.
+        for (size_t i = 0; i < open_count_; ++i) {
+            DeviceBase* device = open_devices_[i].device.get();
+            device->SetVisibility(device == current_device_ ? visibilityFor(current_state_)
+                                                             : ScreenVisibility::Background);
+        }
+
         // Periodic UI refresh (keeps dynamic/timed UI elements updating even without input events).
         // This is especially important for the FatigueTester control screen which shows live data
         // and uses brief visual flashes (e.g., NOT CONNECTED).
         {
-            static TickType_t last_render_tick = 0;
             TickType_t now = xTaskGetTickCount();
-            const TickType_t refresh_period = pdMS_TO_TICKS(250);
-            if ((now - last_render_tick) > refresh_period) {
-                if (current_device_ &&
-                    (current_state_ == UiState::DeviceMain || current_state_ == UiState::DeviceControl)) {
-                    renderCurrentScreen();
-                }
+            uint32_t render_ms = current_device_ ? current_device_->GetRenderPeriodMs() : 0;
+            if (render_ms != 0 && (now - last_render_tick) >= pdMS_TO_TICKS(render_ms)) {
+                renderCurrentScreen();
                 last_render_tick = now;
             }
         }
 
-        // Keepalive / polling: nudge devices so UI stays up-to-date even if the test unit
-        // is not streaming status frequently.
-        {
-            static TickType_t last_poll_tick = 0;
-            TickType_t now = xTaskGetTickCount();
-            const TickType_t poll_period = pdMS_TO_TICKS(1000);
-            if (current_device_ && (now - last_poll_tick) > poll_period) {
-                // Only poll while we're on a device screen.
-                if (current_state_ == UiState::DeviceMain ||
-                    current_state_ == UiState::DeviceControl ||
-                    current_state_ == UiState::DeviceSettings) {
-                    current_device_->RequestStatus();
-                }
-                last_poll_tick = now;
+        // Keepalive / polling for every open session
+        serviceDevices();
+
+        // Write-behind settings: commit coalesced changes once the interval has elapsed
+        SettingsStore::Service();
+
+        // Deep sleep requested by the power task: save and draw here, then let it go on
+        if (sleep_pending_) {
+            sleep_pending_ = false;
+            prepareForSleep();
+            xSemaphoreGive(sleep_done_);
+        }
+
+        // Group commands: queue remaining members, collect acks, report at the deadline
+        PeerGroups::Service();
+
+        // Per-peer PHY rate: re-evaluated every RATE_EVAL_MS_
+        RateControl::Service();
+
+        // Device clock mapping: one TimeSync exchange per call while a round runs
+        TimeSync::Service();
+    }
+}
+
+uint32_t UiController::statusPeriodMs(const DeviceBase& device) noexcept
+{
+    uint32_t status_ms = device.GetStatusPeriodMs();
+    return status_ms > STATUS_SERVICE_PERIOD_MS_ ? STATUS_SERVICE_PERIOD_MS_ : status_ms;
+}
+
+void UiController::serviceDevices() noexcept
+{
+    // RequestStatus() runs at the device's status period, but at least every
+    // STATUS_SERVICE_PERIOD_MS_ so subscription leases stay renewed. The device
+    // rate-limits any fallback polling to its status period itself.
+    TickType_t now = xTaskGetTickCount();
+    for (size_t i = 0; i < open_count_; ++i) {
+        OpenDevice& open = open_devices_[i];
+        uint32_t status_ms = statusPeriodMs(*open.device);
+        if (status_ms != 0 && (now - open.last_poll_tick) >= pdMS_TO_TICKS(status_ms)) {
+            open.device->RequestStatus();
+            open.last_poll_tick = now;
+        }
+    }
+}
+
+TickType_t UiController::nextWakeTicks(TickType_t last_render_tick) const noexcept
+{
+    // Background services (settings commit, rate control, time sync between rounds)
+    // need no more than UI_IDLE_WAKE_MS_; a group command collecting acks, a time
+    // sync round, or an incomplete wake set needs the short period.
+    bool busy = PeerGroups::IsBusy() || TimeSync::IsBusy() || !wake_set_complete_;
+    TickType_t wait = pdMS_TO_TICKS(busy ? UI_BUSY_WAKE_MS_ : UI_IDLE_WAKE_MS_);
+    TickType_t now = xTaskGetTickCount();
+
+    auto until = [now](TickType_t last, uint32_t period_ms) {
+        TickType_t period = pdMS_TO_TICKS(period_ms);
+        TickType_t elapsed = now - last;
+        return elapsed >= period ? 0 : period - elapsed;
+    };
+
+    uint32_t render_ms = current_device_ ? current_device_->GetRenderPeriodMs() : 0;
+    if (render_ms != 0) {
+        wait = std::min(wait, until(last_render_tick, render_ms));
+    }
+    for (size_t i = 0; i < open_count_; ++i) {
+        uint32_t status_ms = statusPeriodMs(*open_devices_[i].device);
+        if (status_ms != 0) {
+            wait = std::min(wait, until(open_devices_[i].last_poll_tick, status_ms));
+        }
+    }
+    return wait;
+}
+
+void UiController::createWakeSet() noexcept
+{
+    QueueHandle_t encoder_queue = s_encoder_ ? s_encoder_->getEventQueue() : nullptr;
+    QueueSetMemberHandle_t sources[WAKE_SOURCES_] = { ui_queue_, g_proto_queue_, encoder_queue, sleep_request_ };
+
+    UBaseType_t length = 0;
+    for (size_t i = 0; i < WAKE_SOURCES_; ++i) {
+        wake_sources_[i] = sources[i];
+        wake_joined_[i] = false;
+        if (sources[i]) {
+            length += uxQueueMessagesWaiting(sources[i]) + uxQueueSpacesAvailable(sources[i]);
+        }
+    }
+    wake_set_ = xQueueCreateSet(length);
+    wake_set_complete_ = (wake_set_ != nullptr);
+    for (size_t i = 0; i < WAKE_SOURCES_; ++i) {
+        QueueSetMemberHandle_t source = wake_sources_[i];
+        bool joined = source && wake_set_ && xQueueAddToSet(source, wake_set_) == pdPASS;
+
+        // The encoder task already runs: drop rotation from boot and try again
+        for (int attempt = 0; !joined && encoder_queue && source == encoder_queue && wake_set_ && attempt < 3; ++attempt) {
+            EC11Encoder::Event evt;
+            while (xQueueReceive(encoder_queue, &evt, 0) == pdTRUE) {
             }
+            joined = (xQueueAddToSet(source, wake_set_) == pdPASS);
         }
-        
-        // If no events, check if we need to refresh
-        // (e.g., for animations or status updates)
-        vTaskDelay(pdMS_TO_TICKS(100));
+        wake_joined_[i] = joined;
+        wake_set_complete_ = wake_set_complete_ && joined;
+    }
+    if (!wake_set_complete_) {
+        ESP_LOGW(TAG_, "UI wake set incomplete, polling every %lu ms",
+                 static_cast<unsigned long>(UI_BUSY_WAKE_MS_));
+    }
+}
+
+QueueSetMemberHandle_t UiController::waitForWork(TickType_t wait) noexcept
+{
+    if (!wake_set_) {
+        vTaskDelay(wait ? wait : 1);
+        return nullptr;
+    }
+    return xQueueSelectFromSet(wake_set_, wait);
+}
+
+/**
+ * @brief Take one item from a wake source and handle it.
+ * @param render Set if the screen should be redrawn once the pass is done
+ * @return false if the source had nothing waiting
+ */
+bool UiController::serviceSource(QueueSetMemberHandle_t source, bool& render) noexcept
+{
+    if (source == ui_queue_) {
+        // Button events forwarded by button_task; handleButton() renders what it changes
+        ButtonEvent evt{};
+        if (xQueueReceive(ui_queue_, &evt, 0) != pdTRUE) return false;
+        handleButton(evt);
+        return true;
+    }
+    if (source == g_proto_queue_) {
+        espnow::ProtoEvent evt{};
+        if (xQueueReceive(g_proto_queue_, &evt, 0) != pdTRUE) return false;
+        handleProtocol(evt);
+        render = true;
+        return true;
+    }
+    if (source == sleep_request_) {
+        if (xSemaphoreTake(sleep_request_, 0) != pdTRUE) return false;
+        sleep_pending_ = true;
+        return true;
+    }
+    if (s_encoder_ && source == s_encoder_->getEventQueue()) {
+        EC11Encoder::Event evt;
+        if (xQueueReceive(s_encoder_->getEventQueue(), &evt, 0) != pdTRUE) return false;
+        if (encoder_stale_events_ > 0) {
+            encoder_stale_events_--;
+        } else {
+            handleEncoderEvent(evt, render);
+        }
+        return true;
     }
+    return false;
 }
 
-void UiController::PrepareForSleep() noexcept
+bool UiController::RequestSleep(TickType_t timeout) noexcept
 {
-    // Save current state before sleep
+    if (!sleep_request_ || !sleep_done_) {
+        return false;
+    }
+    xSemaphoreGive(sleep_request_);
+    return xSemaphoreTake(sleep_done_, timeout) == pdTRUE;
+}
+
+void UiController::prepareForSleep() noexcept
+{
+    // Save current state before sleep; on device screens the highlighted row is the open device
+    DeviceChoice saved{};
+    if (current_state_ != UiState::Splash && selected_choice_ < choice_count_) {
+        saved = choices_[selected_choice_];
+    }
     if (settings_) {
         settings_->ui.last_ui_state = static_cast<uint8_t>(current_state_);
-        settings_->ui.last_device_id = selected_device_id_;
-        SettingsStore::Save(*settings_);
+        settings_->ui.last_device_id = saved.device_id;
+        SettingsStore::Update(*settings_);
+        SettingsStore::Flush();
     }
     
     // Save RTC time when entering sleep (persists across deep sleep)
     // esp_clk_rtc_time() returns RTC time in microseconds, which continues during deep sleep
     s_sleep_rtc_time_us = esp_clk_rtc_time();
+    s_sleep_peer_bound = saved.bound;
+    std::memcpy(s_sleep_peer_mac, saved.mac, sizeof(s_sleep_peer_mac));
     
     if (s_display_) {
         s_display_->clearDisplay();
@@ -351,23 +539,16 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
             break;
         case UiState::DeviceSelection:
             if (event.id == ButtonId::Back) {
-                // Go back to splash screen
-                selected_device_id_ = 0;
+                // Go back to splash screen, closing the sessions left open in the background
+                closeOpenDevices();
+                selected_choice_ = 0;
                 transitionToState(UiState::Splash);
             } else if (event.id == ButtonId::Confirm) {
                 // Select current device and go to main screen
-                const auto& device_ids = device_registry::GetAvailableDeviceIds();
-                if (selected_device_id_ == 0 && !device_ids.empty()) {
-                    // Auto-select first device if none selected
-                    selected_device_id_ = device_ids[0];
-                }
-                if (selected_device_id_ > 0) {
-                    current_device_ = device_registry::CreateDevice(selected_device_id_, s_display_, settings_);
-                    if (current_device_) {
-                        transitionToState(UiState::DeviceMain);
-                        // Reset encoder position when entering device screen
-                        resetEncoderTracking(0);
-                    }
+                if (openSelectedDevice()) {
+                    transitionToState(UiState::DeviceMain);
+                    // Reset encoder position when entering device screen
+                    resetEncoderTracking(0);
                 }
             }
             break;
@@ -375,7 +556,7 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
             // Check for popup first
             if (current_device_ && 
                 current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                 if (ft->IsPopupActive()) {
                     // Handle popup
                     current_device_->HandleButton(event.id);
@@ -383,11 +564,17 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
                     return;
                 }
             }
+
+            if (mainScreenTakesButton(event.id)) {
+                current_device_->HandleButton(event.id);
+                renderCurrentScreen();
+                return;
+            }
             
             if (event.id == ButtonId::Back) {
+                // The session stays open in the background; the list marks it
+                current_device_ = nullptr;
                 transitionToState(UiState::DeviceSelection);
-                current_device_.reset();
-                selected_device_id_ = 0;
             } else if (event.id == ButtonId::Confirm) {
                 transitionToState(UiState::DeviceControl);
             }
@@ -398,7 +585,7 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
                 // Check if this is a FatigueTester and if popup is active
                 bool popup_was_active = false;
                 if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                     popup_was_active = ft->IsPopupActive();
                 }
                 
@@ -408,7 +595,7 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
                 // Check if popup is still active after handling
                 bool popup_still_active = false;
                 if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                     popup_still_active = ft->IsPopupActive();
                 }
                 
@@ -433,7 +620,7 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
             if (current_device_) {
                 bool menu_was_active = false;
                 if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                     menu_was_active = ft->IsMenuActive();
                 }
                 
@@ -442,7 +629,7 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
                 // Check if menu was exited
                 bool menu_still_active = false;
                 if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                    FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                     menu_still_active = ft->IsMenuActive();
                 }
                 
@@ -472,6 +659,26 @@ void UiController::handleButton(const ButtonEvent& event) noexcept
     }
 }
 
+/**
+ * @brief Whether the device main screen handles this button itself.
+ *
+ * The pairing and group screens act on their main screen: Confirm runs the
+ * highlighted row, and Back cancels a pairing or closes the member list
+ * instead of leaving.
+ */
+bool UiController::mainScreenTakesButton(ButtonId button_id) const noexcept
+{
+    if (!current_device_) return false;
+    switch (current_device_->GetDeviceId()) {
+        case device_registry::DEVICE_ID_PAIRING_:
+            return button_id == ButtonId::Confirm || static_cast<PairingScreen*>(current_device_)->IsBusy();
+        case device_registry::DEVICE_ID_GROUPS_:
+            return button_id == ButtonId::Confirm || static_cast<GroupsScreen*>(current_device_)->IsEditing();
+        default:
+            return false;
+    }
+}
+
 void UiController::handleEncoderButton(bool pressed) noexcept
 {
     if (!pressed) return; // Only handle press, not release
@@ -504,7 +711,7 @@ void UiController::handleEncoderButton(bool pressed) noexcept
         bool menu_was_active = false;
         if (current_state_ == UiState::DeviceSettings &&
             current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-            FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+            FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
             menu_was_active = ft->IsMenuActive();
         }
 
@@ -513,7 +720,7 @@ void UiController::handleEncoderButton(bool pressed) noexcept
         if (current_state_ == UiState::DeviceSettings &&
             menu_was_active &&
             current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-            FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+            FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
             if (!ft->IsMenuActive()) {
                 vTaskDelay(pdMS_TO_TICKS(20));
                 transitionToState(UiState::DeviceMain);
@@ -525,10 +732,17 @@ void UiController::handleEncoderButton(bool pressed) noexcept
         return;
     }
     
+    // Pairing and group screens: encoder button runs the highlighted row (same as Confirm)
+    if (current_state_ == UiState::DeviceMain && mainScreenTakesButton(ButtonId::Confirm)) {
+        current_device_->HandleEncoderButton(pressed);
+        renderCurrentScreen();
+        return;
+    }
+
     // DeviceMain state: encoder button goes to settings
     if (current_device_ && current_state_ == UiState::DeviceMain) {
         if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-            FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+            FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
             ft->SetMenuActive(true);
         }
         transitionToState(UiState::DeviceSettings);
@@ -542,20 +756,10 @@ void UiController::handleEncoderButton(bool pressed) noexcept
             break;
         case UiState::DeviceSelection:
             // Encoder button click selects the device (same as Confirm button)
-            {
-                const auto& device_ids = device_registry::GetAvailableDeviceIds();
-                if (selected_device_id_ == 0 && !device_ids.empty()) {
-                    // Auto-select first device if none selected
-                    selected_device_id_ = device_ids[0];
-                }
-                if (selected_device_id_ > 0) {
-                    current_device_ = device_registry::CreateDevice(selected_device_id_, s_display_, settings_);
-                    if (current_device_) {
-                        transitionToState(UiState::DeviceMain);
-                        // Reset encoder position when entering device screen
-                        resetEncoderTracking(0);
-                    }
-                }
+            if (openSelectedDevice()) {
+                transitionToState(UiState::DeviceMain);
+                // Reset encoder position when entering device screen
+                resetEncoderTracking(0);
             }
             break;
         default:
@@ -565,11 +769,136 @@ void UiController::handleEncoderButton(bool pressed) noexcept
 
 void UiController::handleProtocol(const espnow::ProtoEvent& event) noexcept
 {
-    if (current_device_) {
-        current_device_->UpdateFromProtocol(event);
+    // Every open session sees the event and keeps only its own peer's (DeviceBase::isOwnEvent)
+    for (size_t i = 0; i < open_count_; ++i) {
+        open_devices_[i].device->UpdateFromProtocol(event);
     }
 }
 
+bool UiController::sameChoice(const DeviceChoice& a, const DeviceChoice& b) noexcept
+{
+    return a.device_id == b.device_id && a.bound == b.bound &&
+           (!a.bound || std::memcmp(a.mac, b.mac, sizeof(a.mac)) == 0);
+}
+
+void UiController::buildDeviceChoices() noexcept
+{
+    // Keep the highlighted row when pairing added or removed testers
+    DeviceChoice previous = selected_choice_ < choice_count_ ? choices_[selected_choice_] : DeviceChoice{};
+
+    // One row per approved tester, each opened as its own bound session. A type with
+    // no approved peer keeps a single row that follows the protocol's target.
+    static ApprovedPeer s_peers[MAX_DEVICE_CHOICES_];
+    const auto& device_ids = device_registry::GetAvailableDeviceIds();
+    choice_count_ = 0;
+    for (size_t i = 0; i < device_ids.size() && choice_count_ < MAX_DEVICE_CHOICES_; ++i) {
+        size_t peers = 0;
+        if (device_ids[i] == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
+            // Leave a row for each device type listed after the testers
+            size_t later = device_ids.size() - i - 1;
+            size_t room = MAX_DEVICE_CHOICES_ - choice_count_;
+            room = room > later ? room - later : 1;
+            peers = espnow::GetApprovedPeersOfType(DeviceType::FatigueTester, s_peers, room);
+            for (size_t p = 0; p < peers; ++p) {
+                DeviceChoice& choice = choices_[choice_count_++];
+                choice.device_id = device_ids[i];
+                choice.bound = true;
+                std::memcpy(choice.mac, s_peers[p].mac, sizeof(choice.mac));
+            }
+        }
+        if (peers == 0) {
+            choices_[choice_count_++] = DeviceChoice{ device_ids[i], false, {} };
+        }
+    }
+
+    selected_choice_ = 0;
+    for (size_t i = 0; i < choice_count_; ++i) {
+        if (sameChoice(choices_[i], previous)) {
+            selected_choice_ = i;
+            break;
+        }
+    }
+
+    // Close background sessions whose row is gone: an unpaired tester, or the
+    // unbound row once testers were paired (it would take every tester's events)
+    for (size_t i = 0; i < open_count_;) {
+        bool listed = open_devices_[i].device.get() == current_device_;
+        for (size_t c = 0; c < choice_count_ && !listed; ++c) {
+            listed = sameChoice(open_devices_[i].choice, choices_[c]);
+        }
+        if (listed) {
+            ++i;
+            continue;
+        }
+        if (i + 1 < open_count_) {
+            open_devices_[i] = std::move(open_devices_[open_count_ - 1]);
+        }
+        open_devices_[--open_count_].device.reset();
+    }
+}
+
+/**
+ * @brief Bring the highlighted device to the foreground, opening a session if it has none.
+ *
+ * A bound session addresses one tester (DeviceBase::BindPeer). Past MAX_OPEN_DEVICES_
+ * the least recently used background session is closed.
+ * @return false if the device could not be created
+ */
+bool UiController::openSelectedDevice() noexcept
+{
+    if (selected_choice_ >= choice_count_) return false;
+    const DeviceChoice& choice = choices_[selected_choice_];
+    TickType_t now = xTaskGetTickCount();
+
+    OpenDevice* open = nullptr;
+    for (size_t i = 0; i < open_count_ && !open; ++i) {
+        if (sameChoice(open_devices_[i].choice, choice)) {
+            open = &open_devices_[i];
+        }
+    }
+    if (!open) {
+        std::unique_ptr<DeviceBase> device = device_registry::CreateDevice(choice.device_id, s_display_, settings_);
+        if (!device) return false;
+        if (choice.bound) {
+            device->BindPeer(choice.mac);
+        }
+
+        if (open_count_ == MAX_OPEN_DEVICES_) {
+            size_t oldest = 0;
+            for (size_t i = 1; i < open_count_; ++i) {
+                if (now - open_devices_[i].last_used_tick > now - open_devices_[oldest].last_used_tick) {
+                    oldest = i;
+                }
+            }
+            ESP_LOGI(TAG_, "Closing background session (device_id=%d)", (int)open_devices_[oldest].choice.device_id);
+            if (oldest + 1 < open_count_) {
+                open_devices_[oldest] = std::move(open_devices_[open_count_ - 1]);
+            }
+            open_devices_[--open_count_].device.reset();
+        }
+
+        open = &open_devices_[open_count_++];
+        open->choice = choice;
+        open->device = std::move(device);
+        open->last_poll_tick = now - pdMS_TO_TICKS(STATUS_SERVICE_PERIOD_MS_);   // Poll right away
+    }
+
+    open->last_used_tick = now;
+    current_device_ = open->device.get();
+    // Before the first render: a tester back from the background shows its own config
+    current_device_->SetVisibility(visibilityFor(UiState::DeviceMain));
+    return true;
+}
+
+void UiController::closeOpenDevices() noexcept
+{
+    current_device_ = nullptr;
+    for (size_t i = 0; i < open_count_; ++i) {
+        open_devices_[i].device.reset();
+    }
+    open_count_ = 0;
+}
+
 void UiController::renderCurrentScreen() noexcept
 {
     switch (current_state_) {
@@ -592,7 +921,7 @@ void UiController::renderCurrentScreen() noexcept
             // Check if device has popup
             if (current_device_ && 
                 current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-                FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+                FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
                 ft->RenderPopup();
             } else {
                 renderPopup();
@@ -604,6 +933,10 @@ void UiController::renderCurrentScreen() noexcept
 void UiController::transitionToState(UiState new_state) noexcept
 {
     current_state_ = new_state;
+    if (new_state == UiState::DeviceSelection) {
+        // Pairing may have changed the approved testers
+        buildDeviceChoices();
+    }
     if (current_device_) {
         ESP_LOGI(TAG_, "UI state -> %d (device_id=%d)", (int)current_state_, (int)current_device_->GetDeviceId());
     } else {
@@ -694,17 +1027,19 @@ void UiController::renderDeviceSelectionScreen() noexcept
     // Draw line below title
     s_display_->drawLine(0, 9, 128, 9, 1);
     
-    // Get available devices
-    const auto& device_ids = device_registry::GetAvailableDeviceIds();
-    
-    // Display device list
+    // Display device list, scrolled so the highlighted row stays visible
+    size_t first = selected_choice_ >= SELECTION_ROWS_ ? selected_choice_ - SELECTION_ROWS_ + 1 : 0;
     int16_t y_pos = 12;
-    for (size_t i = 0; i < device_ids.size() && y_pos < 64; ++i) {
-        uint8_t device_id = device_ids[i];
-        const char* device_name = device_registry::GetDeviceName(device_id);
+    for (size_t i = first; i < choice_count_ && i < first + SELECTION_ROWS_; ++i) {
+        const DeviceChoice& choice = choices_[i];
+        const char* device_name = device_registry::GetDeviceName(choice.device_id);
+        bool open = false;
+        for (size_t d = 0; d < open_count_; ++d) {
+            open = open || sameChoice(open_devices_[d].choice, choice);
+        }
         
         // Highlight selected device
-        if (device_id == selected_device_id_) {
+        if (i == selected_choice_) {
             // Draw selection indicator
             s_display_->fillRect(0, y_pos - 1, 128, 10, 1);
             s_display_->setTextColor(0); // Inverted text
@@ -712,11 +1047,17 @@ void UiController::renderDeviceSelectionScreen() noexcept
             s_display_->setTextColor(1);
         }
         
-        s_display_->setCursor(4, y_pos);
-        s_display_->print("> ");
+        // "*" marks a session open in the background; testers are told apart by MAC tail
+        s_display_->setCursor(2, y_pos);
+        s_display_->print(open ? "* " : "> ");
         s_display_->print(device_name);
+        if (choice.bound) {
+            char mac_tail[8];
+            snprintf(mac_tail, sizeof(mac_tail), " %02X%02X", choice.mac[4], choice.mac[5]);
+            s_display_->print(mac_tail);
+        }
         
-        if (device_id == selected_device_id_) {
+        if (i == selected_choice_) {
             s_display_->setTextColor(1); // Reset for next item
         }
         
@@ -744,7 +1085,7 @@ void UiController::renderDeviceSettingsScreen() noexcept
     if (current_device_) {
         // Check if this is a FatigueTester
         if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-            FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+            FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
             // Add small delay to ensure I2C bus is ready
             vTaskDelay(pdMS_TO_TICKS(10));
             ft->RenderSettingsMenu();
@@ -768,7 +1109,7 @@ void UiController::renderDeviceControlScreen() noexcept
     if (current_device_) {
         // Check if this is a FatigueTester
         if (current_device_->GetDeviceId() == device_registry::DEVICE_ID_FATIGUE_TESTER_) {
-            FatigueTester* ft = static_cast<FatigueTester*>(current_device_.get());
+            FatigueTester* ft = static_cast<FatigueTester*>(current_device_);
             // Check if popup is active - if so, render popup instead
             if (ft->IsPopupActive()) {
                 ft->RenderPopup();
@@ -805,16 +1146,14 @@ void UiController::resetEncoderTracking(int32_t position) noexcept
         s_encoder_->setPosition(position);
         last_encoder_pos_ = position;
         
-        // Drain any pending encoder events to prevent stale events from causing issues
-        EC11Encoder::Event evt;
-        while (s_encoder_->getEventQueue() && 
-               xQueueReceive(s_encoder_->getEventQueue(), &evt, 0) == pdTRUE) {
-            // Discard pending events
-        }
+        // Events still queued refer to the old position. The queue is a wake set member,
+        // read only when select names it, so count them and discard them as they come out.
+        QueueHandle_t queue = s_encoder_->getEventQueue();
+        encoder_stale_events_ = queue ? uxQueueMessagesWaiting(queue) : 0;
     }
 }
 
-void UiController::processEncoderEvents() noexcept
+void UiController::pollEncoderButton(bool& render) noexcept
 {
     if (!s_encoder_) return;
     
@@ -822,64 +1161,42 @@ void UiController::processEncoderEvents() noexcept
     bool current_encoder_button = s_encoder_->isButtonPressed();
     if (current_encoder_button && !last_encoder_button_state_) {
         handleEncoderButton(true);
-        renderCurrentScreen();
+        render = true;
     }
     last_encoder_button_state_ = current_encoder_button;
-    
-    // Process encoder rotation events from the event queue
-    // This gives us reliable, event-based handling without division artifacts
-    EC11Encoder::Event evt;
-    bool had_rotation = false;
-    
-    while (s_encoder_->getEventQueue() && 
-           xQueueReceive(s_encoder_->getEventQueue(), &evt, 0) == pdTRUE) {
+}
+
+void UiController::handleEncoderEvent(const EC11Encoder::Event& evt, bool& render) noexcept
+{
+    // Rotation events from the encoder's queue: reliable, event-based handling
+    // without division artifacts
+    if (evt.type == EC11Encoder::EventType::ROTATION) {
+        render = true;
         
-        if (evt.type == EC11Encoder::EventType::ROTATION) {
-            had_rotation = true;
-            
-            if (current_state_ == UiState::DeviceSelection) {
-                // Device selection navigation
-                const auto& device_ids = device_registry::GetAvailableDeviceIds();
-                if (!device_ids.empty()) {
-                    // Find current selection index
-                    size_t current_idx = 0;
-                    for (size_t i = 0; i < device_ids.size(); ++i) {
-                        if (device_ids[i] == selected_device_id_) {
-                            current_idx = i;
-                            break;
-                        }
-                    }
-                    
-                    // Navigate based on rotation direction
-                    if (evt.direction == EC11Encoder::Direction::CW && 
-                        current_idx < device_ids.size() - 1) {
-                        // CW moves down (next item)
-                        selected_device_id_ = device_ids[current_idx + 1];
-                    } else if (evt.direction == EC11Encoder::Direction::CCW && 
-                               current_idx > 0) {
-                        // CCW moves up (previous item)
-                        selected_device_id_ = device_ids[current_idx - 1];
-                    }
-                }
-            } else if (current_device_ && 
-                      (current_state_ == UiState::DeviceMain || 
-                       current_state_ == UiState::DeviceSettings || 
-                       current_state_ == UiState::DeviceControl)) {
-                // Device screen encoder handling (for menu navigation)
-                current_device_->HandleEncoder(evt.direction);
+        if (current_state_ == UiState::DeviceSelection) {
+            // Device selection navigation
+            if (evt.direction == EC11Encoder::Direction::CW && 
+                selected_choice_ + 1 < choice_count_) {
+                // CW moves down (next item)
+                selected_choice_++;
+            } else if (evt.direction == EC11Encoder::Direction::CCW && 
+                       selected_choice_ > 0) {
+                // CCW moves up (previous item)
+                selected_choice_--;
             }
-            
-            // Update tracking position
-            last_encoder_pos_ = evt.position;
-        } else if (evt.type == EC11Encoder::EventType::BUTTON && evt.button_pressed) {
-            // Button press event from queue (alternative to polling)
-            handleEncoderButton(true);
+        } else if (current_device_ && 
+                  (current_state_ == UiState::DeviceMain || 
+                   current_state_ == UiState::DeviceSettings || 
+                   current_state_ == UiState::DeviceControl)) {
+            // Device screen encoder handling (for menu navigation)
+            current_device_->HandleEncoder(evt.direction);
         }
-    }
-    
-    // Render if we processed any rotation events
-    if (had_rotation) {
-        renderCurrentScreen();
+        
+        // Update tracking position
+        last_encoder_pos_ = evt.position;
+    } else if (evt.type == EC11Encoder::EventType::BUTTON && evt.button_pressed) {
+        // Button press event from queue (alternative to polling)
+        handleEncoderButton(true);
     }
 }
 
@@ -10,6 +10,7 @@
 #include "ui_state.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "../button.hpp"
 #include "../protocol/espnow_protocol.hpp"
 #include "../settings.hpp"
@@ -23,13 +24,52 @@ public:
     bool Init(QueueHandle_t ui_queue, Settings* settings, 
               uint32_t* inactivity_ticks_ptr) noexcept;
     void Task(void* arg) noexcept;
-    void PrepareForSleep() noexcept;
+
+    /**
+     * @brief Have the UI task save its state and show the sleep screen.
+     *
+     * Called from the power task; settings and display belong to the UI task,
+     * so the work is done there and this waits for it.
+     * @return false if the UI task did not finish within timeout
+     */
+    bool RequestSleep(TickType_t timeout) noexcept;
     
 private:
+    /// One row of the device selection screen
+    struct DeviceChoice {
+        uint8_t device_id;
+        bool bound;         ///< One approved tester; otherwise follows the protocol's target
+        uint8_t mac[6];
+    };
+
+    /// A device session; kept open in the background while another screen is shown
+    struct OpenDevice {
+        DeviceChoice choice;
+        std::unique_ptr<DeviceBase> device;
+        TickType_t last_poll_tick;
+        TickType_t last_used_tick;  ///< The least recently used session is closed first
+    };
+
+    static constexpr size_t MAX_DEVICE_CHOICES_ = 16;
+    static constexpr size_t MAX_OPEN_DEVICES_ = 4;
+    static constexpr size_t SELECTION_ROWS_ = 4;
+
     // Private functions: camelCase
     void handleButton(const ButtonEvent& event) noexcept;
     void handleProtocol(const espnow::ProtoEvent& event) noexcept;
     void handleEncoderButton(bool pressed) noexcept;
+    bool mainScreenTakesButton(ButtonId button_id) const noexcept;
+    void prepareForSleep() noexcept;
+    static bool sameChoice(const DeviceChoice& a, const DeviceChoice& b) noexcept;
+    void buildDeviceChoices() noexcept;
+    bool openSelectedDevice() noexcept;
+    void closeOpenDevices() noexcept;
+    void serviceDevices() noexcept;
+    static uint32_t statusPeriodMs(const DeviceBase& device) noexcept;
+    TickType_t nextWakeTicks(TickType_t last_render_tick) const noexcept;
+    void createWakeSet() noexcept;
+    QueueSetMemberHandle_t waitForWork(TickType_t wait) noexcept;
+    bool serviceSource(QueueSetMemberHandle_t source, bool& render) noexcept;
     void renderCurrentScreen() noexcept;
     void transitionToState(UiState new_state) noexcept;
     void renderSplashScreen() noexcept;
@@ -41,19 +81,34 @@ private:
     
     // Encoder helper methods
     void resetEncoderTracking(int32_t position = 0) noexcept;
-    void processEncoderEvents() noexcept;
+    void handleEncoderEvent(const EC11Encoder::Event& evt, bool& render) noexcept;
+    void pollEncoderButton(bool& render) noexcept;
     
     // Member variables: snake_case + trailing underscore
     UiState current_state_;
-    std::unique_ptr<DeviceBase> current_device_;
+    DeviceBase* current_device_;        ///< Foreground session from open_devices_, or nullptr
+    OpenDevice open_devices_[MAX_OPEN_DEVICES_];
+    size_t open_count_;
+    DeviceChoice choices_[MAX_DEVICE_CHOICES_];
+    size_t choice_count_;
+    size_t selected_choice_;
+    DeviceChoice restore_choice_;       ///< Device screen restored after sleep, opened by Task()
     QueueHandle_t ui_queue_;
     Settings* settings_;
     uint32_t* last_activity_tick_;
-    uint8_t selected_device_id_;
     bool popup_active_;
+    SemaphoreHandle_t sleep_request_;   ///< Given by RequestSleep(), taken by the UI task
+    SemaphoreHandle_t sleep_done_;      ///< Given by the UI task once prepared
+    bool sleep_pending_;                ///< sleep_request_ taken, prepareForSleep() still to run
+    static constexpr size_t WAKE_SOURCES_ = 4;
+    QueueSetHandle_t wake_set_;         ///< Button, protocol and encoder queues plus sleep_request_
+    QueueSetMemberHandle_t wake_sources_[WAKE_SOURCES_];
+    bool wake_joined_[WAKE_SOURCES_];   ///< Read only via select; the others are polled
+    bool wake_set_complete_;            ///< Every source joined; otherwise poll at UI_BUSY_WAKE_MS_
     
     // Encoder tracking (moved from Task() local variables for proper state sync)
     bool last_encoder_button_state_;
     int32_t last_encoder_pos_;
+    UBaseType_t encoder_stale_events_;  ///< Queued before the last reset: discarded as they come out
 };
 
@@ -0,0 +1,105 @@
+/**
+ * @file bench_compact_status.cpp
+ * @brief Host cost of decoding StatusCompact
+ *
+ * Encodes a stream as the simulation in docs/PROTOCOL.md runs it (100 ms
+ * period, extras on every tenth sample, no loss), then times
+ * CompactStatusDecoder over it, acks included, as the controller runs it per
+ * received frame. Reports ns per sample of host time; it says nothing about
+ * target cycles.
+ */
+
+#include "device_protocols.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace device_protocols;
+
+namespace {
+
+constexpr int SAMPLES = 20000;
+constexpr int ITERATIONS = 50;
+
+struct Frame {
+    uint8_t data[COMPACT_STATUS_MAX_SIZE_];
+    uint8_t len;
+};
+
+/// Keeps the optimiser from dropping the decodes
+volatile uint32_t s_sink = 0;
+
+std::vector<Frame> encodeStream(size_t& total_bytes)
+{
+    CompactStatusEncoder enc;
+    CompactStatusDecoder dec;
+    FatigueTestStatusSample sample{};
+    sample.state = 1;
+    sample.has_time = true;
+    sample.device_time_us = 1000000;
+
+    std::vector<Frame> frames(SAMPLES);
+    total_bytes = 0;
+    for (int i = 0; i < SAMPLES; ++i) {
+        sample.cycle_number += 3;
+        sample.device_time_us += 100000 + (i * 37) % 500;
+        bool extras = i % 10 == 0;
+        sample.extras = extras ? COMPACT_EXTRA_CURRENT_ | COMPACT_EXTRA_TEMPERATURE_ | COMPACT_EXTRA_POSITION_ : 0;
+        sample.current_ma = extras ? 800 + (i % 200) : 0;
+        sample.temperature_dc = extras ? 350 + (i % 40) : 0;
+        sample.position = extras ? i * 4096 : 0;
+
+        Frame& frame = frames[i];
+        frame.len = static_cast<uint8_t>(enc.Encode(sample, frame.data, sizeof(frame.data)));
+        total_bytes += frame.len;
+
+        // Acks straight back, so the stream is mostly deltas as on a good link
+        FatigueTestStatusSample out{};
+        dec.Decode(frame.data, frame.len, out);
+        if (dec.AckDue()) {
+            espnow::StatusCompactAckPayload ack{};
+            dec.BuildAck(ack);
+            enc.OnAck(ack);
+        }
+    }
+    return frames;
+}
+
+} // namespace
+
+int main()
+{
+    size_t total_bytes = 0;
+    std::vector<Frame> frames = encodeStream(total_bytes);
+
+    int ok = 0;
+    uint32_t acc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < ITERATIONS; ++it) {
+        CompactStatusDecoder dec;
+        for (const Frame& frame : frames) {
+            FatigueTestStatusSample out{};
+            if (dec.Decode(frame.data, frame.len, out) == CompactStatusDecoder::Result::Ok) {
+                ++ok;
+            }
+            acc += out.cycle_number;
+            if (dec.AckDue()) {
+                espnow::StatusCompactAckPayload ack{};
+                dec.BuildAck(ack);
+                acc += ack.seq;
+            }
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    s_sink = acc;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() /
+                (static_cast<double>(ITERATIONS) * SAMPLES);
+    std::printf("StatusCompact decode, %d samples x %d (host time)\n", SAMPLES, ITERATIONS);
+    std::printf("  %.2f bytes/sample, %d/%d decoded\n", static_cast<double>(total_bytes) / SAMPLES,
+                ok, ITERATIONS * SAMPLES);
+    std::printf("  %.1f ns/sample\n", ns);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file bench_crc.cpp
+ * @brief Host throughput of the CRC16 engines
+ *
+ * Reports ns/byte for each software engine over frame-sized buffers. These
+ * are host timings: they rank the engines, but say nothing about target
+ * cycles, where the tables also pay for flash cache misses.
+ *
+ * esp_rom_crc16_be (CRC16_ENGINE_ Rom) is not measured here: host builds
+ * fall back to the table engine. No figure is recorded for it; it is the
+ * target default because it needs no flash table, and Crc16SelfTest()
+ * checks it at boot.
+ */
+
+#include "espnow_crc.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+using CrcFn = uint16_t (*)(const uint8_t*, size_t, uint16_t);
+
+constexpr size_t FRAME_LEN = 250;
+constexpr int ITERATIONS = 20000;
+
+/// Keeps the optimiser from dropping the CRC calls
+volatile uint16_t s_sink = 0;
+
+double nsPerByte(CrcFn fn, const std::vector<uint8_t>& buf)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint16_t acc = 0;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        acc = static_cast<uint16_t>(acc ^ fn(buf.data(), buf.size(), CRC16_INIT_));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    s_sink = acc;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    return ns / (static_cast<double>(ITERATIONS) * static_cast<double>(buf.size()));
+}
+
+uint16_t bitwise(const uint8_t* d, size_t n, uint16_t c) { return crc16_ccitt_bitwise(d, n, c); }
+uint16_t nibble(const uint8_t* d, size_t n, uint16_t c) { return crc16_ccitt_nibble(d, n, c); }
+uint16_t table(const uint8_t* d, size_t n, uint16_t c) { return crc16_ccitt_table(d, n, c); }
+
+} // namespace
+
+int main()
+{
+    std::vector<uint8_t> buf(FRAME_LEN);
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>(i * 131u + 7u);
+    }
+
+    struct { const char* name; CrcFn fn; } engines[] = {
+        { "bitwise", bitwise },
+        { "nibble",  nibble  },
+        { "table",   table   },
+    };
+
+    std::printf("CRC16 throughput, %zu-byte frames x %d (host time)\n", FRAME_LEN, ITERATIONS);
+    double reference = 0.0;
+    for (const auto& e : engines) {
+        double ns = nsPerByte(e.fn, buf);
+        if (reference == 0.0) {
+            reference = ns;
+        }
+        std::printf("  %-8s %7.3f ns/byte  (%.1fx bitwise)\n", e.name, ns, reference / ns);
+    }
+    return 0;
+}
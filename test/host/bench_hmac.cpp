@@ -0,0 +1,76 @@
+/**
+ * @file bench_hmac.cpp
+ * @brief Per-tag cost of the cached HMAC key schedule vs. one-shot mbedtls_md
+ *
+ * ComputeHmacReference() is the old path: context setup, both key pad
+ * blocks and teardown on every tag. HmacKeySchedule::Compute() starts from
+ * the pre-hashed pads. Reports ns/tag and SHA-256 blocks/tag for message
+ * sizes from a pairing challenge to a full frame. Host numbers use the
+ * software SHA-256 in sim/; on target the hardware engine changes the
+ * absolute cost, but the block counts, and so the saving, are the same.
+ */
+
+#include "espnow_protocol.hpp"
+#include "espnow_security.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr int ITERATIONS = 20000;
+
+/// Keeps the optimiser from dropping the HMAC calls
+volatile uint8_t s_sink = 0;
+
+template <typename Fn>
+double nsPerTag(Fn fn)
+{
+    uint8_t tag[HMAC_SIZE];
+    uint8_t acc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        fn(tag);
+        acc = static_cast<uint8_t>(acc ^ tag[0]);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    s_sink = acc;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+}
+
+/// SHA-256 compressions for a message of len bytes after `prefix` bytes already hashed
+size_t blocks(size_t prefix, size_t len)
+{
+    return (prefix + len + 8) / HmacKeySchedule::BLOCK_SIZE + 1;
+}
+
+} // namespace
+
+int main()
+{
+    const size_t sizes[] = { CHALLENGE_SIZE, 64, 128, espnow::MAX_PAYLOAD_SIZE_ };
+    std::vector<uint8_t> message(espnow::MAX_PAYLOAD_SIZE_);
+    for (size_t i = 0; i < message.size(); ++i) {
+        message[i] = static_cast<uint8_t>(i * 29u + 3u);
+    }
+    const HmacKeySchedule& key = PairingHmacKey();
+
+    std::printf("HMAC-SHA256 tag cost, x %d\n", ITERATIONS);
+    std::printf("  %5s  %12s %8s  %12s %8s  %7s\n", "bytes", "one-shot", "blocks", "cached", "blocks", "speedup");
+    for (size_t len : sizes) {
+        double reference = nsPerTag([&](uint8_t* tag) {
+            ComputeHmacReference(PAIRING_SECRET, sizeof(PAIRING_SECRET), message.data(), len, tag);
+        });
+        double cached = nsPerTag([&](uint8_t* tag) { key.Compute(message.data(), len, tag); });
+
+        // One-shot: inner pad + message, outer pad + digest. Cached: the pads are already in
+        size_t reference_blocks = blocks(HmacKeySchedule::BLOCK_SIZE, len) +
+                                  blocks(HmacKeySchedule::BLOCK_SIZE, 32);
+        size_t cached_blocks = reference_blocks - 2;
+        std::printf("  %5zu  %9.0f ns %8zu  %9.0f ns %8zu  %6.2fx\n",
+                    len, reference, reference_blocks, cached, cached_blocks, reference / cached);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file sim.hpp
+ * @brief Test-side controls of the host simulation (stubs/ declares the IDF side)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "esp_partition.h"
+
+namespace sim {
+
+/**
+ * @brief End the test process with a result code.
+ *
+ * Task threads never return (vTaskDelete parks them), so tests that start
+ * tasks leave through here instead of returning from main().
+ */
+[[noreturn]] void Exit(int code);
+
+/**
+ * @brief Create a RAM-backed partition, erased (0xFF), with 4 KiB erase blocks.
+ *
+ * Writes only clear bits, like NOR flash. Lives until the process exits.
+ */
+const esp_partition_t* CreatePartition(const char* label, uint32_t size);
+
+/**
+ * @brief Reseed esp_random() (fixed seed by default, so runs repeat).
+ */
+void SetRandomSeed(uint32_t seed);
+
+} // namespace sim
@@ -0,0 +1,590 @@
+/**
+ * @file sim_device.cpp
+ * @brief Simulated fatigue tester
+ */
+
+#include "sim_device.hpp"
+#include "espnow_crc.hpp"
+#include "esp_timer.h"
+
+#include <cstring>
+
+namespace sim {
+
+namespace {
+
+/// Frame bytes as the firmware's buildFrame() lays them out
+std::vector<uint8_t> buildFrame(uint8_t device_id, espnow::MsgType type, uint8_t id,
+                                const void* payload, uint8_t len)
+{
+    std::vector<uint8_t> buf(sizeof(espnow::EspNowHeader) + len + sizeof(uint16_t));
+    espnow::EspNowHeader hdr{ espnow::SYNC_BYTE_, espnow::PROTOCOL_VERSION_, device_id,
+                              static_cast<uint8_t>(type), id, len };
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+    if (len > 0) {
+        std::memcpy(buf.data() + sizeof(hdr), payload, len);
+    }
+    uint16_t crc = espnow::crc16_ccitt(buf.data(), sizeof(hdr) + len);
+    std::memcpy(buf.data() + sizeof(hdr) + len, &crc, sizeof(crc));
+    return buf;
+}
+
+} // namespace
+
+void DeviceMac(uint8_t index, uint8_t out[6])
+{
+    const uint8_t mac[6] = { 0x02, 0x51, 0x4D, 0x00, 0x00, static_cast<uint8_t>(index + 1) };
+    std::memcpy(out, mac, 6);
+}
+
+Device::Device(const uint8_t mac[6], const DeviceOptions& options, uint8_t channel)
+    : Station(mac, channel)
+    , options_(options)
+{
+}
+
+// ============================================================================
+// TEST INTERFACE
+// ============================================================================
+
+void Device::SetPairingMode(bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    pairing_mode_ = enabled;
+}
+
+bool Device::IsPaired() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return paired_;
+}
+
+bool Device::HasLinkKey() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return has_key_;
+}
+
+bool Device::GetLinkKey(uint8_t out[ESP_NOW_KEY_LEN]) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (has_key_) {
+        std::memcpy(out, lmk_, ESP_NOW_KEY_LEN);
+    }
+    return has_key_;
+}
+
+void Device::SendMessage(espnow::MsgType type, const void* payload, uint8_t len)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    reply(type, payload, len);
+}
+
+void Device::SendAck(espnow::MsgType type, const void* payload, uint8_t len, uint8_t echo_id)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    reply(type, payload, len, echo_id);
+}
+
+void Device::Restart()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    next_id_ = 1;
+    rx_window_.Reset();
+    sendDeviceInfo();
+}
+
+void Device::SetCommandAcks(bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    command_acks_ = enabled;
+}
+
+std::vector<Received> Device::Log() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return log_;
+}
+
+void Device::ClearLog()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    log_.clear();
+    executed_.clear();
+}
+
+std::vector<uint8_t> Device::Executed() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return executed_;
+}
+
+void Device::SetReceiveHook(std::function<void(const Received& msg)> hook)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    hook_ = std::move(hook);
+}
+
+uint32_t Device::DecryptFailures() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return decrypt_failures_;
+}
+
+uint32_t Device::ChannelSwitches() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return channel_switches_;
+}
+
+uint32_t Device::Rollbacks() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return rollbacks_;
+}
+
+void Device::SetBulkObject(espnow::BulkObject object, std::vector<uint8_t> data)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    bulk_objects_[object] = std::move(data);
+}
+
+std::vector<uint8_t> Device::Uploaded(espnow::BulkObject object) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    auto it = uploads_.find(object);
+    return it != uploads_.end() ? it->second : std::vector<uint8_t>{};
+}
+
+uint32_t Device::BulkRetransmissions() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return bulk_retransmissions_ + bulk_sender_.Retransmissions();
+}
+
+// ============================================================================
+// AIR SIDE
+// ============================================================================
+
+void Device::reply(espnow::MsgType type, const void* payload, uint8_t len, int echo_id)
+{
+    uint8_t id = (echo_id >= 0) ? static_cast<uint8_t>(echo_id) : next_id_++;
+    std::vector<uint8_t> frame = buildFrame(0, type, id, payload, len);
+    Send(frame.data(), frame.size(), nullptr, has_key_ ? lmk_ : nullptr);
+}
+
+void Device::sendDeviceInfo()
+{
+    using espnow::MsgType;
+
+    if (!options_.capability_block) {
+        reply(MsgType::DeviceInfo, options_.name.c_str(), static_cast<uint8_t>(options_.name.size()));
+        return;
+    }
+    espnow::CapabilityPayload caps{};
+    caps.magic = espnow::CAPABILITY_MAGIC_;
+    caps.device_type = static_cast<uint8_t>(DeviceType::FatigueTester);
+    caps.proto_min = espnow::PROTOCOL_VERSION_MIN_;
+    caps.proto_max = espnow::PROTOCOL_VERSION_;
+    caps.max_payload = espnow::MAX_PAYLOAD_SIZE_;
+    caps.features = options_.features;
+    for (MsgType handled : { MsgType::DeviceDiscovery, MsgType::Command, MsgType::ConfigSet,
+                             MsgType::ConfigFieldSet, MsgType::ChannelSwitch, MsgType::ChannelProbe,
+                             MsgType::Fragment, MsgType::TimeSync, MsgType::Aggregate,
+                             MsgType::BulkStart, MsgType::BulkData, MsgType::BulkAck }) {
+        uint8_t t = static_cast<uint8_t>(handled);
+        caps.msg_types[t / 8] |= static_cast<uint8_t>(1u << (t % 8));
+    }
+    reply(MsgType::DeviceInfo, &caps, sizeof(caps));
+}
+
+void Device::OnReceive(const Frame& frame)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    // The driver drops what it cannot decrypt; plain frames always pass
+    if (frame.encrypted && (!has_key_ || std::memcmp(frame.lmk, lmk_, ESP_NOW_KEY_LEN) != 0)) {
+        decrypt_failures_++;
+        return;
+    }
+
+    const std::vector<uint8_t>& data = frame.data;
+    if (data.size() < sizeof(espnow::EspNowHeader) + sizeof(uint16_t)) {
+        return;
+    }
+    espnow::EspNowHeader hdr{};
+    std::memcpy(&hdr, data.data(), sizeof(hdr));
+    size_t crc_len = sizeof(hdr) + hdr.len;
+    if (hdr.sync != espnow::SYNC_BYTE_ || hdr.len > espnow::MAX_PAYLOAD_SIZE_ ||
+        data.size() < crc_len + sizeof(uint16_t)) {
+        return;
+    }
+    uint16_t crc = 0;
+    std::memcpy(&crc, data.data() + crc_len, sizeof(crc));
+    if (crc != espnow::crc16_ccitt(data.data(), crc_len)) {
+        return;
+    }
+    const uint8_t* payload = data.data() + sizeof(hdr);
+
+    if (hdr.type != static_cast<uint8_t>(espnow::MsgType::Aggregate)) {
+        handleMessage(frame, hdr, payload, false);
+        return;
+    }
+
+    size_t offset = 0;
+    while (offset + sizeof(espnow::AggregateSubHeader) <= hdr.len) {
+        espnow::AggregateSubHeader sub{};
+        std::memcpy(&sub, payload + offset, sizeof(sub));
+        offset += sizeof(sub);
+        if (offset + sub.len > hdr.len) {
+            return;
+        }
+        espnow::EspNowHeader sub_hdr{ espnow::SYNC_BYTE_, espnow::PROTOCOL_VERSION_, sub.device_id,
+                                      sub.type, sub.id, sub.len };
+        handleMessage(frame, sub_hdr, payload + offset, true);
+        offset += sub.len;
+    }
+}
+
+void Device::handleMessage(const Frame& frame, const espnow::EspNowHeader& hdr, const uint8_t* payload,
+                           bool aggregated)
+{
+    using espnow::MsgType;
+
+    int64_t now_us = esp_timer_get_time();
+    MsgType type = static_cast<MsgType>(hdr.type);
+
+    Received msg{};
+    msg.type = type;
+    msg.device_id = hdr.device_id;
+    msg.id = hdr.id;
+    msg.aggregated = aggregated;
+    msg.encrypted = frame.encrypted;
+    msg.channel = frame.channel;
+    msg.rx_us = now_us;
+    msg.payload.assign(payload, payload + hdr.len);
+
+    // Requests are acked on every copy (the last ack may have been lost) and run once
+    if (!IsBroadcastMac(frame.dst) && type != MsgType::FragmentAck) {
+        int32_t lost_delta = 0;
+        msg.duplicate = rx_window_.Check(hdr.id, lost_delta) != espnow::ReplayWindow::Verdict::Accept;
+    }
+
+    switch (type) {
+        case MsgType::PairingRequest:
+            handlePairingRequest(payload, hdr.len);
+            break;
+        case MsgType::PairingConfirm:
+            handlePairingConfirm(payload, hdr.len);
+            break;
+        case MsgType::DeviceDiscovery:
+            sendDeviceInfo();
+            break;
+        case MsgType::Command: {
+            if (hdr.len >= 1) {
+                if (!msg.duplicate) {
+                    executed_.push_back(payload[0]);
+                }
+                if (command_acks_) {
+                    espnow::CommandAckPayload ack{ payload[0], espnow::COMMAND_RESULT_OK_ };
+                    reply(MsgType::CommandAck, &ack, sizeof(ack), hdr.id);
+                }
+            }
+            break;
+        }
+        case MsgType::ConfigSet:
+            reply(MsgType::ConfigAck, nullptr, 0, hdr.id);
+            break;
+        case MsgType::ConfigFieldSet:
+            reply(MsgType::ConfigFieldAck, nullptr, 0, hdr.id);
+            break;
+        case MsgType::Fragment:
+            reply(MsgType::FragmentAck, nullptr, 0, hdr.id);
+            break;
+        case MsgType::ChannelSwitch:
+            if (msg.duplicate) {
+                reply(MsgType::ChannelSwitchAck, nullptr, 0, hdr.id);
+            } else {
+                handleChannelSwitch(hdr, payload, now_us);
+            }
+            break;
+        case MsgType::ChannelProbe:
+            reply(MsgType::ChannelProbeAck, payload, hdr.len);
+            break;
+        case MsgType::BulkStart:
+            handleBulkStart(payload, hdr.len, now_us);
+            break;
+        case MsgType::BulkData:
+            handleBulkData(payload, hdr.len, now_us);
+            break;
+        case MsgType::BulkAck:
+            handleBulkAck(payload, hdr.len, now_us);
+            break;
+        case MsgType::TimeSync: {
+            espnow::TimeSyncPayload sync{};
+            if (hdr.len >= sizeof(sync)) {
+                std::memcpy(&sync, payload, sizeof(sync));
+                sync.t2_us = now_us;
+                sync.t3_us = esp_timer_get_time();
+                reply(MsgType::TimeSyncReply, &sync, sizeof(sync));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    log_.push_back(msg);
+    if (hook_) {
+        hook_(log_.back());
+    }
+}
+
+void Device::handlePairingRequest(const uint8_t* payload, uint8_t len)
+{
+    PairingRequestPayload req{};
+    if (!pairing_mode_ || len < sizeof(req)) {
+        return;
+    }
+    std::memcpy(&req, payload, sizeof(req));
+    if (req.expected_peer_type != static_cast<uint8_t>(DeviceType::FatigueTester)) {
+        return;
+    }
+
+    // A new pairing drops the old key; the response and confirm travel in the clear
+    has_key_ = false;
+    std::memcpy(requester_mac_, req.requester_mac, 6);
+    std::memcpy(requester_challenge_, req.challenge, CHALLENGE_SIZE);
+    GenerateChallenge(my_challenge_);
+
+    uint8_t buf[sizeof(PairingResponsePayload) + 1] = {};
+    PairingResponsePayload resp{};
+    std::memcpy(resp.responder_mac, Mac(), 6);
+    resp.device_type = static_cast<uint8_t>(DeviceType::FatigueTester);
+    std::memcpy(resp.challenge, my_challenge_, CHALLENGE_SIZE);
+    if (options_.mac_bound_hmac) {
+        ComputeResponseHmac(req.challenge, resp.responder_mac, resp.hmac_response);
+    } else {
+        ComputePairingHmac(req.challenge, CHALLENGE_SIZE, resp.hmac_response);
+    }
+    std::strncpy(resp.device_name, options_.name.c_str(), MAX_DEVICE_NAME_LEN - 1);
+    std::memcpy(buf, &resp, sizeof(resp));
+    uint8_t flags = (options_.link_key ? PAIRING_FLAG_LINK_KEY : 0) |
+                    (options_.mac_bound_hmac ? PAIRING_FLAG_MAC_BOUND : 0);
+    buf[sizeof(resp)] = flags;
+
+    // Firmware without either feature sends the bare struct
+    reply(espnow::MsgType::PairingResponse, buf, static_cast<uint8_t>(flags ? sizeof(buf) : sizeof(resp)));
+}
+
+void Device::handlePairingConfirm(const uint8_t* payload, uint8_t len)
+{
+    PairingConfirmPayload confirm{};
+    if (!pairing_mode_ || len < sizeof(confirm)) {
+        return;
+    }
+    std::memcpy(&confirm, payload, sizeof(confirm));
+    if (!confirm.success || !MacEquals(confirm.confirmer_mac, requester_mac_) ||
+        !VerifyPairingHmac(my_challenge_, CHALLENGE_SIZE, confirm.hmac_response)) {
+        return;
+    }
+
+    uint8_t flags = (len > sizeof(confirm)) ? payload[sizeof(confirm)] : 0;
+    if (options_.link_key && (flags & PAIRING_FLAG_LINK_KEY)) {
+        DeriveLinkKey(requester_challenge_, my_challenge_, confirm.confirmer_mac, Mac(), lmk_);
+        has_key_ = true;
+    }
+    paired_ = true;
+    pairing_mode_ = false;
+}
+
+void Device::handleChannelSwitch(const espnow::EspNowHeader& hdr, const uint8_t* payload, int64_t now_us)
+{
+    espnow::ChannelSwitchPayload req{};
+    if (hdr.len < sizeof(req)) {
+        return;
+    }
+    std::memcpy(&req, payload, sizeof(req));
+
+    // Acked on the channel it arrived on, before anything moves
+    reply(espnow::MsgType::ChannelSwitchAck, nullptr, 0, hdr.id);
+
+    if (req.channel == Channel() && req.rollback_ms == 0) {
+        rollback_channel_ = 0;      // Commit
+        switch_channel_ = 0;
+        return;
+    }
+    if (req.channel == 0 || req.channel > 14) {
+        return;
+    }
+    switch_channel_ = req.channel;
+    switch_at_us_ = now_us + static_cast<int64_t>(req.switch_delay_ms) * 1000;
+    switch_rollback_ms_ = req.rollback_ms;
+}
+
+void Device::handleBulkStart(const uint8_t* payload, uint8_t len, int64_t now_us)
+{
+    using espnow::BulkStatus;
+
+    espnow::BulkStartPayload req{};
+    if (len < sizeof(req) || !(options_.features & espnow::CAP_BULK_TRANSFER_)) {
+        return;
+    }
+    std::memcpy(&req, payload, sizeof(req));
+
+    espnow::BulkStartPayload answer = req;
+    answer.status = static_cast<uint8_t>(BulkStatus::Ok);
+
+    // A repeated request means our answer was lost: answer again, keep the transfer
+    if (req.transfer_id != bulk_id_) {
+        bulk_retransmissions_ += bulk_sender_.Retransmissions();
+        bulk_sender_.Start(0, BulkTransfer::WINDOW_, now_us);
+        bulk_id_ = 0;
+        bulk_direction_ = static_cast<espnow::BulkDirection>(req.direction);
+        bulk_object_ = static_cast<espnow::BulkObject>(req.object_id);
+        bulk_window_ = (req.window == 0 || req.window > BulkTransfer::WINDOW_) ? BulkTransfer::WINDOW_ : req.window;
+        bulk_data_.clear();
+
+        if (bulk_direction_ == espnow::BulkDirection::Download) {
+            auto it = bulk_objects_.find(bulk_object_);
+            if (it == bulk_objects_.end()) {
+                answer.status = static_cast<uint8_t>(BulkStatus::UnknownObject);
+            } else {
+                bulk_data_ = it->second;
+                bulk_sender_.Start(static_cast<uint32_t>(bulk_data_.size()), bulk_window_, now_us);
+            }
+        } else if (req.total_len > options_.max_upload) {
+            answer.status = static_cast<uint8_t>(BulkStatus::TooLarge);
+        } else {
+            bulk_receiver_.Start(req.total_len, bulk_window_);
+        }
+        if (answer.status == static_cast<uint8_t>(BulkStatus::Ok)) {
+            bulk_id_ = req.transfer_id;
+        }
+    }
+
+    if (answer.status == static_cast<uint8_t>(BulkStatus::Ok)) {
+        answer.window = bulk_window_;
+        if (bulk_direction_ == espnow::BulkDirection::Download) {
+            answer.total_len = static_cast<uint32_t>(bulk_data_.size());
+        }
+    } else {
+        answer.window = 0;
+    }
+    reply(espnow::MsgType::BulkStart, &answer, sizeof(answer));
+}
+
+void Device::handleBulkData(const uint8_t* payload, uint8_t len, int64_t now_us)
+{
+    espnow::BulkDataHeader hdr{};
+    if (len < sizeof(hdr)) {
+        return;
+    }
+    std::memcpy(&hdr, payload, sizeof(hdr));
+    if (bulk_id_ == 0 || hdr.transfer_id != bulk_id_ || bulk_direction_ != espnow::BulkDirection::Upload) {
+        return;
+    }
+
+    // Written strictly in order, as a flash sink would be
+    BulkTransfer::Sink sink{
+        [](void*, uint32_t) { return true; },
+        [](void* ctx, uint32_t offset, const uint8_t* data, size_t size) {
+            auto& out = static_cast<Device*>(ctx)->bulk_data_;
+            if (offset != out.size()) {
+                return false;
+            }
+            out.insert(out.end(), data, data + size);
+            return true;
+        },
+        [](void*, bool) {},
+        this,
+    };
+    bool was_complete = bulk_receiver_.Complete();
+    if (bulk_receiver_.OnData(hdr.seq, payload + sizeof(hdr), len - sizeof(hdr), sink, now_us) ==
+        BulkTransfer::Receiver::Result::SinkFailed) {
+        espnow::BulkAckPayload abort{ bulk_id_, static_cast<uint8_t>(espnow::BulkStatus::StorageError), 0, 0 };
+        reply(espnow::MsgType::BulkAck, &abort, sizeof(abort));
+        bulk_id_ = 0;
+        return;
+    }
+    if (!was_complete && bulk_receiver_.Complete()) {
+        uploads_[bulk_object_] = bulk_data_;
+    }
+    if (bulk_receiver_.AckDue(now_us)) {
+        sendBulkAck();
+    }
+}
+
+void Device::handleBulkAck(const uint8_t* payload, uint8_t len, int64_t now_us)
+{
+    espnow::BulkAckPayload ack{};
+    if (len < sizeof(ack)) {
+        return;
+    }
+    std::memcpy(&ack, payload, sizeof(ack));
+    if (bulk_id_ == 0 || ack.transfer_id != bulk_id_) {
+        return;
+    }
+    if (ack.status != static_cast<uint8_t>(espnow::BulkStatus::Ok)) {
+        bulk_id_ = 0;   // The controller gave up
+        return;
+    }
+    if (bulk_direction_ == espnow::BulkDirection::Download) {
+        bulk_sender_.OnAck(ack.next_seq, ack.sack, now_us);
+    }
+}
+
+void Device::sendBulkAck()
+{
+    espnow::BulkAckPayload ack{};
+    bulk_receiver_.BuildAck(ack);
+    ack.transfer_id = bulk_id_;
+    reply(espnow::MsgType::BulkAck, &ack, sizeof(ack));
+}
+
+void Device::OnTick(int64_t now_us)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    // One chunk per tick, about what the radio takes to send one
+    if (bulk_id_ != 0 && bulk_direction_ == espnow::BulkDirection::Download) {
+        uint32_t seq = 0;
+        if (bulk_sender_.NextChunk(now_us, seq)) {
+            uint8_t buf[espnow::MAX_PAYLOAD_SIZE_];
+            espnow::BulkDataHeader hdr{ bulk_id_, 0, seq };
+            size_t chunk_len = BulkTransfer::ChunkLength(static_cast<uint32_t>(bulk_data_.size()), seq);
+            std::memcpy(buf, &hdr, sizeof(hdr));
+            std::memcpy(buf + sizeof(hdr), bulk_data_.data() + seq * espnow::BULK_CHUNK_SIZE_, chunk_len);
+            reply(espnow::MsgType::BulkData, buf, static_cast<uint8_t>(sizeof(hdr) + chunk_len));
+            bulk_sender_.OnSent(seq, now_us);
+        } else if (bulk_sender_.Failed()) {
+            espnow::BulkAckPayload abort{ bulk_id_, static_cast<uint8_t>(espnow::BulkStatus::Aborted), 0, 0 };
+            reply(espnow::MsgType::BulkAck, &abort, sizeof(abort));
+            bulk_id_ = 0;
+        }
+    }
+    if (bulk_id_ != 0 && bulk_direction_ == espnow::BulkDirection::Upload && bulk_receiver_.AckDue(now_us)) {
+        sendBulkAck();
+    }
+
+    if (switch_channel_ != 0 && now_us >= switch_at_us_) {
+        uint8_t from = Channel();
+        SetChannel(switch_channel_);
+        channel_switches_++;
+        if (switch_rollback_ms_ != 0) {
+            rollback_channel_ = from;
+            rollback_at_us_ = now_us + static_cast<int64_t>(switch_rollback_ms_) * 1000;
+        } else {
+            rollback_channel_ = 0;
+        }
+        switch_channel_ = 0;
+    }
+    if (rollback_channel_ != 0 && now_us >= rollback_at_us_) {
+        SetChannel(rollback_channel_);
+        channel_switches_++;
+        rollbacks_++;
+        rollback_channel_ = 0;
+    }
+}
+
+} // namespace sim
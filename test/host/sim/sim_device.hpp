@@ -0,0 +1,159 @@
+/**
+ * @file sim_device.hpp
+ * @brief Simulated fatigue tester: the device side of the ESP-NOW protocol
+ *
+ * Answers the controller the way the tester firmware does: pairing with an
+ * optional link key, the capability exchange, acks that echo the request's
+ * header id, commands executed once however often they are retransmitted,
+ * timed channel switches with rollback, probes and time sync, and bulk
+ * transfers in both directions. Aggregate frames are unpacked. Everything it
+ * receives is logged for the test.
+ */
+
+#pragma once
+
+#include "sim_radio.hpp"
+#include "espnow_protocol.hpp"
+#include "espnow_bulk.hpp"
+#include "espnow_replay.hpp"
+#include "espnow_security.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+/// One message the device received from the controller (an Aggregate counts per sub-message)
+struct Received {
+    espnow::MsgType type;
+    uint8_t  device_id;
+    uint8_t  id;                ///< Header id (sub-message id inside an Aggregate)
+    bool     duplicate;         ///< Id already accepted (or older than the window): acked again, not executed
+    bool     aggregated;
+    bool     encrypted;
+    uint8_t  channel;
+    int64_t  rx_us;
+    std::vector<uint8_t> payload;
+};
+
+struct DeviceOptions {
+    std::string name = "SimTester";
+    uint32_t features = espnow::CAP_RELIABLE_ACK_ | espnow::CAP_CHANNEL_SWITCH_ | espnow::CAP_TIME_SYNC_;
+    bool     capability_block = true;   ///< false: legacy DeviceInfo without one
+    bool     link_key = true;           ///< Offer PAIRING_FLAG_LINK_KEY when pairing
+    bool     mac_bound_hmac = true;     ///< false: legacy responder, HMAC over the challenge alone
+    uint32_t max_upload = 64 * 1024;    ///< Larger bulk uploads are refused with TooLarge
+};
+
+class Device : public Station {
+public:
+    Device(const uint8_t mac[6], const DeviceOptions& options = DeviceOptions{}, uint8_t channel = 1);
+
+    /// Answer PairingRequest broadcasts until a pairing completes
+    void SetPairingMode(bool enabled);
+    bool IsPaired() const;
+    bool HasLinkKey() const;
+    bool GetLinkKey(uint8_t out[ESP_NOW_KEY_LEN]) const;
+
+    /// Send a message of our own to the controller (header id from our counter)
+    void SendMessage(espnow::MsgType type, const void* payload, uint8_t len);
+
+    /// Send an ack echoing echo_id, as a late or duplicated copy would arrive
+    void SendAck(espnow::MsgType type, const void* payload, uint8_t len, uint8_t echo_id);
+
+    /// Boot again: ids restart from 1, the controller's ids are forgotten, and a DeviceInfo announces us
+    void Restart();
+
+    /// Off: Commands are still logged and run, but never acked
+    void SetCommandAcks(bool enabled);
+
+    std::vector<Received> Log() const;
+    void ClearLog();
+
+    /// Commands executed, in order (retransmitted copies excluded)
+    std::vector<uint8_t> Executed() const;
+
+    /// Called for every received message in the air thread, after the device handled it
+    void SetReceiveHook(std::function<void(const Received& msg)> hook);
+
+    uint32_t DecryptFailures() const;
+    uint32_t ChannelSwitches() const;   ///< Channel changes made, rollbacks included
+    uint32_t Rollbacks() const;
+
+    /// Object served to bulk downloads (needs CAP_BULK_TRANSFER_ in the features)
+    void SetBulkObject(espnow::BulkObject object, std::vector<uint8_t> data);
+
+    /// Last completed upload of an object (empty if none)
+    std::vector<uint8_t> Uploaded(espnow::BulkObject object) const;
+
+    /// Chunks the device sent again while serving downloads
+    uint32_t BulkRetransmissions() const;
+
+protected:
+    void OnReceive(const Frame& frame) override;
+    void OnTick(int64_t now_us) override;
+
+private:
+    void handleMessage(const Frame& frame, const espnow::EspNowHeader& hdr, const uint8_t* payload,
+                       bool aggregated);
+    void handlePairingRequest(const uint8_t* payload, uint8_t len);
+    void handlePairingConfirm(const uint8_t* payload, uint8_t len);
+    void handleChannelSwitch(const espnow::EspNowHeader& hdr, const uint8_t* payload, int64_t now_us);
+    void handleBulkStart(const uint8_t* payload, uint8_t len, int64_t now_us);
+    void handleBulkData(const uint8_t* payload, uint8_t len, int64_t now_us);
+    void handleBulkAck(const uint8_t* payload, uint8_t len, int64_t now_us);
+    void sendBulkAck();
+    void sendDeviceInfo();
+    void reply(espnow::MsgType type, const void* payload, uint8_t len, int echo_id = -1);
+
+    DeviceOptions options_;
+    mutable std::recursive_mutex mutex_;
+
+    uint8_t  next_id_ = 1;
+    bool     pairing_mode_ = false;
+    bool     paired_ = false;
+    bool     command_acks_ = true;
+    uint8_t  requester_mac_[6] = {};
+    uint8_t  requester_challenge_[CHALLENGE_SIZE] = {};
+    uint8_t  my_challenge_[CHALLENGE_SIZE] = {};
+    bool     has_key_ = false;
+    uint8_t  lmk_[ESP_NOW_KEY_LEN] = {};
+
+    // Executed-once memory over the controller's unicast ids (broadcasts have their own)
+    espnow::ReplayWindow rx_window_;
+
+    // Channel switch in progress
+    uint8_t  switch_channel_ = 0;       ///< 0: none pending
+    int64_t  switch_at_us_ = 0;
+    uint16_t switch_rollback_ms_ = 0;
+    uint8_t  rollback_channel_ = 0;     ///< 0: no rollback armed
+    int64_t  rollback_at_us_ = 0;
+
+    // Bulk transfer in progress; one at a time, a new transfer_id replaces it
+    uint8_t  bulk_id_ = 0;              ///< 0: none
+    espnow::BulkDirection bulk_direction_ = espnow::BulkDirection::Download;
+    espnow::BulkObject bulk_object_ = espnow::BulkObject::CycleHistory;
+    uint8_t  bulk_window_ = 0;
+    std::vector<uint8_t> bulk_data_;    ///< Download: the object. Upload: bytes written so far
+    BulkTransfer::Sender   bulk_sender_;
+    BulkTransfer::Receiver bulk_receiver_;
+    uint32_t bulk_retransmissions_ = 0;     ///< Finished transfers; the running one is in bulk_sender_
+    std::map<espnow::BulkObject, std::vector<uint8_t>> bulk_objects_;
+    std::map<espnow::BulkObject, std::vector<uint8_t>> uploads_;
+
+    std::vector<Received> log_;
+    std::vector<uint8_t>  executed_;
+    std::function<void(const Received&)> hook_;
+    uint32_t decrypt_failures_ = 0;
+    uint32_t channel_switches_ = 0;
+    uint32_t rollbacks_ = 0;
+};
+
+/// MAC of the n-th simulated device (distinct, never the test unit's)
+void DeviceMac(uint8_t index, uint8_t out[6]);
+
+} // namespace sim
@@ -0,0 +1,372 @@
+/**
+ * @file sim_freertos.cpp
+ * @brief FreeRTOS on host threads
+ *
+ * Every task is a detached std::thread; priorities are ignored, so code under
+ * test sees true concurrency rather than a single core. Ticks are milliseconds
+ * of the same clock as esp_timer_get_time(). Every critical section takes one
+ * recursive lock, like masking interrupts on a single core.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/stream_buffer.h"
+#include "esp_timer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimTask {
+    std::string             name;
+    std::mutex              mutex;
+    std::condition_variable cv;
+    uint32_t                notify_count = 0;
+};
+
+struct SimQueue {
+    size_t                  item_size;
+    size_t                  length;
+    std::deque<std::vector<uint8_t>> items;
+    std::mutex              mutex;
+    std::condition_variable cv;
+};
+
+struct SimMutex {
+    std::timed_mutex mutex;
+};
+
+struct SimEventGroup {
+    EventBits_t             bits = 0;
+    std::mutex              mutex;
+    std::condition_variable cv;
+};
+
+struct SimStreamBuffer {
+    size_t                  size;
+    size_t                  trigger_level;
+    std::deque<uint8_t>     bytes;
+    std::mutex              mutex;
+    std::condition_variable cv;
+};
+
+namespace {
+
+std::recursive_mutex s_critical_;
+thread_local SimTask* t_current_task_ = nullptr;
+
+/// Wait on cv until pred holds or ticks pass (portMAX_DELAY: forever)
+template <typename Pred>
+bool waitTicks(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Pred pred)
+{
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(pdTICKS_TO_MS(ticks)), pred);
+}
+
+SimTask* currentTask()
+{
+    if (t_current_task_ == nullptr) {
+        // A thread the simulation did not start (main, test threads): adopt it
+        t_current_task_ = new SimTask();
+        t_current_task_->name = "host";
+    }
+    return t_current_task_;
+}
+
+} // namespace
+
+// ============================================================================
+// CRITICAL SECTIONS
+// ============================================================================
+
+void sim_enter_critical(portMUX_TYPE* mux)
+{
+    (void)mux;
+    s_critical_.lock();
+}
+
+void sim_exit_critical(portMUX_TYPE* mux)
+{
+    (void)mux;
+    s_critical_.unlock();
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* out_handle)
+{
+    (void)stack_depth;
+    (void)priority;
+    auto* task = new SimTask();
+    task->name = name ? name : "";
+    if (out_handle) {
+        *out_handle = task;
+    }
+    std::thread([fn, arg, task]() {
+        t_current_task_ = task;
+        fn(arg);
+        // Returning from a task function is a bug on target; park like vTaskDelete
+        vTaskDelete(nullptr);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+    // Task functions are noexcept, so the thread cannot be unwound: park it.
+    // Tests end with std::_Exit, which does not wait for it.
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return static_cast<TickType_t>(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (task == nullptr) {
+        return pdFAIL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notify_count++;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    SimTask* task = currentTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    waitTicks(task->cv, lock, ticks_to_wait, [task]() { return task->notify_count > 0; });
+    uint32_t count = task->notify_count;
+    if (count > 0) {
+        task->notify_count = clear_on_exit ? 0 : count - 1;
+    }
+    return count;
+}
+
+// ============================================================================
+// QUEUES
+// ============================================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    auto* queue = new SimQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitTicks(queue->cv, lock, ticks_to_wait, [queue]() { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    lock.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait)
+{
+    return xQueueSend(queue, item, ticks_to_wait);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken)
+{
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks_to_wait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitTicks(queue->cv, lock, ticks_to_wait, [queue]() { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    std::memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    lock.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->items.clear();
+    }
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return static_cast<UBaseType_t>(queue->items.size());
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return static_cast<UBaseType_t>(queue->length - queue->items.size());
+}
+
+// ============================================================================
+// MUTEXES
+// ============================================================================
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new SimMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    if (ticks_to_wait == portMAX_DELAY) {
+        sem->mutex.lock();
+        return pdTRUE;
+    }
+    return sem->mutex.try_lock_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks_to_wait))) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->mutex.unlock();
+    return pdTRUE;
+}
+
+// ============================================================================
+// EVENT GROUPS
+// ============================================================================
+
+EventGroupHandle_t xEventGroupCreate()
+{
+    return new SimEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t result;
+    {
+        std::lock_guard<std::mutex> lock(group->mutex);
+        group->bits |= bits;
+        result = group->bits;
+    }
+    group->cv.notify_all();
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks_to_wait)
+{
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [&]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool met = waitTicks(group->cv, lock, ticks_to_wait, satisfied);
+    EventBits_t result = group->bits;
+    if (met && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+// ============================================================================
+// STREAM BUFFERS
+// ============================================================================
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level)
+{
+    auto* buffer = new SimStreamBuffer();
+    buffer->size = size;
+    buffer->trigger_level = trigger_level ? trigger_level : 1;
+    return buffer;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void* data, size_t len, TickType_t ticks_to_wait)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t sent = 0;
+    std::unique_lock<std::mutex> lock(buffer->mutex);
+    while (sent < len) {
+        if (!waitTicks(buffer->cv, lock, ticks_to_wait, [buffer]() { return buffer->bytes.size() < buffer->size; })) {
+            break;
+        }
+        while (sent < len && buffer->bytes.size() < buffer->size) {
+            buffer->bytes.push_back(bytes[sent++]);
+        }
+        buffer->cv.notify_all();
+    }
+    return sent;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void* data, size_t len, TickType_t ticks_to_wait)
+{
+    auto* bytes = static_cast<uint8_t*>(data);
+    std::unique_lock<std::mutex> lock(buffer->mutex);
+    waitTicks(buffer->cv, lock, ticks_to_wait, [buffer]() { return buffer->bytes.size() >= buffer->trigger_level; });
+    size_t received = 0;
+    while (received < len && !buffer->bytes.empty()) {
+        bytes[received++] = buffer->bytes.front();
+        buffer->bytes.pop_front();
+    }
+    lock.unlock();
+    buffer->cv.notify_all();
+    return received;
+}
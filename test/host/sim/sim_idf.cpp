@@ -0,0 +1,473 @@
+/**
+ * @file sim_idf.cpp
+ * @brief ESP-IDF services on the host: log, timer, random, CRC, NVS, partitions
+ */
+
+#include "sim.hpp"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_crc.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// LOG
+// ============================================================================
+
+esp_log_level_t sim_log_level = ESP_LOG_INFO;
+
+static std::mutex s_log_mutex_;
+
+void sim_log(esp_log_level_t level, const char* tag, const char* fmt, ...)
+{
+    if (level > sim_log_level || level == ESP_LOG_NONE) {
+        return;
+    }
+    static const char LETTERS[] = "NEWIDV";
+    std::lock_guard<std::mutex> lock(s_log_mutex_);
+    std::printf("%c (%lld) %s: ", LETTERS[level], static_cast<long long>(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, fmt);
+    std::vprintf(fmt, args);
+    va_end(args);
+    std::printf("\n");
+}
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                     return "ESP_OK";
+        case ESP_FAIL:                   return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:             return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:        return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:      return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:       return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:          return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_TIMEOUT:            return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND:      return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_ESPNOW_NOT_INIT:    return "ESP_ERR_ESPNOW_NOT_INIT";
+        case ESP_ERR_ESPNOW_ARG:         return "ESP_ERR_ESPNOW_ARG";
+        case ESP_ERR_ESPNOW_FULL:        return "ESP_ERR_ESPNOW_FULL";
+        case ESP_ERR_ESPNOW_NOT_FOUND:   return "ESP_ERR_ESPNOW_NOT_FOUND";
+        case ESP_ERR_ESPNOW_EXIST:       return "ESP_ERR_ESPNOW_EXIST";
+        default:                         return "UNKNOWN ERROR";
+    }
+}
+
+// ============================================================================
+// TIMER, RANDOM, CRC
+// ============================================================================
+
+static const auto s_start_ = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_start_).count();
+}
+
+static std::mutex s_random_mutex_;
+static std::mt19937 s_random_(0x5EED);
+
+uint32_t esp_random()
+{
+    std::lock_guard<std::mutex> lock(s_random_mutex_);
+    return static_cast<uint32_t>(s_random_());
+}
+
+void esp_fill_random(void* buf, size_t len)
+{
+    auto* bytes = static_cast<uint8_t*>(buf);
+    for (size_t i = 0; i < len; ++i) {
+        bytes[i] = static_cast<uint8_t>(esp_random());
+    }
+}
+
+/// Same convention as the ROM: the running CRC is passed and returned un-inverted
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; ++i) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+// ============================================================================
+// NVS
+// ============================================================================
+// One in-memory partition. Writes take effect at once (nvs_commit is a no-op),
+// which is what the real implementation does for everything but its cache.
+// ============================================================================
+
+namespace {
+
+struct NvsEntry {
+    nvs_type_t           type;
+    std::vector<uint8_t> value;
+};
+
+using NvsNamespace = std::map<std::string, NvsEntry>;
+
+struct NvsHandle {
+    std::string     ns;
+    nvs_open_mode_t mode;
+};
+
+std::mutex s_nvs_mutex_;
+std::map<std::string, NvsNamespace> s_nvs_;
+std::map<nvs_handle_t, NvsHandle> s_nvs_handles_;
+nvs_handle_t s_nvs_next_handle_ = 1;
+
+NvsHandle* findHandle(nvs_handle_t handle)
+{
+    auto it = s_nvs_handles_.find(handle);
+    return it == s_nvs_handles_.end() ? nullptr : &it->second;
+}
+
+bool validKey(const char* key)
+{
+    return key != nullptr && std::strlen(key) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+esp_err_t setValue(nvs_handle_t handle, const char* key, nvs_type_t type, const void* value, size_t len)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    NvsHandle* h = findHandle(handle);
+    if (h == nullptr || !validKey(key)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(value);
+    s_nvs_[h->ns][key] = NvsEntry{ type, std::vector<uint8_t>(bytes, bytes + len) };
+    return ESP_OK;
+}
+
+/// Copy a value of the given type out; *len is the buffer size in, the value size out
+esp_err_t getValue(nvs_handle_t handle, const char* key, nvs_type_t type, void* out, size_t* len)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    NvsHandle* h = findHandle(handle);
+    if (h == nullptr || !validKey(key)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto& ns = s_nvs_[h->ns];
+    auto it = ns.find(key);
+    if (it == ns.end() || it->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    size_t size = it->second.value.size();
+    if (out == nullptr) {
+        *len = size;
+        return ESP_OK;
+    }
+    if (*len < size) {
+        *len = size;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    std::memcpy(out, it->second.value.data(), size);
+    *len = size;
+    return ESP_OK;
+}
+
+} // namespace
+
+struct nvs_opaque_iterator_t {
+    std::vector<nvs_entry_info_t> entries;
+    size_t                        index;
+};
+
+esp_err_t nvs_flash_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    s_nvs_.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* out_handle)
+{
+    if (name == nullptr || std::strlen(name) >= sizeof(nvs_entry_info_t::namespace_name) || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    if (mode == NVS_READONLY && s_nvs_.find(name) == s_nvs_.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    s_nvs_[name];
+    *out_handle = s_nvs_next_handle_++;
+    s_nvs_handles_[*out_handle] = NvsHandle{ name, mode };
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    s_nvs_handles_.erase(handle);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value)
+{
+    size_t len = sizeof(*out_value);
+    return getValue(handle, key, NVS_TYPE_U8, out_value, &len);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value)
+{
+    return setValue(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value)
+{
+    size_t len = sizeof(*out_value);
+    return getValue(handle, key, NVS_TYPE_U32, out_value, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value)
+{
+    return setValue(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length)
+{
+    if (length == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return getValue(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length)
+{
+    return setValue(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    NvsHandle* h = findHandle(handle);
+    if (h == nullptr || !validKey(key)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return s_nvs_[h->ns].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    NvsHandle* h = findHandle(handle);
+    if (h == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_nvs_[h->ns].clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+    return findHandle(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type,
+                         nvs_iterator_t* output_iterator)
+{
+    (void)part_name;
+    if (output_iterator == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto* it = new nvs_opaque_iterator_t{};
+    {
+        std::lock_guard<std::mutex> lock(s_nvs_mutex_);
+        for (const auto& [ns_name, ns] : s_nvs_) {
+            if (namespace_name && ns_name != namespace_name) {
+                continue;
+            }
+            for (const auto& [key, entry] : ns) {
+                if (type != NVS_TYPE_ANY && entry.type != type) {
+                    continue;
+                }
+                nvs_entry_info_t info{};
+                std::strncpy(info.namespace_name, ns_name.c_str(), sizeof(info.namespace_name) - 1);
+                std::strncpy(info.key, key.c_str(), sizeof(info.key) - 1);
+                info.type = entry.type;
+                it->entries.push_back(info);
+            }
+        }
+    }
+    if (it->entries.empty()) {
+        delete it;
+        *output_iterator = nullptr;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = it;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t* iterator)
+{
+    if (iterator == nullptr || *iterator == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (++(*iterator)->index >= (*iterator)->entries.size()) {
+        delete *iterator;
+        *iterator = nullptr;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t* out_info)
+{
+    if (iterator == nullptr || out_info == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_info = iterator->entries[iterator->index];
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    delete iterator;
+}
+
+// ============================================================================
+// PARTITIONS
+// ============================================================================
+
+namespace {
+
+constexpr uint32_t FLASH_SECTOR_SIZE = 4096;
+
+std::mutex s_partition_mutex_;
+std::map<const esp_partition_t*, std::vector<uint8_t>> s_partitions_;
+
+std::vector<uint8_t>* partitionData(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    auto it = s_partitions_.find(partition);
+    if (it == s_partitions_.end() || offset > partition->size || size > partition->size - offset) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+} // namespace
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+    std::lock_guard<std::mutex> lock(s_partition_mutex_);
+    auto* data = partitionData(partition, src_offset, size);
+    if (data == nullptr || dst == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::memcpy(dst, data->data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+    std::lock_guard<std::mutex> lock(s_partition_mutex_);
+    auto* data = partitionData(partition, dst_offset, size);
+    if (data == nullptr || src == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < size; ++i) {
+        (*data)[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    std::lock_guard<std::mutex> lock(s_partition_mutex_);
+    auto* data = partitionData(partition, offset, size);
+    if (data == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % partition->erase_size != 0 || size % partition->erase_size != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::memset(data->data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+// ============================================================================
+// NETIF / EVENT LOOP
+// ============================================================================
+
+esp_err_t esp_netif_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default()
+{
+    return ESP_OK;
+}
+
+// ============================================================================
+// TEST CONTROLS
+// ============================================================================
+
+void sim::Exit(int code)
+{
+    std::fflush(stdout);
+    std::fflush(stderr);
+    std::_Exit(code);
+}
+
+const esp_partition_t* sim::CreatePartition(const char* label, uint32_t size)
+{
+    auto* partition = new esp_partition_t{};
+    partition->size = (size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+    partition->erase_size = FLASH_SECTOR_SIZE;
+    std::strncpy(partition->label, label ? label : "", sizeof(partition->label) - 1);
+
+    std::lock_guard<std::mutex> lock(s_partition_mutex_);
+    partition->address = 0x110000;
+    for (const auto& [other, data] : s_partitions_) {
+        (void)data;
+        if (other->address + other->size > partition->address) {
+            partition->address = other->address + other->size;
+        }
+    }
+    s_partitions_[partition].assign(partition->size, 0xFF);
+    return partition;
+}
+
+void sim::SetRandomSeed(uint32_t seed)
+{
+    std::lock_guard<std::mutex> lock(s_random_mutex_);
+    s_random_.seed(seed);
+}
@@ -0,0 +1,604 @@
+/**
+ * @file sim_radio.cpp
+ * @brief Simulated air and the controller's esp_wifi / esp_now driver
+ */
+
+#include "sim_radio.hpp"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <thread>
+
+namespace sim {
+
+namespace {
+
+using MacKey = std::array<uint8_t, 6>;
+
+constexpr uint8_t BROADCAST[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+constexpr uint8_t MAX_WIFI_CHANNEL = 14;
+constexpr size_t  MAX_ENCRYPTED_PEERS = 7;      // CONFIG_ESP_WIFI_ESPNOW_MAX_ENCRYPT_NUM default
+
+MacKey key(const uint8_t mac[6])
+{
+    MacKey k;
+    std::memcpy(k.data(), mac, 6);
+    return k;
+}
+
+bool isBroadcast(const uint8_t mac[6])
+{
+    return std::memcmp(mac, BROADCAST, 6) == 0;
+}
+
+bool chance(double p)
+{
+    return p > 0.0 && (esp_random() % 1000000u) < static_cast<uint32_t>(p * 1000000.0);
+}
+
+} // namespace
+
+// ============================================================================
+// AIR
+// ============================================================================
+
+struct Air {
+    // Frames waiting for the medium
+    std::mutex              queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Frame>       queue;
+    size_t                  in_flight = 0;      ///< Queued plus the one on the air
+    bool                    started = false;
+
+    // Stations; held while any station callback runs
+    std::recursive_mutex    station_mutex;
+    std::vector<Station*>   stations;
+
+    // Controller radio and driver
+    std::mutex              ctrl_mutex;
+    uint8_t                 mac[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01 };
+    std::atomic<uint8_t>    channel{ 1 };
+    bool                    wifi_started = false;
+    bool                    espnow_init = false;
+    esp_now_recv_cb_t       recv_cb = nullptr;
+    esp_now_send_cb_t       send_cb = nullptr;
+    std::map<MacKey, esp_now_peer_info_t> peers;
+    std::function<void(const Frame&)> tap;
+
+    // Air parameters
+    std::mutex              param_mutex;
+    uint32_t                overhead_us = 150;
+    uint32_t                us_per_byte = 4;
+    double                  channel_loss[MAX_WIFI_CHANNEL + 1] = {};
+    uint32_t                channel_extra_us[MAX_WIFI_CHANNEL + 1] = {};
+
+    std::mutex              stats_mutex;
+    AirStats                stats{};
+
+    void Submit(Frame&& frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!started) {
+                started = true;
+                std::thread([this]() { Run(); }).detach();
+            }
+            queue.push_back(std::move(frame));
+            in_flight++;
+        }
+        queue_cv.notify_all();
+    }
+
+    int64_t Airtime(const Frame& frame)
+    {
+        std::lock_guard<std::mutex> lock(param_mutex);
+        uint8_t ch = frame.channel <= MAX_WIFI_CHANNEL ? frame.channel : 0;
+        return overhead_us + us_per_byte * frame.data.size() + channel_extra_us[ch];
+    }
+
+    double ChannelLoss(uint8_t ch)
+    {
+        std::lock_guard<std::mutex> lock(param_mutex);
+        return ch <= MAX_WIFI_CHANNEL ? channel_loss[ch] : 0.0;
+    }
+
+    void Count(uint32_t AirStats::*field)
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.*field += 1;
+    }
+
+    Station* FindStation(const uint8_t station_mac[6])
+    {
+        for (Station* s : stations) {
+            if (std::memcmp(s->mac_, station_mac, 6) == 0) {
+                return s;
+            }
+        }
+        return nullptr;
+    }
+
+    /// One station's copy of a controller frame: lost, or received (OnReceive runs)
+    bool ReachStation(Station* s, const Frame& frame)
+    {
+        if (s->Channel() != frame.channel) {
+            return false;
+        }
+        if (chance(s->GetLink().loss) || chance(ChannelLoss(frame.channel))) {
+            Count(&AirStats::lost);
+            return false;
+        }
+        Count(&AirStats::delivered);
+        s->OnReceive(frame);
+        return true;
+    }
+
+    void DeliverFromController(const Frame& frame)
+    {
+        bool acked = true;
+        {
+            std::lock_guard<std::recursive_mutex> lock(station_mutex);
+            if (isBroadcast(frame.dst)) {
+                for (Station* s : stations) {
+                    ReachStation(s, frame);
+                }
+            } else {
+                Station* s = FindStation(frame.dst);
+                acked = s != nullptr && ReachStation(s, frame);
+                if (acked && chance(s->GetLink().ack_loss)) {
+                    Count(&AirStats::acks_lost);
+                    acked = false;
+                }
+            }
+        }
+
+        esp_now_send_cb_t cb;
+        {
+            std::lock_guard<std::mutex> lock(ctrl_mutex);
+            cb = send_cb;
+        }
+        if (cb) {
+            uint8_t des[6];
+            uint8_t src[6];
+            std::memcpy(des, frame.dst, 6);
+            std::memcpy(src, frame.src, 6);
+            wifi_tx_info_t info{};
+            info.ifidx = WIFI_IF_STA;
+            info.des_addr = des;
+            info.src_addr = src;
+            info.data = frame.data.data();
+            info.data_len = static_cast<uint16_t>(frame.data.size());
+            info.rate = WIFI_PHY_RATE_1M_L;
+            cb(&info, acked ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+        }
+    }
+
+    void DeliverFromStation(const Frame& frame)
+    {
+        Link link;
+        {
+            std::lock_guard<std::recursive_mutex> lock(station_mutex);
+            Station* s = FindStation(frame.src);
+            if (s == nullptr) {
+                return;     // Station destroyed meanwhile
+            }
+            link = s->GetLink();
+        }
+
+        esp_now_recv_cb_t cb;
+        bool accept;
+        {
+            std::lock_guard<std::mutex> lock(ctrl_mutex);
+            cb = recv_cb;
+            if (!espnow_init || cb == nullptr || channel != frame.channel ||
+                (!isBroadcast(frame.dst) && std::memcmp(frame.dst, mac, 6) != 0)) {
+                return;
+            }
+            // An encrypted frame needs the same key registered for its sender
+            auto peer = peers.find(key(frame.src));
+            accept = !frame.encrypted ||
+                     (peer != peers.end() && peer->second.encrypt &&
+                      std::memcmp(peer->second.lmk, frame.lmk, ESP_NOW_KEY_LEN) == 0);
+        }
+        if (chance(link.loss) || chance(ChannelLoss(frame.channel))) {
+            Count(&AirStats::lost);
+            return;
+        }
+        if (!accept) {
+            Count(&AirStats::decrypt_failures);
+            return;
+        }
+        Count(&AirStats::delivered);
+
+        uint8_t src[6];
+        uint8_t des[6];
+        std::memcpy(src, frame.src, 6);
+        std::memcpy(des, frame.dst, 6);
+        wifi_pkt_rx_ctrl_t rx_ctrl{};
+        rx_ctrl.rssi = link.rssi;
+        rx_ctrl.channel = frame.channel;
+        rx_ctrl.noise_floor = static_cast<unsigned>(-95 & 0xFF);
+        rx_ctrl.timestamp = static_cast<uint32_t>(esp_timer_get_time());
+        esp_now_recv_info_t info{ src, des, &rx_ctrl };
+        cb(&info, frame.data.data(), static_cast<int>(frame.data.size()));
+    }
+
+    void Tick()
+    {
+        int64_t now_us = esp_timer_get_time();
+        std::lock_guard<std::recursive_mutex> lock(station_mutex);
+        for (Station* s : stations) {
+            s->OnTick(now_us);
+        }
+    }
+
+    void Run()
+    {
+        int64_t medium_free_us = 0;
+        while (true) {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !queue.empty(); });
+                if (queue.empty()) {
+                    lock.unlock();
+                    Tick();
+                    continue;
+                }
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            // The medium carries one frame at a time
+            int64_t now_us = esp_timer_get_time();
+            int64_t start_us = (medium_free_us > now_us) ? medium_free_us : now_us;
+            medium_free_us = start_us + Airtime(frame);
+            int64_t wait_us = medium_free_us - esp_timer_get_time();
+            if (wait_us > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+            }
+
+            bool from_controller;
+            {
+                std::lock_guard<std::mutex> lock(ctrl_mutex);
+                from_controller = std::memcmp(frame.src, mac, 6) == 0;
+            }
+            if (from_controller) {
+                DeliverFromController(frame);
+            } else {
+                DeliverFromStation(frame);
+            }
+            Tick();
+
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                in_flight--;
+            }
+            queue_cv.notify_all();
+        }
+    }
+};
+
+static Air& air()
+{
+    static Air* instance = new Air();   // Never destroyed: the air thread outlives main()
+    return *instance;
+}
+
+// ============================================================================
+// STATIONS
+// ============================================================================
+
+Station::Station(const uint8_t mac[6], uint8_t channel)
+    : channel_(channel)
+{
+    std::memcpy(mac_, mac, 6);
+    std::lock_guard<std::recursive_mutex> lock(air().station_mutex);
+    air().stations.push_back(this);
+}
+
+Station::~Station()
+{
+    std::lock_guard<std::recursive_mutex> lock(air().station_mutex);
+    auto& stations = air().stations;
+    for (auto it = stations.begin(); it != stations.end(); ++it) {
+        if (*it == this) {
+            stations.erase(it);
+            break;
+        }
+    }
+}
+
+void Station::SetLink(const Link& link)
+{
+    std::lock_guard<std::mutex> lock(link_mutex_);
+    link_ = link;
+}
+
+Link Station::GetLink() const
+{
+    std::lock_guard<std::mutex> lock(link_mutex_);
+    return link_;
+}
+
+void Station::Send(const uint8_t* data, size_t len, const uint8_t* dst, const uint8_t* lmk)
+{
+    Frame frame{};
+    std::memcpy(frame.src, mac_, 6);
+    if (dst) {
+        std::memcpy(frame.dst, dst, 6);
+    } else {
+        GetControllerMac(frame.dst);
+    }
+    frame.channel = channel_;
+    frame.encrypted = (lmk != nullptr);
+    if (lmk) {
+        std::memcpy(frame.lmk, lmk, sizeof(frame.lmk));
+    }
+    frame.tx_us = esp_timer_get_time();
+    frame.data.assign(data, data + len);
+    air().Count(&AirStats::station_frames);
+    air().Submit(std::move(frame));
+}
+
+// ============================================================================
+// TEST CONTROLS
+// ============================================================================
+
+void SetControllerMac(const uint8_t mac[6])
+{
+    std::lock_guard<std::mutex> lock(air().ctrl_mutex);
+    std::memcpy(air().mac, mac, 6);
+}
+
+void GetControllerMac(uint8_t out[6])
+{
+    std::lock_guard<std::mutex> lock(air().ctrl_mutex);
+    std::memcpy(out, air().mac, 6);
+}
+
+uint8_t ControllerChannel()
+{
+    return air().channel;
+}
+
+void SetAirtime(uint32_t overhead_us, uint32_t us_per_byte)
+{
+    std::lock_guard<std::mutex> lock(air().param_mutex);
+    air().overhead_us = overhead_us;
+    air().us_per_byte = us_per_byte;
+}
+
+void SetChannelConditions(uint8_t channel, double loss, uint32_t extra_airtime_us)
+{
+    if (channel > MAX_WIFI_CHANNEL) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(air().param_mutex);
+    air().channel_loss[channel] = loss;
+    air().channel_extra_us[channel] = extra_airtime_us;
+}
+
+void SetTxTap(std::function<void(const Frame& frame)> tap)
+{
+    std::lock_guard<std::mutex> lock(air().ctrl_mutex);
+    air().tap = std::move(tap);
+}
+
+bool WaitAirIdle(uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(air().queue_mutex);
+    return air().queue_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                   []() { return air().in_flight == 0; });
+}
+
+AirStats GetAirStats()
+{
+    std::lock_guard<std::mutex> lock(air().stats_mutex);
+    return air().stats;
+}
+
+} // namespace sim
+
+// ============================================================================
+// esp_wifi
+// ============================================================================
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config)
+{
+    return config ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    (void)storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start()
+{
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    sim::air().wifi_started = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    (void)second;
+    if (primary < 1 || primary > sim::MAX_WIFI_CHANNEL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    if (!sim::air().wifi_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sim::air().channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second)
+{
+    if (primary) *primary = sim::air().channel;
+    if (second) *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocol_bitmap)
+{
+    (void)ifx;
+    (void)protocol_bitmap;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6])
+{
+    (void)ifx;
+    sim::GetControllerMac(mac);
+    return ESP_OK;
+}
+
+// ============================================================================
+// esp_now
+// ============================================================================
+
+esp_err_t esp_now_init()
+{
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    if (!sim::air().wifi_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sim::air().espnow_init = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    if (!sim::air().espnow_init) return ESP_ERR_ESPNOW_NOT_INIT;
+    sim::air().recv_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    if (!sim::air().espnow_init) return ESP_ERR_ESPNOW_NOT_INIT;
+    sim::air().send_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_pmk(const uint8_t* pmk)
+{
+    return pmk ? ESP_OK : ESP_ERR_ESPNOW_ARG;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer)
+{
+    if (peer == nullptr) return ESP_ERR_ESPNOW_ARG;
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    auto& peers = sim::air().peers;
+    if (!sim::air().espnow_init) return ESP_ERR_ESPNOW_NOT_INIT;
+    if (peers.count(sim::key(peer->peer_addr))) return ESP_ERR_ESPNOW_EXIST;
+    if (peers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) return ESP_ERR_ESPNOW_FULL;
+    if (peer->encrypt) {
+        size_t encrypted = 0;
+        for (const auto& [mac, info] : peers) {
+            (void)mac;
+            encrypted += info.encrypt ? 1 : 0;
+        }
+        if (encrypted >= sim::MAX_ENCRYPTED_PEERS) return ESP_ERR_ESPNOW_FULL;
+    }
+    peers[sim::key(peer->peer_addr)] = *peer;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t* peer)
+{
+    if (peer == nullptr) return ESP_ERR_ESPNOW_ARG;
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    auto& peers = sim::air().peers;
+    auto it = peers.find(sim::key(peer->peer_addr));
+    if (it == peers.end()) return ESP_ERR_ESPNOW_NOT_FOUND;
+    if (peer->encrypt && !it->second.encrypt) {
+        size_t encrypted = 0;
+        for (const auto& [mac, info] : peers) {
+            (void)mac;
+            encrypted += info.encrypt ? 1 : 0;
+        }
+        if (encrypted >= sim::MAX_ENCRYPTED_PEERS) return ESP_ERR_ESPNOW_FULL;
+    }
+    it->second = *peer;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr)
+{
+    if (peer_addr == nullptr) return ESP_ERR_ESPNOW_ARG;
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    return sim::air().peers.erase(sim::key(peer_addr)) ? ESP_OK : ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+esp_err_t esp_now_get_peer(const uint8_t* peer_addr, esp_now_peer_info_t* peer)
+{
+    if (peer_addr == nullptr || peer == nullptr) return ESP_ERR_ESPNOW_ARG;
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    auto it = sim::air().peers.find(sim::key(peer_addr));
+    if (it == sim::air().peers.end()) return ESP_ERR_ESPNOW_NOT_FOUND;
+    *peer = it->second;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_peer_rate_config(const uint8_t* peer_addr, esp_now_rate_config_t* config)
+{
+    if (peer_addr == nullptr || config == nullptr) return ESP_ERR_ESPNOW_ARG;
+    std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+    return sim::air().peers.count(sim::key(peer_addr)) ? ESP_OK : ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len)
+{
+    if (peer_addr == nullptr || data == nullptr || len == 0 || len > ESP_NOW_MAX_DATA_LEN) {
+        return ESP_ERR_ESPNOW_ARG;
+    }
+
+    sim::Frame frame{};
+    std::function<void(const sim::Frame&)> tap;
+    {
+        std::lock_guard<std::mutex> lock(sim::air().ctrl_mutex);
+        if (!sim::air().espnow_init) return ESP_ERR_ESPNOW_NOT_INIT;
+        auto it = sim::air().peers.find(sim::key(peer_addr));
+        if (it == sim::air().peers.end()) return ESP_ERR_ESPNOW_NOT_FOUND;
+
+        std::memcpy(frame.src, sim::air().mac, 6);
+        std::memcpy(frame.dst, peer_addr, 6);
+        frame.channel = sim::air().channel;
+        frame.encrypted = it->second.encrypt && !sim::isBroadcast(peer_addr);
+        if (frame.encrypted) {
+            std::memcpy(frame.lmk, it->second.lmk, sizeof(frame.lmk));
+        }
+        tap = sim::air().tap;
+    }
+    frame.tx_us = esp_timer_get_time();
+    frame.data.assign(data, data + len);
+
+    if (tap) {
+        tap(frame);
+    }
+    sim::air().Count(&sim::AirStats::controller_frames);
+    sim::air().Submit(std::move(frame));
+    return ESP_OK;
+}
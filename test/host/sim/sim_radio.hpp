@@ -0,0 +1,130 @@
+/**
+ * @file sim_radio.hpp
+ * @brief Simulated air for ESP-NOW: the controller's radio plus test stations
+ *
+ * The controller side is the esp_wifi/esp_now API from stubs/. Stations are
+ * the devices around it. One air thread carries every frame in submission
+ * order, one at a time (airtime grows with length), and delivers it when its
+ * airtime ends to whoever is on the channel it was sent on. A unicast from
+ * the controller reports ESP_NOW_SEND_SUCCESS only if the station received it
+ * and its MAC ack was not lost; a broadcast always succeeds. Stations have no
+ * send callback and are heard by the controller only.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace sim {
+
+/// A frame on the air
+struct Frame {
+    uint8_t  src[6];
+    uint8_t  dst[6];
+    uint8_t  channel;           ///< Channel the sender was on when it queued the frame
+    bool     encrypted;         ///< Sent with a link key
+    uint8_t  lmk[16];
+    int64_t  tx_us;             ///< When it was queued (esp_now_send or Station::Send)
+    std::vector<uint8_t> data;
+};
+
+/// Conditions on the path between the controller and one station (both directions)
+struct Link {
+    double   loss = 0.0;        ///< Probability a frame is not received
+    double   ack_loss = 0.0;    ///< Controller to station: received, but the MAC ack is lost
+    int8_t   rssi = -50;        ///< Reported to the controller's receive callback
+};
+
+/**
+ * @brief A device on the air. Callbacks run in the air thread, one at a time.
+ */
+class Station {
+public:
+    explicit Station(const uint8_t mac[6], uint8_t channel = 1);
+    virtual ~Station();
+
+    Station(const Station&) = delete;
+    Station& operator=(const Station&) = delete;
+
+    const uint8_t* Mac() const { return mac_; }
+    uint8_t Channel() const { return channel_; }
+    void SetChannel(uint8_t channel) { channel_ = channel; }
+
+    void SetLink(const Link& link);
+    Link GetLink() const;
+
+    /**
+     * @brief Queue a frame on the current channel.
+     * @param dst nullptr for the controller
+     * @param lmk Link key to encrypt with, nullptr for plain
+     */
+    void Send(const uint8_t* data, size_t len, const uint8_t* dst = nullptr, const uint8_t* lmk = nullptr);
+
+protected:
+    /// A frame for this station (unicast to it, or broadcast) arrived
+    virtual void OnReceive(const Frame& frame) = 0;
+
+    /// Called about every millisecond, for timers
+    virtual void OnTick(int64_t now_us) { (void)now_us; }
+
+private:
+    friend struct Air;
+
+    uint8_t              mac_[6];
+    std::atomic<uint8_t> channel_;
+    mutable std::mutex   link_mutex_;
+    Link                 link_;
+};
+
+struct AirStats {
+    uint32_t controller_frames;     ///< Accepted by esp_now_send
+    uint32_t station_frames;
+    uint32_t delivered;             ///< Frame copies received (a broadcast counts per station)
+    uint32_t lost;                  ///< Copies dropped by link or channel loss
+    uint32_t acks_lost;
+    uint32_t decrypt_failures;      ///< Dropped by the controller: wrong or missing link key
+};
+
+/**
+ * @brief Controller MAC returned by esp_wifi_get_mac (set before espnow::Init).
+ */
+void SetControllerMac(const uint8_t mac[6]);
+void GetControllerMac(uint8_t out[6]);
+
+/**
+ * @brief Channel the controller's radio is on (esp_wifi_set_channel).
+ */
+uint8_t ControllerChannel();
+
+/**
+ * @brief Airtime of a frame: overhead_us + len * us_per_byte (default 150 + 4).
+ */
+void SetAirtime(uint32_t overhead_us, uint32_t us_per_byte);
+
+/**
+ * @brief Interference on a channel: extra loss for every frame sent there, and
+ *        extra airtime per frame (contention with other networks).
+ */
+void SetChannelConditions(uint8_t channel, double loss, uint32_t extra_airtime_us);
+
+/**
+ * @brief Observe every frame the controller hands to esp_now_send, in order.
+ *
+ * Runs in the sending task; pass nullptr to remove.
+ */
+void SetTxTap(std::function<void(const Frame& frame)> tap);
+
+/**
+ * @brief Wait until no frame is queued or in flight.
+ * @return false on timeout
+ */
+bool WaitAirIdle(uint32_t timeout_ms);
+
+AirStats GetAirStats();
+
+} // namespace sim
@@ -0,0 +1,228 @@
+/**
+ * @file sim_sha256.cpp
+ * @brief SHA-256 and HMAC-SHA256 behind the mbedtls API (FIPS 180-4, RFC 2104)
+ */
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/md.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr size_t BLOCK_SIZE = 64;
+constexpr size_t DIGEST_SIZE = 32;
+
+uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+void processBlock(uint32_t state[8], const unsigned char block[BLOCK_SIZE])
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[4 * i]) << 24) | (static_cast<uint32_t>(block[4 * i + 1]) << 16) |
+               (static_cast<uint32_t>(block[4 * i + 2]) << 8) | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+const mbedtls_md_info_t SHA256_INFO = { MBEDTLS_MD_SHA256 };
+
+} // namespace
+
+// ============================================================================
+// SHA-256
+// ============================================================================
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx)
+{
+    std::memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx)
+{
+    if (ctx) {
+        std::memset(ctx, 0, sizeof(*ctx));
+    }
+}
+
+void mbedtls_sha256_clone(mbedtls_sha256_context* dst, const mbedtls_sha256_context* src)
+{
+    *dst = *src;
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224)
+{
+    static constexpr uint32_t IV256[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    static constexpr uint32_t IV224[8] = {
+        0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4,
+    };
+    std::memcpy(ctx->state, is224 ? IV224 : IV256, sizeof(ctx->state));
+    ctx->total = 0;
+    ctx->is224 = is224;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t ilen)
+{
+    size_t fill = static_cast<size_t>(ctx->total % BLOCK_SIZE);
+    ctx->total += ilen;
+
+    if (fill > 0) {
+        size_t take = BLOCK_SIZE - fill;
+        if (ilen < take) {
+            std::memcpy(ctx->buffer + fill, input, ilen);
+            return 0;
+        }
+        std::memcpy(ctx->buffer + fill, input, take);
+        processBlock(ctx->state, ctx->buffer);
+        input += take;
+        ilen -= take;
+    }
+    while (ilen >= BLOCK_SIZE) {
+        processBlock(ctx->state, input);
+        input += BLOCK_SIZE;
+        ilen -= BLOCK_SIZE;
+    }
+    std::memcpy(ctx->buffer, input, ilen);
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32])
+{
+    uint64_t bit_len = ctx->total * 8;
+    size_t fill = static_cast<size_t>(ctx->total % BLOCK_SIZE);
+
+    unsigned char pad[BLOCK_SIZE * 2] = { 0x80 };
+    size_t pad_len = (fill < BLOCK_SIZE - 8) ? BLOCK_SIZE - 8 - fill : 2 * BLOCK_SIZE - 8 - fill;
+    unsigned char len_be[8];
+    for (int i = 0; i < 8; ++i) {
+        len_be[i] = static_cast<unsigned char>(bit_len >> (56 - 8 * i));
+    }
+    mbedtls_sha256_update(ctx, pad, pad_len);
+    mbedtls_sha256_update(ctx, len_be, sizeof(len_be));
+
+    size_t words = ctx->is224 ? 7 : 8;
+    for (size_t i = 0; i < words; ++i) {
+        output[4 * i]     = static_cast<unsigned char>(ctx->state[i] >> 24);
+        output[4 * i + 1] = static_cast<unsigned char>(ctx->state[i] >> 16);
+        output[4 * i + 2] = static_cast<unsigned char>(ctx->state[i] >> 8);
+        output[4 * i + 3] = static_cast<unsigned char>(ctx->state[i]);
+    }
+    return 0;
+}
+
+// ============================================================================
+// HMAC (mbedtls_md, SHA-256 only)
+// ============================================================================
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type)
+{
+    return md_type == MBEDTLS_MD_SHA256 ? &SHA256_INFO : nullptr;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t* ctx)
+{
+    std::memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md_free(mbedtls_md_context_t* ctx)
+{
+    if (ctx) {
+        std::memset(ctx, 0, sizeof(*ctx));
+    }
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t* ctx, const mbedtls_md_info_t* md_info, int hmac)
+{
+    if (md_info == nullptr || md_info->type != MBEDTLS_MD_SHA256) {
+        return -1;
+    }
+    ctx->md_info = md_info;
+    ctx->hmac = hmac;
+    return 0;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t* ctx, const unsigned char* key, size_t keylen)
+{
+    if (ctx->md_info == nullptr || !ctx->hmac) {
+        return -1;
+    }
+    unsigned char block[BLOCK_SIZE] = {};
+    if (keylen > BLOCK_SIZE) {
+        mbedtls_sha256_context hash;
+        mbedtls_sha256_init(&hash);
+        mbedtls_sha256_starts(&hash, 0);
+        mbedtls_sha256_update(&hash, key, keylen);
+        mbedtls_sha256_finish(&hash, block);
+    } else if (keylen > 0) {
+        std::memcpy(block, key, keylen);
+    }
+
+    unsigned char ipad[BLOCK_SIZE];
+    unsigned char opad[BLOCK_SIZE];
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        ipad[i] = static_cast<unsigned char>(block[i] ^ 0x36);
+        opad[i] = static_cast<unsigned char>(block[i] ^ 0x5C);
+    }
+    mbedtls_sha256_starts(&ctx->inner, 0);
+    mbedtls_sha256_update(&ctx->inner, ipad, sizeof(ipad));
+    mbedtls_sha256_starts(&ctx->outer, 0);
+    mbedtls_sha256_update(&ctx->outer, opad, sizeof(opad));
+    return 0;
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t* ctx, const unsigned char* input, size_t ilen)
+{
+    if (ctx->md_info == nullptr || !ctx->hmac) {
+        return -1;
+    }
+    return mbedtls_sha256_update(&ctx->inner, input, ilen);
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t* ctx, unsigned char* output)
+{
+    if (ctx->md_info == nullptr || !ctx->hmac) {
+        return -1;
+    }
+    unsigned char inner_digest[DIGEST_SIZE];
+    mbedtls_sha256_finish(&ctx->inner, inner_digest);
+    mbedtls_sha256_update(&ctx->outer, inner_digest, sizeof(inner_digest));
+    return mbedtls_sha256_finish(&ctx->outer, output);
+}
@@ -0,0 +1,6 @@
+// Host stub of driver/i2c_master.h (only the port type config.hpp names)
+#pragma once
+
+#include "driver/gpio.h"
+
+typedef enum { I2C_NUM_0 = 0, I2C_NUM_1 } i2c_port_t;
@@ -0,0 +1,6 @@
+// Host stub of esp_crc.h
+#pragma once
+
+#include <cstdint>
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,26 @@
+// Host stub of esp_err.h
+#pragma once
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#define ESP_ERR_NO_MEM                  0x101
+#define ESP_ERR_INVALID_ARG             0x102
+#define ESP_ERR_INVALID_STATE           0x103
+#define ESP_ERR_INVALID_SIZE            0x104
+#define ESP_ERR_NOT_FOUND               0x105
+#define ESP_ERR_TIMEOUT                 0x107
+#define ESP_ERR_NVS_NOT_FOUND           0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH      0x110c
+#define ESP_ERR_ESPNOW_NOT_INIT         0x3065
+#define ESP_ERR_ESPNOW_ARG              0x3066
+#define ESP_ERR_ESPNOW_FULL             0x3068
+#define ESP_ERR_ESPNOW_NOT_FOUND        0x3069
+#define ESP_ERR_ESPNOW_EXIST            0x306b
+
+const char* esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) do { (void)(x); } while (0)
@@ -0,0 +1,6 @@
+// Host stub of esp_netif.h
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t esp_netif_init();
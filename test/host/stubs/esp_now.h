@@ -0,0 +1,61 @@
+// Host stub of esp_now.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN            6
+#define ESP_NOW_KEY_LEN             16
+#define ESP_NOW_MAX_DATA_LEN        250
+#define ESP_NOW_MAX_TOTAL_PEER_NUM  20
+#define ESP_NOW_MAX_ENCRYPT_PEER_NUM 17
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+
+typedef struct {
+    uint8_t          peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t          lmk[ESP_NOW_KEY_LEN];
+    uint8_t          channel;
+    wifi_interface_t ifidx;
+    bool             encrypt;
+    void*            priv;
+} esp_now_peer_info_t;
+
+typedef struct {
+    uint8_t*            src_addr;
+    uint8_t*            des_addr;
+    wifi_pkt_rx_ctrl_t* rx_ctrl;
+} esp_now_recv_info_t;
+
+typedef struct {
+    wifi_interface_t ifidx;
+    uint8_t*         des_addr;
+    uint8_t*         src_addr;
+    const uint8_t*   data;
+    uint16_t         data_len;
+    wifi_phy_rate_t  rate;
+    int              tx_status;
+} wifi_tx_info_t;
+
+typedef struct {
+    wifi_phy_mode_t phymode;
+    wifi_phy_rate_t rate;
+    bool            ersu;
+    bool            dcm;
+} esp_now_rate_config_t;
+
+typedef void (*esp_now_recv_cb_t)(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+typedef void (*esp_now_send_cb_t)(const wifi_tx_info_t* info, esp_now_send_status_t status);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr);
+esp_err_t esp_now_get_peer(const uint8_t* peer_addr, esp_now_peer_info_t* peer);
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len);
+esp_err_t esp_now_set_pmk(const uint8_t* pmk);
+esp_err_t esp_now_set_peer_rate_config(const uint8_t* peer_addr, esp_now_rate_config_t* config);
@@ -0,0 +1,8 @@
+// Host stub of esp_random.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+uint32_t esp_random();
+void esp_fill_random(void* buf, size_t len);
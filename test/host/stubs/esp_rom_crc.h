@@ -0,0 +1,6 @@
+// Host stub of esp_rom_crc.h (espnow_crc.hpp only uses it on target)
+#pragma once
+
+#include <cstdint>
+
+uint16_t esp_rom_crc16_be(uint16_t crc, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,7 @@
+// Host stub of esp_timer.h
+#pragma once
+
+#include <cstdint>
+
+/// Microseconds since the simulation started (monotonic)
+int64_t esp_timer_get_time();
@@ -0,0 +1,63 @@
+// Host stub of esp_wifi.h
+#pragma once
+
+#include <cstdint>
+#include "esp_err.h"
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+typedef enum { WIFI_STORAGE_FLASH, WIFI_STORAGE_RAM } wifi_storage_t;
+typedef enum { WIFI_SECOND_CHAN_NONE = 0, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+
+typedef struct { int reserved; } wifi_init_config_t;
+#define WIFI_INIT_CONFIG_DEFAULT() wifi_init_config_t{0}
+
+#define WIFI_PROTOCOL_11B   0x01
+#define WIFI_PROTOCOL_11G   0x02
+#define WIFI_PROTOCOL_11N   0x04
+#define WIFI_PROTOCOL_LR    0x08
+#define WIFI_PROTOCOL_11AX  0x20
+
+typedef enum {
+    WIFI_PHY_MODE_LR,
+    WIFI_PHY_MODE_11B,
+    WIFI_PHY_MODE_11G,
+    WIFI_PHY_MODE_11A,
+    WIFI_PHY_MODE_HT20,
+    WIFI_PHY_MODE_HT40,
+    WIFI_PHY_MODE_HE20,
+} wifi_phy_mode_t;
+
+typedef enum {
+    WIFI_PHY_RATE_1M_L      = 0x00,
+    WIFI_PHY_RATE_2M_L      = 0x01,
+    WIFI_PHY_RATE_5M_L      = 0x02,
+    WIFI_PHY_RATE_11M_L     = 0x03,
+    WIFI_PHY_RATE_48M       = 0x08,
+    WIFI_PHY_RATE_24M       = 0x09,
+    WIFI_PHY_RATE_12M       = 0x0A,
+    WIFI_PHY_RATE_6M        = 0x0B,
+    WIFI_PHY_RATE_54M       = 0x0C,
+    WIFI_PHY_RATE_36M       = 0x0D,
+    WIFI_PHY_RATE_18M       = 0x0E,
+    WIFI_PHY_RATE_9M        = 0x0F,
+    WIFI_PHY_RATE_LORA_250K = 0x29,
+    WIFI_PHY_RATE_LORA_500K = 0x2A,
+} wifi_phy_rate_t;
+
+typedef struct {
+    signed   rssi : 8;
+    unsigned rate : 5;
+    unsigned channel : 4;
+    unsigned noise_floor : 8;
+    unsigned timestamp : 32;
+} wifi_pkt_rx_ctrl_t;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_start();
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second);
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocol_bitmap);
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]);
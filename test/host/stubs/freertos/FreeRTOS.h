@@ -0,0 +1,42 @@
+// Host stub of freertos/FreeRTOS.h (tasks are std::threads, see sim/sim_freertos.cpp)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdFAIL              0
+#define pdPASS              1
+#define portMAX_DELAY       0xFFFFFFFFu
+
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(t)    ((uint32_t)(((uint64_t)(t) * 1000) / configTICK_RATE_HZ))
+
+#define IRAM_ATTR
+
+/// Every critical section takes the same recursive lock, like a single core
+/// with interrupts masked; the mux itself is only a placeholder
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void sim_enter_critical(portMUX_TYPE* mux);
+void sim_exit_critical(portMUX_TYPE* mux);
+
+#define taskENTER_CRITICAL(mux)     sim_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)      sim_exit_critical(mux)
+#define portENTER_CRITICAL(mux)     sim_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)      sim_exit_critical(mux)
+#define taskENTER_CRITICAL_ISR(mux) sim_enter_critical(mux)
+#define taskEXIT_CRITICAL_ISR(mux)  sim_exit_critical(mux)
+#define portYIELD_FROM_ISR(...)     do { } while (0)
@@ -0,0 +1,10 @@
+// Host stub of freertos/semphr.h (mutexes only)
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
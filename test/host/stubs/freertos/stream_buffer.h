@@ -0,0 +1,10 @@
+// Host stub of freertos/stream_buffer.h
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimStreamBuffer* StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void* data, size_t len, TickType_t ticks_to_wait);
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void* data, size_t len, TickType_t ticks_to_wait);
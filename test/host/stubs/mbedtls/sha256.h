@@ -0,0 +1,19 @@
+// Host stub of mbedtls/sha256.h (implemented in sim/sim_sha256.cpp)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+typedef struct {
+    uint32_t      state[8];
+    uint64_t      total;        ///< Bytes hashed so far
+    unsigned char buffer[64];
+    int           is224;
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_clone(mbedtls_sha256_context* dst, const mbedtls_sha256_context* src);
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
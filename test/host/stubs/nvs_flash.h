@@ -0,0 +1,7 @@
+// Host stub of nvs_flash.h
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
@@ -0,0 +1,634 @@
+/**
+ * @file test_bulk.cpp
+ * @brief Bulk transfer window and SACK over lossy links
+ *
+ * First the window logic alone: a Sender and a Receiver joined by a
+ * simulated link on a fake clock (latency, jitter, data and ack loss), so
+ * retransmission counts are exact and runs repeat. Then whole transfers
+ * through the protocol stack to a simulated device: downloads into a flash
+ * partition and into a small stream buffer, and uploads from memory.
+ */
+
+#include "espnow_bulk.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace espnow;
+using BulkTransfer::Receiver;
+using BulkTransfer::Sender;
+
+namespace {
+
+std::vector<uint8_t> makeObject(size_t len, uint32_t seed)
+{
+    std::vector<uint8_t> data(len);
+    std::mt19937 rng(seed);
+    for (auto& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// ============================================================================
+// WINDOW LOGIC ON A FAKE CLOCK
+// ============================================================================
+
+struct LinkOptions {
+    uint8_t  window = BulkTransfer::WINDOW_;
+    double   data_loss = 0.0;
+    double   ack_loss = 0.0;
+    uint32_t latency_us = 2000;         ///< One way
+    uint32_t jitter_us = 0;             ///< Added at random per frame; reorders frames
+    uint32_t airtime_us = 800;          ///< Sender puts one chunk on the air per airtime
+    std::set<uint32_t> drop_first;      ///< Chunks whose first transmission is lost
+    int64_t  dead_after_us = -1;        ///< From then on nothing gets through
+    uint32_t seed = 1;
+};
+
+struct LinkResult {
+    bool     complete = false;
+    bool     failed = false;
+    bool     data_ok = false;
+    bool     in_order = true;           ///< Every sink write continued where the last ended
+    uint32_t chunks = 0;
+    uint32_t chunks_sent = 0;
+    uint32_t retransmissions = 0;
+    uint32_t data_lost = 0;
+    uint32_t acks_lost = 0;
+    uint32_t duplicates = 0;            ///< Counted by the receiver
+    uint32_t max_in_flight = 0;         ///< Sent beyond the highest cumulative ack the sender had
+    uint32_t max_transmissions = 0;     ///< Of any one chunk
+    int64_t  max_resend_delay_us = 0;   ///< Longest from a chunk's first send to its first resend
+    int64_t  elapsed_us = 0;
+};
+
+struct MemorySink {
+    std::vector<uint8_t> out;
+    bool in_order = true;
+
+    BulkTransfer::Sink sink()
+    {
+        return BulkTransfer::Sink{
+            [](void*, uint32_t) { return true; },
+            [](void* ctx, uint32_t offset, const uint8_t* data, size_t len) {
+                auto* self = static_cast<MemorySink*>(ctx);
+                if (offset != self->out.size()) {
+                    self->in_order = false;
+                    return false;
+                }
+                self->out.insert(self->out.end(), data, data + len);
+                return true;
+            },
+            [](void*, bool) {},
+            this,
+        };
+    }
+};
+
+/// A frame on the simulated link
+struct InFlight {
+    bool     ack;
+    uint32_t seq;           ///< Data
+    uint32_t next_seq;      ///< Ack
+    uint32_t sack;
+};
+
+LinkResult runLink(const std::vector<uint8_t>& object, const LinkOptions& options)
+{
+    constexpr int64_t STEP_US = 100;
+    constexpr int64_t LIMIT_US = 120LL * 1000 * 1000;
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    auto total = static_cast<uint32_t>(object.size());
+
+    LinkResult result{};
+    result.chunks = BulkTransfer::ChunkCount(total);
+
+    Sender tx;
+    Receiver rx;
+    MemorySink sink;
+    BulkTransfer::Sink out = sink.sink();
+    tx.Start(total, options.window, 0);
+    rx.Start(total, options.window);
+
+    std::multimap<int64_t, InFlight> link;
+    std::map<uint32_t, uint32_t> transmissions;
+    std::map<uint32_t, int64_t> first_sent_us;
+    uint32_t acked_next = 0;
+    int64_t next_tx_us = 0;
+    int64_t now_us = 0;
+
+    auto lost = [&](int64_t at_us, double loss) {
+        return (options.dead_after_us >= 0 && at_us >= options.dead_after_us) || chance(rng) < loss;
+    };
+    auto delay = [&]() {
+        return static_cast<int64_t>(options.latency_us) +
+               (options.jitter_us ? static_cast<int64_t>(rng() % options.jitter_us) : 0);
+    };
+    auto sendAck = [&]() {
+        BulkAckPayload ack{};
+        rx.BuildAck(ack);
+        if (lost(now_us, options.ack_loss)) {
+            result.acks_lost++;
+            return;
+        }
+        link.emplace(now_us + delay(), InFlight{ true, 0, ack.next_seq, ack.sack });
+    };
+
+    while (!tx.Complete() && !tx.Failed() && now_us < LIMIT_US) {
+        while (!link.empty() && link.begin()->first <= now_us) {
+            InFlight frame = link.begin()->second;
+            link.erase(link.begin());
+            if (frame.ack) {
+                if (frame.next_seq > acked_next) {
+                    acked_next = frame.next_seq;
+                }
+                tx.OnAck(frame.next_seq, frame.sack, now_us);
+                continue;
+            }
+            size_t offset = static_cast<size_t>(frame.seq) * BULK_CHUNK_SIZE_;
+            size_t len = BulkTransfer::ChunkLength(total, frame.seq);
+            rx.OnData(frame.seq, object.data() + offset, len, out, now_us);
+            if (rx.AckDue(now_us)) {
+                sendAck();
+            }
+        }
+        if (rx.AckDue(now_us)) {
+            sendAck();
+        }
+
+        uint32_t seq = 0;
+        if (now_us >= next_tx_us && tx.NextChunk(now_us, seq)) {
+            uint32_t sent = ++transmissions[seq];
+            if (sent == 1) {
+                first_sent_us[seq] = now_us;
+                uint32_t in_flight = seq + 1 - acked_next;
+                result.max_in_flight = std::max(result.max_in_flight, in_flight);
+            } else if (sent == 2) {
+                result.max_resend_delay_us = std::max(result.max_resend_delay_us, now_us - first_sent_us[seq]);
+            }
+            result.max_transmissions = std::max(result.max_transmissions, sent);
+
+            bool drop = (sent == 1 && options.drop_first.count(seq)) || lost(now_us, options.data_loss);
+            if (drop) {
+                result.data_lost++;
+            } else {
+                link.emplace(now_us + delay(), InFlight{ false, seq, 0, 0 });
+            }
+            tx.OnSent(seq, now_us);
+            next_tx_us = now_us + options.airtime_us;
+        }
+        now_us += STEP_US;
+    }
+
+    result.complete = tx.Complete();
+    result.failed = tx.Failed();
+    result.data_ok = rx.Complete() && sink.out == object;
+    result.in_order = sink.in_order;
+    result.chunks_sent = tx.ChunksSent();
+    result.retransmissions = tx.Retransmissions();
+    result.duplicates = rx.Duplicates();
+    result.elapsed_us = now_us;
+    return result;
+}
+
+void testChunkMath()
+{
+    CHECK_EQ(BulkTransfer::ChunkCount(0), 0u);
+    CHECK_EQ(BulkTransfer::ChunkCount(1), 1u);
+    CHECK_EQ(BulkTransfer::ChunkCount(BULK_CHUNK_SIZE_), 1u);
+    CHECK_EQ(BulkTransfer::ChunkCount(BULK_CHUNK_SIZE_ + 1), 2u);
+    CHECK_EQ(BulkTransfer::ChunkLength(BULK_CHUNK_SIZE_ + 1, 0), BULK_CHUNK_SIZE_);
+    CHECK_EQ(BulkTransfer::ChunkLength(BULK_CHUNK_SIZE_ + 1, 1), 1u);
+    CHECK_EQ(BulkTransfer::ChunkLength(BULK_CHUNK_SIZE_ + 1, 2), 0u);
+    CHECK_EQ(BulkTransfer::ChunkCount(0xFFFFFFFFu), (0xFFFFFFFFull + BULK_CHUNK_SIZE_ - 1) / BULK_CHUNK_SIZE_);
+}
+
+void testReceiver()
+{
+    auto object = makeObject(10 * BULK_CHUNK_SIZE_ + 7, 3);
+    auto total = static_cast<uint32_t>(object.size());
+    auto chunk = [&](uint32_t seq) { return object.data() + seq * BULK_CHUNK_SIZE_; };
+    auto length = [&](uint32_t seq) { return BulkTransfer::ChunkLength(total, seq); };
+
+    Receiver rx;
+    MemorySink sink;
+    BulkTransfer::Sink out = sink.sink();
+    rx.Start(total, 4);
+    BulkAckPayload ack{};
+
+    CHECK(rx.OnData(0, chunk(0), length(0), out, 0) == Receiver::Result::Stored);
+    CHECK(!rx.AckDue(0));
+    CHECK(rx.AckDue(BulkTransfer::ACK_DELAY_MS_ * 1000));
+
+    // A gap is acked at once, with the chunk after it in the SACK
+    CHECK(rx.OnData(2, chunk(2), length(2), out, 0) == Receiver::Result::Stored);
+    CHECK(rx.AckDue(0));
+    rx.BuildAck(ack);
+    CHECK_EQ(ack.next_seq, 1u);
+    CHECK_EQ(ack.sack, 0x1u);
+    CHECK_EQ(sink.out.size(), BULK_CHUNK_SIZE_);
+
+    CHECK(rx.OnData(2, chunk(2), length(2), out, 0) == Receiver::Result::Duplicate);
+    CHECK(rx.OnData(0, chunk(0), length(0), out, 0) == Receiver::Result::Duplicate);
+    CHECK_EQ(rx.Duplicates(), 2u);
+    CHECK(rx.AckDue(0));
+    rx.BuildAck(ack);
+
+    // Window of 4 from chunk 1: chunk 5 is beyond it
+    CHECK(rx.OnData(5, chunk(5), length(5), out, 0) == Receiver::Result::OutOfWindow);
+    CHECK(rx.OnData(3, chunk(3), length(3) - 1, out, 0) == Receiver::Result::Invalid);
+    CHECK(rx.OnData(11, chunk(0), length(0), out, 0) == Receiver::Result::Invalid);
+
+    // Filling the gap writes the held chunk behind it
+    CHECK(rx.OnData(1, chunk(1), length(1), out, 0) == Receiver::Result::Stored);
+    CHECK_EQ(sink.out.size(), 3u * BULK_CHUNK_SIZE_);
+    CHECK_EQ(rx.BytesDone(), 3u * BULK_CHUNK_SIZE_);
+    rx.BuildAck(ack);
+    CHECK_EQ(ack.next_seq, 3u);
+    CHECK_EQ(ack.sack, 0u);
+
+    for (uint32_t seq = 3; seq < 11; ++seq) {
+        CHECK(rx.OnData(seq, chunk(seq), length(seq), out, 0) == Receiver::Result::Stored);
+    }
+    CHECK(rx.Complete());
+    CHECK(rx.AckDue(0));
+    CHECK_EQ(rx.BytesDone(), total);
+    CHECK(sink.out == object);
+    CHECK(sink.in_order);
+
+    // A sink that cannot take the data stops the transfer
+    Receiver full;
+    BulkTransfer::Sink failing{
+        [](void*, uint32_t) { return true; },
+        [](void*, uint32_t, const uint8_t*, size_t) { return false; },
+        [](void*, bool) {},
+        nullptr,
+    };
+    full.Start(total, 4);
+    CHECK(full.OnData(1, chunk(1), length(1), failing, 0) == Receiver::Result::Stored);
+    CHECK(full.OnData(0, chunk(0), length(0), failing, 0) == Receiver::Result::SinkFailed);
+}
+
+void testCleanLink()
+{
+    auto object = makeObject(50 * 1024, 1);
+
+    LinkResult r = runLink(object, LinkOptions{});
+    CHECK(r.complete);
+    CHECK(r.data_ok);
+    CHECK(r.in_order);
+    CHECK_EQ(r.chunks_sent, r.chunks);
+    CHECK_EQ(r.retransmissions, 0u);
+    CHECK_EQ(r.duplicates, 0u);
+
+    // A long link fills the window and never exceeds it
+    for (uint8_t window : { uint8_t{ 4 }, BulkTransfer::WINDOW_ }) {
+        LinkOptions options{};
+        options.window = window;
+        options.latency_us = 20000;
+        r = runLink(object, options);
+        CHECK(r.complete);
+        CHECK(r.data_ok);
+        CHECK_EQ(r.retransmissions, 0u);
+        CHECK_EQ(r.max_in_flight, window);
+        std::printf("clean, window %2u: %lu chunks in %lld ms\n", window,
+                    static_cast<unsigned long>(r.chunks), static_cast<long long>(r.elapsed_us / 1000));
+    }
+}
+
+void testSelectiveResend()
+{
+    auto object = makeObject(20 * 1024, 2);
+
+    // One loss costs one frame, resent when the SACK shows the hole, well before any timeout
+    LinkOptions one{};
+    one.drop_first = { 5 };
+    LinkResult r = runLink(object, one);
+    CHECK(r.complete);
+    CHECK(r.data_ok);
+    CHECK_EQ(r.retransmissions, 1u);
+    CHECK_EQ(r.chunks_sent, r.chunks + 1);
+    CHECK_EQ(r.duplicates, 0u);
+    CHECK(r.max_resend_delay_us < BulkTransfer::MIN_RTO_MS_ * 1000);
+
+    // A burst costs exactly its length
+    LinkOptions burst{};
+    burst.drop_first = { 10, 11, 12, 13, 40 };
+    r = runLink(object, burst);
+    CHECK(r.complete);
+    CHECK(r.data_ok);
+    CHECK_EQ(r.retransmissions, 5u);
+    CHECK(r.max_resend_delay_us < BulkTransfer::MIN_RTO_MS_ * 1000);
+
+    // The last chunk has nothing behind it to reveal the loss: its timer does
+    LinkOptions tail{};
+    uint32_t last = BulkTransfer::ChunkCount(static_cast<uint32_t>(object.size())) - 1;
+    tail.drop_first = { last };
+    r = runLink(object, tail);
+    CHECK(r.complete);
+    CHECK(r.data_ok);
+    CHECK_EQ(r.retransmissions, 1u);
+    CHECK(r.max_resend_delay_us >= BulkTransfer::MIN_RTO_MS_ * 1000);
+}
+
+void testRandomLoss()
+{
+    auto object = makeObject(64 * 1024, 4);
+
+    for (double loss : { 0.02, 0.05, 0.10, 0.20 }) {
+        uint32_t lost = 0;
+        uint32_t retransmissions = 0;
+        uint32_t sent = 0;
+        int64_t elapsed_us = 0;
+        for (uint32_t seed = 1; seed <= 10; ++seed) {
+            LinkOptions options{};
+            options.data_loss = loss;
+            options.ack_loss = loss;
+            options.seed = seed;
+            LinkResult r = runLink(object, options);
+            CHECK(r.complete);
+            CHECK(r.data_ok);
+            CHECK(r.in_order);
+            CHECK(r.max_in_flight <= BulkTransfer::WINDOW_);
+            CHECK(r.max_transmissions <= BulkTransfer::MAX_RETRANSMITS_ + 1u);
+            lost += r.data_lost;
+            retransmissions += r.retransmissions;
+            sent += r.chunks_sent;
+            elapsed_us += r.elapsed_us;
+        }
+        std::printf("loss %4.0f%%: %lu chunks lost, %lu resent (%.2f per loss), %lu sent, %lld ms per 64 KiB\n",
+                    loss * 100, static_cast<unsigned long>(lost), static_cast<unsigned long>(retransmissions),
+                    lost ? static_cast<double>(retransmissions) / lost : 0.0,
+                    static_cast<unsigned long>(sent), static_cast<long long>(elapsed_us / 10 / 1000));
+
+        // Selective: resends track losses, not losses times the window
+        CHECK(retransmissions >= lost);
+        CHECK(retransmissions <= lost + lost / 2 + 10);
+    }
+}
+
+void testReordering()
+{
+    auto object = makeObject(32 * 1024, 5);
+    for (uint32_t seed = 1; seed <= 10; ++seed) {
+        LinkOptions options{};
+        options.jitter_us = 3000;
+        options.data_loss = 0.05;
+        options.seed = seed;
+        LinkResult r = runLink(object, options);
+        CHECK(r.complete);
+        CHECK(r.data_ok);
+        CHECK(r.in_order);
+        CHECK(r.max_in_flight <= BulkTransfer::WINDOW_);
+    }
+}
+
+void testDeadLink()
+{
+    auto object = makeObject(32 * 1024, 6);
+    LinkOptions options{};
+    options.dead_after_us = 20000;
+    LinkResult r = runLink(object, options);
+    CHECK(r.failed);
+    CHECK(!r.complete);
+    CHECK_EQ(r.max_transmissions, BulkTransfer::MAX_RETRANSMITS_ + 1u);
+
+    // Backoff doubles up to MAX_RTO_MS_: the give-up time is bounded
+    CHECK(r.elapsed_us < 20000 + static_cast<int64_t>(BulkTransfer::MAX_RETRANSMITS_ + 1) *
+                                     BulkTransfer::MAX_RTO_MS_ * 1000);
+    std::printf("dead link: gave up after %lld ms\n", static_cast<long long>((r.elapsed_us - 20000) / 1000));
+}
+
+// ============================================================================
+// THROUGH THE STACK
+// ============================================================================
+
+uint8_t s_device_mac_[6];
+
+/// Loss starts once the handshake is done (it only has START_ATTEMPTS_ tries); the window is under test
+bool waitRunning(sim::Device& device, double loss)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (BulkTransfer::GetProgress().state != BulkTransfer::State::Starting) {
+            device.SetLink(sim::Link{ loss, 0.0, -50 });
+            return BulkTransfer::GetProgress().state == BulkTransfer::State::Running;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+bool waitTransfer(BulkTransfer::Progress& progress, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        progress = BulkTransfer::GetProgress();
+        if (progress.state == BulkTransfer::State::Done || progress.state == BulkTransfer::State::Failed) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    progress = BulkTransfer::GetProgress();
+    return false;
+}
+
+void printProgress(const char* what, const BulkTransfer::Progress& p)
+{
+    std::printf("%s: %lu/%lu bytes in %lu ms (%lu B/s), %lu sent, %lu resent, %lu received, %lu duplicates, "
+                "%lu acks\n", what,
+                static_cast<unsigned long>(p.done_bytes), static_cast<unsigned long>(p.total_bytes),
+                static_cast<unsigned long>(p.elapsed_ms), static_cast<unsigned long>(p.bytes_per_second),
+                static_cast<unsigned long>(p.chunks_sent), static_cast<unsigned long>(p.retransmissions),
+                static_cast<unsigned long>(p.chunks_received), static_cast<unsigned long>(p.duplicates),
+                static_cast<unsigned long>(p.acks));
+}
+
+void testDownloadToPartition(sim::Device& device)
+{
+    auto object = makeObject(40 * 1024, 7);
+    device.SetBulkObject(BulkObject::CycleHistory, object);
+    const esp_partition_t* partition = sim::CreatePartition("history", 64 * 1024);
+
+    uint32_t resent_before = device.BulkRetransmissions();
+    CHECK(BulkTransfer::StartDownload(s_device_mac_, BulkObject::CycleHistory,
+                                      BulkTransfer::PartitionSink(partition)));
+    CHECK(!BulkTransfer::StartDownload(s_device_mac_, BulkObject::CycleHistory,
+                                       BulkTransfer::PartitionSink(partition)));    // One at a time
+    CHECK(waitRunning(device, 0.05));
+
+    BulkTransfer::Progress progress{};
+    CHECK(waitTransfer(progress, 20000));
+    device.SetLink(sim::Link{});
+    printProgress("download to partition", progress);
+
+    CHECK(progress.state == BulkTransfer::State::Done);
+    CHECK(progress.direction == BulkDirection::Download);
+    CHECK_EQ(progress.total_bytes, object.size());
+    CHECK_EQ(progress.done_bytes, object.size());
+    CHECK(progress.chunks_received >= BulkTransfer::ChunkCount(static_cast<uint32_t>(object.size())));
+    CHECK(progress.acks > 0);
+    CHECK(progress.bytes_per_second > 0);
+    CHECK(device.BulkRetransmissions() > resent_before);
+
+    std::vector<uint8_t> stored(object.size());
+    CHECK(esp_partition_read(partition, 0, stored.data(), stored.size()) == ESP_OK);
+    CHECK(stored == object);
+}
+
+struct Drain {
+    StreamBufferHandle_t buffer;
+    size_t expected;
+    std::vector<uint8_t> out;
+    std::atomic<bool> done{ false };
+};
+
+void drainTask(void* arg)
+{
+    auto* drain = static_cast<Drain*>(arg);
+    uint8_t buf[100];
+    while (drain->out.size() < drain->expected) {
+        size_t n = xStreamBufferReceive(drain->buffer, buf, sizeof(buf), pdMS_TO_TICKS(100));
+        drain->out.insert(drain->out.end(), buf, buf + n);
+        vTaskDelay(1);      // A slow consumer: the sink has to wait for room
+    }
+    drain->done = true;
+    vTaskDelete(nullptr);
+}
+
+void testDownloadToStreamBuffer(sim::Device& device)
+{
+    // Far larger than the buffer: the transfer is paced by the consumer
+    auto object = makeObject(24 * 1024, 8);
+    device.SetBulkObject(BulkObject::ErrorHistory, object);
+
+    Drain drain{};
+    drain.buffer = xStreamBufferCreate(1024, 1);
+    drain.expected = object.size();
+    xTaskCreate(drainTask, "drain", 4096, &drain, 5, nullptr);
+
+    CHECK(BulkTransfer::StartDownload(s_device_mac_, BulkObject::ErrorHistory,
+                                      BulkTransfer::StreamBufferSink(drain.buffer)));
+    CHECK(waitRunning(device, 0.03));
+    BulkTransfer::Progress progress{};
+    CHECK(waitTransfer(progress, 30000));
+    device.SetLink(sim::Link{});
+    printProgress("download to stream buffer", progress);
+
+    CHECK(progress.state == BulkTransfer::State::Done);
+    for (int i = 0; i < 200 && !drain.done; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK(drain.done);
+    CHECK(drain.out == object);
+}
+
+void testUpload(sim::Device& device)
+{
+    auto object = makeObject(30 * 1024, 9);
+    CHECK(BulkTransfer::StartUpload(s_device_mac_, BulkObject::ConfigBundle, static_cast<uint32_t>(object.size()),
+                                    BulkTransfer::MemorySource(object.data())));
+    CHECK(waitRunning(device, 0.05));
+    BulkTransfer::Progress progress{};
+    CHECK(waitTransfer(progress, 20000));
+    device.SetLink(sim::Link{});
+    printProgress("upload", progress);
+
+    CHECK(progress.state == BulkTransfer::State::Done);
+    CHECK(progress.direction == BulkDirection::Upload);
+    CHECK_EQ(progress.done_bytes, object.size());
+    CHECK(progress.retransmissions > 0);
+    CHECK_EQ(progress.chunks_sent,
+             BulkTransfer::ChunkCount(static_cast<uint32_t>(object.size())) + progress.retransmissions);
+    CHECK(progress.srtt_us > 0);
+    CHECK(device.Uploaded(BulkObject::ConfigBundle) == object);
+}
+
+void testRefused(sim::Device& device)
+{
+    BulkTransfer::Progress progress{};
+
+    auto big = makeObject(80 * 1024, 10);
+    CHECK(BulkTransfer::StartUpload(s_device_mac_, BulkObject::ConfigBundle, static_cast<uint32_t>(big.size()),
+                                    BulkTransfer::MemorySource(big.data())));
+    CHECK(waitTransfer(progress, 5000));
+    CHECK(progress.state == BulkTransfer::State::Failed);
+    CHECK(progress.status == BulkStatus::TooLarge);
+
+    MemorySink sink;
+    CHECK(BulkTransfer::StartDownload(s_device_mac_, static_cast<BulkObject>(99), sink.sink()));
+    CHECK(waitTransfer(progress, 5000));
+    CHECK(progress.state == BulkTransfer::State::Failed);
+    CHECK(progress.status == BulkStatus::UnknownObject);
+
+    // A device that stops answering mid-transfer: the controller gives up
+    auto object = makeObject(40 * 1024, 11);
+    device.SetBulkObject(BulkObject::CycleHistory, object);
+    CHECK(BulkTransfer::StartDownload(s_device_mac_, BulkObject::CycleHistory, sink.sink()));
+    for (int i = 0; i < 500 && BulkTransfer::GetProgress().done_bytes < 4096; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    device.SetLink(sim::Link{ 1.0, 0.0, -50 });
+    CHECK(waitTransfer(progress, BulkTransfer::IDLE_TIMEOUT_MS_ + 3000));
+    device.SetLink(sim::Link{});
+    CHECK(progress.state == BulkTransfer::State::Failed);
+    CHECK(progress.status == BulkStatus::Timeout);
+    CHECK(progress.done_bytes < object.size());
+}
+
+void runThroughStack()
+{
+    sim::DeviceOptions options{};
+    options.features |= CAP_BULK_TRANSFER_;
+    sim::DeviceMac(0, s_device_mac_);
+    sim::Device device(s_device_mac_, options);
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    BulkTransfer::Init();
+    CHECK(AddApprovedPeer(s_device_mac_, DeviceType::FatigueTester, "bulk"));
+
+    device.SendMessage(MsgType::StatusUpdate, nullptr, 0);
+    PeerCapabilities caps{};
+    for (int i = 0; i < 200 && !GetPeerCapabilities(s_device_mac_, caps); ++i) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    CHECK(caps.Has(CAP_BULK_TRANSFER_));
+
+    testDownloadToPartition(device);
+    testDownloadToStreamBuffer(device);
+    testUpload(device);
+    testRefused(device);
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_WARN;
+
+    testChunkMath();
+    testReceiver();
+    testCleanLink();
+    testSelectiveResend();
+    testRandomLoss();
+    testReordering();
+    testDeadLink();
+
+    runThroughStack();
+    sim::Exit(host_test::TestResult("test_bulk"));
+}
@@ -0,0 +1,218 @@
+/**
+ * @file test_channel.cpp
+ * @brief Channel migration against a simulated multi-channel radio
+ *
+ * Runs ChannelManager::Migrate over the real protocol stack with simulated
+ * devices that switch channels and roll back as the tester firmware does.
+ * Faults are injected when the controller sends a peer its commit: the
+ * commits are lost for a while, the peer resets to the old channel, or the
+ * peer goes silent for good. A recovered peer must end up on the new
+ * channel, and the channel must be saved only if every peer acked.
+ */
+
+#include "espnow_channel.hpp"
+#include "espnow_protocol.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr uint8_t DEVICE_COUNT = 4;
+
+enum class Fault : uint8_t {
+    None,
+    LoseFirstCommits,   ///< The first COMMIT_ATTEMPTS_ commits are lost, later ones arrive
+    ResetToHome,        ///< The peer is back on the old channel when its first commit goes out
+    Dead,               ///< Nothing gets through from the first commit on
+};
+
+std::vector<std::unique_ptr<sim::Device>> s_devices_;
+uint8_t s_peers_[DEVICE_COUNT][6];
+
+std::atomic<Fault>   s_fault_{ Fault::None };
+std::atomic<uint8_t> s_fault_device_{ 0 };
+std::atomic<uint8_t> s_fault_home_{ 0 };
+std::atomic<int>     s_fault_commits_{ 0 };
+
+/// TX tap: inject the fault as the faulty peer's commit (forward, not a revert) is queued
+void onTx(const sim::Frame& frame)
+{
+    Fault fault = s_fault_.load();
+    sim::Device& device = *s_devices_[s_fault_device_];
+    if (fault == Fault::None || frame.data.size() < sizeof(EspNowHeader) + sizeof(ChannelSwitchPayload) ||
+        frame.data[3] != static_cast<uint8_t>(MsgType::ChannelSwitch) || !MacEquals(frame.dst, device.Mac())) {
+        return;
+    }
+    ChannelSwitchPayload req{};
+    std::memcpy(&req, frame.data.data() + sizeof(EspNowHeader), sizeof(req));
+    if (req.rollback_ms != 0 || req.channel == s_fault_home_) {
+        return;
+    }
+
+    int n = ++s_fault_commits_;
+    switch (fault) {
+        case Fault::LoseFirstCommits:
+            device.SetLink(sim::Link{ n <= ChannelManager::COMMIT_ATTEMPTS_ ? 1.0 : 0.0, 0.0, -50 });
+            break;
+        case Fault::ResetToHome:
+            if (n == 1) {
+                device.SetChannel(s_fault_home_);
+            }
+            break;
+        case Fault::Dead:
+            device.SetLink(sim::Link{ 1.0, 0.0, -50 });
+            break;
+        case Fault::None:
+            break;
+    }
+}
+
+void setFault(Fault fault, uint8_t device, uint8_t home)
+{
+    s_fault_device_ = device;
+    s_fault_home_ = home;
+    s_fault_commits_ = 0;
+    s_fault_ = fault;
+}
+
+/// @return 0 if nothing is saved
+uint8_t savedChannel()
+{
+    nvs_handle_t h;
+    uint8_t channel = 0;
+    if (nvs_open("espnow_chan", NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_u8(h, "channel", &channel);
+        nvs_close(h);
+    }
+    return channel;
+}
+
+bool allOn(uint8_t channel)
+{
+    bool all = sim::ControllerChannel() == channel;
+    for (auto& device : s_devices_) {
+        all &= device->Channel() == channel;
+    }
+    return all;
+}
+
+/// Longer than any trial's rollback timer, so a pending rollback has fired by then
+void waitOutRollbacks()
+{
+    vTaskDelay(pdMS_TO_TICKS(ChannelManager::ROLLBACK_MS_ + 500));
+}
+
+uint32_t totalRollbacks()
+{
+    uint32_t total = 0;
+    for (auto& device : s_devices_) {
+        total += device->Rollbacks();
+    }
+    return total;
+}
+
+void testDeadPeerSavesNothing()
+{
+    setFault(Fault::Dead, 3, 1);
+    int64_t start_us = esp_timer_get_time();
+    CHECK(!ChannelManager::Migrate(s_peers_, DEVICE_COUNT, 6));
+    std::printf("dead peer: gave up after %lld ms\n",
+                static_cast<long long>((esp_timer_get_time() - start_us) / 1000));
+    s_fault_ = Fault::None;
+
+    CHECK_EQ(sim::ControllerChannel(), 1);
+    CHECK_EQ(savedChannel(), 0);
+
+    // The committed peers were led back; the silent one returns on its rollback timer
+    for (uint8_t i = 0; i < 3; ++i) {
+        CHECK_EQ(s_devices_[i]->Channel(), 1);
+    }
+    s_devices_[3]->SetLink(sim::Link{});
+    waitOutRollbacks();
+    CHECK(allOn(1));
+    CHECK_EQ(s_devices_[3]->Rollbacks(), 1u);
+    CHECK_EQ(savedChannel(), 0);
+}
+
+void testLostCommitsRecovered()
+{
+    setFault(Fault::LoseFirstCommits, 1, 1);
+    CHECK(ChannelManager::Migrate(s_peers_, DEVICE_COUNT, 6));
+    s_fault_ = Fault::None;
+
+    CHECK(s_fault_commits_ > ChannelManager::COMMIT_ATTEMPTS_);
+    CHECK(allOn(6));
+    CHECK_EQ(savedChannel(), 6);
+}
+
+void testResetPeerRecovered()
+{
+    uint32_t switches_before = s_devices_[2]->ChannelSwitches();
+    setFault(Fault::ResetToHome, 2, 6);
+    CHECK(ChannelManager::Migrate(s_peers_, DEVICE_COUNT, 11));
+    s_fault_ = Fault::None;
+
+    // Found on the old channel, sent on a fresh trial and committed
+    CHECK(s_fault_commits_ > ChannelManager::COMMIT_ATTEMPTS_);
+    CHECK(s_devices_[2]->ChannelSwitches() >= switches_before + 2);
+    CHECK(allOn(11));
+    CHECK_EQ(savedChannel(), 11);
+}
+
+void testCommitsHold()
+{
+    // Every commit cancelled its peer's rollback: nobody leaves on their own
+    uint32_t rollbacks = totalRollbacks();
+    waitOutRollbacks();
+    CHECK(allOn(11));
+    CHECK_EQ(totalRollbacks(), rollbacks);
+
+    // And the saved channel is where the next boot starts
+    CHECK(SetChannel(1));
+    ChannelManager::Init();
+    CHECK_EQ(sim::ControllerChannel(), 11);
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_ERROR;
+
+    for (uint8_t i = 0; i < DEVICE_COUNT; ++i) {
+        sim::DeviceMac(i, s_peers_[i]);
+        s_devices_.push_back(std::make_unique<sim::Device>(s_peers_[i]));
+    }
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    ChannelManager::Init();
+    CHECK_EQ(sim::ControllerChannel(), WIFI_CHANNEL_);
+    for (auto& device : s_devices_) {
+        CHECK(AddApprovedPeer(device->Mac(), DeviceType::FatigueTester, "chan"));
+    }
+    sim::SetTxTap(onTx);
+
+    testDeadPeerSavesNothing();
+    testLostCommitsRecovered();
+    testResetPeerRecovered();
+    testCommitsHold();
+
+    sim::SetTxTap(nullptr);
+    sim::Exit(host_test::TestResult("test_channel"));
+}
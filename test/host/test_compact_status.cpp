@@ -0,0 +1,289 @@
+/**
+ * @file test_compact_status.cpp
+ * @brief Varint/zigzag primitives and the StatusCompact encoder/decoder pair
+ */
+
+#include "device_protocols.hpp"
+#include "test_support.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace device_protocols;
+
+namespace {
+
+bool sameSample(const FatigueTestStatusSample& a, const FatigueTestStatusSample& b)
+{
+    return a.cycle_number == b.cycle_number && a.state == b.state && a.err_code == b.err_code &&
+           a.has_time == b.has_time && (!a.has_time || a.device_time_us == b.device_time_us) &&
+           a.extras == b.extras && a.current_ma == b.current_ma &&
+           a.temperature_dc == b.temperature_dc && a.position == b.position;
+}
+
+void testZigZag()
+{
+    CHECK_EQ(ZigZagEncode(0), 0u);
+    CHECK_EQ(ZigZagEncode(-1), 1u);
+    CHECK_EQ(ZigZagEncode(1), 2u);
+    CHECK_EQ(ZigZagEncode(-2), 3u);
+    CHECK(ZigZagEncode(std::numeric_limits<int64_t>::max()) == std::numeric_limits<uint64_t>::max() - 1);
+    CHECK(ZigZagEncode(std::numeric_limits<int64_t>::min()) == std::numeric_limits<uint64_t>::max());
+
+    const int64_t values[] = { 0, 1, -1, 63, -64, 64, -65, INT32_MAX, INT32_MIN,
+                               std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() };
+    for (int64_t v : values) {
+        CHECK(ZigZagDecode(ZigZagEncode(v)) == v);
+    }
+}
+
+void testVarint()
+{
+    // Encoded length steps up every 7 bits
+    for (unsigned bits = 0; bits <= 64; ++bits) {
+        uint64_t value = bits == 0 ? 0 : (bits == 64 ? std::numeric_limits<uint64_t>::max()
+                                                     : (uint64_t{1} << bits) - 1);
+        uint8_t buf[10];
+        size_t pos = 0;
+        CHECK(PutVarint(buf, sizeof(buf), pos, value));
+        size_t expected = bits == 0 ? 1 : (bits + 6) / 7;
+        CHECK_EQ(pos, expected);
+
+        size_t rpos = 0;
+        uint64_t decoded = 0;
+        CHECK(GetVarint(buf, pos, rpos, decoded));
+        CHECK(decoded == value);
+        CHECK_EQ(rpos, pos);
+
+        // Every truncation is rejected
+        for (size_t cut = 0; cut < pos; ++cut) {
+            rpos = 0;
+            CHECK(!GetVarint(buf, cut, rpos, decoded));
+        }
+        // As is a buffer one byte short
+        if (pos > 0) {
+            size_t wpos = 0;
+            CHECK(!PutVarint(buf, pos - 1, wpos, value));
+        }
+    }
+
+    // Eleven continuation bytes are longer than 64 bits
+    uint8_t overlong[11];
+    for (auto& b : overlong) b = 0x80;
+    overlong[10] = 0x01;
+    size_t pos = 0;
+    uint64_t value = 0;
+    CHECK(!GetVarint(overlong, sizeof(overlong), pos, value));
+
+    // Values back to back
+    std::mt19937_64 rng(99);
+    std::vector<uint64_t> values(200);
+    std::vector<uint8_t> buf(values.size() * 10);
+    size_t wpos = 0;
+    for (auto& v : values) {
+        v = rng() >> (rng() % 64);
+        CHECK(PutVarint(buf.data(), buf.size(), wpos, v));
+    }
+    size_t rpos = 0;
+    for (uint64_t v : values) {
+        uint64_t got = 0;
+        CHECK(GetVarint(buf.data(), wpos, rpos, got) && got == v);
+    }
+    CHECK_EQ(rpos, wpos);
+}
+
+/// Steady running sizes the StatusCompact comment promises
+void testSteadySizes()
+{
+    CompactStatusEncoder enc;
+    CompactStatusDecoder dec;
+    FatigueTestStatusSample sample{};
+    sample.cycle_number = 100000;
+    sample.state = 1;
+    sample.has_time = true;
+    sample.device_time_us = 5000000;
+
+    uint8_t buf[COMPACT_STATUS_MAX_SIZE_];
+    FatigueTestStatusSample out{};
+    size_t len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK(len > 0);
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    CHECK(dec.AckDue());
+    espnow::StatusCompactAckPayload ack{};
+    dec.BuildAck(ack);
+    enc.OnAck(ack);
+
+    sample.cycle_number += 3;
+    sample.device_time_us += 100000;
+    len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK_EQ(len, 7u);
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    CHECK(sameSample(out, sample));
+
+    sample.has_time = false;
+    sample.cycle_number += 3;
+    len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK_EQ(len, 4u);
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    CHECK(sameSample(out, sample));
+}
+
+void testWorstCaseSize()
+{
+    FatigueTestStatusSample sample{};
+    sample.cycle_number = UINT32_MAX;
+    sample.state = 0xFF;
+    sample.err_code = 0xFF;
+    sample.has_time = true;
+    sample.device_time_us = std::numeric_limits<int64_t>::max();
+    sample.extras = COMPACT_EXTRA_CURRENT_ | COMPACT_EXTRA_TEMPERATURE_ | COMPACT_EXTRA_POSITION_;
+    sample.current_ma = INT32_MIN;
+    sample.temperature_dc = INT32_MIN;
+    sample.position = INT32_MIN;
+
+    FatigueTestStatusSample ref{};
+    ref.has_time = true;
+    ref.device_time_us = std::numeric_limits<int64_t>::min() / 2;
+
+    uint8_t buf[COMPACT_STATUS_MAX_SIZE_ + 8];
+    size_t key_len = EncodeCompactStatus(sample, 0, nullptr, 0, buf, sizeof(buf));
+    size_t delta_len = EncodeCompactStatus(sample, 1, &ref, 0, buf, sizeof(buf));
+    CHECK(key_len > 0 && key_len <= COMPACT_STATUS_MAX_SIZE_);
+    CHECK(delta_len > 0 && delta_len <= COMPACT_STATUS_MAX_SIZE_);
+
+    // Any smaller buffer is refused rather than overrun
+    for (size_t cap = 0; cap < key_len; ++cap) {
+        CHECK_EQ(EncodeCompactStatus(sample, 0, nullptr, 0, buf, cap), 0u);
+    }
+}
+
+/// Controller restart: deltas against a reference it no longer holds ask for a key frame
+void testMissingReference()
+{
+    CompactStatusEncoder enc;
+    CompactStatusDecoder dec;
+    FatigueTestStatusSample sample{};
+    sample.cycle_number = 10;
+    uint8_t buf[COMPACT_STATUS_MAX_SIZE_];
+    FatigueTestStatusSample out{};
+    espnow::StatusCompactAckPayload ack{};
+
+    size_t len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    dec.BuildAck(ack);
+    enc.OnAck(ack);
+
+    dec.Reset();
+    sample.cycle_number++;
+    len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::MissingReference);
+    CHECK(dec.AckDue());
+    dec.BuildAck(ack);
+    CHECK(ack.flags & espnow::STATUS_ACK_NEED_KEY_);
+    enc.OnAck(ack);
+
+    sample.cycle_number++;
+    len = enc.Encode(sample, buf, sizeof(buf));
+    CHECK(buf[0] & COMPACT_STATUS_KEY_);
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    CHECK(sameSample(out, sample));
+}
+
+void testTruncatedFrames()
+{
+    CompactStatusDecoder dec;
+    FatigueTestStatusSample sample{};
+    sample.cycle_number = 1234567;
+    sample.state = 2;
+    sample.err_code = 7;
+    sample.has_time = true;
+    sample.device_time_us = 987654321;
+    sample.extras = COMPACT_EXTRA_CURRENT_ | COMPACT_EXTRA_POSITION_;
+    sample.current_ma = -1500;
+    sample.position = 40000;
+
+    uint8_t buf[COMPACT_STATUS_MAX_SIZE_];
+    size_t len = EncodeCompactStatus(sample, 0, nullptr, 0, buf, sizeof(buf));
+    FatigueTestStatusSample out{};
+    for (size_t cut = 0; cut < len; ++cut) {
+        CHECK(dec.Decode(buf, cut, out) == CompactStatusDecoder::Result::Invalid);
+    }
+    CHECK(!dec.AckDue());
+
+    // Unknown extras bits are malformed
+    uint8_t bad[COMPACT_STATUS_MAX_SIZE_];
+    FatigueTestStatusSample plain{};
+    plain.extras = COMPACT_EXTRA_CURRENT_;
+    size_t bad_len = EncodeCompactStatus(plain, 0, nullptr, 0, bad, sizeof(bad));
+    bad[bad_len - 2] |= 1u << COMPACT_EXTRA_COUNT_;
+    CHECK(dec.Decode(bad, bad_len, out) == CompactStatusDecoder::Result::Invalid);
+
+    // The decoder is unharmed by the rejects
+    CHECK(dec.Decode(buf, len, out) == CompactStatusDecoder::Result::Ok);
+    CHECK(sameSample(out, sample));
+}
+
+/// Random walk of samples over a link that loses frames and acks
+void testLossyStream(std::mt19937& rng)
+{
+    CompactStatusEncoder enc;
+    CompactStatusDecoder dec;
+    FatigueTestStatusSample sample{};
+    sample.has_time = true;
+    sample.device_time_us = 1000000;
+
+    int decoded = 0;
+    int key_frames = 0;
+    size_t total_bytes = 0;
+    for (int i = 0; i < 5000; ++i) {
+        sample.cycle_number += rng() % 5;
+        sample.device_time_us += 90000 + rng() % 20000;
+        if (rng() % 200 == 0) sample.state = static_cast<uint8_t>(rng() % 5);
+        if (rng() % 500 == 0) sample.err_code = static_cast<uint8_t>(rng() % 10);
+        sample.extras = static_cast<uint8_t>(rng() % 8);
+        sample.current_ma = (sample.extras & COMPACT_EXTRA_CURRENT_) ? static_cast<int32_t>(rng() % 3000) - 1500 : 0;
+        sample.temperature_dc = (sample.extras & COMPACT_EXTRA_TEMPERATURE_) ? static_cast<int32_t>(rng() % 900) : 0;
+        sample.position = (sample.extras & COMPACT_EXTRA_POSITION_) ? static_cast<int32_t>(rng()) : 0;
+
+        uint8_t buf[COMPACT_STATUS_MAX_SIZE_];
+        size_t len = enc.Encode(sample, buf, sizeof(buf));
+        CHECK(len > 0 && len <= COMPACT_STATUS_MAX_SIZE_);
+        total_bytes += len;
+        if (buf[0] & COMPACT_STATUS_KEY_) key_frames++;
+        if (rng() % 100 < 20) continue;             // Frame lost
+
+        FatigueTestStatusSample out{};
+        auto result = dec.Decode(buf, len, out);
+        CHECK(result != CompactStatusDecoder::Result::Invalid);
+        if (result == CompactStatusDecoder::Result::Ok) {
+            decoded++;
+            CHECK(sameSample(out, sample));
+        }
+        if (dec.AckDue()) {
+            espnow::StatusCompactAckPayload ack{};
+            dec.BuildAck(ack);
+            if (rng() % 100 >= 20) enc.OnAck(ack);  // Ack lost otherwise
+        }
+    }
+    CHECK(decoded > 3500);
+    // Lost acks never force a resync: the encoder keeps its older reference
+    CHECK_EQ(key_frames, 1);
+    std::printf("lossy stream: %d decoded, %.2f bytes/sample\n", decoded, static_cast<double>(total_bytes) / 5000);
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(2024);
+    testZigZag();
+    testVarint();
+    testSteadySizes();
+    testWorstCaseSize();
+    testMissingReference();
+    testTruncatedFrames();
+    testLossyStream(rng);
+    return host_test::TestResult("test_compact_status");
+}
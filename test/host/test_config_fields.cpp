@@ -0,0 +1,280 @@
+/**
+ * @file test_config_fields.cpp
+ * @brief ConfigFieldSet/ConfigFieldReport TLV codec and the legacy fixed layout
+ *
+ * Runs EncodeConfigFields/DecodeConfigFields over the fatigue tester's field
+ * table: ids the table does not know and records of the wrong length are
+ * skipped, a payload cut mid-record applies only the whole records before
+ * the cut, and fields that do not fit out_cap are left out of sent_mask for
+ * the next send. DecodeLegacyConfig is checked at the sizes older firmware
+ * sent (17-byte base, 33 bytes with the bounds fields, 34 with SGT).
+ */
+
+#include "device_protocols.hpp"
+#include "test_support.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace espnow;
+using device_protocols::FatigueConfigField;
+using device_protocols::FatigueTestConfigPayload;
+
+namespace {
+
+const ConfigFieldDesc* const FIELDS = device_protocols::FATIGUE_CONFIG_FIELDS_;
+constexpr size_t COUNT = device_protocols::FATIGUE_CONFIG_FIELD_COUNT_;
+constexpr uint32_t ALL_FIELDS = (1u << COUNT) - 1;
+
+// Payload sizes of the fixed layout before ConfigFieldSet
+constexpr size_t LEGACY_BASE_SIZE = 17;         ///< cycle_amount .. bounds_method
+constexpr size_t LEGACY_EXT_V1_SIZE = 33;       ///< + the four bounds-finding floats
+constexpr size_t LEGACY_EXT_V2_SIZE = 34;       ///< + stallguard_sgt
+
+FatigueTestConfigPayload sampleConfig()
+{
+    FatigueTestConfigPayload config{};
+    config.cycle_amount = 123456;
+    config.oscillation_vmax_rpm = 90.5f;
+    config.oscillation_amax_rev_s2 = 12.25f;
+    config.dwell_time_ms = 750;
+    config.bounds_method = 1;
+    config.bounds_search_velocity_rpm = 30.0f;
+    config.stallguard_min_velocity_rpm = 15.0f;
+    config.stall_detection_current_factor = 0.6f;
+    config.bounds_search_accel_rev_s2 = 4.5f;
+    config.stallguard_sgt = -12;
+    return config;
+}
+
+/// Bit of a field in the table's masks
+uint32_t bit(FatigueConfigField id)
+{
+    size_t index = 0;
+    CHECK(FindConfigField(FIELDS, COUNT, static_cast<uint8_t>(id), &index) != nullptr);
+    return 1u << index;
+}
+
+/// Fields in mask equal between a and b, fields outside it equal to untouched
+void checkFields(const FatigueTestConfigPayload& a, const FatigueTestConfigPayload& b, uint32_t mask,
+                 const FatigueTestConfigPayload& untouched)
+{
+    const uint8_t* pa = reinterpret_cast<const uint8_t*>(&a);
+    const uint8_t* pb = reinterpret_cast<const uint8_t*>(&b);
+    const uint8_t* pu = reinterpret_cast<const uint8_t*>(&untouched);
+    for (size_t i = 0; i < COUNT; ++i) {
+        const ConfigFieldDesc& f = FIELDS[i];
+        const uint8_t* expected = (mask & (1u << i)) ? pb : pu;
+        CHECK(std::memcmp(pa + f.offset, expected + f.offset, f.size) == 0);
+    }
+}
+
+void putRecord(std::vector<uint8_t>& out, uint8_t id, const void* value, uint8_t len)
+{
+    out.push_back(id);
+    out.push_back(len);
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    out.insert(out.end(), bytes, bytes + len);
+}
+
+void testRoundTrip()
+{
+    FatigueTestConfigPayload config = sampleConfig();
+    FatigueTestConfigPayload empty{};
+    uint8_t buf[MAX_PAYLOAD_SIZE_];
+    uint32_t sent = 0;
+
+    // Nothing known: every field goes
+    size_t len = EncodeConfigFields(FIELDS, COUNT, &config, &empty, 0, buf, sizeof(buf), &sent);
+    CHECK_EQ(sent, ALL_FIELDS);
+    CHECK_EQ(len, COUNT * sizeof(ConfigFieldHeader) + sizeof(FatigueTestConfigPayload));
+
+    FatigueTestConfigPayload out{};
+    uint32_t applied = 0;
+    CHECK(DecodeConfigFields(FIELDS, COUNT, buf, len, &out, &applied));
+    CHECK_EQ(applied, ALL_FIELDS);
+    checkFields(out, config, ALL_FIELDS, empty);
+
+    // Baseline known: only what changed
+    FatigueTestConfigPayload changed = config;
+    changed.dwell_time_ms = 500;
+    changed.stallguard_sgt = 5;
+    len = EncodeConfigFields(FIELDS, COUNT, &changed, &config, ALL_FIELDS, buf, sizeof(buf), &sent);
+    CHECK_EQ(sent, bit(FatigueConfigField::DwellTimeMs) | bit(FatigueConfigField::StallguardSgt));
+    CHECK_EQ(len, 2 * sizeof(ConfigFieldHeader) + sizeof(changed.dwell_time_ms) + sizeof(changed.stallguard_sgt));
+    out = config;
+    CHECK(DecodeConfigFields(FIELDS, COUNT, buf, len, &out, &applied));
+    CHECK_EQ(applied, sent);
+    checkFields(out, changed, ALL_FIELDS, changed);
+
+    // Unchanged: nothing to send
+    CHECK_EQ(EncodeConfigFields(FIELDS, COUNT, &config, &config, ALL_FIELDS, buf, sizeof(buf), &sent), 0u);
+    CHECK_EQ(sent, 0u);
+}
+
+void testUnknownId()
+{
+    // A field from newer firmware between two known ones
+    FatigueTestConfigPayload config = sampleConfig();
+    std::vector<uint8_t> payload;
+    putRecord(payload, static_cast<uint8_t>(FatigueConfigField::CycleAmount),
+              &config.cycle_amount, sizeof(config.cycle_amount));
+    const uint8_t future[5] = { 1, 2, 3, 4, 5 };
+    putRecord(payload, 200, future, sizeof(future));
+    putRecord(payload, static_cast<uint8_t>(FatigueConfigField::BoundsMethod),
+              &config.bounds_method, sizeof(config.bounds_method));
+
+    FatigueTestConfigPayload out{};
+    FatigueTestConfigPayload untouched{};
+    uint32_t applied = 0;
+    CHECK(DecodeConfigFields(FIELDS, COUNT, payload.data(), payload.size(), &out, &applied));
+    uint32_t expected = bit(FatigueConfigField::CycleAmount) | bit(FatigueConfigField::BoundsMethod);
+    CHECK_EQ(applied, expected);
+    checkFields(out, config, expected, untouched);
+}
+
+void testLengthMismatch()
+{
+    // cycle_amount as 2 and as 8 bytes (a changed type), then a good record
+    FatigueTestConfigPayload config = sampleConfig();
+    std::vector<uint8_t> payload;
+    const uint8_t short_value[2] = { 0xAA, 0xBB };
+    const uint8_t long_value[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    putRecord(payload, static_cast<uint8_t>(FatigueConfigField::CycleAmount), short_value, sizeof(short_value));
+    putRecord(payload, static_cast<uint8_t>(FatigueConfigField::CycleAmount), long_value, sizeof(long_value));
+    putRecord(payload, static_cast<uint8_t>(FatigueConfigField::DwellTimeMs),
+              &config.dwell_time_ms, sizeof(config.dwell_time_ms));
+
+    FatigueTestConfigPayload out{};
+    FatigueTestConfigPayload untouched{};
+    uint32_t applied = 0;
+    CHECK(DecodeConfigFields(FIELDS, COUNT, payload.data(), payload.size(), &out, &applied));
+    CHECK_EQ(applied, bit(FatigueConfigField::DwellTimeMs));
+    checkFields(out, config, applied, untouched);
+}
+
+void testTruncation()
+{
+    FatigueTestConfigPayload config = sampleConfig();
+    FatigueTestConfigPayload empty{};
+    uint8_t buf[MAX_PAYLOAD_SIZE_];
+    uint32_t sent = 0;
+    size_t len = EncodeConfigFields(FIELDS, COUNT, &config, &empty, 0, buf, sizeof(buf), &sent);
+
+    // Record boundaries, and the mask of the whole records before each
+    std::vector<size_t> ends;
+    std::vector<uint32_t> masks;
+    size_t pos = 0;
+    uint32_t mask = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+        pos += sizeof(ConfigFieldHeader) + FIELDS[i].size;
+        mask |= 1u << i;
+        ends.push_back(pos);
+        masks.push_back(mask);
+    }
+    CHECK_EQ(pos, len);
+
+    for (size_t cut = 0; cut <= len; ++cut) {
+        uint32_t whole = 0;
+        bool boundary = (cut == 0);
+        for (size_t i = 0; i < ends.size(); ++i) {
+            if (ends[i] <= cut) whole = masks[i];
+            if (ends[i] == cut) boundary = true;
+        }
+
+        FatigueTestConfigPayload out{};
+        uint32_t applied = 0;
+        bool ok = DecodeConfigFields(FIELDS, COUNT, buf, cut, &out, &applied);
+        CHECK(ok == boundary);
+        CHECK_EQ(applied, whole);
+        checkFields(out, config, whole, empty);     // The cut record is not half-written
+    }
+}
+
+void testOutCapOverflow()
+{
+    FatigueTestConfigPayload config = sampleConfig();
+    FatigueTestConfigPayload empty{};
+    uint8_t buf[MAX_PAYLOAD_SIZE_];
+
+    // Every capacity from nothing to all of it
+    const size_t full = COUNT * sizeof(ConfigFieldHeader) + sizeof(FatigueTestConfigPayload);
+    for (size_t cap = 0; cap <= full; ++cap) {
+        uint32_t sent = 0;
+        size_t len = EncodeConfigFields(FIELDS, COUNT, &config, &empty, 0, buf, cap, &sent);
+        CHECK(len <= cap);
+
+        // Exactly the fields in sent_mask are in the payload
+        FatigueTestConfigPayload out{};
+        uint32_t applied = 0;
+        CHECK(DecodeConfigFields(FIELDS, COUNT, buf, len, &out, &applied));
+        CHECK_EQ(applied, sent);
+        checkFields(out, config, sent, empty);
+
+        // The peer now holds those; the next send carries the rest
+        uint32_t rest = 0;
+        EncodeConfigFields(FIELDS, COUNT, &config, &config, sent, buf, sizeof(buf), &rest);
+        CHECK_EQ(rest, ALL_FIELDS & ~sent);
+        CHECK((sent & rest) == 0);
+    }
+
+    // A small field still fits after a larger one that did not
+    uint32_t sent = 0;
+    const size_t cap = sizeof(ConfigFieldHeader) * 2 + sizeof(config.cycle_amount) + sizeof(config.bounds_method);
+    EncodeConfigFields(FIELDS, COUNT, &config, &empty, 0, buf, cap, &sent);
+    CHECK_EQ(sent, bit(FatigueConfigField::CycleAmount) | bit(FatigueConfigField::BoundsMethod));
+}
+
+void testLegacySizes()
+{
+    FatigueTestConfigPayload config = sampleConfig();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&config);
+
+    const uint32_t base = bit(FatigueConfigField::CycleAmount) | bit(FatigueConfigField::OscillationVmaxRpm) |
+                          bit(FatigueConfigField::OscillationAmaxRevS2) | bit(FatigueConfigField::DwellTimeMs) |
+                          bit(FatigueConfigField::BoundsMethod);
+    const uint32_t ext_v1 = base | bit(FatigueConfigField::BoundsSearchVelocityRpm) |
+                            bit(FatigueConfigField::StallguardMinVelocityRpm) |
+                            bit(FatigueConfigField::StallDetectionCurrentFactor) |
+                            bit(FatigueConfigField::BoundsSearchAccelRevS2);
+    const uint32_t ext_v2 = ext_v1 | bit(FatigueConfigField::StallguardSgt);
+    CHECK_EQ(device_protocols::FATIGUE_TEST_CONFIG_BASE_SIZE, LEGACY_BASE_SIZE);
+    CHECK_EQ(device_protocols::FATIGUE_TEST_CONFIG_FULL_SIZE, LEGACY_EXT_V2_SIZE);
+    CHECK_EQ(ext_v2, ALL_FIELDS);
+
+    struct { size_t len; uint32_t mask; } cases[] = {
+        { LEGACY_BASE_SIZE,       base },
+        { LEGACY_EXT_V1_SIZE,     ext_v1 },
+        { LEGACY_EXT_V2_SIZE,     ext_v2 },
+        { LEGACY_BASE_SIZE - 1,   base & ~bit(FatigueConfigField::BoundsMethod) },
+        { LEGACY_BASE_SIZE + 2,   base },         // Half a float: not applied
+        { LEGACY_EXT_V1_SIZE - 1, ext_v1 & ~bit(FatigueConfigField::BoundsSearchAccelRevS2) },
+        { 0,                      0 },
+    };
+    FatigueTestConfigPayload untouched = sampleConfig();
+    untouched.cycle_amount = 1;
+    untouched.bounds_method = 0;
+    untouched.bounds_search_accel_rev_s2 = 1.0f;
+    untouched.stallguard_sgt = 127;
+    for (const auto& c : cases) {
+        FatigueTestConfigPayload out = untouched;
+        uint32_t applied = 0;
+        DecodeLegacyConfig(FIELDS, COUNT, bytes, c.len, &out, &applied);
+        CHECK_EQ(applied, c.mask);
+        checkFields(out, config, c.mask, untouched);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testUnknownId();
+    testLengthMismatch();
+    testTruncation();
+    testOutCapOverflow();
+    testLegacySizes();
+    return host_test::TestResult("test_config_fields");
+}
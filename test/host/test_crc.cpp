@@ -0,0 +1,109 @@
+/**
+ * @file test_crc.cpp
+ * @brief CRC16-CCITT engines against the bitwise reference
+ *
+ * The compile-time static_asserts in espnow_crc.hpp only cover two fixed
+ * vectors. This runs every engine over random buffers of every frame length,
+ * with chained (incremental) updates and non-default seeds.
+ */
+
+#include "espnow_crc.hpp"
+#include "test_support.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr size_t MAX_LEN = 256;   ///< Header + largest payload + slack
+
+void testCheckValue()
+{
+    const uint8_t* in = crc_check::CHECK_INPUT_;
+    const size_t len = sizeof(crc_check::CHECK_INPUT_);
+    CHECK_EQ(crc16_ccitt_bitwise(in, len), CRC16_CHECK_VALUE_);
+    CHECK_EQ(crc16_ccitt_nibble(in, len), CRC16_CHECK_VALUE_);
+    CHECK_EQ(crc16_ccitt_table(in, len), CRC16_CHECK_VALUE_);
+    CHECK_EQ(crc16_ccitt_rom(in, len), CRC16_CHECK_VALUE_);
+    CHECK_EQ(crc16_ccitt(in, len), CRC16_CHECK_VALUE_);
+}
+
+void testEmptyBuffer()
+{
+    uint8_t dummy = 0;
+    CHECK_EQ(crc16_ccitt_bitwise(&dummy, 0), CRC16_INIT_);
+    CHECK_EQ(crc16_ccitt_nibble(&dummy, 0), CRC16_INIT_);
+    CHECK_EQ(crc16_ccitt_table(&dummy, 0), CRC16_INIT_);
+    CHECK_EQ(crc16_ccitt(&dummy, 0), CRC16_INIT_);
+}
+
+void testRandomBuffers(std::mt19937& rng)
+{
+    std::vector<uint8_t> buf(MAX_LEN);
+    for (int round = 0; round < 8; ++round) {
+        for (auto& b : buf) {
+            b = static_cast<uint8_t>(rng());
+        }
+        for (size_t len = 0; len <= MAX_LEN; ++len) {
+            uint16_t ref = crc16_ccitt_bitwise(buf.data(), len);
+            CHECK_EQ(crc16_ccitt_nibble(buf.data(), len), ref);
+            CHECK_EQ(crc16_ccitt_table(buf.data(), len), ref);
+            CHECK_EQ(crc16_ccitt_rom(buf.data(), len), ref);
+            CHECK_EQ(crc16_ccitt(buf.data(), len), ref);
+        }
+    }
+}
+
+void testSeedsAndChaining(std::mt19937& rng)
+{
+    std::vector<uint8_t> buf(MAX_LEN);
+    for (auto& b : buf) {
+        b = static_cast<uint8_t>(rng());
+    }
+    const uint16_t seeds[] = { 0x0000, 0x1D0F, 0xFFFF, 0x8000, 0x0001 };
+    for (uint16_t seed : seeds) {
+        uint16_t ref = crc16_ccitt_bitwise(buf.data(), buf.size(), seed);
+        CHECK_EQ(crc16_ccitt_nibble(buf.data(), buf.size(), seed), ref);
+        CHECK_EQ(crc16_ccitt_table(buf.data(), buf.size(), seed), ref);
+        CHECK_EQ(crc16_ccitt_rom(buf.data(), buf.size(), seed), ref);
+    }
+
+    // Header and payload checksummed in two calls must equal one pass
+    uint16_t whole = crc16_ccitt_bitwise(buf.data(), buf.size());
+    for (size_t split = 0; split <= buf.size(); split += 7) {
+        size_t rest = buf.size() - split;
+        CHECK_EQ(crc16_ccitt_table(buf.data() + split, rest, crc16_ccitt_table(buf.data(), split)), whole);
+        CHECK_EQ(crc16_ccitt_nibble(buf.data() + split, rest, crc16_ccitt_nibble(buf.data(), split)), whole);
+    }
+}
+
+void testDetectsSingleBitErrors(std::mt19937& rng)
+{
+    std::vector<uint8_t> buf(64);
+    for (auto& b : buf) {
+        b = static_cast<uint8_t>(rng());
+    }
+    uint16_t good = crc16_ccitt(buf.data(), buf.size());
+    for (size_t bit = 0; bit < buf.size() * 8; ++bit) {
+        buf[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+        CHECK(crc16_ccitt(buf.data(), buf.size()) != good);
+        buf[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(0xC0FFEE);
+    testCheckValue();
+    testEmptyBuffer();
+    testRandomBuffers(rng);
+    testSeedsAndChaining(rng);
+    testDetectsSingleBitErrors(rng);
+    CHECK(Crc16SelfTest());
+    return host_test::TestResult("test_crc");
+}
@@ -0,0 +1,312 @@
+/**
+ * @file test_fragment.cpp
+ * @brief Fragmentation and reassembly against reordered, lossy and duplicated streams
+ */
+
+#include "espnow_fragment.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+const uint8_t MAC_A[6] = { 0x02, 0, 0, 0, 0, 0xA1 };
+const uint8_t MAC_B[6] = { 0x02, 0, 0, 0, 0, 0xB2 };
+const uint8_t MAC_C[6] = { 0x02, 0, 0, 0, 0, 0xC3 };
+
+constexpr MsgType MSG_TYPE = MsgType::ConfigResponse;
+constexpr int64_t TIMEOUT_US = static_cast<int64_t>(REASSEMBLY_TIMEOUT_MS_) * 1000;
+
+struct Fragment {
+    uint8_t payload[MAX_PAYLOAD_SIZE_];
+    uint8_t len;
+};
+
+std::vector<uint8_t> makeMessage(size_t len, uint32_t seed)
+{
+    std::vector<uint8_t> msg(len);
+    std::mt19937 rng(seed);
+    for (auto& b : msg) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return msg;
+}
+
+std::vector<Fragment> split(const std::vector<uint8_t>& msg, uint8_t msg_id)
+{
+    std::vector<Fragment> frags(FragmentCount(msg.size()));
+    for (size_t i = 0; i < frags.size(); ++i) {
+        frags[i].len = BuildFragment(MSG_TYPE, msg_id, msg.data(), msg.size(),
+                                     static_cast<uint8_t>(i), frags[i].payload);
+    }
+    return frags;
+}
+
+/// Feeds fragments to a Reassembler and records the completed message
+struct Receiver {
+    Reassembler reassembler;
+    std::vector<uint8_t> last;
+    int completed = 0;
+
+    Reassembler::Result add(const uint8_t* mac, const Fragment& f, int64_t now_us)
+    {
+        const FragmentHeader* header = nullptr;
+        const uint8_t* out = nullptr;
+        size_t out_len = 0;
+        auto result = reassembler.Add(mac, f.payload, f.len, now_us, header, out, out_len);
+        if (result == Reassembler::Result::Complete) {
+            CHECK(header != nullptr && header->type == static_cast<uint8_t>(MSG_TYPE));
+            last.assign(out, out + out_len);
+            completed++;
+        }
+        return result;
+    }
+};
+
+void testFragmentCount()
+{
+    CHECK_EQ(FragmentCount(0), 0);
+    CHECK_EQ(FragmentCount(1), 1);
+    CHECK_EQ(FragmentCount(FRAGMENT_DATA_SIZE_), 1);
+    CHECK_EQ(FragmentCount(FRAGMENT_DATA_SIZE_ + 1), 2);
+    CHECK_EQ(FragmentCount(MAX_MESSAGE_SIZE_), MAX_FRAGMENTS_);
+    CHECK_EQ(FragmentCount(MAX_MESSAGE_SIZE_ + 1), 0);
+
+    uint8_t out[MAX_PAYLOAD_SIZE_];
+    uint8_t data[8] = {};
+    CHECK_EQ(BuildFragment(MSG_TYPE, 1, data, sizeof(data), 1, out), 0);
+}
+
+void testInOrderEveryLength()
+{
+    for (size_t len = 1; len <= MAX_MESSAGE_SIZE_; len += 13) {
+        Receiver rx;
+        auto msg = makeMessage(len, static_cast<uint32_t>(len));
+        auto frags = split(msg, static_cast<uint8_t>(len));
+        for (size_t i = 0; i < frags.size(); ++i) {
+            CHECK(frags[i].len <= MAX_PAYLOAD_SIZE_);
+            auto result = rx.add(MAC_A, frags[i], 0);
+            CHECK(result == (i + 1 == frags.size() ? Reassembler::Result::Complete
+                                                   : Reassembler::Result::Incomplete));
+        }
+        CHECK(rx.last == msg);
+        CHECK_EQ(rx.reassembler.InFlight(), 0u);
+    }
+}
+
+void testReorderedWithDuplicates(std::mt19937& rng)
+{
+    for (int round = 0; round < 200; ++round) {
+        Receiver rx;
+        auto msg = makeMessage(1 + rng() % MAX_MESSAGE_SIZE_, rng());
+        auto frags = split(msg, static_cast<uint8_t>(round));
+
+        // Every fragment at least once, some twice, in random order
+        std::vector<Fragment> stream = frags;
+        for (const auto& f : frags) {
+            if (rng() % 3 == 0) {
+                stream.push_back(f);
+            }
+        }
+        std::shuffle(stream.begin(), stream.end(), rng);
+
+        int duplicates = 0;
+        for (const auto& f : stream) {
+            if (rx.add(MAC_A, f, 0) == Reassembler::Result::Duplicate) {
+                duplicates++;
+            }
+        }
+        CHECK_EQ(rx.completed, 1);
+        CHECK(rx.last == msg);
+        CHECK_EQ(duplicates, static_cast<int>(stream.size() - frags.size()));
+        CHECK_EQ(rx.reassembler.Stats().duplicates, static_cast<uint32_t>(duplicates));
+
+        // A late copy after completion must not restart the message
+        CHECK(rx.add(MAC_A, frags[0], 0) == Reassembler::Result::Duplicate);
+        CHECK_EQ(rx.reassembler.InFlight(), 0u);
+    }
+}
+
+void testLossAndTimeout()
+{
+    Receiver rx;
+    auto msg = makeMessage(MAX_MESSAGE_SIZE_, 7);
+    auto frags = split(msg, 42);
+
+    // Last fragment lost: the message stays partial and then times out
+    for (size_t i = 0; i + 1 < frags.size(); ++i) {
+        CHECK(rx.add(MAC_A, frags[i], 0) == Reassembler::Result::Incomplete);
+    }
+    CHECK_EQ(rx.reassembler.InFlight(), 1u);
+    CHECK_EQ(rx.reassembler.Expire(TIMEOUT_US - 1), 0u);
+    CHECK_EQ(rx.reassembler.Expire(TIMEOUT_US), 1u);
+    CHECK_EQ(rx.reassembler.Stats().timeouts, 1u);
+    CHECK_EQ(rx.reassembler.InFlight(), 0u);
+
+    // The sender's retransmission starts over and completes
+    int64_t now = 2 * TIMEOUT_US;
+    for (const auto& f : frags) {
+        rx.add(MAC_A, f, now);
+    }
+    CHECK_EQ(rx.completed, 1);
+    CHECK(rx.last == msg);
+
+    // Progress resets the timeout: fragments spaced just under it still complete
+    auto msg2 = makeMessage(MAX_MESSAGE_SIZE_, 8);
+    auto frags2 = split(msg2, 43);
+    for (const auto& f : frags2) {
+        now += TIMEOUT_US - 1;
+        rx.add(MAC_A, f, now);
+    }
+    CHECK_EQ(rx.completed, 2);
+    CHECK(rx.last == msg2);
+}
+
+void testSendersAndSlots()
+{
+    Receiver rx;
+    auto msg_a = makeMessage(600, 1);
+    auto msg_b = makeMessage(500, 2);
+    auto frags_a = split(msg_a, 5);
+    auto frags_b = split(msg_b, 5);   // Same id, different sender
+
+    // Interleaved senders each get a slot
+    size_t n = std::max(frags_a.size(), frags_b.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (i < frags_a.size()) rx.add(MAC_A, frags_a[i], 0);
+        if (i + 1 < frags_b.size()) rx.add(MAC_B, frags_b[i], 0);
+    }
+    CHECK_EQ(rx.completed, 1);
+    CHECK(rx.last == msg_a);
+
+    // Both slots busy (B partial, C partial): a third message has no buffer
+    auto msg_c = makeMessage(400, 3);
+    auto frags_c = split(msg_c, 9);
+    CHECK(rx.add(MAC_C, frags_c[0], 0) == Reassembler::Result::Incomplete);
+    auto msg_x = makeMessage(400, 4);
+    auto frags_x = split(msg_x, 1);
+    CHECK(rx.add(MAC_A, frags_x[0], 0) == Reassembler::Result::NoBuffer);
+    CHECK_EQ(rx.reassembler.Stats().no_buffer, 1u);
+
+    rx.add(MAC_B, frags_b.back(), 0);
+    CHECK_EQ(rx.completed, 2);
+    CHECK(rx.last == msg_b);
+
+    // A sender starting a new message abandons its old one
+    auto msg_c2 = makeMessage(300, 5);
+    auto frags_c2 = split(msg_c2, 10);
+    for (const auto& f : frags_c2) {
+        rx.add(MAC_C, f, 0);
+    }
+    CHECK_EQ(rx.reassembler.Stats().replaced, 1u);
+    CHECK_EQ(rx.completed, 3);
+    CHECK(rx.last == msg_c2);
+    CHECK_EQ(rx.reassembler.InFlight(), 0u);
+}
+
+void testInvalid()
+{
+    Receiver rx;
+    auto msg = makeMessage(MAX_MESSAGE_SIZE_, 11);
+    auto frags = split(msg, 3);
+
+    Fragment shortened = frags[0];
+    shortened.len = sizeof(FragmentHeader) - 1;
+    CHECK(rx.add(MAC_A, shortened, 0) == Reassembler::Result::Invalid);
+
+    Fragment truncated = frags[0];
+    truncated.len--;
+    CHECK(rx.add(MAC_A, truncated, 0) == Reassembler::Result::Invalid);
+
+    Fragment bad_index = frags[0];
+    reinterpret_cast<FragmentHeader*>(bad_index.payload)->index = MAX_FRAGMENTS_;
+    CHECK(rx.add(MAC_A, bad_index, 0) == Reassembler::Result::Invalid);
+
+    Fragment bad_count = frags[0];
+    reinterpret_cast<FragmentHeader*>(bad_count.payload)->count = 0;
+    CHECK(rx.add(MAC_A, bad_count, 0) == Reassembler::Result::Invalid);
+
+    // A fragment disagreeing with the message so far is rejected, the message survives
+    CHECK(rx.add(MAC_A, frags[0], 0) == Reassembler::Result::Incomplete);
+    auto other = split(makeMessage(MAX_MESSAGE_SIZE_ - 1, 12), 3);
+    CHECK(rx.add(MAC_A, other[1], 0) == Reassembler::Result::Invalid);
+    for (size_t i = 1; i < frags.size(); ++i) {
+        rx.add(MAC_A, frags[i], 0);
+    }
+    CHECK_EQ(rx.completed, 1);
+    CHECK(rx.last == msg);
+    CHECK_EQ(rx.reassembler.Stats().invalid, 5u);
+}
+
+/// Many messages over a link that drops, duplicates and reorders; the sender
+/// resends the whole message until the receiver reports it complete.
+/// Goodput is message bytes delivered over fragment bytes sent.
+void testLossyLink(std::mt19937& rng)
+{
+    Receiver rx;
+    int64_t now = 0;
+    size_t delivered_bytes = 0;
+    size_t sent_bytes = 0;
+    size_t once_bytes = 0;      ///< Fragment bytes for every message sent once
+    for (int n = 0; n < 300; ++n) {
+        auto msg = makeMessage(1 + rng() % MAX_MESSAGE_SIZE_, rng());
+        auto frags = split(msg, static_cast<uint8_t>(n));
+        for (const auto& f : frags) {
+            once_bytes += f.len;
+        }
+        int before = rx.completed;
+        for (int attempt = 0; attempt < 50 && rx.completed == before; ++attempt) {
+            std::vector<Fragment> air;
+            for (const auto& f : frags) {
+                sent_bytes += f.len;
+                if (rng() % 100 < 25) continue;         // Lost
+                air.push_back(f);
+                if (rng() % 100 < 10) air.push_back(f); // Duplicated
+            }
+            std::shuffle(air.begin(), air.end(), rng);
+            for (const auto& f : air) {
+                rx.add(MAC_A, f, now);
+                now += 1000;
+            }
+        }
+        CHECK_EQ(rx.completed, before + 1);
+        CHECK(rx.last == msg);
+        if (rx.completed == before + 1 && rx.last == msg) {
+            delivered_bytes += msg.size();
+        }
+    }
+    CHECK_EQ(rx.reassembler.Stats().messages_received, 300u);
+
+    // Headers cap goodput below 1 even without loss. The receiver keeps the
+    // fragments of earlier attempts, so at 25 % loss even an eight-fragment
+    // message needs about 2.5 sends on average, not one clean run of eight
+    double lossless = static_cast<double>(delivered_bytes) / static_cast<double>(once_bytes);
+    double goodput = static_cast<double>(delivered_bytes) / static_cast<double>(sent_bytes);
+    std::printf("lossy link: goodput %.3f (%zu message bytes / %zu fragment bytes sent), %.3f without loss\n",
+                goodput, delivered_bytes, sent_bytes, lossless);
+    CHECK(lossless < 1.0);
+    CHECK(goodput <= lossless);
+    CHECK(goodput > lossless / 3.0);
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(1234);
+    testFragmentCount();
+    testInOrderEveryLength();
+    testReorderedWithDuplicates(rng);
+    testLossAndTimeout();
+    testSendersAndSlots();
+    testInvalid();
+    testLossyLink(rng);
+    return host_test::TestResult("test_fragment");
+}
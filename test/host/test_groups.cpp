@@ -0,0 +1,221 @@
+/**
+ * @file test_groups.cpp
+ * @brief Group commands to up to sixteen simulated members, and their skew
+ *
+ * Runs PeerGroups over the real protocol stack. Groups of 1 to 16 members
+ * get unicast commands and the skew between the first and last ack is
+ * measured for each size. With every member's first copy lost, a sixteen
+ * member command must still complete: more members than reliable slots must
+ * wait for a slot, not go out best-effort. The whole fleet is also sent one
+ * broadcast, which only the group of every approved peer may use.
+ */
+
+#include "espnow_groups.hpp"
+#include "espnow_protocol.hpp"
+#include "config.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr uint8_t  MEMBERS = PeerGroups::MAX_MEMBERS_;
+constexpr uint8_t  REPEATS = 5;
+constexpr uint32_t DEADLINE_MS = 3000;
+constexpr uint8_t  GROUP_SIZES[] = { 1, 2, 4, 8, 16 };
+
+std::vector<std::unique_ptr<sim::Device>> s_devices_;
+uint8_t s_members_[MEMBERS][6];
+uint8_t s_next_command_ = 0x40;
+double  s_unicast_skew_ms_ = 0.0;      ///< Mean over REPEATS sixteen member unicast commands
+
+// Lose the first copy of each member's Command, let the retransmissions through
+std::atomic<bool> s_lose_first_{ false };
+std::atomic<uint32_t> s_commands_seen_[MEMBERS];
+
+void onTx(const sim::Frame& frame)
+{
+    if (!s_lose_first_ || frame.data.size() < sizeof(EspNowHeader) ||
+        frame.data[3] != static_cast<uint8_t>(MsgType::Command)) {
+        return;
+    }
+    for (uint8_t i = 0; i < MEMBERS; ++i) {
+        if (MacEquals(frame.dst, s_members_[i])) {
+            bool first = s_commands_seen_[i]++ == 0;
+            s_devices_[i]->SetLink(sim::Link{ first ? 1.0 : 0.0, 0.0, -50 });
+            return;
+        }
+    }
+}
+
+/// Send one group command and service it to the end, as the UI loop does
+PeerGroups::Result runCommand(uint8_t group, PeerGroups::Fanout fanout)
+{
+    uint8_t command_id = s_next_command_++;
+    for (auto& device : s_devices_) {
+        device->ClearLog();
+    }
+    std::vector<std::vector<uint8_t>> executed_before;
+    for (auto& device : s_devices_) {
+        executed_before.push_back(device->Executed());
+    }
+
+    CHECK(PeerGroups::SendCommand(group, 0, command_id, nullptr, 0, TxPriority::Control, fanout, DEADLINE_MS));
+    CHECK(PeerGroups::IsBusy());
+    for (uint32_t waited = 0; PeerGroups::IsBusy() && waited < DEADLINE_MS + 1000; ++waited) {
+        vTaskDelay(1);
+        PeerGroups::Service();
+    }
+    CHECK(!PeerGroups::IsBusy());
+
+    PeerGroups::Result result{};
+    CHECK(PeerGroups::GetLastResult(result));
+    CHECK_EQ(result.command_id, command_id);
+
+    // Every member ran it exactly once, nobody else ran it
+    PeerGroups::Group def{};
+    CHECK(PeerGroups::GetGroup(group, def));
+    for (uint8_t i = 0; i < MEMBERS; ++i) {
+        std::vector<uint8_t> executed = s_devices_[i]->Executed();
+        size_t runs = executed.size() - executed_before[i].size();
+        CHECK_EQ(runs, i < def.member_count ? 1u : 0u);
+        if (runs == 1) {
+            CHECK_EQ(executed.back(), command_id);
+        }
+    }
+    return result;
+}
+
+double meanSkewMs(uint8_t size)
+{
+    const PeerGroups::Stats& stats = PeerGroups::GetStats();
+    if (stats.skew_samples[size] == 0) {
+        return 0.0;
+    }
+    return stats.skew_sum_us[size] / 1000.0 / stats.skew_samples[size];
+}
+
+void testSkewBySize()
+{
+    std::printf("unicast skew by group size:\n");
+    for (uint8_t size : GROUP_SIZES) {
+        CHECK(PeerGroups::SetGroup(0, "skew", s_members_, size));
+        uint32_t worst_us = 0;
+        for (uint8_t rep = 0; rep < REPEATS; ++rep) {
+            PeerGroups::Result result = runCommand(0, PeerGroups::Fanout::Unicast);
+            CHECK(result.complete);
+            CHECK_EQ(result.members, size);
+            CHECK_EQ(result.acked, size);
+            CHECK(result.fanout == PeerGroups::Fanout::Unicast);
+            CHECK(result.skew_us <= result.last_ack_us);
+            if (size == 1) {
+                CHECK_EQ(result.skew_us, 0u);
+            }
+            worst_us = result.skew_us > worst_us ? result.skew_us : worst_us;
+        }
+        std::printf("  %2u members: mean %.2f ms, worst %.2f ms\n", size, meanSkewMs(size), worst_us / 1000.0);
+    }
+
+    // Skew samples are kept by size for commands with more than one ack
+    const PeerGroups::Stats& stats = PeerGroups::GetStats();
+    CHECK_EQ(stats.skew_samples[1], 0u);
+    for (uint8_t size : GROUP_SIZES) {
+        if (size > 1) {
+            CHECK_EQ(stats.skew_samples[size], REPEATS);
+        }
+    }
+    // Each member adds its Command and ack to the shared air
+    CHECK(meanSkewMs(MEMBERS) > meanSkewMs(2));
+    s_unicast_skew_ms_ = meanSkewMs(MEMBERS);
+}
+
+void testLostFirstCopies()
+{
+    // Twice the reliable slots: the second half waits for slots the first half frees
+    CHECK(PeerGroups::SetGroup(0, "lossy", s_members_, MEMBERS));
+    for (auto& seen : s_commands_seen_) {
+        seen = 0;
+    }
+    s_lose_first_ = true;
+    PeerGroups::Result result = runCommand(0, PeerGroups::Fanout::Unicast);
+    s_lose_first_ = false;
+    for (auto& device : s_devices_) {
+        device->SetLink(sim::Link{});
+    }
+
+    std::printf("first copies lost: %u/%u acked, last %.2f ms, skew %.2f ms\n", result.acked, result.members,
+                result.last_ack_us / 1000.0, result.skew_us / 1000.0);
+    CHECK(result.complete);
+    CHECK_EQ(result.acked, MEMBERS);
+    for (auto& seen : s_commands_seen_) {
+        CHECK(seen >= 2u);
+    }
+}
+
+void testBroadcast()
+{
+    // Every approved peer, none keyed: one frame reaches the lot
+    CHECK_EQ(GetApprovedPeerCount(), static_cast<size_t>(MEMBERS));
+    CHECK(PeerGroups::SetGroup(1, "all", s_members_, MEMBERS));
+    uint64_t sum_us = 0;
+    for (uint8_t rep = 0; rep < REPEATS; ++rep) {
+        PeerGroups::Result result = runCommand(1, PeerGroups::Fanout::Broadcast);
+        CHECK(result.complete);
+        CHECK(result.fanout == PeerGroups::Fanout::Broadcast);
+        sum_us += result.skew_us;
+    }
+    double broadcast_skew_ms = sum_us / 1000.0 / REPEATS;
+    std::printf("broadcast to %u members: mean skew %.2f ms\n", MEMBERS, broadcast_skew_ms);
+    CHECK(broadcast_skew_ms < s_unicast_skew_ms_);      // Only the acks queue up on the air
+
+    // A subset would reach devices outside it: sent unicast instead
+    CHECK(PeerGroups::SetGroup(2, "half", s_members_, MEMBERS / 2));
+    PeerGroups::Result result = runCommand(2, PeerGroups::Fanout::Broadcast);
+    CHECK(result.complete);
+    CHECK(result.fanout == PeerGroups::Fanout::Unicast);
+
+    CHECK_EQ(PeerGroups::GetStats().partial, 0u);
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_WARN;
+
+    // The pre-configured test unit is always approved, so it is one of the members
+    std::memcpy(s_members_[0], TEST_UNIT_MAC_, 6);
+    for (uint8_t i = 1; i < MEMBERS; ++i) {
+        sim::DeviceMac(i, s_members_[i]);
+    }
+    for (uint8_t i = 0; i < MEMBERS; ++i) {
+        s_devices_.push_back(std::make_unique<sim::Device>(s_members_[i]));
+    }
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    PeerGroups::Init();
+    for (uint8_t i = 1; i < MEMBERS; ++i) {
+        CHECK(AddApprovedPeer(s_members_[i], DeviceType::FatigueTester, "member"));
+    }
+    sim::SetTxTap(onTx);
+
+    testSkewBySize();
+    testLostFirstCopies();
+    testBroadcast();
+
+    sim::SetTxTap(nullptr);
+    sim::Exit(host_test::TestResult("test_groups"));
+}
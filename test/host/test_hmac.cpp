@@ -0,0 +1,128 @@
+/**
+ * @file test_hmac.cpp
+ * @brief Cached HMAC key schedule against the one-shot reference
+ *
+ * HmacSelfTest() is what espnow::Init() runs on the target; here it runs
+ * against the host SHA-256. Both paths are also checked against RFC 4231
+ * vectors (truncated to HMAC_SIZE), and a two-part tag must equal the tag
+ * over the joined message wherever it is split. The derived ESP-NOW keys
+ * (PMK and a pairing's LMK) are pinned to fixed vectors for the test secret,
+ * computed independently of this code, so both ends of a pairing keep
+ * deriving the same keys across firmware versions.
+ */
+
+#include "espnow_security.hpp"
+#include "test_support.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Vector {
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> data;
+    uint8_t tag[HMAC_SIZE];
+};
+
+std::vector<uint8_t> bytes(const char* s)
+{
+    return std::vector<uint8_t>(s, s + std::strlen(s));
+}
+
+void testRfc4231()
+{
+    const Vector vectors[] = {
+        // Test case 1
+        { std::vector<uint8_t>(20, 0x0B), bytes("Hi There"),
+          { 0xB0, 0x34, 0x4C, 0x61, 0xD8, 0xDB, 0x38, 0x53, 0x5C, 0xA8, 0xAF, 0xCE, 0xAF, 0x0B, 0xF1, 0x2B } },
+        // Test case 2: key shorter than the block
+        { bytes("Jefe"), bytes("what do ya want for nothing?"),
+          { 0x5B, 0xDC, 0xC1, 0x46, 0xBF, 0x60, 0x75, 0x4E, 0x6A, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xC7 } },
+        // Test case 6: key longer than the block is hashed first
+        { std::vector<uint8_t>(131, 0xAA), bytes("Test Using Larger Than Block-Size Key - Hash Key First"),
+          { 0x60, 0xE4, 0x31, 0x59, 0x1E, 0xE0, 0xB6, 0x7F, 0x0D, 0x8A, 0x26, 0xAA, 0xCB, 0xF5, 0xB7, 0x7F } },
+    };
+
+    for (const Vector& v : vectors) {
+        uint8_t tag[HMAC_SIZE];
+        ComputeHmacReference(v.key.data(), v.key.size(), v.data.data(), v.data.size(), tag);
+        CHECK(HmacEquals(tag, v.tag));
+
+        HmacKeySchedule schedule;
+        schedule.Init(v.key.data(), v.key.size());
+        schedule.Compute(v.data.data(), v.data.size(), tag);
+        CHECK(HmacEquals(tag, v.tag));
+        CHECK(schedule.Verify(v.data.data(), v.data.size(), v.tag));
+    }
+}
+
+void testSelfTest()
+{
+    CHECK(HmacSelfTest());
+}
+
+void testSplitAndVerify()
+{
+    uint8_t message[200];
+    for (size_t i = 0; i < sizeof(message); ++i) {
+        message[i] = static_cast<uint8_t>(i * 13 + 5);
+    }
+    const HmacKeySchedule& key = PairingHmacKey();
+
+    // Across the 64-byte block boundaries too
+    uint8_t whole[HMAC_SIZE];
+    key.Compute(message, sizeof(message), whole);
+    for (size_t split = 0; split <= sizeof(message); ++split) {
+        uint8_t parts[HMAC_SIZE];
+        key.Compute(message, split, message + split, sizeof(message) - split, parts);
+        CHECK(HmacEquals(parts, whole));
+    }
+
+    // A flipped bit in the message or in the tag is refused
+    CHECK(key.Verify(message, sizeof(message), whole));
+    message[100] ^= 0x01;
+    CHECK(!key.Verify(message, sizeof(message), whole));
+    message[100] ^= 0x01;
+    whole[HMAC_SIZE - 1] ^= 0x80;
+    CHECK(!key.Verify(message, sizeof(message), whole));
+}
+
+/// Expected values: HMAC-SHA256 truncated to 16 bytes (Python hmac), key
+/// 00112233445566778899aabbccddeeff as ESPNOW_PAIRING_SECRET_HEX in CMakeLists.txt
+void testDerivedKeys()
+{
+    const uint8_t pmk_expected[LINK_KEY_SIZE] = {
+        0xE7, 0x5E, 0x58, 0x71, 0x3A, 0x8D, 0x68, 0x57, 0x2C, 0x5D, 0x47, 0xEE, 0x48, 0x4F, 0x7F, 0xB5
+    };
+    uint8_t pmk[LINK_KEY_SIZE];
+    DerivePrimaryKey(pmk);
+    CHECK(std::memcmp(pmk, pmk_expected, LINK_KEY_SIZE) == 0);
+
+    // "espnow-lmk-v1" | 01..08 | 11..18 | 24:6F:28:AA:BB:01 | 24:6F:28:AA:BB:02
+    const uint8_t requester_challenge[CHALLENGE_SIZE] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    const uint8_t responder_challenge[CHALLENGE_SIZE] = { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18 };
+    const uint8_t requester_mac[6] = { 0x24, 0x6F, 0x28, 0xAA, 0xBB, 0x01 };
+    const uint8_t responder_mac[6] = { 0x24, 0x6F, 0x28, 0xAA, 0xBB, 0x02 };
+    const uint8_t lmk_expected[LINK_KEY_SIZE] = {
+        0x35, 0xE0, 0xBC, 0x74, 0xB5, 0xE6, 0x0F, 0xC6, 0x5B, 0x4C, 0x7E, 0x84, 0x5A, 0x4D, 0x72, 0xE3
+    };
+    uint8_t lmk[LINK_KEY_SIZE];
+    DeriveLinkKey(requester_challenge, responder_challenge, requester_mac, responder_mac, lmk);
+    CHECK(std::memcmp(lmk, lmk_expected, LINK_KEY_SIZE) == 0);
+
+    // The roles are not interchangeable: swapped inputs give another key
+    DeriveLinkKey(responder_challenge, requester_challenge, responder_mac, requester_mac, lmk);
+    CHECK(std::memcmp(lmk, lmk_expected, LINK_KEY_SIZE) != 0);
+}
+
+} // namespace
+
+int main()
+{
+    testRfc4231();
+    testSelfTest();
+    testSplitAndVerify();
+    testDerivedKeys();
+    return host_test::TestResult("test_hmac");
+}
@@ -0,0 +1,290 @@
+/**
+ * @file test_pairing_sweep.cpp
+ * @brief Sixteen responders answering one pairing sweep at once
+ *
+ * Runs the real protocol stack against simulated devices. All sixteen answer
+ * the broadcast request together; each must be verified, confirmed and
+ * approved, with link keys for as many as the driver has encrypted slots.
+ * Two impostors replay a valid response (as if sniffed) from their own MAC
+ * and must be rejected. A second sweep checks that a device whose confirm is
+ * never acked is not approved, and a third that test units on older firmware
+ * (HMAC over the challenge alone, with or without a flags byte) still pair.
+ */
+
+#include "espnow_protocol.hpp"
+#include "espnow_crc.hpp"
+#include "espnow_peer_store.hpp"
+#include "espnow_security.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr uint8_t  RESPONDERS = PAIRING_SWEEP_MAX_;
+constexpr uint32_t WINDOW_MS = 500;
+constexpr uint8_t  COMMAND_BASE = 0x20;
+
+/**
+ * @brief Answers a PairingRequest with the response a victim device would
+ *        send, from its own MAC. Knows no secret: the HMAC is the victim's.
+ */
+class Impostor : public sim::Station {
+public:
+    enum class Claim : uint8_t {
+        Victim,     ///< responder_mac left as the victim's
+        Self,       ///< responder_mac rewritten to our own
+    };
+
+    Impostor(const uint8_t mac[6], const uint8_t victim[6], Claim claim)
+        : Station(mac)
+        , claim_(claim)
+    {
+        std::memcpy(victim_, victim, 6);
+    }
+
+protected:
+    void OnReceive(const sim::Frame& frame) override
+    {
+        EspNowHeader hdr{};
+        if (frame.data.size() < sizeof(hdr) + sizeof(PairingRequestPayload)) {
+            return;
+        }
+        std::memcpy(&hdr, frame.data.data(), sizeof(hdr));
+        if (hdr.type != static_cast<uint8_t>(MsgType::PairingRequest)) {
+            return;
+        }
+        PairingRequestPayload req{};
+        std::memcpy(&req, frame.data.data() + sizeof(hdr), sizeof(req));
+
+        PairingResponsePayload resp{};
+        std::memcpy(resp.responder_mac, claim_ == Claim::Victim ? victim_ : Mac(), 6);
+        resp.device_type = static_cast<uint8_t>(DeviceType::FatigueTester);
+        ComputeResponseHmac(req.challenge, victim_, resp.hmac_response);
+        std::strncpy(resp.device_name, "Impostor", MAX_DEVICE_NAME_LEN - 1);
+        const uint8_t flags = PAIRING_FLAG_LINK_KEY | PAIRING_FLAG_MAC_BOUND;   // As the victim sent them
+        const size_t len = sizeof(resp) + sizeof(flags);
+
+        std::vector<uint8_t> out(sizeof(EspNowHeader) + len + sizeof(uint16_t));
+        EspNowHeader out_hdr{ SYNC_BYTE_, PROTOCOL_VERSION_, 0, static_cast<uint8_t>(MsgType::PairingResponse),
+                              1, static_cast<uint8_t>(len) };
+        std::memcpy(out.data(), &out_hdr, sizeof(out_hdr));
+        std::memcpy(out.data() + sizeof(out_hdr), &resp, sizeof(resp));
+        out[sizeof(out_hdr) + sizeof(resp)] = flags;
+        uint16_t crc = crc16_ccitt(out.data(), sizeof(out_hdr) + len);
+        std::memcpy(out.data() + sizeof(out_hdr) + len, &crc, sizeof(crc));
+        Send(out.data(), out.size());
+    }
+
+private:
+    uint8_t victim_[6];
+    Claim   claim_;
+};
+
+std::vector<std::unique_ptr<sim::Device>> s_devices_;
+std::atomic<uint32_t> s_delivered_{ 0 };
+std::atomic<uint32_t> s_failed_{ 0 };
+
+void onDelivery(const DeliveryReport& report)
+{
+    if (report.type == MsgType::Command) {
+        (report.delivered ? s_delivered_ : s_failed_)++;
+    }
+}
+
+bool waitSweep(PairingSweepResult& result, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        if (GetPairingSweepResult(result)) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+void testSixteenResponders()
+{
+    const uint8_t impostor_macs[2][6] = { { 0x02, 0x66, 0x66, 0x00, 0x00, 0x01 },
+                                          { 0x02, 0x66, 0x66, 0x00, 0x00, 0x02 } };
+    Impostor replay_victim(impostor_macs[0], s_devices_[0]->Mac(), Impostor::Claim::Victim);
+    Impostor replay_self(impostor_macs[1], s_devices_[1]->Mac(), Impostor::Claim::Self);
+
+    for (auto& device : s_devices_) {
+        device->SetPairingMode(true);
+    }
+    CHECK(StartPairingSweep(WINDOW_MS));
+    CHECK(!StartPairingSweep(WINDOW_MS));      // One at a time
+
+    PairingSweepResult result{};
+    CHECK(waitSweep(result, WINDOW_MS + 10000));
+    CHECK(GetPairingState() == PairingState::Complete);
+    std::printf("sweep: %u responses, %u verified, %u rejected, %u paired, %u failed in %lu ms "
+                "(confirming %lu ms), %lu devices/min\n",
+                result.responses, result.verified, result.rejected, result.paired, result.failed,
+                static_cast<unsigned long>(result.duration_ms), static_cast<unsigned long>(result.confirm_ms),
+                static_cast<unsigned long>(result.devices_per_minute));
+
+    CHECK_EQ(result.responses, RESPONDERS + 2);
+    CHECK_EQ(result.verified, RESPONDERS);
+    CHECK_EQ(result.rejected, 2);
+    CHECK_EQ(result.overflow, 0);
+    CHECK_EQ(result.paired, RESPONDERS);
+    CHECK_EQ(result.failed, 0);
+    CHECK(result.duration_ms >= WINDOW_MS);
+    CHECK(result.devices_per_minute > 0);
+
+    for (auto& device : s_devices_) {
+        CHECK(device->IsPaired());
+        CHECK(IsPeerApproved(device->Mac()));
+    }
+    for (const auto& mac : impostor_macs) {
+        CHECK(!IsPeerApproved(mac));
+    }
+
+    // Keys for as many as the driver can encrypt, the same on both ends
+    size_t keyed = 0;
+    for (auto& device : s_devices_) {
+        uint8_t ours[LINK_KEY_SIZE];
+        uint8_t theirs[ESP_NOW_KEY_LEN];
+        bool have_ours = PeerStore::GetLinkKey(device->Mac(), ours);
+        CHECK_EQ(have_ours, device->GetLinkKey(theirs));
+        if (have_ours) {
+            CHECK(std::memcmp(ours, theirs, LINK_KEY_SIZE) == 0);
+            keyed++;
+        }
+    }
+    CHECK_EQ(keyed, MAX_ENCRYPTED_PEERS);
+    CancelPairing();
+}
+
+void testCommandsAfterPairing()
+{
+    // A reliable slot first, so none of the sixteen goes out best-effort
+    for (uint8_t i = 0; i < RESPONDERS; ++i) {
+        const uint8_t* mac = s_devices_[i]->Mac();
+        s_devices_[i]->ClearLog();
+        while (true) {
+            if (!ReserveReliable(mac, MsgType::Command, 1)) {
+                vTaskDelay(1);
+                continue;
+            }
+            if (SendCommandTo(mac, 0, static_cast<uint8_t>(COMMAND_BASE + i), nullptr, 0)) {
+                break;
+            }
+            ReleaseReliable(mac, MsgType::Command, 1);
+            vTaskDelay(1);
+        }
+    }
+    for (int i = 0; i < 300 && s_delivered_ + s_failed_ < RESPONDERS; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK_EQ(s_delivered_.load(), RESPONDERS);
+    CHECK_EQ(s_failed_.load(), 0u);
+
+    for (uint8_t i = 0; i < RESPONDERS; ++i) {
+        sim::Device& device = *s_devices_[i];
+        std::vector<uint8_t> executed = device.Executed();
+        CHECK(executed == std::vector<uint8_t>{ static_cast<uint8_t>(COMMAND_BASE + i) });
+        CHECK_EQ(device.DecryptFailures(), 0u);
+        for (const sim::Received& msg : device.Log()) {
+            if (msg.type == MsgType::Command) {
+                CHECK_EQ(msg.encrypted, device.HasLinkKey());
+            }
+        }
+    }
+}
+
+void testUnackedConfirm()
+{
+    uint8_t mac[6];
+    sim::DeviceMac(RESPONDERS, mac);
+    sim::Device deaf(mac);              // Hears everything, its acks never arrive
+    sim::DeviceMac(RESPONDERS + 1, mac);
+    sim::Device good(mac);
+    deaf.SetLink(sim::Link{ 0.0, 1.0, -50 });
+
+    deaf.SetPairingMode(true);
+    good.SetPairingMode(true);
+    CHECK(StartPairingSweep(WINDOW_MS));
+    PairingSweepResult result{};
+    CHECK(waitSweep(result, WINDOW_MS + 10000));
+
+    CHECK_EQ(result.verified, 2);
+    CHECK_EQ(result.paired, 1);
+    CHECK_EQ(result.failed, 1);
+    CHECK(IsPeerApproved(good.Mac()));
+    CHECK(!IsPeerApproved(deaf.Mac()));
+    CancelPairing();
+}
+
+void testLegacyResponders()
+{
+    // Deployed units: no flags byte at all, or the link-key flag without MAC binding
+    uint8_t mac[6];
+    sim::DeviceOptions bare{};
+    bare.link_key = false;
+    bare.mac_bound_hmac = false;
+    sim::DeviceMac(RESPONDERS + 2, mac);
+    sim::Device old_bare(mac, bare);
+
+    sim::DeviceOptions keyed{};
+    keyed.mac_bound_hmac = false;
+    sim::DeviceMac(RESPONDERS + 3, mac);
+    sim::Device old_keyed(mac, keyed);
+
+    old_bare.SetPairingMode(true);
+    old_keyed.SetPairingMode(true);
+    CHECK(StartPairingSweep(WINDOW_MS));
+    PairingSweepResult result{};
+    CHECK(waitSweep(result, WINDOW_MS + 10000));
+
+    CHECK_EQ(result.verified, 2);
+    CHECK_EQ(result.rejected, 0);
+    CHECK_EQ(result.paired, 2);
+    CHECK(old_bare.IsPaired());
+    CHECK(old_keyed.IsPaired());
+    CHECK(IsPeerApproved(old_bare.Mac()));
+    CHECK(IsPeerApproved(old_keyed.Mac()));
+    CHECK(!old_bare.HasLinkKey());
+    CancelPairing();
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_WARN;
+
+    for (uint8_t i = 0; i < RESPONDERS; ++i) {
+        uint8_t mac[6];
+        sim::DeviceMac(i, mac);
+        sim::DeviceOptions options{};
+        options.name = "Tester" + std::to_string(i);
+        s_devices_.push_back(std::make_unique<sim::Device>(mac, options));
+    }
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    SetDeliveryCallback(onDelivery);
+
+    testSixteenResponders();
+    testCommandsAfterPairing();
+    testUnackedConfirm();
+    testLegacyResponders();
+
+    sim::Exit(host_test::TestResult("test_pairing_sweep"));
+}
@@ -0,0 +1,445 @@
+/**
+ * @file test_peer_store.cpp
+ * @brief Per-peer NVS records and the MAC index over them
+ *
+ * Runs PeerStore on the in-memory NVS. Whole-table blobs as earlier firmware
+ * wrote them ("peers" alone, and "peers" + "peers_ext") must migrate to
+ * per-peer records and be erased; a migration cut short, or one that finds
+ * a corrupt blob, must run again on the next Init. Every AddPeer writes one
+ * record and every RemovePeer erases one, which is checked against what the
+ * old layout rewrote for the same change. The load time and the entries
+ * visited are reported at 4 and 64 peers.
+ *
+ * The index is driven into probe chains with MACs that hash to the same
+ * slot: every member must stay reachable through removals in the middle of
+ * a chain and re-adds, a full table must refuse one more peer, and a peer's
+ * GetPeerSlot must not move while others come and go.
+ */
+
+#include "espnow_peer_store.hpp"
+#include "test_support.hpp"
+
+#include "esp_crc.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+// Layout as the store (and earlier firmware) writes it
+const char* NVS_NAMESPACE = "espnow_peers";
+const char* KEY_PEERS = "peers";
+const char* KEY_CRC = "peers_crc";
+const char* KEY_PEERS_EXT = "peers_ext";
+const char* KEY_EXT_CRC = "peers_ext_crc";
+
+constexpr size_t NVS_ENTRY_SIZE = 32;
+constexpr size_t EXT_PEERS = 6;     ///< Peers in the seeded "peers_ext" blob
+
+SecuritySettings s_sec_;
+
+/// Flash written by an NVS blob: data header + data spans + blob index entry
+size_t blobBytes(size_t len)
+{
+    return NVS_ENTRY_SIZE * (2 + (len + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE);
+}
+
+/// What the whole-table layout wrote for any change to a table of `peers` entries
+size_t wholeTableBytes(size_t peers)
+{
+    size_t bytes = blobBytes(sizeof(ApprovedPeer) * LEGACY_PEER_SLOTS) + NVS_ENTRY_SIZE;   // + CRC
+    if (peers > LEGACY_PEER_SLOTS) {
+        bytes += blobBytes(sizeof(ApprovedPeer) * (peers - LEGACY_PEER_SLOTS)) + NVS_ENTRY_SIZE;
+    }
+    return bytes;
+}
+
+void testMac(size_t n, uint8_t mac[6])
+{
+    const uint8_t base[6] = { 0x24, 0x6F, 0x28, 0x10, 0x00, 0x00 };
+    std::memcpy(mac, base, 6);
+    mac[4] = static_cast<uint8_t>(n >> 8);
+    mac[5] = static_cast<uint8_t>(n);
+}
+
+ApprovedPeer makePeer(size_t n)
+{
+    ApprovedPeer peer{};
+    testMac(n, peer.mac);
+    peer.device_type = static_cast<uint8_t>(DeviceType::FatigueTester);
+    std::snprintf(peer.name, sizeof(peer.name), "tester %u", static_cast<uint16_t>(n));
+    peer.paired_timestamp = static_cast<uint32_t>(1000 + n);
+    peer.valid = true;
+    return peer;
+}
+
+/// Home slot of a MAC in the index (FNV-1a, as PeerStore hashes it)
+size_t indexSlot(const uint8_t mac[6])
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; ++i) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    return h & (PEER_INDEX_SLOTS - 1);
+}
+
+/// Test MAC numbers (from `from` on) of the first `count` MACs whose home slot is `slot`
+std::vector<size_t> collidingMacs(size_t slot, size_t count, size_t from = 0)
+{
+    std::vector<size_t> found;
+    for (size_t n = from; found.size() < count; ++n) {
+        uint8_t mac[6];
+        testMac(n, mac);
+        if (indexSlot(mac) == slot) {
+            found.push_back(n);
+        }
+    }
+    return found;
+}
+
+bool addTestPeer(size_t n)
+{
+    ApprovedPeer peer = makePeer(n);
+    return PeerStore::AddPeer(s_sec_, peer.mac, DeviceType::FatigueTester, peer.name);
+}
+
+bool removeTestPeer(size_t n)
+{
+    uint8_t mac[6];
+    testMac(n, mac);
+    return PeerStore::RemovePeer(s_sec_, mac);
+}
+
+int slotOf(size_t n)
+{
+    uint8_t mac[6];
+    testMac(n, mac);
+    return PeerStore::GetPeerSlot(s_sec_, mac);
+}
+
+void peerKey(const uint8_t mac[6], char out[14])
+{
+    std::snprintf(out, 14, "p%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void writeBlob(nvs_handle_t h, const char* key, const char* crc_key, const ApprovedPeer* peers, size_t count,
+               uint32_t crc_xor = 0)
+{
+    size_t size = sizeof(ApprovedPeer) * count;
+    CHECK(nvs_set_blob(h, key, peers, size) == ESP_OK);
+    CHECK(nvs_set_u32(h, crc_key, esp_crc32_le(0, reinterpret_cast<const uint8_t*>(peers), size) ^ crc_xor) == ESP_OK);
+}
+
+/**
+ * @brief Start from an empty partition holding the blobs of earlier firmware.
+ * @param legacy_valid Valid entries in "peers" (the rest are empty slots)
+ * @param ext_count Entries in "peers_ext", 0 for none
+ * @param ext_crc_xor Non-zero corrupts the "peers_ext" CRC
+ */
+void seedLegacy(size_t legacy_valid, size_t ext_count, uint32_t ext_crc_xor = 0)
+{
+    nvs_flash_erase();
+    nvs_handle_t h;
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK);
+
+    ApprovedPeer legacy[LEGACY_PEER_SLOTS] = {};
+    for (size_t i = 0; i < legacy_valid; ++i) {
+        legacy[i] = makePeer(i);
+    }
+    writeBlob(h, KEY_PEERS, KEY_CRC, legacy, LEGACY_PEER_SLOTS);
+
+    if (ext_count > 0) {
+        ApprovedPeer ext[EXT_PEERS] = {};
+        for (size_t i = 0; i < ext_count; ++i) {
+            ext[i] = makePeer(LEGACY_PEER_SLOTS + i);
+        }
+        writeBlob(h, KEY_PEERS_EXT, KEY_EXT_CRC, ext, ext_count, ext_crc_xor);
+    }
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+bool hasKey(const char* key)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    size_t size = 0;
+    uint32_t value = 0;
+    bool found = nvs_get_blob(h, key, nullptr, &size) == ESP_OK || nvs_get_u32(h, key, &value) == ESP_OK;
+    nvs_close(h);
+    return found;
+}
+
+bool legacyKeysGone()
+{
+    return !hasKey(KEY_PEERS) && !hasKey(KEY_CRC) && !hasKey(KEY_PEERS_EXT) && !hasKey(KEY_EXT_CRC);
+}
+
+/// Every one of peers [0, count) approved with its name and timestamp intact
+void checkPeers(size_t count)
+{
+    CHECK_EQ(PeerStore::GetPeerCount(s_sec_), count);
+    for (size_t i = 0; i < count; ++i) {
+        ApprovedPeer expected = makePeer(i);
+        const ApprovedPeer* peer = PeerStore::GetPeer(s_sec_, expected.mac);
+        CHECK(peer != nullptr);
+        if (peer == nullptr) continue;
+        CHECK(std::strcmp(peer->name, expected.name) == 0);
+        CHECK_EQ(peer->paired_timestamp, expected.paired_timestamp);
+        CHECK_EQ(peer->device_type, expected.device_type);
+    }
+}
+
+void testMigrateV1()
+{
+    // Three peers in the four-slot v1 table, one empty slot; no extension
+    seedLegacy(3, 0);
+    uint32_t written = PeerStore::GetStats().records_written;
+    PeerStore::Init(s_sec_);
+    checkPeers(3);
+    CHECK(legacyKeysGone());
+    CHECK_EQ(PeerStore::GetStats().records_written - written, 3u);
+
+    // Migrated once: the next boot only loads
+    written = PeerStore::GetStats().records_written;
+    PeerStore::Init(s_sec_);
+    checkPeers(3);
+    CHECK_EQ(PeerStore::GetStats().records_written - written, 0u);
+}
+
+void testMigrateV1Ext()
+{
+    seedLegacy(LEGACY_PEER_SLOTS, EXT_PEERS);
+    PeerStore::Init(s_sec_);
+    checkPeers(LEGACY_PEER_SLOTS + EXT_PEERS);
+    CHECK(legacyKeysGone());
+}
+
+void testInterruptedMigration()
+{
+    const size_t total = LEGACY_PEER_SLOTS + EXT_PEERS;
+
+    // Power lost after two records were written but before the blobs were erased
+    seedLegacy(LEGACY_PEER_SLOTS, EXT_PEERS);
+    nvs_handle_t h;
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK);
+    for (size_t i = 0; i < 2; ++i) {
+        ApprovedPeer peer = makePeer(i);
+        char key[14];
+        peerKey(peer.mac, key);
+        CHECK(nvs_set_blob(h, key, &peer, sizeof(peer)) == ESP_OK);
+    }
+    nvs_commit(h);
+    nvs_close(h);
+
+    PeerStore::Init(s_sec_);
+    checkPeers(total);      // No duplicates of the two already written
+    CHECK(legacyKeysGone());
+
+    // A corrupt extension keeps both blobs; nothing is written from them
+    seedLegacy(LEGACY_PEER_SLOTS, EXT_PEERS, 0xDEADBEEF);
+    uint32_t written = PeerStore::GetStats().records_written;
+    PeerStore::Init(s_sec_);
+    CHECK_EQ(PeerStore::GetStats().records_written - written, 0u);
+    CHECK_EQ(PeerStore::GetPeerCount(s_sec_), 0u);
+    CHECK(hasKey(KEY_PEERS));
+    CHECK(hasKey(KEY_PEERS_EXT));
+
+    // ... and the migration runs again on the boot after the blob is good
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK);
+    ApprovedPeer ext[EXT_PEERS] = {};
+    for (size_t i = 0; i < EXT_PEERS; ++i) {
+        ext[i] = makePeer(LEGACY_PEER_SLOTS + i);
+    }
+    writeBlob(h, KEY_PEERS_EXT, KEY_EXT_CRC, ext, EXT_PEERS);
+    nvs_commit(h);
+    nvs_close(h);
+
+    PeerStore::Init(s_sec_);
+    checkPeers(total);
+    CHECK(legacyKeysGone());
+}
+
+void testWriteCost()
+{
+    nvs_flash_erase();
+    PeerStore::Init(s_sec_);
+
+    const size_t record_bytes = blobBytes(sizeof(ApprovedPeer));
+    for (size_t i = 0; i < MAX_APPROVED_PEERS; ++i) {
+        ApprovedPeer peer = makePeer(i);
+        PeerStore::Stats before = PeerStore::GetStats();
+        CHECK(PeerStore::AddPeer(s_sec_, peer.mac, DeviceType::FatigueTester, peer.name));
+        PeerStore::Stats after = PeerStore::GetStats();
+        CHECK_EQ(after.records_written - before.records_written, 1u);
+        CHECK_EQ(after.bytes_written - before.bytes_written, record_bytes);
+        CHECK(record_bytes < wholeTableBytes(i + 1));
+    }
+
+    ApprovedPeer peer = makePeer(MAX_APPROVED_PEERS / 2);
+    PeerStore::Stats before = PeerStore::GetStats();
+    CHECK(PeerStore::RemovePeer(s_sec_, peer.mac));
+    PeerStore::Stats after = PeerStore::GetStats();
+    CHECK_EQ(after.records_erased - before.records_erased, 1u);
+    CHECK_EQ(after.bytes_written - before.bytes_written, 0u);
+
+    // Removing an unknown peer touches nothing
+    CHECK(!PeerStore::RemovePeer(s_sec_, peer.mac));
+    CHECK_EQ(PeerStore::GetStats().records_erased, after.records_erased);
+
+    std::printf("Bytes per AddPeer: %zu (whole-table layout: %zu at 4 peers, %zu at %zu)\n",
+                record_bytes, wholeTableBytes(LEGACY_PEER_SLOTS), wholeTableBytes(MAX_APPROVED_PEERS),
+                MAX_APPROVED_PEERS);
+    std::printf("Bytes per RemovePeer: 0, one entry erased (whole-table layout: %zu at %zu)\n",
+                wholeTableBytes(MAX_APPROVED_PEERS - 1), MAX_APPROVED_PEERS - 1);
+}
+
+void testLoad()
+{
+    for (size_t count : { LEGACY_PEER_SLOTS, MAX_APPROVED_PEERS }) {
+        nvs_flash_erase();
+        PeerStore::Init(s_sec_);
+        for (size_t i = 0; i < count; ++i) {
+            ApprovedPeer peer = makePeer(i);
+            CHECK(PeerStore::AddPeer(s_sec_, peer.mac, DeviceType::FatigueTester, peer.name));
+        }
+
+        PeerStore::Init(s_sec_);
+        PeerStore::Stats stats = PeerStore::GetStats();
+        CHECK_EQ(PeerStore::GetPeerCount(s_sec_), count);
+        CHECK_EQ(stats.load_entries, count);    // One pass, one entry per peer
+        std::printf("Load of %2zu peers: %lu us, %u NVS entries visited\n",
+                    count, static_cast<unsigned long>(stats.load_us), stats.load_entries);
+    }
+}
+
+void testCollisions()
+{
+    nvs_flash_erase();
+    PeerStore::Init(s_sec_);
+
+    // Five MACs with one home slot, then one homed on the slot after it, so
+    // the two chains run into each other
+    std::vector<size_t> chain = collidingMacs(7, 5);
+    std::vector<size_t> next = collidingMacs(8, 1);
+    chain.push_back(next[0]);
+    for (size_t n : chain) {
+        CHECK(addTestPeer(n));
+    }
+    for (size_t n : chain) {
+        CHECK(slotOf(n) >= 0);
+    }
+
+    // A MAC with the same home slot that was never added ends its probe at the gap
+    std::vector<size_t> stranger = collidingMacs(7, 1, chain[4] + 1);
+    CHECK_EQ(slotOf(stranger[0]), -1);
+
+    // Remove from the middle of the chain: everything behind it stays reachable
+    CHECK(removeTestPeer(chain[1]));
+    CHECK_EQ(slotOf(chain[1]), -1);        // Not even from the last-hit cache
+    for (size_t i = 0; i < chain.size(); ++i) {
+        if (i != 1) CHECK(slotOf(chain[i]) >= 0);
+    }
+
+    // Re-add: found again, and in the entry it left
+    CHECK(addTestPeer(chain[1]));
+    CHECK_EQ(slotOf(chain[1]), 1);
+    CHECK_EQ(PeerStore::GetPeerCount(s_sec_), chain.size());
+
+    // Remove the head, the tail and the neighbouring chain's MAC in turn
+    for (size_t i : { size_t{ 0 }, size_t{ 4 }, size_t{ 5 } }) {
+        CHECK(removeTestPeer(chain[i]));
+        CHECK_EQ(slotOf(chain[i]), -1);
+    }
+    for (size_t i : { size_t{ 1 }, size_t{ 2 }, size_t{ 3 } }) {
+        CHECK(slotOf(chain[i]) >= 0);
+    }
+}
+
+void testFullTable()
+{
+    nvs_flash_erase();
+    PeerStore::Init(s_sec_);
+
+    for (size_t i = 0; i < MAX_APPROVED_PEERS; ++i) {
+        CHECK(addTestPeer(i));
+    }
+    CHECK(!addTestPeer(MAX_APPROVED_PEERS));
+    CHECK_EQ(slotOf(MAX_APPROVED_PEERS), -1);
+    CHECK_EQ(PeerStore::GetPeerCount(s_sec_), MAX_APPROVED_PEERS);
+    for (size_t i = 0; i < MAX_APPROVED_PEERS; ++i) {
+        CHECK_EQ(slotOf(i), i);
+    }
+
+    // Renaming a peer needs no free entry
+    ApprovedPeer peer = makePeer(3);
+    CHECK(PeerStore::AddPeer(s_sec_, peer.mac, DeviceType::FatigueTester, "renamed"));
+    CHECK(std::strcmp(PeerStore::GetPeer(s_sec_, peer.mac)->name, "renamed") == 0);
+
+    // One out, one in: the newcomer takes the freed entry
+    CHECK(removeTestPeer(10));
+    CHECK(addTestPeer(MAX_APPROVED_PEERS));
+    CHECK_EQ(slotOf(MAX_APPROVED_PEERS), 10);
+    CHECK(!addTestPeer(10));
+}
+
+void testSlotStability()
+{
+    nvs_flash_erase();
+    PeerStore::Init(s_sec_);
+
+    constexpr size_t COUNT = 16;
+    int slots[COUNT];
+    for (size_t i = 0; i < COUNT; ++i) {
+        CHECK(addTestPeer(i));
+        slots[i] = slotOf(i);
+    }
+
+    // Per-peer state arrays are indexed by slot: nobody else's may move
+    for (size_t i = 0; i < COUNT; i += 3) {
+        CHECK(removeTestPeer(i));
+    }
+    for (size_t i = COUNT; i < COUNT + 4; ++i) {
+        CHECK(addTestPeer(i));
+    }
+    for (size_t i = 0; i < COUNT; ++i) {
+        if (i % 3 == 0) continue;
+        CHECK_EQ(slotOf(i), slots[i]);
+        CHECK_EQ(slotOf(i), slots[i]);     // Again through the last-hit cache
+    }
+
+    // The pre-configured peer has the slot after the table; unknown MACs none.
+    // Last: PeerStore keeps the pre-configured peer across Init calls.
+    ApprovedPeer pre = makePeer(0x0F00);
+    PeerStore::Init(s_sec_, pre.mac, DeviceType::FatigueTester, "bench unit");
+    CHECK_EQ(PeerStore::GetPeerSlot(s_sec_, pre.mac), MAX_APPROVED_PEERS);
+    CHECK_EQ(slotOf(0x0F01), -1);
+    const uint8_t zero[6] = {};
+    CHECK_EQ(PeerStore::GetPeerSlot(s_sec_, zero), -1);
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_ERROR;  // The corrupt-blob case warns on purpose
+
+    testMigrateV1();
+    testMigrateV1Ext();
+    testInterruptedMigration();
+    testWriteCost();
+    testLoad();
+    testCollisions();
+    testFullTable();
+    testSlotStability();
+
+    return host_test::TestResult("test_peer_store");
+}
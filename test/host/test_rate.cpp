@@ -0,0 +1,228 @@
+/**
+ * @file test_rate.cpp
+ * @brief RateControl::Step() over a fake radio whose delivery depends on the rate
+ *
+ * Each window the fake link reports frames, failures and RSSI for the rate
+ * the fake Radio was last set to, and Step() picks the next rate, as
+ * Service() does per peer. Covered: stepping up on clean windows (and only
+ * as far as the RSSI allows), undoing a failed step up with the holdoff
+ * doubling up to RATE_HOLDOFF_MAX_MS_, windows below RATE_MIN_FRAMES_ not
+ * judging delivery, an idle peer dropping only once its RSSI falls past the
+ * hysteresis, and the LR rungs used only for long-range peers.
+ */
+
+#include "espnow_rate.hpp"
+#include "test_support.hpp"
+
+#include <cstdint>
+
+using namespace RateControl;
+
+namespace {
+
+constexpr size_t RATES = static_cast<size_t>(PhyRate::Count);
+
+/// Link the fake radio is on: delivery per rate, RSSI and traffic per window
+struct FakeLink {
+    uint32_t failure_permille[RATES] = {};
+    int8_t   rssi = -60;
+    bool     has_rssi = true;
+    uint32_t frames = 50;
+    bool     long_range = false;
+};
+
+PhyRate  s_radio_rate_ = DEFAULT_RATE_;
+uint32_t s_radio_changes_ = 0;
+
+bool fakeSetRate(const uint8_t mac[6], PhyRate rate)
+{
+    (void)mac;
+    s_radio_rate_ = rate;
+    s_radio_changes_++;
+    return true;
+}
+
+const Radio FAKE_RADIO = { fakeSetRate };
+const uint8_t PEER_MAC[6] = { 0x24, 0x6F, 0x28, 0x00, 0x00, 0x01 };
+
+PeerRate freshPeer()
+{
+    s_radio_rate_ = DEFAULT_RATE_;
+    s_radio_changes_ = 0;
+    return InitialState();
+}
+
+/// One evaluation window at the radio's current rate; applies a change as Service() does
+PhyRate step(PeerRate& state, const FakeLink& link)
+{
+    Window window{};
+    window.elapsed_ms = RATE_EVAL_MS_;
+    window.frames = link.frames;
+    window.failures = link.frames * link.failure_permille[static_cast<size_t>(s_radio_rate_)] / 1000;
+    window.has_rssi = link.has_rssi;
+    window.rssi_avg = link.rssi;
+    window.long_range = link.long_range;
+
+    PhyRate old_rate = state.rate;
+    PhyRate rate = Step(state, window);
+    CHECK(rate == state.rate);
+    if (rate != old_rate) {
+        FAKE_RADIO.set_rate(PEER_MAC, rate);
+    }
+    CHECK(s_radio_rate_ == state.rate);
+    return rate;
+}
+
+void testStepUp()
+{
+    // Clean at every rate: one rung per window, then stay at the top
+    FakeLink link;
+    PeerRate state = freshPeer();
+    CHECK(step(state, link) == PhyRate::Mbps6);
+    CHECK(state.probing);
+    CHECK(step(state, link) == PhyRate::Mbps12);
+    CHECK(step(state, link) == PhyRate::Mbps24);
+    CHECK(step(state, link) == PhyRate::Mbps24);
+    CHECK(!state.probing);
+    CHECK_EQ(s_radio_changes_, 3u);
+
+    // The RSSI caps the climb: -80 dBm supports 6M (-82) but not 12M (-79)
+    link.rssi = -80;
+    state = freshPeer();
+    for (int i = 0; i < 5; ++i) {
+        step(state, link);
+    }
+    CHECK(state.rate == PhyRate::Mbps6);
+    CHECK_EQ(s_radio_changes_, 1u);
+
+    // 97.9 % delivery holds a rate but does not climb
+    link.rssi = -60;
+    link.frames = 1000;
+    link.failure_permille[static_cast<size_t>(PhyRate::Mbps1)] = 21;
+    state = freshPeer();
+    CHECK(step(state, link) == PhyRate::Mbps1);
+    CHECK_EQ(s_radio_changes_, 0u);
+}
+
+void testFailedProbe()
+{
+    // Clean up to 12M, 30 % loss at 24M
+    FakeLink link;
+    link.failure_permille[static_cast<size_t>(PhyRate::Mbps24)] = 300;
+    PeerRate state = freshPeer();
+    step(state, link);
+    step(state, link);
+    CHECK(state.rate == PhyRate::Mbps12);
+
+    // Each failed probe is undone and the wait before the next one doubles
+    uint32_t holdoff_ms = RATE_HOLDOFF_MIN_MS_;
+    for (int probe = 0; probe < 6; ++probe) {
+        CHECK(step(state, link) == PhyRate::Mbps24);
+        CHECK(state.probing);
+        CHECK(step(state, link) == PhyRate::Mbps12);
+        CHECK(!state.probing);
+        CHECK_EQ(state.holdoff_left_ms, holdoff_ms);
+        uint32_t next_ms = holdoff_ms * 2 > RATE_HOLDOFF_MAX_MS_ ? RATE_HOLDOFF_MAX_MS_ : holdoff_ms * 2;
+        CHECK_EQ(state.holdoff_ms, next_ms);
+
+        // No step up until the holdoff has run out
+        for (uint32_t waited = RATE_EVAL_MS_; waited < holdoff_ms; waited += RATE_EVAL_MS_) {
+            CHECK(step(state, link) == PhyRate::Mbps12);
+        }
+        holdoff_ms = next_ms;
+    }
+    CHECK_EQ(holdoff_ms, RATE_HOLDOFF_MAX_MS_);
+
+    // A step up that holds resets the holdoff
+    link.failure_permille[static_cast<size_t>(PhyRate::Mbps24)] = 0;
+    CHECK(step(state, link) == PhyRate::Mbps24);
+    CHECK(step(state, link) == PhyRate::Mbps24);
+    CHECK(!state.probing);
+    CHECK_EQ(state.holdoff_ms, RATE_HOLDOFF_MIN_MS_);
+}
+
+void testMinFrames()
+{
+    // Too few frames: neither total loss nor perfect delivery moves the rate
+    FakeLink link;
+    link.frames = RATE_MIN_FRAMES_ - 1;
+    PeerRate state = freshPeer();
+    state.rate = s_radio_rate_ = PhyRate::Mbps12;
+    CHECK(step(state, link) == PhyRate::Mbps12);
+    link.failure_permille[static_cast<size_t>(PhyRate::Mbps12)] = 1000;
+    CHECK(step(state, link) == PhyRate::Mbps12);
+    CHECK_EQ(s_radio_changes_, 0u);
+
+    // One frame more and the same loss counts
+    link.frames = RATE_MIN_FRAMES_;
+    CHECK(step(state, link) == PhyRate::Mbps6);
+}
+
+void testIdleRssiDrop()
+{
+    FakeLink link;
+    link.frames = 0;
+    PeerRate state = freshPeer();
+    state.rate = s_radio_rate_ = PhyRate::Mbps12;
+    const int8_t floor_rssi = RATE_MIN_RSSI_[static_cast<size_t>(PhyRate::Mbps12)];
+
+    // Inside the hysteresis band, or with no RSSI at all: stay
+    link.rssi = static_cast<int8_t>(floor_rssi - RATE_RSSI_HYSTERESIS_);
+    CHECK(step(state, link) == PhyRate::Mbps12);
+    link.has_rssi = false;
+    link.rssi = -120;
+    CHECK(step(state, link) == PhyRate::Mbps12);
+
+    // Past it: one rung per window, never below the floor
+    link.has_rssi = true;
+    link.rssi = static_cast<int8_t>(floor_rssi - RATE_RSSI_HYSTERESIS_ - 1);
+    CHECK(step(state, link) == PhyRate::Mbps6);
+    link.rssi = -120;
+    CHECK(step(state, link) == PhyRate::Mbps1);
+    CHECK(step(state, link) == PhyRate::Mbps1);
+    CHECK_EQ(s_radio_changes_, 2u);
+}
+
+void testLongRange()
+{
+    // Nothing gets through: a normal peer stays at 1M
+    FakeLink link;
+    for (auto& permille : link.failure_permille) {
+        permille = 1000;
+    }
+    link.rssi = -100;
+    PeerRate state = freshPeer();
+    CHECK(step(state, link) == PhyRate::Mbps1);
+    CHECK(step(state, link) == PhyRate::Mbps1);
+    CHECK_EQ(s_radio_changes_, 0u);
+
+    // A long-range peer goes down to LR 250k
+    link.long_range = true;
+    CHECK(step(state, link) == PhyRate::Lr500k);
+    CHECK(step(state, link) == PhyRate::Lr250k);
+    CHECK(step(state, link) == PhyRate::Lr250k);
+
+    // ... and climbs as far as the RSSI allows once the link recovers
+    link.failure_permille[static_cast<size_t>(PhyRate::Lr250k)] = 0;
+    link.failure_permille[static_cast<size_t>(PhyRate::Lr500k)] = 0;
+    link.rssi = -92;
+    CHECK(step(state, link) == PhyRate::Lr500k);
+    CHECK(step(state, link) == PhyRate::Lr500k);     // -92 dBm is below the 1M floor
+
+    // Losing the capability leaves LR at once, whatever the window says
+    link.long_range = false;
+    link.frames = 0;
+    CHECK(step(state, link) == PhyRate::Mbps1);
+}
+
+} // namespace
+
+int main()
+{
+    testStepUp();
+    testFailedProbe();
+    testMinFrames();
+    testIdleRssiDrop();
+    testLongRange();
+    return host_test::TestResult("test_rate");
+}
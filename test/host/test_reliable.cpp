@@ -0,0 +1,175 @@
+/**
+ * @file test_reliable.cpp
+ * @brief Matching acks to outstanding reliable messages
+ *
+ * Runs the real protocol stack against simulated devices. A peer that echoes
+ * request ids has its acks matched by id only: a late copy of the ack for an
+ * earlier command must not complete a later command that never got through,
+ * which keeps retransmitting until it is reported failed. A legacy peer, whose
+ * acks carry no usable id, still has its ack complete the oldest command.
+ */
+
+#include "espnow_protocol.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr uint8_t CMD_FIRST = 0x31;
+constexpr uint8_t CMD_STOP = 0x32;
+constexpr uint8_t CMD_LEGACY = 0x33;
+
+std::mutex s_reports_mutex_;
+std::vector<DeliveryReport> s_reports_;
+
+void onDelivery(const DeliveryReport& report)
+{
+    std::lock_guard<std::mutex> lock(s_reports_mutex_);
+    s_reports_.push_back(report);
+}
+
+/// Wait for the delivery report of the n-th reliable message (0-based)
+bool waitReport(size_t n, DeliveryReport& out, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 5) {
+        {
+            std::lock_guard<std::mutex> lock(s_reports_mutex_);
+            if (s_reports_.size() > n) {
+                out = s_reports_[n];
+                return true;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return false;
+}
+
+size_t reportCount()
+{
+    std::lock_guard<std::mutex> lock(s_reports_mutex_);
+    return s_reports_.size();
+}
+
+/// Header id and copies the device received of a command
+uint8_t commandId(const sim::Device& device, uint8_t command_id, size_t* copies = nullptr)
+{
+    uint8_t id = 0;
+    size_t n = 0;
+    for (const sim::Received& msg : device.Log()) {
+        if (msg.type == MsgType::Command && !msg.payload.empty() && msg.payload[0] == command_id) {
+            id = msg.id;
+            n++;
+        }
+    }
+    if (copies) {
+        *copies = n;
+    }
+    return id;
+}
+
+void testStaleAckDoesNotCompleteStop(sim::Device& device)
+{
+    // A first command, delivered and acked normally
+    CHECK(SendCommandTo(device.Mac(), 0, CMD_FIRST, nullptr, 0));
+    DeliveryReport first{};
+    CHECK(waitReport(0, first, 1000));
+    CHECK(first.delivered);
+    uint8_t first_id = commandId(device, CMD_FIRST);
+    CHECK_EQ(first.msg_id, first_id);
+
+    // Past the receive dedup window, a late copy of that ack is no longer dropped as a duplicate
+    vTaskDelay(pdMS_TO_TICKS(RX_DEDUP_WINDOW_MS_ + 100));
+
+    // A Stop that never gets acked: the device hears every copy, the controller hears nothing back
+    device.SetCommandAcks(false);
+    uint32_t unmatched_before = GetReliabilityStats().unmatched_acks;
+    CHECK(SendCommandTo(device.Mac(), 0, CMD_STOP, nullptr, 0, TxPriority::Safety));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    CHECK_EQ(reportCount(), 1u);
+
+    CommandAckPayload stale{ CMD_FIRST, COMMAND_RESULT_OK_ };
+    device.SendAck(MsgType::CommandAck, &stale, sizeof(stale), first_id);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    CHECK_EQ(reportCount(), 1u);            // The Stop is still outstanding
+    CHECK_EQ(GetReliabilityStats().unmatched_acks, unmatched_before + 1);
+
+    DeliveryReport stop{};
+    CHECK(waitReport(1, stop, RELIABLE_MAX_DELIVERY_MS_ + 1000));
+    std::printf("stop after a stale ack: %s after %u attempts, %lu ms\n",
+                stop.delivered ? "delivered" : "failed", stop.attempts,
+                static_cast<unsigned long>(stop.latency_ms));
+    CHECK(stop.type == MsgType::Command);
+    CHECK(!stop.delivered);
+    CHECK_EQ(stop.attempts, RELIABLE_MAX_ATTEMPTS_);
+    size_t copies = 0;
+    commandId(device, CMD_STOP, &copies);
+    CHECK_EQ(copies, static_cast<size_t>(RELIABLE_MAX_ATTEMPTS_));
+    device.SetCommandAcks(true);
+}
+
+void testLegacyAckCompletesOldest(sim::Device& legacy)
+{
+    // No id echo to go by: an ack with any id is for the oldest command of its type
+    size_t before = reportCount();
+    legacy.SetCommandAcks(false);
+    CHECK(SendCommandTo(legacy.Mac(), 0, CMD_LEGACY, nullptr, 0));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    uint8_t id = commandId(legacy, CMD_LEGACY);
+
+    CommandAckPayload ack{ CMD_LEGACY, COMMAND_RESULT_OK_ };
+    legacy.SendAck(MsgType::CommandAck, &ack, sizeof(ack), static_cast<uint8_t>(id + 7));
+    DeliveryReport report{};
+    CHECK(waitReport(before, report, 1000));
+    CHECK(report.delivered);
+    CHECK_EQ(report.msg_id, id);
+    legacy.SetCommandAcks(true);
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_ERROR;
+
+    uint8_t mac[6];
+    sim::DeviceMac(0, mac);
+    sim::Device device(mac);
+    sim::DeviceMac(1, mac);
+    sim::DeviceOptions legacy_options{};
+    legacy_options.capability_block = false;
+    sim::Device legacy(mac, legacy_options);
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    SetDeliveryCallback(onDelivery);
+    CHECK(AddApprovedPeer(device.Mac(), DeviceType::FatigueTester, "echo"));
+    CHECK(AddApprovedPeer(legacy.Mac(), DeviceType::FatigueTester, "legacy"));
+
+    device.SendMessage(MsgType::StatusUpdate, nullptr, 0);
+    legacy.SendMessage(MsgType::StatusUpdate, nullptr, 0);
+    PeerCapabilities caps{};
+    for (int i = 0; i < 200 && !GetPeerCapabilities(device.Mac(), caps); ++i) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    CHECK(caps.Has(CAP_RELIABLE_ACK_));
+    CHECK(sim::WaitAirIdle(1000));
+    CHECK(!GetPeerCapabilities(legacy.Mac(), caps));
+
+    testStaleAckDoesNotCompleteStop(device);
+    testLegacyAckCompletesOldest(legacy);
+
+    sim::Exit(host_test::TestResult("test_reliable"));
+}
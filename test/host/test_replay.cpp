@@ -0,0 +1,216 @@
+/**
+ * @file test_replay.cpp
+ * @brief ReplayWindow on 8-bit ids, and its resync when a device restarts
+ *
+ * The window is driven directly through id wrap, reordering inside the
+ * window, duplicates, ids older than the 64-id window and ids 128 and more
+ * behind, which 8 bits cannot tell from ids ahead. Then a simulated device
+ * restarts its ids from 1 well into a session: its DeviceInfo must
+ * restart the controller's window at once, so the fault it reports right
+ * after booting is delivered instead of dropped as a replay.
+ */
+
+#include "espnow_protocol.hpp"
+#include "espnow_replay.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <cstdio>
+
+using namespace espnow;
+
+namespace {
+
+using Verdict = ReplayWindow::Verdict;
+
+/// Accept ids first..last in order
+void feed(ReplayWindow& window, uint32_t first, uint32_t last)
+{
+    int32_t lost = 0;
+    for (uint32_t seq = first; seq <= last; ++seq) {
+        CHECK(window.Check(static_cast<uint8_t>(seq), lost) == Verdict::Accept);
+        CHECK_EQ(lost, 0);
+    }
+}
+
+void testWrap()
+{
+    // Sequence numbers keep counting across every 255 -> 0 wrap of the id
+    ReplayWindow window;
+    feed(window, 0, 600);
+    CHECK_EQ(window.Top(), 600u);
+
+    int32_t lost = 0;
+    CHECK(window.Check(static_cast<uint8_t>(600 - 10), lost) == Verdict::Duplicate);
+    CHECK(window.Check(static_cast<uint8_t>(603), lost) == Verdict::Accept);
+    CHECK_EQ(lost, 2);
+    CHECK_EQ(window.Top(), 603u);
+}
+
+void testReorderAndDuplicate()
+{
+    ReplayWindow window;
+    int32_t lost = 0;
+    CHECK(window.Check(10, lost) == Verdict::Accept);
+    CHECK(window.Check(13, lost) == Verdict::Accept);
+    CHECK_EQ(lost, 2);
+
+    // Late frames fill their gaps, once
+    CHECK(window.Check(12, lost) == Verdict::Accept);
+    CHECK_EQ(lost, -1);
+    CHECK(window.Check(11, lost) == Verdict::Accept);
+    CHECK_EQ(lost, -1);
+    CHECK(window.Check(11, lost) == Verdict::Duplicate);
+    CHECK(window.Check(13, lost) == Verdict::Duplicate);
+    CHECK(window.Check(10, lost) == Verdict::Duplicate);
+    CHECK_EQ(window.Top(), 13u);
+}
+
+void testStaleBeyondWindow()
+{
+    // Gaps left at 1..49 and 51..109
+    ReplayWindow window;
+    int32_t lost = 0;
+    CHECK(window.Check(0, lost) == Verdict::Accept);
+    CHECK(window.Check(50, lost) == Verdict::Accept);
+    CHECK(window.Check(110, lost) == Verdict::Accept);
+
+    // The oldest id still in the window is 63 back; 64 back is out
+    CHECK(window.Check(110 - (ReplayWindow::SIZE_ - 1), lost) == Verdict::Accept);
+    CHECK_EQ(lost, -1);
+    CHECK(window.Check(110 - ReplayWindow::SIZE_, lost) == Verdict::Stale);
+    CHECK(window.Check(1, lost) == Verdict::Stale);
+    CHECK_EQ(window.Top(), 110u);
+}
+
+void testFarBehind()
+{
+    ReplayWindow window;
+    feed(window, 0, 300);
+    int32_t lost = 0;
+
+    // Exactly 128 back is the one id both ways ambiguous: taken as behind
+    CHECK(window.Check(static_cast<uint8_t>(300 - 128), lost) == Verdict::Stale);
+
+    // 129-191 back reads as 65-127 ahead: held back, the window stays put
+    for (uint32_t back = 129; back <= 191; ++back) {
+        CHECK(window.Check(static_cast<uint8_t>(300 - back), lost) == Verdict::Unconfirmed);
+        CHECK_EQ(window.Top(), 300u);
+    }
+    CHECK(window.Check(static_cast<uint8_t>(301), lost) == Verdict::Accept);
+    CHECK_EQ(lost, 0);
+    CHECK_EQ(window.Top(), 301u);
+
+    // 192-255 back reads as at most 64 ahead and cannot be told apart (documented limit)
+    CHECK(window.Check(static_cast<uint8_t>(301 - 200), lost) == Verdict::Accept);
+    CHECK_EQ(window.Top(), 301u + 56);
+}
+
+void testLossBurst()
+{
+    // 99 frames lost: the first one after the burst waits for the next to confirm it
+    ReplayWindow window;
+    feed(window, 0, 10);
+    int32_t lost = 0;
+    CHECK(window.Check(110, lost) == Verdict::Unconfirmed);
+    CHECK_EQ(window.Top(), 10u);
+    CHECK(window.Check(111, lost) == Verdict::Accept);
+    CHECK_EQ(lost, 100);
+    CHECK_EQ(window.Top(), 111u);
+
+    // The held-back frame is still welcome when it is sent again
+    CHECK(window.Check(110, lost) == Verdict::Accept);
+    CHECK_EQ(lost, -1);
+
+    window.Reset();
+    CHECK(!window.IsValid());
+    CHECK(window.Check(3, lost) == Verdict::Accept);
+    CHECK_EQ(window.Top(), 3u);
+}
+
+/// Next event of a type from the device, or false after timeout_ms
+bool waitEvent(QueueHandle_t events, MsgType type, uint32_t timeout_ms, ProtoEvent& out)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 5) {
+        while (xQueueReceive(events, &out, 0) == pdTRUE) {
+            if (out.type == type) {
+                return true;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return false;
+}
+
+void testRestartResyncs(QueueHandle_t events, sim::Device& device)
+{
+    // Well into a session: the window has moved past id 100
+    for (int batch = 0; batch < 10; ++batch) {
+        for (int i = 0; i < 10; ++i) {
+            device.SendMessage(MsgType::StatusUpdate, nullptr, 0);
+        }
+        CHECK(sim::WaitAirIdle(1000));
+    }
+    xQueueReset(events);
+    ReliabilityStats before = GetReliabilityStats();
+
+    // Reboot: DeviceInfo with id 1, then a fault with id 2, both far older than the window
+    device.Restart();
+    uint8_t code = 0x07;
+    device.SendMessage(MsgType::Error, &code, sizeof(code));
+
+    ProtoEvent evt{};
+    CHECK(waitEvent(events, MsgType::Error, 500, evt));
+    CHECK_EQ(evt.sequence_id, 2);
+    ReliabilityStats after = GetReliabilityStats();
+    std::printf("after restart: resyncs %lu, duplicates %lu, stale %lu\n",
+                static_cast<unsigned long>(after.window_resyncs - before.window_resyncs),
+                static_cast<unsigned long>(after.duplicates_dropped - before.duplicates_dropped),
+                static_cast<unsigned long>(after.stale_dropped - before.stale_dropped));
+    CHECK_EQ(after.window_resyncs, before.window_resyncs + 1);
+    CHECK_EQ(after.duplicates_dropped, before.duplicates_dropped);
+    CHECK_EQ(after.stale_dropped, before.stale_dropped);
+
+    // A copy of the fault is still a duplicate in the new window
+    device.SendAck(MsgType::Error, &code, sizeof(code), 2);
+    CHECK(sim::WaitAirIdle(1000));
+    CHECK(!waitEvent(events, MsgType::Error, 100, evt));
+    CHECK_EQ(GetReliabilityStats().duplicates_dropped, after.duplicates_dropped + 1);
+}
+
+} // namespace
+
+int main()
+{
+    testWrap();
+    testReorderAndDuplicate();
+    testStaleBeyondWindow();
+    testFarBehind();
+    testLossBurst();
+
+    sim_log_level = ESP_LOG_ERROR;
+    uint8_t mac[6];
+    sim::DeviceMac(0, mac);
+    sim::Device device(mac);
+
+    QueueHandle_t events = xQueueCreate(64, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    CHECK(AddApprovedPeer(device.Mac(), DeviceType::FatigueTester, "restart"));
+
+    device.SendMessage(MsgType::StatusUpdate, nullptr, 0);
+    PeerCapabilities caps{};
+    for (int i = 0; i < 200 && !GetPeerCapabilities(device.Mac(), caps); ++i) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    CHECK(caps.Has(CAP_RELIABLE_ACK_));
+    CHECK(sim::WaitAirIdle(1000));
+
+    testRestartResyncs(events, device);
+
+    sim::Exit(host_test::TestResult("test_replay"));
+}
@@ -0,0 +1,51 @@
+/**
+ * @file test_support.hpp
+ * @brief Minimal assertion helpers for the host tests
+ *
+ * Each test is a plain executable: CHECK() logs a failure and keeps going,
+ * TestResult() turns the failure count into the process exit code ctest
+ * looks at.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+namespace host_test {
+
+inline int s_failures = 0;
+
+inline void Fail(const char* file, int line, const char* expr) noexcept
+{
+    std::printf("%s:%d: CHECK failed: %s\n", file, line, expr);
+    ++s_failures;
+}
+
+/// Integer comparison that logs both values on mismatch
+template <typename A, typename B>
+inline void CheckEq(const char* file, int line, const char* expr, A a, B b) noexcept
+{
+    if (static_cast<long long>(a) != static_cast<long long>(b)) {
+        std::printf("%s:%d: CHECK failed: %s (%lld vs %lld)\n", file, line, expr,
+                    static_cast<long long>(a), static_cast<long long>(b));
+        ++s_failures;
+    }
+}
+
+/// @return Process exit code: 0 if every CHECK passed
+inline int TestResult(const char* name) noexcept
+{
+    if (s_failures == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", name, s_failures);
+    return 1;
+}
+
+} // namespace host_test
+
+#define CHECK(expr) \
+    do { if (!(expr)) host_test::Fail(__FILE__, __LINE__, #expr); } while (0)
+
+#define CHECK_EQ(a, b) host_test::CheckEq(__FILE__, __LINE__, #a " == " #b, (a), (b))
@@ -0,0 +1,259 @@
+/**
+ * @file test_timesync.cpp
+ * @brief ClockEstimator accuracy over a simulated link with injected delay
+ *
+ * Drives TimeSync::ClockEstimator on a fake clock, with rounds on the same
+ * schedule TimeSync::Service() keeps. The device clock runs from its own
+ * origin with a crystal drift of up to +-40 ppm. Every frame takes a fixed
+ * 0.6 ms plus exponential queueing, with a different mean in each direction,
+ * and 10 % of frames are lost. Device events are then mapped to controller
+ * time and compared with when they really happened, and with stamping them
+ * on arrival. A device reboot must restart the mapping, and it must recover.
+ */
+
+#include "espnow_time.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using TimeSync::ClockEstimator;
+using TimeSync::Exchange;
+
+namespace {
+
+constexpr int64_t  BASE_DELAY_US = 600;
+constexpr int64_t  DEVICE_TURNAROUND_US = 150;
+constexpr int64_t  UI_LOOP_US = 10000;          ///< One exchange per Service() call
+constexpr int64_t  RUN_US = 300LL * 1000000;
+constexpr int64_t  WARMUP_US = 60LL * 1000000;  ///< Errors are measured after this
+constexpr double   LOSS = 0.10;
+constexpr uint32_t SEEDS = 10;                  ///< Independent runs per scenario
+
+struct Scenario {
+    const char* name;
+    double   drift_ppm;
+    double   forward_queue_us;  ///< Mean exponential queueing, controller to device
+    double   reverse_queue_us;
+    uint32_t max_mean_error_us; ///< Stated bounds
+    uint32_t max_error_us;
+    double   max_drift_error_ppm;
+};
+
+/// The device: its clock, and a link to it with injected delay and loss
+class SimPeer {
+public:
+    SimPeer(const Scenario& scenario, uint32_t seed)
+        : scenario_(scenario)
+        , rng_(seed)
+        , forward_(1.0 / scenario.forward_queue_us)
+        , reverse_(1.0 / scenario.reverse_queue_us)
+    {
+    }
+
+    /// Device clock at controller time t
+    int64_t DeviceTime(int64_t t_us) const
+    {
+        return origin_us_ + static_cast<int64_t>(std::llround((t_us - boot_us_) * (1.0 + scenario_.drift_ppm * 1e-6)));
+    }
+
+    /// The device restarts at controller time t: its clock starts over from zero
+    void Reboot(int64_t t_us)
+    {
+        boot_us_ = t_us;
+        origin_us_ = 0;
+    }
+
+    int64_t ForwardDelay() { return BASE_DELAY_US + static_cast<int64_t>(forward_(rng_)); }
+    int64_t ReverseDelay() { return BASE_DELAY_US + static_cast<int64_t>(reverse_(rng_)); }
+    bool Lost() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < LOSS; }
+
+    /// One TimeSync request sent at t1: false if either frame was lost
+    bool Exchange(int64_t t1_us, TimeSync::Exchange& x)
+    {
+        if (Lost() || Lost()) {
+            return false;
+        }
+        int64_t arrive_us = t1_us + ForwardDelay();
+        int64_t reply_us = arrive_us + DEVICE_TURNAROUND_US;
+        x.t1_us = t1_us;
+        x.t2_us = DeviceTime(arrive_us);
+        x.t3_us = DeviceTime(reply_us);
+        x.t4_us = reply_us + ReverseDelay();
+        return true;
+    }
+
+    std::mt19937& Rng() { return rng_; }
+
+private:
+    const Scenario& scenario_;
+    std::mt19937 rng_;
+    std::exponential_distribution<double> forward_;
+    std::exponential_distribution<double> reverse_;
+    int64_t boot_us_ = 0;
+    int64_t origin_us_ = 123456789;     ///< Device booted long before the controller
+};
+
+/**
+ * @brief Rounds as TimeSync::Service() schedules them, from start_us until end_us.
+ * @return Controller time after the last round
+ */
+int64_t runRounds(ClockEstimator& clock, SimPeer& peer, int64_t start_us, int64_t end_us)
+{
+    int64_t t_us = start_us;
+    while (t_us < end_us) {
+        for (uint8_t i = 0; i < TimeSync::BURST_; ++i) {
+            Exchange x{};
+            if (peer.Exchange(t_us, x)) {
+                clock.AddExchange(x);
+            }
+            t_us += UI_LOOP_US;
+        }
+        t_us += static_cast<int64_t>(TimeSync::REPLY_WAIT_MS_) * 1000;
+        clock.EndRound();
+        t_us += static_cast<int64_t>(clock.DriftKnown() ? TimeSync::ROUND_INTERVAL_MS_ : TimeSync::FAST_INTERVAL_MS_) * 1000;
+    }
+    return t_us;
+}
+
+struct Accuracy {
+    double  mean_error_us = 0;
+    int64_t max_error_us = 0;
+    double  drift_error_ppm = 0;
+    int64_t max_arrival_error_us = 0;
+};
+
+Accuracy runAccuracy(const Scenario& scenario, uint32_t seed)
+{
+    SimPeer peer(scenario, seed);
+    ClockEstimator clock;
+    Accuracy result{};
+
+    // Measure between rounds: an event at controller time t, stamped by the device
+    int64_t t_us = runRounds(clock, peer, 0, WARMUP_US);
+    double sum_error = 0;
+    uint32_t samples = 0;
+    while (t_us < RUN_US) {
+        int64_t next_us = runRounds(clock, peer, t_us, t_us + 1);
+        std::uniform_int_distribution<int64_t> when(t_us, next_us);
+        for (int i = 0; i < 20; ++i) {
+            int64_t event_us = when(peer.Rng());
+            int64_t error = std::llabs(clock.ToController(peer.DeviceTime(event_us)) - event_us);
+            sum_error += static_cast<double>(error);
+            result.max_error_us = std::max(result.max_error_us, error);
+            result.max_arrival_error_us = std::max(result.max_arrival_error_us, peer.ReverseDelay());
+            samples++;
+        }
+        t_us = next_us;
+    }
+    result.mean_error_us = sum_error / samples;
+    result.drift_error_ppm = std::fabs(clock.DriftPpb() / 1000.0 - scenario.drift_ppm);
+
+    CHECK(clock.Valid());
+    CHECK_EQ(clock.Resets(), 0u);       // Slow rounds are not mistaken for a reboot
+    CHECK_EQ(clock.Points(), TimeSync::HISTORY_);
+    return result;
+}
+
+void testAccuracy(const Scenario& scenario)
+{
+    Accuracy worst{};
+    for (uint32_t seed = 1; seed <= SEEDS; ++seed) {
+        Accuracy run = runAccuracy(scenario, seed);
+        worst.mean_error_us = std::max(worst.mean_error_us, run.mean_error_us);
+        worst.max_error_us = std::max(worst.max_error_us, run.max_error_us);
+        worst.drift_error_ppm = std::max(worst.drift_error_ppm, run.drift_error_ppm);
+        worst.max_arrival_error_us = std::max(worst.max_arrival_error_us, run.max_arrival_error_us);
+    }
+    std::printf("%-11s drift %+5.1f ppm: error mean <= %6.1f us, max %5lld us; drift off by <= %.2f ppm; "
+                "arrival stamps off by up to %lld us\n",
+                scenario.name, scenario.drift_ppm, worst.mean_error_us,
+                static_cast<long long>(worst.max_error_us), worst.drift_error_ppm,
+                static_cast<long long>(worst.max_arrival_error_us));
+
+    CHECK(worst.mean_error_us <= scenario.max_mean_error_us);
+    CHECK(worst.max_error_us <= static_cast<int64_t>(scenario.max_error_us));
+    CHECK(worst.drift_error_ppm <= scenario.max_drift_error_ppm);
+    CHECK(worst.max_error_us < worst.max_arrival_error_us);
+}
+
+void testRebootDetected()
+{
+    Scenario scenario{ "reboot", -40.0, 1000.0, 500.0, 0, 0, 0.0 };
+    SimPeer peer(scenario, 11);
+    ClockEstimator clock;
+
+    int64_t t_us = runRounds(clock, peer, 0, WARMUP_US);
+    CHECK(clock.Valid());
+    CHECK(clock.DriftKnown());
+    CHECK_EQ(clock.Resets(), 0u);
+
+    // Back from a reboot, the device clock reads from zero again
+    peer.Reboot(t_us);
+    t_us = runRounds(clock, peer, t_us, t_us + 1);
+    CHECK_EQ(clock.Resets(), 1u);
+    CHECK(clock.Valid());
+    CHECK_EQ(clock.Points(), 1);
+    CHECK(!clock.DriftKnown());
+
+    // The old mapping is gone: new events map right as soon as the round is in
+    int64_t error = std::llabs(clock.ToController(peer.DeviceTime(t_us)) - t_us);
+    std::printf("after reboot: error %lld us from the first round\n", static_cast<long long>(error));
+    CHECK(error <= 2000);
+
+    // And the drift is learned again at the fast interval
+    t_us = runRounds(clock, peer, t_us, t_us + WARMUP_US);
+    CHECK_EQ(clock.Resets(), 1u);
+    CHECK(clock.DriftKnown());
+    CHECK(std::fabs(clock.DriftPpb() / 1000.0 - scenario.drift_ppm) <= 5.0);
+}
+
+void testJumpAndBadExchanges()
+{
+    Scenario scenario{ "jump", 25.0, 500.0, 500.0, 0, 0, 0.0 };
+    SimPeer peer(scenario, 13);
+    ClockEstimator clock;
+    int64_t t_us = runRounds(clock, peer, 0, WARMUP_US);
+    uint8_t points = clock.Points();
+
+    // Inconsistent or too slow exchanges are refused and leave the round empty
+    Exchange slow{ t_us, peer.DeviceTime(t_us + 40000), peer.DeviceTime(t_us + 40100),
+                   t_us + TimeSync::MAX_RTT_US_ + 40200 };
+    Exchange reversed{ t_us, peer.DeviceTime(t_us + 1000), peer.DeviceTime(t_us + 900), t_us + 2000 };
+    CHECK(!clock.AddExchange(slow));
+    CHECK(!clock.AddExchange(reversed));
+    CHECK(!clock.EndRound());
+    CHECK_EQ(clock.Points(), points);
+
+    // A device clock that steps forward by more than STEP_RESET_US_ restarts the mapping too
+    int64_t step = static_cast<int64_t>(TimeSync::STEP_RESET_US_) * 3;
+    Exchange jumped{ t_us, peer.DeviceTime(t_us + 700) + step, peer.DeviceTime(t_us + 850) + step, t_us + 1500 };
+    CHECK(clock.AddExchange(jumped));
+    CHECK(clock.EndRound());
+    CHECK_EQ(clock.Resets(), 1u);
+    CHECK_EQ(clock.Points(), 1);
+}
+
+} // namespace
+
+int main()
+{
+    // Stated bounds, worst over SEEDS runs: mapped event times within these of the
+    // truth after a minute of sync, and the final drift estimate
+    const Scenario scenarios[] = {
+        { "low jitter",  0.0,   500.0,   200.0,  150,  400,  2.0 },
+        { "low jitter",  40.0,  500.0,   200.0,  150,  400,  2.0 },
+        { "low jitter",  -40.0, 500.0,   200.0,  150,  400,  2.0 },
+        { "high jitter", 40.0,  10000.0, 2000.0, 1000, 2500, 10.0 },
+        { "high jitter", -40.0, 10000.0, 2000.0, 1000, 2500, 10.0 },
+    };
+    for (const Scenario& scenario : scenarios) {
+        testAccuracy(scenario);
+    }
+    testRebootDetected();
+    testJumpAndBadExchanges();
+
+    return host_test::TestResult("test_timesync");
+}
@@ -0,0 +1,425 @@
+/**
+ * @file test_tx_stress.cpp
+ * @brief Several producer tasks sending through the TX task at once
+ *
+ * Runs the real protocol stack against simulated devices. Checks what the
+ * single TX task promises its producers: every message goes out exactly
+ * once, with header ids that are consecutive per peer; messages of one
+ * producer to one peer keep their order; and a Safety message never waits
+ * behind more than the one message already being sent. A second pass on a
+ * lossy link checks that retransmissions still execute every command once.
+ */
+
+#include "espnow_protocol.hpp"
+#include "sim.hpp"
+#include "sim_device.hpp"
+#include "test_support.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace espnow;
+
+namespace {
+
+constexpr uint8_t  DEVICE_COUNT = 4;
+constexpr uint8_t  COMMAND_BASE = 0x40;         ///< command_id = COMMAND_BASE + producer
+constexpr uint16_t SAFETY_EVERY_MS = 5;
+
+/// Command payload after command_id: who sent it and in what order
+struct Tag {
+    uint8_t  producer;
+    uint8_t  priority;
+    uint16_t seq;
+};
+
+struct Producer {
+    uint8_t    index;
+    TxPriority priority;
+    uint16_t   count;
+    uint32_t   pace_ms;         ///< Pause between messages (0: as fast as the queues take them)
+    std::atomic<bool> done{ false };
+};
+
+/// One frame seen by the TX tap
+struct TxFrame {
+    uint8_t  dst[6];
+    uint8_t  type;
+    uint8_t  id;
+    bool     command;
+    Tag      tag;
+    std::vector<uint8_t> bytes;
+};
+
+std::vector<std::unique_ptr<sim::Device>> s_devices_;
+
+std::mutex s_tap_mutex_;
+std::vector<TxFrame> s_tx_;
+std::atomic<uint32_t> s_tx_count_{ 0 };
+
+/// Safety commands: tap position when SendCommandTo returned
+std::mutex s_safety_mutex_;
+std::map<uint16_t, uint32_t> s_safety_queued_at_;
+
+std::atomic<uint32_t> s_delivered_{ 0 };
+std::atomic<uint32_t> s_failed_{ 0 };
+std::atomic<uint32_t> s_send_completions_{ 0 };
+
+uint64_t macKey(const uint8_t mac[6])
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 6; ++i) {
+        key = (key << 8) | mac[i];
+    }
+    return key;
+}
+
+void onTx(const sim::Frame& frame)
+{
+    TxFrame tx{};
+    std::memcpy(tx.dst, frame.dst, 6);
+    tx.type = frame.data[3];
+    tx.id = frame.data[4];
+    tx.command = tx.type == static_cast<uint8_t>(MsgType::Command);
+    if (tx.command && frame.data.size() >= sizeof(EspNowHeader) + 1 + sizeof(Tag)) {
+        std::memcpy(&tx.tag, frame.data.data() + sizeof(EspNowHeader) + 1, sizeof(Tag));
+    }
+    tx.bytes = frame.data;
+
+    std::lock_guard<std::mutex> lock(s_tap_mutex_);
+    s_tx_.push_back(std::move(tx));
+    s_tx_count_++;
+}
+
+void onDelivery(const DeliveryReport& report)
+{
+    if (report.type != MsgType::Command) {
+        return;
+    }
+    if (report.delivered) {
+        s_delivered_++;
+    } else {
+        s_failed_++;
+    }
+}
+
+void onSendComplete(const SendCompletion& completion)
+{
+    (void)completion;
+    s_send_completions_++;
+}
+
+/// Reserve a reliable slot first, as PeerGroups does, so nothing goes best-effort
+void sendTagged(const Producer& p, uint16_t seq)
+{
+    const uint8_t* mac = s_devices_[seq % DEVICE_COUNT]->Mac();
+    Tag tag{ p.index, static_cast<uint8_t>(p.priority), seq };
+
+    while (true) {
+        if (!ReserveReliable(mac, MsgType::Command, 1)) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (SendCommandTo(mac, 0, static_cast<uint8_t>(COMMAND_BASE + p.index), &tag, sizeof(tag), p.priority)) {
+            break;
+        }
+        ReleaseReliable(mac, MsgType::Command, 1);     // Queue full
+        vTaskDelay(1);
+    }
+
+    if (p.priority == TxPriority::Safety) {
+        std::lock_guard<std::mutex> lock(s_safety_mutex_);
+        s_safety_queued_at_[seq] = s_tx_count_.load();
+    }
+}
+
+void producerTask(void* arg)
+{
+    Producer* p = static_cast<Producer*>(arg);
+    for (uint16_t seq = 0; seq < p->count; ++seq) {
+        sendTagged(*p, seq);
+        if (p->pace_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(p->pace_ms));
+        }
+    }
+    p->done = true;
+    vTaskDelete(nullptr);
+}
+
+void runProducers(std::vector<std::unique_ptr<Producer>>& producers)
+{
+    for (auto& p : producers) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "producer%u", p->index);
+        xTaskCreate(producerTask, name, 4096, p.get(), 5, nullptr);
+    }
+    for (auto& p : producers) {
+        while (!p->done) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+    }
+}
+
+bool waitFor(uint32_t expected, const std::atomic<uint32_t>& a, const std::atomic<uint32_t>& b, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        if (a + b >= expected) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return a + b >= expected;
+}
+
+uint32_t totalCommands(const std::vector<std::unique_ptr<Producer>>& producers)
+{
+    uint32_t total = 0;
+    for (const auto& p : producers) {
+        total += p->count;
+    }
+    return total;
+}
+
+std::vector<std::unique_ptr<Producer>> makeProducers(uint16_t count, uint32_t pace_ms)
+{
+    std::vector<std::unique_ptr<Producer>> producers;
+    const TxPriority priorities[] = { TxPriority::Control, TxPriority::Control, TxPriority::Polling,
+                                      TxPriority::Bulk, TxPriority::Safety };
+    for (TxPriority priority : priorities) {
+        auto p = std::make_unique<Producer>();
+        p->index = static_cast<uint8_t>(producers.size());
+        p->priority = priority;
+        p->count = (priority == TxPriority::Safety) ? count / 8 : count;
+        p->pace_ms = (priority == TxPriority::Safety) ? SAFETY_EVERY_MS : pace_ms;
+        producers.push_back(std::move(p));
+    }
+    return producers;
+}
+
+/// Every command (producer, seq) ran exactly once on the device it was sent to
+void checkExactlyOnce(const std::vector<std::unique_ptr<Producer>>& producers)
+{
+    for (const auto& p : producers) {
+        for (uint8_t d = 0; d < DEVICE_COUNT; ++d) {
+            std::set<uint16_t> seen;
+            uint32_t executed = 0;
+            for (const auto& msg : s_devices_[d]->Log()) {
+                if (msg.type != MsgType::Command || msg.duplicate || msg.payload[0] != COMMAND_BASE + p->index) {
+                    continue;
+                }
+                Tag tag{};
+                std::memcpy(&tag, msg.payload.data() + 1, sizeof(tag));
+                CHECK(seen.insert(tag.seq).second);
+                CHECK_EQ(tag.seq % DEVICE_COUNT, d);
+                executed++;
+            }
+            uint32_t expected = p->count / DEVICE_COUNT + ((p->count % DEVICE_COUNT) > d ? 1 : 0);
+            CHECK_EQ(executed, expected);
+        }
+    }
+}
+
+// ============================================================================
+// Pass 1: clean link
+// ============================================================================
+
+void testOrderingAndUniqueness()
+{
+    auto producers = makeProducers(400, 0);
+    uint32_t total = totalCommands(producers);
+    runProducers(producers);
+    CHECK(waitFor(total, s_delivered_, s_failed_, 10000));
+    CHECK(sim::WaitAirIdle(2000));
+    CHECK_EQ(s_delivered_.load(), total);
+    CHECK_EQ(s_failed_.load(), 0);
+    CHECK_EQ(GetReliabilityStats().untracked_sends, 0);
+
+    std::vector<TxFrame> tx;
+    {
+        std::lock_guard<std::mutex> lock(s_tap_mutex_);
+        tx = s_tx_;
+    }
+
+    // Header ids: consecutive per peer; a repeat is a retransmission of identical bytes
+    std::map<uint64_t, uint8_t> last_id;
+    std::map<std::pair<uint64_t, uint8_t>, std::vector<uint8_t>> frames_by_id;
+    std::vector<bool> fresh(tx.size(), false);
+    uint32_t retransmissions = 0;
+    for (size_t i = 0; i < tx.size(); ++i) {
+        uint64_t dst = macKey(tx[i].dst);
+        auto key = std::make_pair(dst, tx[i].id);
+        auto seen = frames_by_id.find(key);
+        if (seen != frames_by_id.end() && seen->second == tx[i].bytes) {
+            retransmissions++;
+            continue;
+        }
+        fresh[i] = true;
+        auto last = last_id.find(dst);
+        if (last != last_id.end()) {
+            CHECK_EQ(tx[i].id, static_cast<uint8_t>(last->second + 1));
+        }
+        last_id[dst] = tx[i].id;
+        frames_by_id[key] = tx[i].bytes;
+    }
+
+    // One producer's commands to one peer leave, and run, in the order they were queued
+    std::map<std::pair<uint8_t, uint8_t>, int32_t> last_seq;
+    uint32_t commands = 0;
+    for (size_t i = 0; i < tx.size(); ++i) {
+        if (!fresh[i] || !tx[i].command) {
+            continue;
+        }
+        commands++;
+        auto key = std::make_pair(tx[i].tag.producer, tx[i].dst[5]);
+        auto last = last_seq.find(key);
+        if (last != last_seq.end()) {
+            CHECK_EQ(tx[i].tag.seq, last->second + DEVICE_COUNT);
+        }
+        last_seq[key] = tx[i].tag.seq;
+    }
+    CHECK_EQ(commands, total);
+
+    for (const auto& p : producers) {
+        for (uint8_t d = 0; d < DEVICE_COUNT; ++d) {
+            int32_t expected = d;
+            for (const auto& msg : s_devices_[d]->Log()) {
+                if (msg.type != MsgType::Command || msg.duplicate || msg.payload[0] != COMMAND_BASE + p->index) {
+                    continue;
+                }
+                Tag tag{};
+                std::memcpy(&tag, msg.payload.data() + 1, sizeof(tag));
+                CHECK_EQ(tag.seq, expected);
+                expected += DEVICE_COUNT;
+            }
+        }
+    }
+    checkExactlyOnce(producers);
+
+    // A Safety message waits behind at most the one message already being sent
+    std::map<uint16_t, uint32_t> queued_at;
+    {
+        std::lock_guard<std::mutex> lock(s_safety_mutex_);
+        queued_at = s_safety_queued_at_;
+    }
+    uint32_t worst = 0;
+    for (size_t i = 0; i < tx.size(); ++i) {
+        if (!fresh[i] || !tx[i].command || tx[i].tag.priority != static_cast<uint8_t>(TxPriority::Safety)) {
+            continue;
+        }
+        auto q = queued_at.find(tx[i].tag.seq);
+        if (q == queued_at.end()) {
+            CHECK(false);
+            continue;
+        }
+        uint32_t ahead = 0;
+        for (size_t j = q->second; j < i; ++j) {
+            bool safety = tx[j].command && tx[j].tag.priority == static_cast<uint8_t>(TxPriority::Safety);
+            if (fresh[j] && !safety) {
+                ahead++;
+            }
+        }
+        CHECK(ahead <= 1);
+        worst = (ahead > worst) ? ahead : worst;
+    }
+    std::printf("clean: %u commands, %zu frames, %u retransmissions, Safety waited behind <= %u\n",
+                static_cast<unsigned>(total), tx.size(), static_cast<unsigned>(retransmissions),
+                static_cast<unsigned>(worst));
+}
+
+// ============================================================================
+// Pass 2: lossy link
+// ============================================================================
+
+void testLossyExactlyOnce()
+{
+    for (auto& device : s_devices_) {
+        device->ClearLog();
+        sim::Link link{};
+        link.loss = 0.03;
+        link.ack_loss = 0.02;
+        device->SetLink(link);
+    }
+    s_delivered_ = 0;
+    s_failed_ = 0;
+    uint32_t retransmitted_before = GetReliabilityStats().retransmissions;
+
+    // Paced as real command traffic is, so a retransmission chain spans far
+    // fewer ids to a peer than the device's replay window: at full stress rate
+    // a fourth retransmission can arrive older than the window and be dropped
+    auto producers = makeProducers(160, 5);
+    uint32_t total = totalCommands(producers);
+    runProducers(producers);
+    CHECK(waitFor(total, s_delivered_, s_failed_, 30000));
+    CHECK(sim::WaitAirIdle(2000));
+
+    // Every message is reported once, and with 6 attempts at 3% loss all get through
+    CHECK_EQ(s_delivered_ + s_failed_, total);
+    CHECK_EQ(s_failed_.load(), 0);
+    CHECK(GetReliabilityStats().retransmissions > retransmitted_before);
+    checkExactlyOnce(producers);
+
+    uint32_t duplicates = 0;
+    for (auto& device : s_devices_) {
+        for (const auto& msg : device->Log()) {
+            duplicates += msg.duplicate ? 1 : 0;
+        }
+    }
+    std::printf("lossy: %u commands, %u retransmissions, %u duplicate copies acked but not run\n",
+                static_cast<unsigned>(total),
+                static_cast<unsigned>(GetReliabilityStats().retransmissions - retransmitted_before),
+                static_cast<unsigned>(duplicates));
+}
+
+} // namespace
+
+int main()
+{
+    sim_log_level = ESP_LOG_WARN;
+
+    sim::DeviceOptions options{};
+    options.features = CAP_RELIABLE_ACK_;     // No CAP_AGGREGATION_: one message per frame
+    for (uint8_t i = 0; i < DEVICE_COUNT; ++i) {
+        uint8_t mac[6];
+        sim::DeviceMac(i, mac);
+        s_devices_.push_back(std::make_unique<sim::Device>(mac, options));
+    }
+
+    QueueHandle_t events = xQueueCreate(32, sizeof(ProtoEvent));
+    CHECK(Init(events));
+    SetDeliveryCallback(onDelivery);
+    SetSendCompleteCallback(onSendComplete);
+    for (auto& device : s_devices_) {
+        CHECK(AddApprovedPeer(device->Mac(), DeviceType::FatigueTester, "stress"));
+    }
+
+    // Capability exchange first, so only the producers' traffic is measured
+    for (auto& device : s_devices_) {
+        device->SendMessage(MsgType::StatusUpdate, nullptr, 0);
+    }
+    for (auto& device : s_devices_) {
+        PeerCapabilities caps{};
+        for (int i = 0; i < 200 && !GetPeerCapabilities(device->Mac(), caps); ++i) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        CHECK(caps.valid);
+    }
+    CHECK(sim::WaitAirIdle(1000));
+    sim::SetTxTap(onTx);
+
+    testOrderingAndUniqueness();
+    sim::SetTxTap(nullptr);
+    testLossyExactlyOnce();
+
+    CHECK(s_send_completions_.load() > 0);
+    sim::Exit(host_test::TestResult("test_tx_stress"));
+}